@@ -0,0 +1,498 @@
+/*
+ * ray_bench.c - Benchmark del render sin runtime de BennuGD
+ * Carga un .raymap con el FPG sintético de ray_bench_runtime.c, renderiza
+ * en un GRAPH en memoria y recorre un camino de cámara fijo por tramos:
+ * giros completos en celdas libres, los niveles superiores, puertas
+ * abriéndose y una zona con muchos sprites. Al final muestra FPS y, por
+ * tramo y por fase del frame (RAY_GET_STATS), media y percentiles.
+ *
+ * La física avanza exactamente un paso por frame, así que dos ejecuciones
+ * con los mismos parámetros dibujan los mismos frames.
+ *
+ * Compilación: cmake -DRAY_BUILD_BENCH=ON
+ * Uso:
+ *   ray_bench [-m mapa] [-w ancho] [-h alto] [-s strip] [-t hilos]
+ *             [-f frames por tramo] [-n sprites] [-b MB de chunks] [--spans] [--fog]
+ *             [-o frames.csv]
+ */
+
+#include "ray_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+extern RAY_Engine g_engine;
+
+#define RAY_BENCH_WARMUP 10           /* Frames sin medir (texturas, arena, RLE) */
+#define RAY_BENCH_STOPS 8             /* Celdas donde la cámara da una vuelta */
+#define RAY_BENCH_MAX_DOORS 8
+#define RAY_BENCH_MAX_SECTIONS 8
+
+typedef struct {
+    const char *map;
+    int width, height;
+    int strip_width;
+    int threads;
+    int frames;                      /* Por tramo */
+    int sprites;
+    int spans;
+    int fog;
+    int chunk_budget;                /* MB para chunks, 0 = por defecto */
+    const char *csv;
+} RAY_BenchOptions;
+
+typedef struct {
+    const char *name;
+    int first, last;                 /* Frames [first, last) */
+} RAY_BenchSection;
+
+typedef struct {
+    float *stats;                    /* RAY_STAT_COUNT por frame */
+    double *wall_ms;                 /* RAY_RENDER completo visto desde fuera */
+    int count, capacity;
+    RAY_BenchSection sections[RAY_BENCH_MAX_SECTIONS];
+    int num_sections;
+    int *open_cells;                 /* Celdas vacías del nivel 0 */
+    int num_open;
+} RAY_Bench;
+
+static const char *g_stat_names[RAY_STAT_COUNT] = {
+    "frame_ms", "physics_ms", "sky_ms", "strips_ms", "raycast_ms", "floor_ms",
+    "walls_ms", "sprites_ms", "minimap_ms", "hits_avg", "hits_max", "pixels",
+    "texture_samples", "sprites_drawn", "sprites_culled", "thin_wall_tests",
+    "sort_comparisons", "arena_bytes", "chunks_ms", "chunk_loads", "chunks_resident"
+};
+
+static RAY_Bench g_bench;
+
+/* ============================================================================
+   LLAMADAS AL MÓDULO
+   Se usan las mismas funciones que llamaría un PRG.
+   ============================================================================ */
+
+static void ray_bench_float(int64_t *param, float value)
+{
+    *param = 0;
+    *(float*)param = value;
+}
+
+static void ray_bench_camera(float x, float y, float z, float rot)
+{
+    int64_t params[5];
+    ray_bench_float(&params[0], x);
+    ray_bench_float(&params[1], y);
+    ray_bench_float(&params[2], z);
+    ray_bench_float(&params[3], rot);
+    ray_bench_float(&params[4], 0.0f);
+    libmod_ray_set_camera(NULL, params);
+}
+
+/* Renderiza un frame y guarda sus estadísticas (record = 0: calentamiento) */
+static int ray_bench_frame(int record)
+{
+    /* Con el contador a 0 ray_physics_advance simula un único paso */
+    g_engine.physicsCounter = 0;
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    libmod_ray_render(NULL, NULL);
+    double ms = ray_stats_ms(SDL_GetPerformanceCounter() - start);
+    if (!record) return 1;
+
+    RAY_Bench *bench = &g_bench;
+    if (bench->count == bench->capacity) {
+        int capacity = bench->capacity ? bench->capacity * 2 : 1024;
+        float *stats = (float*)realloc(bench->stats, (size_t)capacity * RAY_STAT_COUNT * sizeof(float));
+        if (!stats) return 0;
+        bench->stats = stats;
+        double *wall_ms = (double*)realloc(bench->wall_ms, (size_t)capacity * sizeof(double));
+        if (!wall_ms) return 0;
+        bench->wall_ms = wall_ms;
+        bench->capacity = capacity;
+    }
+
+    memcpy(bench->stats + (size_t)bench->count * RAY_STAT_COUNT,
+           g_engine.stats.last, RAY_STAT_COUNT * sizeof(float));
+    bench->wall_ms[bench->count++] = ms;
+    return 1;
+}
+
+static void ray_bench_section_begin(const char *name)
+{
+    RAY_BenchSection *section = &g_bench.sections[g_bench.num_sections];
+    section->name = name;
+    section->first = g_bench.count;
+}
+
+static void ray_bench_section_end(void)
+{
+    RAY_BenchSection *section = &g_bench.sections[g_bench.num_sections];
+    section->last = g_bench.count;
+    if (section->last > section->first) g_bench.num_sections++;
+}
+
+/* ============================================================================
+   CAMINO DE CÁMARA
+   ============================================================================ */
+
+static float ray_bench_cell_x(int cell)
+{
+    return (cell % g_engine.raycaster.gridWidth + 0.5f) * RAY_TILE_SIZE;
+}
+
+static float ray_bench_cell_y(int cell)
+{
+    return (cell / g_engine.raycaster.gridWidth + 0.5f) * RAY_TILE_SIZE;
+}
+
+/* Celdas libres del nivel 0, chunk a chunk: en un mapa por chunks la
+ * cámara pasa por cada uno para que se cargue antes de mirarlo (un mapa
+ * normal es un único chunk y sale fila a fila) */
+static int ray_bench_find_open_cells(void)
+{
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    RAY_World *world = &g_engine.world;
+    int cells = rc->gridWidth * rc->gridHeight;
+    int size = 1 << world->shift;
+
+    g_bench.open_cells = (int*)malloc((size_t)cells * sizeof(int));
+    if (!g_bench.open_cells) return 0;
+
+    g_bench.num_open = 0;
+    for (int cy = 0; cy < world->chunksY; cy++) {
+        for (int cx = 0; cx < world->chunksX; cx++) {
+            if (!world->chunks[cy * world->chunksX + cx].resident) {
+                g_engine.camera.x = (cx * size + size / 2) * (float)RAY_TILE_SIZE;
+                g_engine.camera.y = (cy * size + size / 2) * (float)RAY_TILE_SIZE;
+                ray_world_update();
+            }
+            for (int y = cy * size; y < (cy + 1) * size && y < rc->gridHeight; y++) {
+                for (int x = cx * size; x < (cx + 1) * size && x < rc->gridWidth; x++) {
+                    if (ray_world_wall(world, 0, x, y) == 0) {
+                        g_bench.open_cells[g_bench.num_open++] = x + y * rc->gridWidth;
+                    }
+                }
+            }
+        }
+    }
+    return g_bench.num_open > 0;
+}
+
+/* 'stops' celdas libres repartidas por el mapa, una vuelta completa en cada
+ * una a la altura z */
+static int ray_bench_spin(int stops, int frames, float z)
+{
+    int per_stop = frames / stops > 0 ? frames / stops : 1;
+
+    for (int s = 0; s < stops; s++) {
+        int cell = g_bench.open_cells[(int)((long long)s * g_bench.num_open / stops)];
+        for (int f = 0; f < per_stop; f++) {
+            float rot = RAY_TWO_PI * f / per_stop;
+            ray_bench_camera(ray_bench_cell_x(cell), ray_bench_cell_y(cell), z, rot);
+            if (!ray_bench_frame(1)) return 0;
+        }
+    }
+    return 1;
+}
+
+/* Cámara en una celda libre junto a cada puerta, mirándola mientras se abre */
+static int ray_bench_doors(int frames)
+{
+    RAY_DoorTable *table = &g_engine.doorTable;
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    static const int dx[4] = { 1, -1, 0, 0 };
+    static const int dy[4] = { 0, 0, 1, -1 };
+
+    int doors = table->count < RAY_BENCH_MAX_DOORS ? table->count : RAY_BENCH_MAX_DOORS;
+    if (doors == 0) return 1;
+    int per_door = frames / doors > 0 ? frames / doors : 1;
+
+    for (int d = 0; d < doors; d++) {
+        RAY_Door *door = &table->doors[d];
+        int door_x = door->cell % rc->gridWidth;
+        int door_y = door->cell / rc->gridWidth;
+
+        for (int n = 0; n < 4; n++) {
+            int x = door_x + dx[n];
+            int y = door_y + dy[n];
+            if (x < 0 || y < 0 || x >= rc->gridWidth || y >= rc->gridHeight) continue;
+            if (ray_world_wall(&g_engine.world, 0, x, y) != 0) continue;
+
+            /* El eje Y del mundo va al revés que el ángulo */
+            float rot = atan2f((float)dy[n], (float)-dx[n]);
+            if (door->state == 0) ray_door_toggle(door);
+
+            for (int f = 0; f < per_door; f++) {
+                ray_bench_camera((x + 0.5f) * RAY_TILE_SIZE, (y + 0.5f) * RAY_TILE_SIZE, 0.0f, rot);
+                if (!ray_bench_frame(1)) return 0;
+            }
+            break;
+        }
+    }
+    return 1;
+}
+
+/* Muchos sprites repartidos por celdas libres (generador fijo) */
+static int ray_bench_sprites(int count, int frames)
+{
+    int64_t *handles = (int64_t*)malloc((size_t)count * sizeof(int64_t));
+    if (!handles) return 0;
+
+    uint32_t seed = 12345;
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        int cell = g_bench.open_cells[(seed >> 8) % (uint32_t)g_bench.num_open];
+        seed = seed * 1664525u + 1013904223u;
+        float ox = ((seed >> 8) & 0xFF) / 255.0f - 0.5f;
+        float oy = ((seed >> 16) & 0xFF) / 255.0f - 0.5f;
+
+        int64_t params[6];
+        ray_bench_float(&params[0], ray_bench_cell_x(cell) + ox * RAY_TILE_SIZE * 0.8f);
+        ray_bench_float(&params[1], ray_bench_cell_y(cell) + oy * RAY_TILE_SIZE * 0.8f);
+        ray_bench_float(&params[2], 0.0f);
+        params[3] = RAY_BENCH_SPRITE_GRAPH + i % 8;
+        params[4] = RAY_TILE_SIZE / 2;
+        params[5] = RAY_TILE_SIZE / 2;
+        handles[added] = libmod_ray_add_sprite(NULL, params);
+        if (handles[added] >= 0) added++;
+    }
+
+    int ok = ray_bench_spin(RAY_BENCH_STOPS / 2, frames, 0.0f);
+
+    for (int i = 0; i < added; i++) {
+        int64_t params[1] = { handles[i] };
+        libmod_ray_remove_sprite(NULL, params);
+    }
+    free(handles);
+    return ok;
+}
+
+/* ============================================================================
+   INFORME
+   ============================================================================ */
+
+static int ray_bench_compare(const void *a, const void *b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    double mean, p50, p95, p99, max;
+} RAY_BenchSummary;
+
+/* 'values' se ordena in situ; percentil por rango más cercano */
+static RAY_BenchSummary ray_bench_summarize(double *values, int count)
+{
+    RAY_BenchSummary s;
+    memset(&s, 0, sizeof(s));
+    if (count <= 0) return s;
+
+    qsort(values, count, sizeof(double), ray_bench_compare);
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += values[i];
+
+    s.mean = sum / count;
+    s.p50 = values[(count - 1) * 50 / 100];
+    s.p95 = values[(count - 1) * 95 / 100];
+    s.p99 = values[(count - 1) * 99 / 100];
+    s.max = values[count - 1];
+    return s;
+}
+
+static void ray_bench_report(void)
+{
+    RAY_Bench *bench = &g_bench;
+    double *values = (double*)malloc((size_t)bench->count * sizeof(double));
+    if (!values) return;
+
+    printf("\n%-10s %7s %9s %9s %9s %9s %9s %9s\n",
+           "tramo", "frames", "fps", "media ms", "p50", "p95", "p99", "max");
+    for (int s = 0; s <= bench->num_sections; s++) {
+        /* La última fila es el total */
+        int first = s < bench->num_sections ? bench->sections[s].first : 0;
+        int last = s < bench->num_sections ? bench->sections[s].last : bench->count;
+        const char *name = s < bench->num_sections ? bench->sections[s].name : "total";
+        int count = last - first;
+        if (count <= 0) continue;
+
+        memcpy(values, bench->wall_ms + first, (size_t)count * sizeof(double));
+        RAY_BenchSummary sum = ray_bench_summarize(values, count);
+        printf("%-10s %7d %9.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+               name, count, sum.mean > 0.0 ? 1000.0 / sum.mean : 0.0,
+               sum.mean, sum.p50, sum.p95, sum.p99, sum.max);
+    }
+
+    printf("\n%-18s %12s %12s %12s %12s %12s\n", "fase / contador", "media", "p50", "p95", "p99", "max");
+    for (int stat = 0; stat < RAY_STAT_COUNT; stat++) {
+        for (int i = 0; i < bench->count; i++) {
+            values[i] = bench->stats[(size_t)i * RAY_STAT_COUNT + stat];
+        }
+        RAY_BenchSummary sum = ray_bench_summarize(values, bench->count);
+        printf("%-18s %12.3f %12.3f %12.3f %12.3f %12.3f\n",
+               g_stat_names[stat], sum.mean, sum.p50, sum.p95, sum.p99, sum.max);
+    }
+    free(values);
+}
+
+static void ray_bench_write_csv(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "RAY_BENCH: No se pudo abrir %s\n", path);
+        return;
+    }
+
+    fprintf(f, "frame,tramo,wall_ms");
+    for (int stat = 0; stat < RAY_STAT_COUNT; stat++) fprintf(f, ",%s", g_stat_names[stat]);
+    fprintf(f, "\n");
+
+    for (int s = 0; s < g_bench.num_sections; s++) {
+        const RAY_BenchSection *section = &g_bench.sections[s];
+        for (int i = section->first; i < section->last; i++) {
+            fprintf(f, "%d,%s,%.4f", i, section->name, g_bench.wall_ms[i]);
+            for (int stat = 0; stat < RAY_STAT_COUNT; stat++) {
+                fprintf(f, ",%g", g_bench.stats[(size_t)i * RAY_STAT_COUNT + stat]);
+            }
+            fprintf(f, "\n");
+        }
+    }
+    fclose(f);
+    printf("RAY_BENCH: Frames guardados en %s\n", path);
+}
+
+/* ============================================================================
+   PROGRAMA
+   ============================================================================ */
+
+static int ray_bench_parse(int argc, char **argv, RAY_BenchOptions *opt)
+{
+    opt->map = "test.raymap";
+    opt->width = 1280;
+    opt->height = 720;
+    opt->strip_width = 1;
+    opt->threads = 0;
+    opt->frames = 240;
+    opt->sprites = 256;
+    opt->spans = 0;
+    opt->fog = 0;
+    opt->chunk_budget = 0;
+    opt->csv = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--spans") == 0) { opt->spans = 1; continue; }
+        if (strcmp(arg, "--fog") == 0) { opt->fog = 1; continue; }
+        if (!value) return 0;
+
+        if (strcmp(arg, "-m") == 0) opt->map = value;
+        else if (strcmp(arg, "-w") == 0) opt->width = atoi(value);
+        else if (strcmp(arg, "-h") == 0) opt->height = atoi(value);
+        else if (strcmp(arg, "-s") == 0) opt->strip_width = atoi(value);
+        else if (strcmp(arg, "-t") == 0) opt->threads = atoi(value);
+        else if (strcmp(arg, "-f") == 0) opt->frames = atoi(value);
+        else if (strcmp(arg, "-n") == 0) opt->sprites = atoi(value);
+        else if (strcmp(arg, "-b") == 0) opt->chunk_budget = atoi(value);
+        else if (strcmp(arg, "-o") == 0) opt->csv = value;
+        else return 0;
+        i++;
+    }
+
+    return opt->width > 0 && opt->height > 0 && opt->strip_width > 0 &&
+           opt->frames >= RAY_BENCH_STOPS && opt->sprites >= 0 && opt->chunk_budget >= 0 &&
+           opt->sprites <= RAY_MAX_SPRITES;
+}
+
+int main(int argc, char **argv)
+{
+    RAY_BenchOptions opt;
+    if (!ray_bench_parse(argc, argv, &opt)) {
+        fprintf(stderr, "Uso: %s [-m mapa] [-w ancho] [-h alto] [-s strip] [-t hilos]\n"
+                        "       [-f frames por tramo] [-n sprites] [-b MB de chunks] [--spans] [--fog]\n"
+                        "       [-o frames.csv]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (!ray_bench_runtime_init()) return 1;
+
+    int64_t params[6];
+    params[0] = opt.width;
+    params[1] = opt.height;
+    params[2] = 60;
+    params[3] = opt.strip_width;
+    if (!libmod_ray_init(NULL, params)) return 1;
+
+    params[0] = opt.threads;
+    int threads = (int)libmod_ray_set_threads(NULL, params);
+    params[0] = opt.spans ? RAY_FLOOR_MODE_SPANS : RAY_FLOOR_MODE_COLUMNS;
+    libmod_ray_set_floor_mode(NULL, params);
+    if (opt.fog) {
+        params[0] = 1;
+        params[1] = 150;
+        params[2] = 150;
+        params[3] = 180;
+        ray_bench_float(&params[4], RAY_TILE_SIZE * 4.0f);
+        ray_bench_float(&params[5], RAY_TILE_SIZE * 12.0f);
+        libmod_ray_set_fog(NULL, params);
+    }
+    if (opt.chunk_budget > 0) {
+        params[0] = opt.chunk_budget;
+        libmod_ray_set_chunk_budget(NULL, params);
+    }
+
+    params[0] = ray_bench_string(opt.map);
+    params[1] = RAY_BENCH_FPG;
+    if (!libmod_ray_load_map(NULL, params) || !ray_bench_find_open_cells()) {
+        fprintf(stderr, "RAY_BENCH: No se pudo cargar %s o no tiene celdas libres\n", opt.map);
+        libmod_ray_shutdown(NULL, NULL);
+        ray_bench_runtime_free();
+        return 1;
+    }
+
+    printf("RAY_BENCH: %s, %dx%d, strip %d, %d hilos, suelo por %s%s, %d frames por tramo\n",
+           opt.map, opt.width, opt.height, opt.strip_width, threads,
+           opt.spans ? "filas" : "columnas", opt.fog ? ", fog" : "", opt.frames);
+
+    int ok = 1;
+    ray_bench_camera(ray_bench_cell_x(g_bench.open_cells[0]), ray_bench_cell_y(g_bench.open_cells[0]), 0.0f, 0.0f);
+    for (int i = 0; i < RAY_BENCH_WARMUP && ok; i++) {
+        ok = ray_bench_frame(0);
+    }
+
+    ray_bench_section_begin("paredes");
+    ok = ok && ray_bench_spin(RAY_BENCH_STOPS, opt.frames, 0.0f);
+    ray_bench_section_end();
+
+    ray_bench_section_begin("niveles");
+    for (int level = 1; level < g_engine.raycaster.gridCount && ok; level++) {
+        ok = ray_bench_spin(RAY_BENCH_STOPS, opt.frames / (g_engine.raycaster.gridCount - 1),
+                            (float)(level * RAY_TILE_SIZE));
+    }
+    ray_bench_section_end();
+
+    ray_bench_section_begin("puertas");
+    ok = ok && ray_bench_doors(opt.frames);
+    ray_bench_section_end();
+
+    ray_bench_section_begin("sprites");
+    ok = ok && ray_bench_sprites(opt.sprites, opt.frames);
+    ray_bench_section_end();
+
+    if (!ok) fprintf(stderr, "RAY_BENCH: Sin memoria para las estadísticas\n");
+
+    ray_bench_report();
+    if (opt.csv) ray_bench_write_csv(opt.csv);
+
+    libmod_ray_shutdown(NULL, NULL);
+    ray_bench_runtime_free();
+    free(g_bench.stats);
+    free(g_bench.wall_ms);
+    free(g_bench.open_cells);
+    return ok ? 0 : 1;
+}
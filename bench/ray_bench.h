@@ -0,0 +1,20 @@
+/*
+ * ray_bench.h - Benchmark del render sin runtime de BennuGD
+ * Interfaz entre el programa (ray_bench.c) y el sustituto del runtime
+ * (ray_bench_runtime.c).
+ */
+
+#ifndef __RAY_BENCH_H
+#define __RAY_BENCH_H
+
+#include "libmod_ray.h"
+
+#define RAY_BENCH_FPG 1               /* ID del FPG sintético */
+#define RAY_BENCH_SPRITE_GRAPH 900    /* Graphs desde aquí: sprites con transparencia */
+
+/* Runtime */
+int ray_bench_runtime_init(void);
+void ray_bench_runtime_free(void);
+int64_t ray_bench_string(const char *text);
+
+#endif /* __RAY_BENCH_H */
@@ -0,0 +1,188 @@
+/*
+ * ray_bench_runtime.c - Sustituto del runtime de BennuGD para ray_bench
+ * Implementa las pocas funciones de bgdrtm y libbggfx que usa el módulo,
+ * sin ventana ni renderer: los GRAPH son superficies SDL en memoria y el
+ * FPG es un juego de texturas sintéticas que se generan la primera vez
+ * que se piden. Así el benchmark corre en una máquina sin display.
+ */
+
+#include "ray_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#define RAY_BENCH_MAX_STRINGS 16
+
+SDL_PixelFormat *gPixelFormat = NULL;
+
+static GRAPH *g_graphs[RAY_MAX_TEXTURES];
+static GRLIB g_fpg;
+static const char *g_strings[RAY_BENCH_MAX_STRINGS];
+static int g_num_strings = 0;
+
+/* ============================================================================
+   GRAPHS EN MEMORIA
+   ============================================================================ */
+
+GRAPH *bitmap_new_syslib(int64_t w, int64_t h)
+{
+    GRAPH *graph = (GRAPH*)calloc(1, sizeof(GRAPH));
+    if (!graph) return NULL;
+
+    graph->surface = SDL_CreateRGBSurfaceWithFormat(0, (int)w, (int)h, 32, gPixelFormat->format);
+    if (!graph->surface) {
+        fprintf(stderr, "RAY_BENCH: No se pudo crear una superficie %dx%d: %s\n",
+                (int)w, (int)h, SDL_GetError());
+        free(graph);
+        return NULL;
+    }
+    graph->width = w;
+    graph->height = h;
+    return graph;
+}
+
+void bitmap_destroy(GRAPH *graph)
+{
+    if (!graph) return;
+    SDL_FreeSurface(graph->surface);
+    free(graph);
+}
+
+int64_t gr_get_pixel(GRAPH *graph, int64_t x, int64_t y)
+{
+    if (!graph || x < 0 || y < 0 || x >= graph->width || y >= graph->height) return 0;
+    SDL_Surface *surface = graph->surface;
+    return ((const uint32_t*)surface->pixels)[y * (surface->pitch / 4) + x];
+}
+
+void gr_put_pixel(GRAPH *graph, int64_t x, int64_t y, int64_t color)
+{
+    if (!graph || x < 0 || y < 0 || x >= graph->width || y >= graph->height) return;
+    SDL_Surface *surface = graph->surface;
+    ((uint32_t*)surface->pixels)[y * (surface->pitch / 4) + x] = (uint32_t)color;
+}
+
+void gr_clear_as(GRAPH *graph, int64_t color)
+{
+    if (!graph) return;
+    SDL_FillRect(graph->surface, NULL, (uint32_t)color);
+}
+
+/* ============================================================================
+   FPG SINTÉTICO
+   Ladrillos de 32x16 con un color por graph y algo de ruido; los graphs
+   desde RAY_BENCH_SPRITE_GRAPH son un disco sobre fondo transparente (0)
+   para que los sprites tengan tramos opacos y huecos como uno real.
+   ============================================================================ */
+
+static uint32_t ray_bench_hash(uint32_t v)
+{
+    v ^= v >> 16;
+    v *= 0x7FEB352Du;
+    v ^= v >> 15;
+    v *= 0x846CA68Bu;
+    v ^= v >> 16;
+    return v;
+}
+
+static GRAPH *ray_bench_make_graph(int code)
+{
+    GRAPH *graph = bitmap_new_syslib(RAY_TEXTURE_SIZE, RAY_TEXTURE_SIZE);
+    if (!graph) return NULL;
+    graph->code = code;
+
+    uint32_t base = ray_bench_hash((uint32_t)code);
+    int radius = RAY_TEXTURE_SIZE / 2 - 4;
+
+    for (int y = 0; y < RAY_TEXTURE_SIZE; y++) {
+        for (int x = 0; x < RAY_TEXTURE_SIZE; x++) {
+            uint32_t pixel = 0;
+
+            int dx = x - RAY_TEXTURE_SIZE / 2;
+            int dy = y - RAY_TEXTURE_SIZE / 2;
+            if (code < RAY_BENCH_SPRITE_GRAPH || dx * dx + dy * dy <= radius * radius) {
+                int brick_x = (x + ((y / 16) & 1) * 16) % 32;
+                int mortar = (y % 16) == 0 || brick_x == 0;
+                uint32_t noise = ray_bench_hash((uint32_t)(x + y * RAY_TEXTURE_SIZE) ^ base) & 0x1F;
+
+                uint8_t r = mortar ? 96 : (uint8_t)(((base >> 16) & 0x9F) + noise);
+                uint8_t g = mortar ? 96 : (uint8_t)(((base >> 8) & 0x9F) + noise);
+                uint8_t b = mortar ? 96 : (uint8_t)((base & 0x9F) + noise);
+                pixel = SDL_MapRGBA(gPixelFormat, r, g, b, 255);
+            }
+            gr_put_pixel(graph, x, y, pixel);
+        }
+    }
+    return graph;
+}
+
+GRAPH *bitmap_get(int64_t libid, int64_t code)
+{
+    if (libid != RAY_BENCH_FPG || code <= 0 || code >= RAY_MAX_TEXTURES) return NULL;
+    if (!g_graphs[code]) {
+        g_graphs[code] = ray_bench_make_graph((int)code);
+    }
+    return g_graphs[code];
+}
+
+GRLIB *grlib_get(int64_t libid)
+{
+    return libid == RAY_BENCH_FPG ? &g_fpg : NULL;
+}
+
+/* ============================================================================
+   PROCESOS Y CADENAS
+   ============================================================================ */
+
+/* El benchmark no tiene procesos: los sprites usan siempre su textureID */
+GRAPH *instance_graph(INSTANCE *instance)
+{
+    (void)instance;
+    return NULL;
+}
+
+/* Cadena para pasar como parámetro STRING a una función del módulo */
+int64_t ray_bench_string(const char *text)
+{
+    if (g_num_strings >= RAY_BENCH_MAX_STRINGS) return -1;
+    g_strings[g_num_strings] = text;
+    return g_num_strings++;
+}
+
+const char *string_get(int64_t code)
+{
+    return (code >= 0 && code < g_num_strings) ? g_strings[code] : "";
+}
+
+void string_discard(int64_t code)
+{
+    (void)code;
+}
+
+/* ============================================================================
+   INICIO Y FIN
+   ============================================================================ */
+
+int ray_bench_runtime_init(void)
+{
+    gPixelFormat = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
+    if (!gPixelFormat) {
+        fprintf(stderr, "RAY_BENCH: SDL_AllocFormat: %s\n", SDL_GetError());
+        return 0;
+    }
+    memset(g_graphs, 0, sizeof(g_graphs));
+    return 1;
+}
+
+void ray_bench_runtime_free(void)
+{
+    for (int i = 0; i < RAY_MAX_TEXTURES; i++) {
+        bitmap_destroy(g_graphs[i]);
+        g_graphs[i] = NULL;
+    }
+    if (gPixelFormat) {
+        SDL_FreeFormat(gPixelFormat);
+        gPixelFormat = NULL;
+    }
+}
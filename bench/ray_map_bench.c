@@ -0,0 +1,308 @@
+/*
+ * ray_map_bench.c - Benchmark de carga de mapas .raymap v7
+ * Amplía un mapa en mosaico hasta N x N celdas (1024 por defecto), lo
+ * escribe con los grids en raw, RLE y deflate y mide, para cada archivo,
+ * la carga (ray_load_map_from_file) y la carga más una lectura de todas
+ * las celdas empaquetadas. Los grids de origen se sueltan al empaquetar,
+ * así que el mapa de entrada se reconstruye desde sus RAY_Cell. Los tres
+ * archivos deben dar la misma suma de control. Un cuarto archivo guarda el
+ * mapa por chunks: su carga solo descomprime los chunks de alrededor de la
+ * cámara y no tiene un mapa entero que leer.
+ *
+ * Los archivos se acaban de escribir, así que están en la caché de páginas
+ * del sistema: mide la CPU de la carga, no el disco.
+ *
+ * Compilación: cmake -DRAY_BUILD_BENCH=ON
+ * Uso:
+ *   ray_map_bench [-m mapa] [-s celdas por lado] [-n cargas] [-d directorio]
+ */
+
+#include "ray_bench.h"
+#define RAY_MAPFILE_WRITER
+#include "libmod_ray_mapfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+extern RAY_Engine g_engine;
+
+#define RAY_MAP_BENCH_CODECS 4
+#define RAY_MAP_BENCH_GRIDS 6            /* Paredes, altura, Z-offset, suelo, techo, altura de suelo */
+
+typedef struct {
+    const char *map;
+    int size;
+    int loads;
+    const char *dir;
+} RAY_MapBenchOptions;
+
+typedef struct {
+    const char *name;
+    uint32_t codec;
+    int chunked;                         /* Grids por chunks */
+    char path[512];
+    long bytes;
+    double load_ms;                      /* Mejor carga */
+    double touch_ms;                     /* Mejor carga + lectura de todas las celdas */
+    double load_sum;
+    uint32_t checksum;
+} RAY_MapBenchCodec;
+
+static RAY_MapBenchCodec g_codecs[RAY_MAP_BENCH_CODECS] = {
+    { "raw", RAY_MAPFILE_CODEC_RAW },
+    { "rle", RAY_MAPFILE_CODEC_RLE },
+    { "deflate", RAY_MAPFILE_CODEC_DEFLATE },
+#ifdef RAY_HAVE_ZLIB
+    { "chunks", RAY_MAPFILE_CODEC_DEFLATE, 1 }
+#else
+    { "chunks", RAY_MAPFILE_CODEC_RLE, 1 }
+#endif
+};
+
+/* ============================================================================
+   MAPA AMPLIADO
+   ============================================================================ */
+
+/* Copia 'src' (w x h) en mosaico sobre un grid size x size */
+static uint32_t *ray_map_bench_tile(const void *src, int w, int h, int size)
+{
+    uint32_t *dst = (uint32_t*)malloc((size_t)size * size * 4);
+    if (!dst) return NULL;
+
+    const uint32_t *cells = (const uint32_t*)src;
+    for (int y = 0; y < size; y++) {
+        const uint32_t *row = cells + (size_t)(y % h) * w;
+        for (int x = 0; x < size; x++) {
+            dst[(size_t)y * size + x] = row[x % w];
+        }
+    }
+    return dst;
+}
+
+/* Grid 'g' (orden de las secciones) del nivel 'level', sacado de las
+ * celdas empaquetadas del mapa cargado */
+static uint32_t *ray_map_bench_unpack(int g, int level)
+{
+    const RAY_World *world = &g_engine.world;
+    const RAY_Chunk *chunk = &world->chunks[0];
+    uint32_t *grid = (uint32_t*)malloc((size_t)chunk->numCells * 4);
+    if (!grid) return NULL;
+
+    for (int i = 0; i < chunk->numCells; i++) {
+        const RAY_Cell *cell = ray_chunk_levels(world, chunk, i) + level;
+        int id = 0;
+        float value = 0.0f;
+        switch (g) {
+            case 0: id = cell->wall; break;
+            case 1: value = ray_cell_height(cell); break;
+            case 2: value = ray_cell_z_offset(cell); break;
+            case 3: id = cell->floor; break;
+            case 4: id = cell->ceiling; break;
+            default: value = ray_cell_floor_height(cell); break;
+        }
+        if (g == 0 || g == 3 || g == 4) memcpy(&grid[i], &id, 4);
+        else memcpy(&grid[i], &value, 4);
+    }
+    return grid;
+}
+
+/* Escribe el mapa cargado, ampliado, con un archivo por codec */
+static int ray_map_bench_write(const RAY_MapBenchOptions *opt)
+{
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    int w = rc->gridWidth, h = rc->gridHeight, size = opt->size;
+    int levels = rc->gridCount;
+    uint64_t bytes = (uint64_t)size * size * 4;
+
+    if (g_engine.world.streaming) {
+        fprintf(stderr, "RAY_BENCH: El mapa de entrada no puede estar guardado por chunks\n");
+        return 0;
+    }
+
+    /* Grids de origen por tipo de sección y nivel */
+    uint32_t *grids[RAY_MAP_BENCH_GRIDS][3];
+    memset(grids, 0, sizeof(grids));
+    for (int level = 0; level < 3; level++) {
+        for (int g = 0; g < RAY_MAP_BENCH_GRIDS; g++) {
+            if (g < 3 && level >= levels) continue;
+            uint32_t *src = ray_map_bench_unpack(g, level);
+            if (src) grids[g][level] = ray_map_bench_tile(src, w, h, size);
+            free(src);
+        }
+    }
+
+    int ok = 1;
+    for (int c = 0; c < RAY_MAP_BENCH_CODECS && ok; c++) {
+        RAY_MapBenchCodec *codec = &g_codecs[c];
+        RAY_MapFileWriter writer;
+        if (!ray_mapfile_writer_init(&writer, size, size, levels, codec->codec)) {
+            printf("RAY_BENCH: Codec %s no disponible (sin RAY_HAVE_ZLIB)\n", codec->name);
+            continue;
+        }
+        writer.header.flags = RAY_MAPFILE_FLAG_CAMERA;
+        writer.header.camera_x = g_engine.camera.x;
+        writer.header.camera_y = g_engine.camera.y;
+        writer.header.camera_z = g_engine.camera.z;
+        writer.header.camera_rot = g_engine.camera.rot;
+        writer.header.camera_pitch = g_engine.camera.pitch;
+
+        if (codec->chunked) {
+            /* Planos en el orden del bloque: paredes, altura y Z-offset por
+             * nivel y después suelo, techo y altura de suelo */
+            const void *planes[RAY_MAPFILE_CHUNK_PLANES(3)] = { NULL };
+            for (int level = 0; level < levels; level++) {
+                for (int g = 0; g < 3; g++) planes[3 * level + g] = grids[g][level];
+            }
+            for (int level = 0; level < 3; level++) {
+                for (int g = 3; g < RAY_MAP_BENCH_GRIDS; g++) {
+                    planes[3 * levels + 3 * level + g - 3] = grids[g][level];
+                }
+            }
+            ok = ray_mapfile_writer_add_chunks(&writer, planes);
+        }
+        for (int level = 0; level < 3 && !codec->chunked; level++) {
+            for (int g = 0; g < RAY_MAP_BENCH_GRIDS; g++) {
+                if (!grids[g][level]) continue;
+                ray_mapfile_writer_add(&writer, RAY_SECTION_GRID + g, level, grids[g][level],
+                                       bytes, (uint32_t)size * size);
+            }
+        }
+
+        snprintf(codec->path, sizeof(codec->path), "%s/ray_map_bench_%s.raymap", opt->dir, codec->name);
+        ok = ok && ray_mapfile_writer_save(&writer, codec->path);
+        ray_mapfile_writer_free(&writer);
+        if (!ok) {
+            fprintf(stderr, "RAY_BENCH: No se pudo escribir %s\n", codec->path);
+            break;
+        }
+
+        FILE *f = fopen(codec->path, "rb");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            codec->bytes = ftell(f);
+            fclose(f);
+        }
+    }
+
+    for (int g = 0; g < RAY_MAP_BENCH_GRIDS; g++) {
+        for (int level = 0; level < 3; level++) free(grids[g][level]);
+    }
+    return ok;
+}
+
+/* ============================================================================
+   CARGA
+   ============================================================================ */
+
+static uint32_t ray_map_bench_sum(const void *grid, size_t cells, uint32_t sum)
+{
+    const uint32_t *words = (const uint32_t*)grid;
+    if (!grid) return sum;
+    for (size_t i = 0; i < cells; i++) {
+        sum = (sum ^ words[i]) * 16777619u;
+    }
+    return sum;
+}
+
+/* Lee todas las celdas empaquetadas del mapa cargado */
+static uint32_t ray_map_bench_touch(void)
+{
+    const RAY_World *world = &g_engine.world;
+    const RAY_Chunk *chunk = &world->chunks[0];
+    size_t words = (size_t)chunk->numCells * world->levels * sizeof(RAY_Cell) / 4;
+    return ray_map_bench_sum(chunk->cells, words, 2166136261u);
+}
+
+static int ray_map_bench_load(RAY_MapBenchCodec *codec, int loads)
+{
+    codec->load_ms = codec->touch_ms = 1e30;
+    codec->load_sum = 0.0;
+
+    for (int i = 0; i < loads; i++) {
+        uint64_t start = SDL_GetPerformanceCounter();
+        if (!ray_load_map_from_file(codec->path, RAY_BENCH_FPG)) return 0;
+        uint64_t loaded = SDL_GetPerformanceCounter();
+        if (!codec->chunked) codec->checksum = ray_map_bench_touch();
+        uint64_t touched = SDL_GetPerformanceCounter();
+        libmod_ray_free_map(NULL, NULL);
+
+        double load_ms = ray_stats_ms(loaded - start);
+        double touch_ms = ray_stats_ms(touched - start);
+        codec->load_sum += load_ms;
+        if (load_ms < codec->load_ms) codec->load_ms = load_ms;
+        if (touch_ms < codec->touch_ms) codec->touch_ms = touch_ms;
+    }
+    return 1;
+}
+
+/* ============================================================================
+   PROGRAMA
+   ============================================================================ */
+
+static int ray_map_bench_parse(int argc, char **argv, RAY_MapBenchOptions *opt)
+{
+    opt->map = "test.raymap";
+    opt->size = 1024;
+    opt->loads = 10;
+    opt->dir = ".";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *arg = argv[i];
+        const char *value = argv[i + 1];
+
+        if (strcmp(arg, "-m") == 0) opt->map = value;
+        else if (strcmp(arg, "-s") == 0) opt->size = atoi(value);
+        else if (strcmp(arg, "-n") == 0) opt->loads = atoi(value);
+        else if (strcmp(arg, "-d") == 0) opt->dir = value;
+        else return 0;
+    }
+    return argc % 2 == 1 && opt->size > 0 && opt->loads > 0;
+}
+
+int main(int argc, char **argv)
+{
+    RAY_MapBenchOptions opt;
+    if (!ray_map_bench_parse(argc, argv, &opt)) {
+        fprintf(stderr, "Uso: %s [-m mapa] [-s celdas por lado] [-n cargas] [-d directorio]\n", argv[0]);
+        return 1;
+    }
+
+    if (!ray_bench_runtime_init()) return 1;
+
+    int64_t params[4] = { 320, 200, 60, 1 };
+    if (!libmod_ray_init(NULL, params)) return 1;
+
+    params[0] = ray_bench_string(opt.map);
+    params[1] = RAY_BENCH_FPG;
+    int ok = libmod_ray_load_map(NULL, params);
+    if (!ok) fprintf(stderr, "RAY_BENCH: No se pudo cargar %s\n", opt.map);
+
+    ok = ok && ray_map_bench_write(&opt);
+    libmod_ray_free_map(NULL, NULL);
+
+    for (int c = 0; c < RAY_MAP_BENCH_CODECS && ok; c++) {
+        if (g_codecs[c].bytes == 0) continue;
+        ok = ray_map_bench_load(&g_codecs[c], opt.loads);
+        if (!ok) fprintf(stderr, "RAY_BENCH: No se pudo cargar %s\n", g_codecs[c].path);
+    }
+
+    if (ok) {
+        printf("\nRAY_BENCH: %s ampliado a %dx%d, %d cargas por codec\n",
+               opt.map, opt.size, opt.size, opt.loads);
+        printf("%-8s %12s %8s %12s %12s %16s %10s\n",
+               "codec", "bytes", "ratio", "carga ms", "media ms", "carga+lectura", "checksum");
+        for (int c = 0; c < RAY_MAP_BENCH_CODECS; c++) {
+            const RAY_MapBenchCodec *codec = &g_codecs[c];
+            if (codec->bytes == 0) continue;
+            printf("%-8s %12ld %8.3f %12.3f %12.3f %16.3f %10s\n",
+                   codec->name, codec->bytes, (double)codec->bytes / g_codecs[0].bytes,
+                   codec->load_ms, codec->load_sum / opt.loads, codec->touch_ms,
+                   codec->chunked ? "-" : codec->checksum == g_codecs[0].checksum ? "igual" : "DISTINTO");
+        }
+    }
+
+    libmod_ray_shutdown(NULL, NULL);
+    ray_bench_runtime_free();
+    return ok ? 0 : 1;
+}
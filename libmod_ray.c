@@ -5,10 +5,12 @@
  */
 
 #include "libmod_ray.h"
+#include "libmod_ray_trace.h"
 #include <stdlib.h>
 #include <float.h>
 #include <string.h>
 #include <stdio.h>
+#include <SDL2/SDL.h>
 
 /* ============================================================================
    ESTADO GLOBAL DEL MOTOR
@@ -59,26 +61,46 @@ int64_t libmod_ray_init(INSTANCE *my, int64_t *params) {
     g_engine.rayCount = screen_w / strip_width;
     g_engine.viewDist = ray_screen_distance((float)screen_w, g_engine.fovRadians);
     
-    /* Precalcular ángulos de strips */
+    /* Precalcular ángulos de strips y su trigonometría */
     g_engine.stripAngles = (float*)malloc(g_engine.rayCount * sizeof(float));
-    if (!g_engine.stripAngles) {
+    g_engine.stripTrig = (RAY_StripTrig*)malloc(g_engine.rayCount * sizeof(RAY_StripTrig));
+    if (!g_engine.stripAngles || !g_engine.stripTrig) {
         fprintf(stderr, "RAY: Error al asignar memoria para stripAngles\n");
+        free(g_engine.stripAngles);
+        free(g_engine.stripTrig);
+        g_engine.stripAngles = NULL;
+        g_engine.stripTrig = NULL;
         return 0;
     }
     
     for (int strip = 0; strip < g_engine.rayCount; strip++) {
         float screenX = (g_engine.rayCount / 2 - strip) * strip_width;
-        g_engine.stripAngles[strip] = ray_strip_angle(screenX, g_engine.viewDist);
+        float angle = ray_strip_angle(screenX, g_engine.viewDist);
+        g_engine.stripAngles[strip] = angle;
+        g_engine.stripTrig[strip].cosAngle = cosf(angle);
+        g_engine.stripTrig[strip].sinAngle = sinf(angle);
+        g_engine.stripTrig[strip].invCos = 1.0f / cosf(angle);
+    }
+    
+    /* Reservar memoria del frame una sola vez (crece solo si hace falta) */
+    if (!ray_arena_init(&g_engine.frameArena, ray_arena_frame_bytes(g_engine.rayCount, RAY_MAX_SPRITES))) {
+        free(g_engine.stripAngles);
+        free(g_engine.stripTrig);
+        g_engine.stripAngles = NULL;
+        g_engine.stripTrig = NULL;
+        return 0;
     }
     
+    /* Pool de hilos del render: uno por CPU por defecto (RAY_SET_THREADS) */
+    ray_threads_init(0);
+    
     /* Inicializar cámara */
     memset(&g_engine.camera, 0, sizeof(RAY_Camera));
     g_engine.camera.moveSpeed = RAY_TILE_SIZE / 16.0f;
     g_engine.camera.rotSpeed = 1.5f * M_PI / 180.0f;
     
     /* Inicializar arrays dinámicos */
-    g_engine.sprites_capacity = RAY_MAX_SPRITES;
-    g_engine.sprites = (RAY_Sprite*)calloc(g_engine.sprites_capacity, sizeof(RAY_Sprite));
+    ray_sprite_store_init(RAY_MAX_SPRITES);
     
     g_engine.thin_walls_capacity = RAY_MAX_THIN_WALLS;
     g_engine.thinWalls = (RAY_ThinWall**)calloc(g_engine.thin_walls_capacity, sizeof(RAY_ThinWall*));
@@ -95,6 +117,7 @@ int64_t libmod_ray_init(INSTANCE *my, int64_t *params) {
     g_engine.drawMiniMap = 1;
     g_engine.drawTexturedFloor = 1;
     g_engine.drawCeiling = 1;
+    g_engine.floorMode = RAY_FLOOR_MODE_COLUMNS;
     g_engine.drawWalls = 1;
     g_engine.drawWeapon = 1;
     g_engine.fogOn = 0;
@@ -110,6 +133,7 @@ int64_t libmod_ray_init(INSTANCE *my, int64_t *params) {
     g_engine.fog_b = 180;
     g_engine.fog_start_distance = RAY_TILE_SIZE * 8;  /* 8 baldosas */
     g_engine.fog_end_distance = RAY_TILE_SIZE * 20;   /* 20 baldosas */
+    ray_fog_init();
     
     /* Minimapa - Configuración por defecto */
     g_engine.minimap_size = 200;
@@ -135,17 +159,31 @@ int64_t libmod_ray_shutdown(INSTANCE *my, int64_t *params) {
         return 0;
     }
     
+    /* Parar los hilos del render */
+    ray_threads_shutdown();
+    
+    /* Volcar las trazas (solo con RAY_ENABLE_TRACE) */
+    ray_trace_dump(RAY_TRACE_FILE);
+    
     /* Liberar stripAngles */
     if (g_engine.stripAngles) {
         free(g_engine.stripAngles);
         g_engine.stripAngles = NULL;
     }
+    if (g_engine.stripTrig) {
+        free(g_engine.stripTrig);
+        g_engine.stripTrig = NULL;
+    }
+    
+    /* Liberar frame arena */
+    printf("RAY: Frame arena - pico %zu bytes de %zu reservados (%d ampliaciones)\n",
+           g_engine.frameArena.high_water, g_engine.frameArena.capacity,
+           g_engine.frameArena.grow_count);
+    ray_arena_free(&g_engine.frameArena);
     
     /* Liberar sprites */
-    if (g_engine.sprites) {
-        free(g_engine.sprites);
-        g_engine.sprites = NULL;
-    }
+    ray_sprite_store_free();
+    ray_sprite_rle_cache_free();
     
     /* Liberar thin walls */
     if (g_engine.thinWalls) {
@@ -164,35 +202,17 @@ int64_t libmod_ray_shutdown(INSTANCE *my, int64_t *params) {
         free(g_engine.thickWalls);
         g_engine.thickWalls = NULL;
     }
+    ray_thin_wall_grid_free();
+    ray_minimap_free();
     
-    /* Liberar grids */
-    if (g_engine.raycaster.grids) {
-        for (int i = 0; i < g_engine.raycaster.gridCount; i++) {
-            if (g_engine.raycaster.grids[i]) {
-                free(g_engine.raycaster.grids[i]);
-            }
-        }
-        free(g_engine.raycaster.grids);
-        g_engine.raycaster.grids = NULL;
-    }
-    
-    /* Liberar floor/ceiling grids por nivel */
-    for (int level = 0; level < 3; level++) {
-        if (g_engine.floorGrids[level]) {
-            free(g_engine.floorGrids[level]);
-            g_engine.floorGrids[level] = NULL;
-        }
-        if (g_engine.ceilingGrids[level]) {
-            free(g_engine.ceilingGrids[level]);
-            g_engine.ceilingGrids[level] = NULL;
-        }
-    }
+    /* Liberar grids (y cerrar el archivo v7 al que pueden apuntar) */
+    ray_map_release_grids();
     
     /* Liberar doors */
-    if (g_engine.doors) {
-        free(g_engine.doors);
-        g_engine.doors = NULL;
-    }
+    ray_door_table_free();
+    
+    /* Liberar texture cache */
+    ray_texture_cache_free();
     
     /* Liberar spawn flags */
     if (g_engine.spawn_flags) {
@@ -259,6 +279,7 @@ int64_t libmod_ray_set_camera(INSTANCE *my, int64_t *params) {
     g_engine.camera.x = x;
     g_engine.camera.y = y;
     g_engine.camera.z = z;
+    ray_camera_snap();
     g_engine.camera.rot = rot;
     g_engine.camera.pitch = pitch;
     
@@ -267,6 +288,9 @@ int64_t libmod_ray_set_camera(INSTANCE *my, int64_t *params) {
     if (g_engine.camera.pitch > max_pitch) g_engine.camera.pitch = max_pitch;
     if (g_engine.camera.pitch < -max_pitch) g_engine.camera.pitch = -max_pitch;
     
+    /* Un salto de cámara no espera al siguiente frame para tener sus chunks */
+    ray_world_update();
+    
     return 1;
 }
 
@@ -276,11 +300,11 @@ int64_t libmod_ray_set_camera(INSTANCE *my, int64_t *params) {
 
 /* Verificar si una posición colisiona con una pared */
 static int ray_check_collision(float x, float y, float radius) {
-    if (!g_engine.raycaster.grids || !g_engine.raycaster.grids[0]) {
+    const RAY_World *world = &g_engine.world;
+    if (!world->chunks) {
         return 0;
     }
     
-    int *grid = g_engine.raycaster.grids[0];
     int gridWidth = g_engine.raycaster.gridWidth;
     int gridHeight = g_engine.raycaster.gridHeight;
     
@@ -301,22 +325,20 @@ static int ray_check_collision(float x, float y, float radius) {
             return 1; /* Fuera del mapa */
         }
         
-        int cellValue = grid[gridX + gridY * gridWidth];
-        if (cellValue > 0) {
+        /* Un chunk aún sin cargar es sólido */
+        const RAY_Chunk *chunk = ray_world_chunk(world, gridX, gridY);
+        if (!chunk->resident) return 1;
+        const RAY_Cell *cell = ray_chunk_levels(world, chunk, ray_chunk_cell(world, chunk, gridX, gridY));
+        
+        if (cell->flags & RAY_CELL_WALL) {
             /* Si es puerta, verificar si está abierta */
-            if (ray_is_door(cellValue)) {
-                int doorOffset = gridX + gridY * gridWidth;
-                if (g_engine.doors && doorOffset >= 0 && doorOffset < gridWidth * gridHeight) {
-                    RAY_Door *door = &g_engine.doors[doorOffset];
-                    if (door->offset < 0.9f) return 1; /* Puerta cerrada */
-                }
+            if (cell->flags & RAY_CELL_DOOR) {
+                RAY_Door *door = ray_door_at(gridX + gridY * gridWidth);
+                if (door && door->offset < 0.9f) return 1; /* Puerta cerrada */
             } else {
                 /* Pared normal - verificar Z-offset */
                 /* Obtener Z-offset de esta pared */
-                float wall_z_offset = 0.0f;
-                if (g_engine.raycaster.zOffsetGrids && g_engine.raycaster.zOffsetGrids[0]) {
-                    wall_z_offset = g_engine.raycaster.zOffsetGrids[0][gridX + gridY * gridWidth];
-                }
+                float wall_z_offset = ray_cell_z_offset(cell);
                 
                 /* Si el jugador está completamente por debajo del inicio de la pared, puede pasar */
                 if (player_top < wall_z_offset) {
@@ -333,6 +355,16 @@ static int ray_check_collision(float x, float y, float radius) {
 /* ============================================================================
    MOVIMIENTO
    ============================================================================*/
+/* El paso fijo no simula el movimiento del script: x/y se colocan sin
+ * interpolar para que se vea en este mismo frame. prev_z no se toca y el
+ * salto sigue interpolándose */
+static void ray_camera_move_to(float x, float y) {
+    g_engine.camera.x = x;
+    g_engine.camera.y = y;
+    g_engine.camera.prev_x = x;
+    g_engine.camera.prev_y = y;
+}
+
 /* Movement functions */
 int64_t libmod_ray_move_forward(INSTANCE *my, int64_t *params) {
     if (!g_engine.initialized) return 0;
@@ -352,8 +384,7 @@ int64_t libmod_ray_move_forward(INSTANCE *my, int64_t *params) {
     /* TODO: Implementar detección de colisiones */
     /* Verificar colisión antes de mover */
     if (!ray_check_collision(newX, newY, 20.0f)) {
-        g_engine.camera.x = newX;
-        g_engine.camera.y = newY;
+        ray_camera_move_to(newX, newY);
     }
     
     return 1;
@@ -377,8 +408,7 @@ int64_t libmod_ray_move_backward(INSTANCE *my, int64_t *params) {
     /* TODO: Implementar detección de colisiones */
     /* Verificar colisión antes de mover */
     if (!ray_check_collision(newX, newY, 20.0f)) {
-        g_engine.camera.x = newX;
-        g_engine.camera.y = newY;
+        ray_camera_move_to(newX, newY);
     }
     
     return 1;
@@ -402,8 +432,7 @@ int64_t libmod_ray_strafe_left(INSTANCE *my, int64_t *params) {
     /* TODO: Implementar detección de colisiones */
     /* Verificar colisión antes de mover */
     if (!ray_check_collision(newX, newY, 20.0f)) {
-        g_engine.camera.x = newX;
-        g_engine.camera.y = newY;
+        ray_camera_move_to(newX, newY);
     }
     
     return 1;
@@ -427,8 +456,7 @@ int64_t libmod_ray_strafe_right(INSTANCE *my, int64_t *params) {
     /* TODO: Implementar detección de colisiones */
     /* Verificar colisión antes de mover */
     if (!ray_check_collision(newX, newY, 20.0f)) {
-        g_engine.camera.x = newX;
-        g_engine.camera.y = newY;
+        ray_camera_move_to(newX, newY);
     }
     
     return 1;
@@ -472,56 +500,6 @@ int64_t libmod_ray_jump(INSTANCE *my, int64_t *params) {
     return 1;
 }
 
-/* ============================================================================
-   DOOR ANIMATION UPDATE
-   ============================================================================ */
-
-void ray_update_doors(float delta_time) {
-    if (!g_engine.doors || !g_engine.initialized) return;
-    
-    int total_doors = g_engine.raycaster.gridWidth * g_engine.raycaster.gridHeight;
-    static int debug_count = 0;
-    
-    for (int i = 0; i < total_doors; i++) {
-        RAY_Door *door = &g_engine.doors[i];
-        
-        if (!door->animating) continue;
-        
-        /* Calcular incremento de offset basado en velocidad y delta time */
-        float increment = door->anim_speed * delta_time;
-        
-        if (door->state == 1) {
-            /* Abriendo - incrementar offset hacia 1.0 */
-            door->offset += increment;
-            if (door->offset >= 1.0f) {
-                door->offset = 1.0f;
-                door->animating = 0; /* Animación completa */
-                if (debug_count < 5) {
-                    printf("RAY: Puerta %d completó animación de APERTURA, offset=%.2f\n", i, door->offset);
-                    debug_count++;
-                }
-            } else if (debug_count < 20) {
-                printf("RAY: Puerta %d animando APERTURA, offset=%.2f\n", i, door->offset);
-                debug_count++;
-            }
-        } else {
-            /* Cerrando - decrementar offset hacia 0.0 */
-            door->offset -= increment;
-            if (door->offset <= 0.0f) {
-                door->offset = 0.0f;
-                door->animating = 0; /* Animación completa */
-                if (debug_count < 5) {
-                    printf("RAY: Puerta %d completó animación de CIERRE, offset=%.2f\n", i, door->offset);
-                    debug_count++;
-                }
-            } else if (debug_count < 20) {
-                printf("RAY: Puerta %d animando CIERRE, offset=%.2f\n", i, door->offset);
-                debug_count++;
-            }
-        }
-    }
-}
-
 /* ============================================================================
    UPDATE - Actualización de física (llamar cada frame)
    ============================================================================ */
@@ -562,16 +540,55 @@ void ray_update_physics(float delta_time) {
     }
     
     /* Limpiar sprites marcados para eliminación */
-    int write_idx = 0;
-    for (int read_idx = 0; read_idx < g_engine.num_sprites; read_idx++) {
-        if (!g_engine.sprites[read_idx].cleanup) {
-            if (write_idx != read_idx) {
-                g_engine.sprites[write_idx] = g_engine.sprites[read_idx];
-            }
-            write_idx++;
+    ray_sprite_collect();
+}
+
+/* ============================================================================
+   PASO FIJO - La física avanza en pasos de RAY_PHYSICS_STEP según el
+   tiempo real transcurrido, sea cual sea el ritmo de render. Lo que sobra
+   queda en el acumulador y physicsAlpha dice cuánto de un paso es, para
+   que el render interpole entre prev_* y la posición actual.
+   ============================================================================ */
+
+/* Colocar sin interpolar (teletransporte, alta o movimiento de sprite,
+ * carga de mapa) */
+void ray_camera_snap(void) {
+    g_engine.camera.prev_x = g_engine.camera.x;
+    g_engine.camera.prev_y = g_engine.camera.y;
+    g_engine.camera.prev_z = g_engine.camera.z;
+}
+
+void ray_sprite_snap(RAY_Sprite *sprite) {
+    sprite->prev_x = sprite->x;
+    sprite->prev_y = sprite->y;
+    sprite->prev_z = sprite->z;
+}
+
+/* Llamar una vez por frame antes de renderizar */
+void ray_physics_advance(void) {
+    uint64_t now = SDL_GetPerformanceCounter();
+    double elapsed = RAY_PHYSICS_STEP;
+    if (g_engine.physicsCounter != 0 && now > g_engine.physicsCounter) {
+        elapsed = (double)(now - g_engine.physicsCounter) / (double)SDL_GetPerformanceFrequency();
+    }
+    g_engine.physicsCounter = now;
+    
+    /* Tras un parón (carga, depurador) no intentar recuperar todo */
+    g_engine.physicsAccumulator += elapsed;
+    if (g_engine.physicsAccumulator > RAY_PHYSICS_MAX_STEPS * RAY_PHYSICS_STEP) {
+        g_engine.physicsAccumulator = RAY_PHYSICS_MAX_STEPS * RAY_PHYSICS_STEP;
+    }
+    
+    while (g_engine.physicsAccumulator >= RAY_PHYSICS_STEP) {
+        ray_camera_snap();
+        for (int i = 0; i < g_engine.num_sprites; i++) {
+            ray_sprite_snap(&g_engine.sprites[i]);
         }
+        ray_update_physics(RAY_PHYSICS_STEP);
+        g_engine.physicsAccumulator -= RAY_PHYSICS_STEP;
     }
-    g_engine.num_sprites = write_idx;
+    
+    g_engine.physicsAlpha = (float)(g_engine.physicsAccumulator / RAY_PHYSICS_STEP);
 }
 
 /* ============================================================================
@@ -584,6 +601,14 @@ int64_t libmod_ray_set_draw_minimap(INSTANCE *my, int64_t *params) {
     return 1;
 }
 
+int64_t libmod_ray_set_floor_mode(INSTANCE *my, int64_t *params) {
+    if (!g_engine.initialized) return 0;
+    int mode = (int)params[0];
+    if (mode != RAY_FLOOR_MODE_COLUMNS && mode != RAY_FLOOR_MODE_SPANS) return 0;
+    g_engine.floorMode = mode;
+    return 1;
+}
+
 int64_t libmod_ray_set_draw_weapon(INSTANCE *my, int64_t *params) {
     if (!g_engine.initialized) return 0;
     g_engine.drawWeapon = (int)params[0];
@@ -593,6 +618,7 @@ int64_t libmod_ray_set_draw_weapon(INSTANCE *my, int64_t *params) {
 int64_t libmod_ray_set_sky_texture(INSTANCE *my, int64_t *params) {
     if (!g_engine.initialized) return 0;
     g_engine.skyTextureID = (int)params[0];
+    ray_texture_load(g_engine.skyTextureID);   /* Sin mapa cargado lo hará ray_texture_cache_build */
     return 1;
 }
 
@@ -619,7 +645,7 @@ int64_t libmod_ray_check_collision(INSTANCE *my, int64_t *params) {
 
 int64_t libmod_ray_toggle_door(INSTANCE *my, int64_t *params) {
     if (!g_engine.initialized) return 0;
-    if (!g_engine.doors) return 0;
+    if (g_engine.doorTable.count == 0) return 0;
     
     /* Hacer un raycast simple para encontrar la puerta más cercana frente al jugador */
     float rayAngle = g_engine.camera.rot;
@@ -635,7 +661,7 @@ int64_t libmod_ray_toggle_door(INSTANCE *my, int64_t *params) {
                 (rayAngle > RAY_TWO_PI * 0.75f);
     int up = rayAngle < RAY_TWO_PI * 0.5f && rayAngle >= 0;
     
-    int *grid = g_engine.raycaster.grids[0]; /* Solo nivel 0 por ahora */
+    const RAY_World *world = &g_engine.world; /* Solo nivel 0 por ahora */
     int tileSize = RAY_TILE_SIZE;
     
     /* Buscar intersección vertical */
@@ -660,7 +686,7 @@ int64_t libmod_ray_toggle_door(INSTANCE *my, int64_t *params) {
         if (wallX >= 0 && wallX < g_engine.raycaster.gridWidth &&
             wallY >= 0 && wallY < g_engine.raycaster.gridHeight) {
             
-            int wallType = grid[wallX + wallY * g_engine.raycaster.gridWidth];
+            int wallType = ray_world_wall(world, 0, wallX, wallY);
             
             if (ray_is_door(wallType)) {
                 float dx = playerX - vx;
@@ -699,7 +725,7 @@ int64_t libmod_ray_toggle_door(INSTANCE *my, int64_t *params) {
         if (wallX >= 0 && wallX < g_engine.raycaster.gridWidth &&
             wallY >= 0 && wallY < g_engine.raycaster.gridHeight) {
             
-            int wallType = grid[wallX + wallY * g_engine.raycaster.gridWidth];
+            int wallType = ray_world_wall(world, 0, wallX, wallY);
             
             if (ray_is_door(wallType)) {
                 float dx = playerX - hx;
@@ -721,14 +747,12 @@ int64_t libmod_ray_toggle_door(INSTANCE *my, int64_t *params) {
     
     /* Si encontramos una puerta, togglearla */
     if (door_x >= 0 && door_y >= 0 && min_door_dist < RAY_TILE_SIZE * 2.0f) {
-        int offset = door_x + door_y * g_engine.raycaster.gridWidth;
-        RAY_Door *door = &g_engine.doors[offset];
+        RAY_Door *door = ray_door_at(door_x + door_y * g_engine.raycaster.gridWidth);
+        if (!door) return 0;
         
-        /* Toggle state */
-        door->state = !door->state;
-        
-        /* Iniciar animación */
-        door->animating = 1;
+        /* Toggle state e iniciar animación */
+        ray_door_toggle(door);
+        ray_minimap_invalidate_cell(door_x, door_y);
         
         printf("RAY: Puerta detectada automáticamente en (%d, %d) cambiada a estado %d, iniciando animación\n", 
                door_x, door_y, door->state);
@@ -754,37 +778,36 @@ int64_t libmod_ray_add_sprite(INSTANCE *my, int64_t *params) {
     int w = (int)params[4];
     int h = (int)params[5];
     
-    if (g_engine.num_sprites >= g_engine.sprites_capacity) {
-        fprintf(stderr, "RAY: Máximo de sprites alcanzado\n");
+    int64_t handle;
+    RAY_Sprite *sprite = ray_sprite_alloc(&handle);
+    if (!sprite) {
         return -1;
     }
     
-    RAY_Sprite *sprite = &g_engine.sprites[g_engine.num_sprites];
-    memset(sprite, 0, sizeof(RAY_Sprite));
-    
     sprite->x = x;
     sprite->y = y;
     sprite->z = z;
+    ray_sprite_snap(sprite);
     sprite->w = w;
     sprite->h = h;
     sprite->textureID = textureID;
     sprite->level = 0; /* TODO: Calcular nivel correcto */
+    sprite->flag_id = -1;
     
-    g_engine.num_sprites++;
-    return g_engine.num_sprites - 1;
+    /* Handle estable: sigue siendo válido aunque se borren otros sprites */
+    return handle;
 }
 
 int64_t libmod_ray_remove_sprite(INSTANCE *my, int64_t *params) {
     if (!g_engine.initialized) return 0;
     
-    int index = (int)params[0];
-    
-    if (index < 0 || index >= g_engine.num_sprites) {
+    /* Un handle ya borrado (o de un mapa anterior) no es válido */
+    int index = ray_sprite_index(params[0]);
+    if (index < 0) {
         return 0;
     }
     
-    /* Marcar para eliminación */
-    g_engine.sprites[index].cleanup = 1;
+    ray_sprite_remove_at(index);
     
     return 1;
 }
@@ -832,18 +855,17 @@ int64_t libmod_ray_set_flag(INSTANCE *my, int64_t *params) {
     
     /* Si no existe, crear uno nuevo */
     if (!sprite) {
-        if (g_engine.num_sprites >= g_engine.sprites_capacity) {
-            fprintf(stderr, "RAY: Máximo de sprites alcanzado\n");
+        sprite = ray_sprite_alloc(NULL);
+        if (!sprite) {
             return 0;
         }
-        sprite = &g_engine.sprites[g_engine.num_sprites++];
-        memset(sprite, 0, sizeof(RAY_Sprite));
     }
     
     /* Configurar sprite con datos de la flag */
     sprite->x = flag->x;
     sprite->y = flag->y;
     sprite->z = flag->z;
+    ray_sprite_snap(sprite);
     sprite->level = flag->level;
     sprite->process_ptr = my;  /* Vincular al proceso */
     sprite->flag_id = flag_id;
@@ -881,8 +903,8 @@ int64_t libmod_ray_clear_flag(INSTANCE *my, int64_t *params) {
                 }
             }
             
-            /* Marcar sprite para eliminación */
-            g_engine.sprites[i].cleanup = 1;
+            /* Quitar el sprite */
+            ray_sprite_remove_at(i);
             
             printf("RAY: Proceso %p desvinculado de flag %d\n", (void*)my, flag_id);
             return 1;
@@ -960,6 +982,7 @@ int64_t libmod_ray_update_sprite_position(INSTANCE *my, int64_t *params) {
             g_engine.sprites[i].x = x;
             g_engine.sprites[i].y = y;
             g_engine.sprites[i].z = z;
+            ray_sprite_snap(&g_engine.sprites[i]);
             return 1;
         }
     }
@@ -981,6 +1004,7 @@ int64_t libmod_ray_set_fog(INSTANCE *my, int64_t *params) {
     g_engine.fog_b = (uint8_t)params[3];
     g_engine.fog_start_distance = *(float*)&params[4];
     g_engine.fog_end_distance = *(float*)&params[5];
+    ray_fog_build();
     
     return 1;
 }
@@ -997,6 +1021,18 @@ int64_t libmod_ray_set_minimap(INSTANCE *my, int64_t *params) {
     return 1;
 }
 
+/* ============================================================================
+   HILOS DEL RENDER - Configuración
+   ============================================================================ */
+
+/* RAY_SET_THREADS(n): n hilos de render (0 = uno por CPU, 1 = sin hilos).
+ * Devuelve los hilos que se han podido crear. */
+int64_t libmod_ray_set_threads(INSTANCE *my, int64_t *params) {
+    if (!g_engine.initialized) return 0;
+    
+    return ray_threads_init((int)params[0]);
+}
+
 /* ============================================================================
    RENDERIZADO
    ============================================================================ */
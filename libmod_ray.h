@@ -21,6 +21,8 @@
 #define RAY_MAX_THIN_WALLS 1000
 #define RAY_MAX_THICK_WALLS 100
 #define RAY_MAX_RAYHITS 2000
+#define RAY_MAX_COLD_HITS 256        /* Hits con parte fría (ThinWalls) por strip */
+#define RAY_MAX_TEXTURES 1000
 #define RAY_TWO_PI (M_PI * 2.0f)
 
 /* Tipos de ThickWall */
@@ -33,6 +35,10 @@
 #define RAY_SLOPE_TYPE_WEST_EAST 1
 #define RAY_SLOPE_TYPE_NORTH_SOUTH 2
 
+/* Modos de render de suelo y techo */
+#define RAY_FLOOR_MODE_COLUMNS 0     /* Por strip y pixel (original) */
+#define RAY_FLOOR_MODE_SPANS 1       /* Por filas de pantalla (spans horizontales) */
+
 /* Tipos de puertas (compatibilidad con motor original) */
 #define RAY_DOOR_VERTICAL_MIN 1000
 #define RAY_DOOR_VERTICAL_MAX 1499
@@ -106,8 +112,21 @@ typedef struct {
     float offset;        /* 0.0 a 1.0 - progreso de animación */
     int animating;       /* 1 si está animándose */
     float anim_speed;    /* Velocidad de animación (unidades por segundo) */
+    int cell;            /* Celda x + y * width */
 } RAY_Door;
 
+/* Puertas del mapa: array compacto + hash celda -> puerta + lista de las
+ * que se están animando (libmod_ray_doors.c) */
+typedef struct {
+    RAY_Door *doors;
+    int count;
+    int *cells;          /* Hash: celda de cada entrada, -1 = libre */
+    int *slots;          /* Hash: índice en 'doors' */
+    int capacity;        /* Potencia de 2 */
+    int *active;         /* Índices de puertas animándose */
+    int numActive;
+} RAY_DoorTable;
+
 /* ============================================================================
    SPAWN FLAGS - Posiciones de spawn para sprites
    ============================================================================ */
@@ -124,8 +143,26 @@ typedef struct {
    SPRITES
    ============================================================================ */
 
+/* Tramo opaco de una columna de un graph de sprite */
+typedef struct {
+    uint16_t start;                  /* Primera fila del tramo */
+    uint16_t length;                 /* Filas opacas seguidas */
+    uint32_t offset;                 /* Primer texel del tramo en 'pixels' */
+} RAY_SpriteSpan;
+
+/* Graph de sprite convertido a tramos opacos por columna */
+typedef struct {
+    GRAPH *graph;                    /* Clave: (graph, code, width, height) */
+    int64_t code;
+    int width, height;
+    int *columnSpans;                /* width + 1 offsets en 'spans' */
+    RAY_SpriteSpan *spans;
+    uint32_t *pixels;                /* Solo texels opacos, tramo a tramo */
+} RAY_SpriteRLE;
+
 typedef struct {
     float x, y, z;
+    float prev_x, prev_y, prev_z;    /* Posición al empezar el último paso de física */
     int w, h;
     int level;                       /* Nivel del grid (0, 1, 2...) */
     int dir;                         /* -1 izquierda, 1 derecha */
@@ -144,30 +181,47 @@ typedef struct {
     int jumping;
     float heightJumped;
     int rayhit;                      /* 1 si fue golpeado por un rayo */
+    RAY_SpriteRLE *rle;              /* Tramos del último graph dibujado */
+    uint32_t rleGeneration;          /* Generación de la caché de tramos al guardarlo */
 } RAY_Sprite;
 
+/* Slot map de sprites: handle = (generación << RAY_SPRITE_SLOT_BITS) | slot */
+#define RAY_SPRITE_SLOT_BITS 16
+
+typedef struct {
+    int dense;                       /* Índice en g_engine.sprites, o siguiente slot libre */
+    uint32_t generation;             /* Sube cada vez que se libera el slot */
+    int used;
+} RAY_SpriteSlot;
+
 /* ============================================================================
    RAY HIT - Información de colisión de un rayo
    ============================================================================ */
 
+/* Parte caliente: lo que leen el orden, el z-buffer y los bucles de dibujo.
+ * 32 bytes, dos hits por línea de caché. */
 typedef struct {
-    float x, y;                      /* Posición del impacto en unidades de juego */
-    int wallX, wallY;                /* Posición en grid (columna, fila) */
-    int wallType;                    /* Tipo de pared golpeada */
-    int strip;                       /* Columna de pantalla */
-    float tileX;                     /* Coordenada X dentro del tile (para textura) */
-    float squaredDistance;           /* Distancia al cuadrado */
     float distance;                  /* Distancia al impacto */
     float correctDistance;           /* Distancia corregida (fisheye) */
-    int horizontal;                  /* 1 si golpeó pared horizontal */
-    float rayAngle;                  /* Ángulo del rayo */
-    RAY_Sprite *sprite;              /* Sprite golpeado (NULL si es pared) */
-    int level;                       /* Nivel del grid */
-    int right;                       /* 1 si el rayo va a la derecha */
-    int up;                          /* 1 si el rayo va hacia arriba */
-    RAY_ThinWall *thinWall;         /* ThinWall golpeado */
+    float tileX;                     /* Coordenada X dentro del tile (para textura) */
     float wallHeight;                /* Altura de la pared */
     float wallZOffset;               /* Z-offset (altura base) de la pared */
+    int32_t wallType;                /* Tipo de pared golpeada */
+    int16_t wallX, wallY;            /* Posición en grid (columna, fila) */
+    uint8_t level;                   /* Nivel del grid */
+    uint8_t flags;                   /* RAY_HIT_* */
+    uint16_t cold;                   /* Índice en el array frío del strip o RAY_HIT_NO_COLD */
+} RAY_RayHit;
+
+#define RAY_HIT_HORIZONTAL 0x01      /* Golpeó una pared horizontal */
+#define RAY_HIT_THIN_WALL  0x02      /* Hit de ThinWall (datos en la parte fría) */
+#define RAY_HIT_NO_COLD    0xFFFF
+
+/* Parte fría: datos que solo necesitan ThinWalls y slopes */
+typedef struct {
+    float x, y;                      /* Posición del impacto en unidades de juego */
+    RAY_ThinWall *thinWall;          /* ThinWall golpeado */
+    RAY_Sprite *sprite;              /* Sprite golpeado (NULL si es pared) */
     float invertedZ;                 /* Z invertido (para slopes invertidos) */
     
     /* Sibling (para slopes) */
@@ -176,10 +230,49 @@ typedef struct {
     float siblingCorrectDistance;
     float siblingThinWallZ;
     float siblingInvertedZ;
-    
-    /* Distancia de ordenamiento (para z-buffer) */
-    float sortdistance;
-} RAY_RayHit;
+} RAY_RayHitCold;
+
+/* Clave compacta para ordenar los hits de un strip sin mover los RAY_RayHit */
+typedef struct {
+    uint32_t key;                    /* Distancia como entero: ascendente = más lejano primero */
+    uint32_t index;                  /* Posición del hit en el array del strip */
+} RAY_HitKey;
+
+/* Paso fijo de la física; el render interpola entre pasos */
+#define RAY_PHYSICS_STEP (1.0f / 60.0f)
+#define RAY_PHYSICS_MAX_STEPS 8      /* Pasos como máximo por frame tras un parón */
+
+/* Entradas de la tabla de fog entre fog_start y fog_end */
+#define RAY_FOG_TABLE_SIZE 1024
+
+/* Sprite que ha pasado el culling: rectángulo en pantalla ya calculado */
+#define RAY_ZTILE_STRIPS 8           /* Strips por tile del z-buffer jerárquico */
+
+typedef struct {
+    int sprite;                      /* Índice denso en g_engine.sprites */
+    float screen_w, screen_h;        /* Tamaño sin recortar */
+    int origin_x, start_x, end_x;    /* Borde izquierdo sin recortar y columnas [start, end) */
+    int screen_y, sy_start, sy_end;  /* Borde superior sin recortar y filas [start, end) */
+    int test_z;                      /* 0 si está delante de todas las paredes de su rango */
+} RAY_SpriteProjection;
+
+/* ============================================================================
+   RAYOS POR STRIP - Tablas de RAY_INIT y rayo del frame
+   ============================================================================ */
+
+/* Trigonometría fija de cada strip (depende solo del FOV y la resolución) */
+typedef struct {
+    float cosAngle;                  /* cos(stripAngle): corrección de ojo de pez */
+    float sinAngle;                  /* sin(stripAngle) */
+    float invCos;                    /* 1 / cos(stripAngle): distancia recta -> diagonal */
+} RAY_StripTrig;
+
+/* Rayo de un strip en el frame actual (tabla del strip rotada por la cámara) */
+typedef struct {
+    float angle;                     /* Ángulo absoluto en [0, 2π) */
+    float dirX, dirY;                /* Dirección unitaria en el mapa (Y hacia abajo) */
+    float cosStrip;                  /* cos(stripAngle) */
+} RAY_Ray;
 
 /* ============================================================================
    RAYCASTER - Motor principal
@@ -195,12 +288,165 @@ typedef struct {
     float **zOffsetGrids;            /* Array de grids de Z-offset [nivel][offset] */
 } RAY_Raycaster;
 
+/* ============================================================================
+   CELDA EMPAQUETADA - Lo que se lee de una celda en un nivel
+   Pared, suelo, techo, altura, Z-offset y altura de suelo juntos en 16
+   bytes, construidos al cargar a partir de los grids. Las celdas guardan
+   sus niveles seguidos, así que el raycaster lee todos los niveles de una
+   celda en una o dos líneas de caché en lugar de en un array por dato.
+   Las alturas van en punto fijo: los valores múltiplos de 1/16 de unidad
+   (altura, Z-offset) o de 1/256 de tile (altura de suelo) se conservan
+   exactos; el resto se redondea.
+   ============================================================================ */
+
+#define RAY_CELL_WALL  0x0001            /* wall > 0 */
+#define RAY_CELL_DOOR  0x0002            /* ray_is_door(wall) */
+
+#define RAY_CELL_HEIGHT_SCALE 16.0f      /* height y zOffset: 1/16 de unidad */
+#define RAY_CELL_FLOOR_SCALE 256.0f      /* floorHeight: 1/256 de tile */
+
+typedef struct {
+    uint16_t wall;                   /* 0 = vacía */
+    uint16_t flags;                  /* RAY_CELL_* */
+    uint16_t floor;                  /* Textura de suelo (niveles 0-2) */
+    uint16_t ceiling;                /* Textura de techo (niveles 0-2) */
+    int16_t height;                  /* Altura de la pared, ya con el valor por defecto */
+    int16_t zOffset;
+    int16_t floorHeight;
+    uint16_t reserved;
+} RAY_Cell;
+
+typedef char RAY_CellSizeCheck[sizeof(RAY_Cell) == 16 ? 1 : -1];
+
+static inline float ray_cell_height(const RAY_Cell *cell)
+{
+    return cell->height * (1.0f / RAY_CELL_HEIGHT_SCALE);
+}
+
+static inline float ray_cell_z_offset(const RAY_Cell *cell)
+{
+    return cell->zOffset * (1.0f / RAY_CELL_HEIGHT_SCALE);
+}
+
+static inline float ray_cell_floor_height(const RAY_Cell *cell)
+{
+    return cell->floorHeight * (1.0f / RAY_CELL_FLOOR_SCALE);
+}
+
+/* ============================================================================
+   MUNDO POR CHUNKS - Celdas del mapa por bloques (libmod_ray_chunks.c)
+   Un mapa normal es un único chunk con todas las celdas del mapa. Un
+   .raymap guardado por chunks de 64x64 solo tiene residentes los chunks
+   cercanos a la cámara; el resto se ve con su proxy (la pared más
+   frecuente del chunk en el nivel 0) hasta que se cargan. Todo el que lee
+   celdas pasa por ray_world_*.
+
+   Cada chunk residente lleva, por nivel, un bitmap de ocupación (un bit
+   por celda con pared) y otro de bloques de 8x8 celdas con alguna pared,
+   para que el raycaster cruce el espacio vacío sin leer celdas.
+   ============================================================================ */
+
+#define RAY_CHUNK_DEFAULT_BUDGET (64 * 1024 * 1024)  /* Bytes de chunks residentes */
+#define RAY_CHUNK_BLOCK_SHIFT 3                       /* Bloques de 8x8 celdas */
+
+typedef struct {
+    RAY_Cell *cells;                 /* [celda * world->levels + nivel], NULL = no residente */
+    int stride;                      /* Celdas por fila del chunk */
+    int numCells;
+    uint64_t *occupancy;             /* [nivel * occupancyWords + celda / 64] */
+    uint64_t *blocks;                /* [nivel * blockWords + bloque / 64] */
+    int occupancyWords, blockWords;
+    int blockStride;                 /* Bloques por fila */
+    uint32_t levelMask;              /* Niveles (< 32) con alguna pared */
+    int resident;                    /* 0 = sin datos: solo vale el proxy */
+    int proxyWall;                   /* 0 = chunk sin paredes */
+    int proxyFloor, proxyCeiling;
+} RAY_Chunk;
+
+typedef struct {
+    RAY_Chunk *chunks;               /* chunksX * chunksY, fila a fila; NULL = sin mapa */
+    int chunksX, chunksY;
+    int shift;                       /* Celdas por lado del chunk = 1 << shift */
+    int mask;                        /* (1 << shift) - 1 */
+    int levels;                      /* RAY_Cell por celda: max(gridCount, 3) */
+    uint32_t levelMask;              /* Niveles con pared en algún chunk cargado (solo crece) */
+    int streaming;                   /* 1 = chunks cargados bajo demanda */
+    size_t budget;                   /* Memoria para chunks residentes (RAY_SET_CHUNK_BUDGET) */
+    int resident;                    /* Chunks residentes ahora */
+    int loads;                       /* Chunks publicados en el último ray_world_update */
+} RAY_World;
+
+/* Chunk de la celda (x, y); la celda tiene que estar dentro del mapa */
+static inline RAY_Chunk *ray_world_chunk(const RAY_World *world, int x, int y)
+{
+    return &world->chunks[(y >> world->shift) * world->chunksX + (x >> world->shift)];
+}
+
+/* Posición de la celda (x, y) dentro de su chunk */
+static inline int ray_chunk_cell(const RAY_World *world, const RAY_Chunk *chunk, int x, int y)
+{
+    return (y & world->mask) * chunk->stride + (x & world->mask);
+}
+
+/* Niveles de la celda 'cell' de un chunk residente: [0, world->levels) */
+static inline const RAY_Cell *ray_chunk_levels(const RAY_World *world, const RAY_Chunk *chunk, int cell)
+{
+    return chunk->cells + (size_t)cell * world->levels;
+}
+
+/* 1 si el bit 'index' está a 1 en el bitmap de algún nivel de 'active';
+ * 'bits' tiene 'words' palabras por nivel */
+static inline int ray_chunk_bits_any(const uint64_t *bits, int words, uint32_t active, int levels, int index)
+{
+    const uint64_t *word = bits + (index >> 6);
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    for (int level = 0; level < levels; level++, word += words) {
+        if (((active >> level) & 1) && (*word & bit)) return 1;
+    }
+    return 0;
+}
+
+/* Pared de la celda en 'level'; en un chunk no residente el nivel 0 es
+ * su proxy y el resto está vacío */
+static inline int ray_world_wall(const RAY_World *world, int level, int x, int y)
+{
+    const RAY_Chunk *chunk = ray_world_chunk(world, x, y);
+    if (!chunk->resident) return level == 0 ? chunk->proxyWall : 0;
+    return ray_chunk_levels(world, chunk, ray_chunk_cell(world, chunk, x, y))[level].wall;
+}
+
+static inline int ray_world_floor(const RAY_World *world, int level, int x, int y)
+{
+    const RAY_Chunk *chunk = ray_world_chunk(world, x, y);
+    if (!chunk->resident) return level == 0 ? chunk->proxyFloor : 0;
+    return ray_chunk_levels(world, chunk, ray_chunk_cell(world, chunk, x, y))[level].floor;
+}
+
+static inline int ray_world_ceiling(const RAY_World *world, int level, int x, int y)
+{
+    const RAY_Chunk *chunk = ray_world_chunk(world, x, y);
+    if (!chunk->resident) return level == 0 ? chunk->proxyCeiling : 0;
+    return ray_chunk_levels(world, chunk, ray_chunk_cell(world, chunk, x, y))[level].ceiling;
+}
+
+/* ============================================================================
+   ARCHIVO DE MAPA v7 - Proyección del .raymap (libmod_ray_mapfile.c)
+   Los grids del mapa pueden apuntar dentro de 'base' mientras esté abierto.
+   ============================================================================ */
+
+typedef struct {
+    uint8_t *base;                   /* Contenido del archivo */
+    size_t size;                     /* Bytes del archivo */
+    int mapped;                      /* 1 = mmap/MapViewOfFile, 0 = leído en memoria */
+} RAY_MapFile;
+
 /* ============================================================================
    CÁMARA
    ============================================================================ */
 
 typedef struct {
     float x, y, z;
+    float prev_x, prev_y, prev_z;    /* Posición al empezar el último paso de física */
     float rot;                       /* Rotación en radianes */
     float pitch;                     /* Pitch (mirar arriba/abajo) */
     float moveSpeed;
@@ -211,6 +457,123 @@ typedef struct {
     float heightJumped;
 } RAY_Camera;
 
+/* ============================================================================
+   FRAME ARENA - Memoria temporal del frame (hits, contadores, z-buffer)
+   ============================================================================ */
+
+#define RAY_ARENA_ALIGN 64
+
+typedef struct {
+    uint8_t *base;                   /* Bloque reservado */
+    size_t capacity;                 /* Bytes reservados */
+    size_t used;                     /* Bytes entregados en el frame actual */
+    size_t high_water;               /* Máximo de bytes usados en un frame */
+    int grow_count;                  /* Veces que el bloque ha tenido que crecer */
+} RAY_FrameArena;
+
+/* ============================================================================
+   HILOS DEL RENDER - Pool de workers creado en RAY_INIT
+   ============================================================================ */
+
+#define RAY_MAX_THREADS 16           /* Hilos de render como máximo (incluye el principal) */
+#define RAY_THREAD_BAND 8            /* Strips por banda de trabajo */
+
+/* Trabajo paralelo sobre el rango [first, last); 'worker' va de 0 a count-1 */
+typedef void (*RAY_ThreadJob)(void *ctx, int first, int last, int worker);
+
+/* ============================================================================
+   ESTADÍSTICAS DEL FRAME - Tiempos por fase y contadores (RAY_GET_STATS)
+   ============================================================================ */
+
+typedef enum {
+    RAY_STAT_FRAME_MS,               /* RAY_RENDER completo */
+    RAY_STAT_PHYSICS_MS,             /* Pasos de física del frame */
+    RAY_STAT_SKY_MS,                 /* Limpiado y cielo */
+    RAY_STAT_STRIPS_MS,              /* Fase paralela completa (tiempo real) */
+    RAY_STAT_RAYCAST_MS,             /* Raycast de strips, sumado entre hilos */
+    RAY_STAT_FLOOR_MS,               /* Suelo y techo, sumado entre hilos */
+    RAY_STAT_WALLS_MS,               /* Paredes, sumado entre hilos */
+    RAY_STAT_SPRITES_MS,
+    RAY_STAT_MINIMAP_MS,
+    RAY_STAT_HITS_AVG,               /* Hits por strip */
+    RAY_STAT_HITS_MAX,
+    RAY_STAT_PIXELS,                 /* Pixels escritos en la vista 3D */
+    RAY_STAT_TEXTURE_SAMPLES,
+    RAY_STAT_SPRITES_DRAWN,
+    RAY_STAT_SPRITES_CULLED,
+    RAY_STAT_THIN_WALL_TESTS,        /* Intersecciones rayo-ThinWall probadas */
+    RAY_STAT_SORT_COMPARISONS,       /* Al ordenar hits y sprites */
+    RAY_STAT_ARENA_BYTES,            /* Frame arena usada en el frame */
+    RAY_STAT_CHUNKS_MS,              /* ray_world_update: publicar, cargar y encolar chunks */
+    RAY_STAT_CHUNK_LOADS,            /* Chunks que pasan a residentes en el frame */
+    RAY_STAT_CHUNKS_RESIDENT,
+    RAY_STAT_COUNT
+} RAY_StatID;
+
+#define RAY_STATS_WINDOW 60          /* Frames de la media móvil */
+
+/* Contadores de un hilo del render; cada uno escribe solo los suyos y
+ * ocupan una línea de caché para no compartirla entre hilos */
+typedef struct {
+    uint64_t raycastTicks;           /* SDL_GetPerformanceCounter */
+    uint64_t floorTicks;
+    uint64_t wallTicks;
+    uint64_t pixels;
+    uint64_t samples;
+    uint64_t thinWallTests;
+    uint8_t pad[RAY_ARENA_ALIGN - 6 * sizeof(uint64_t)];
+} RAY_WorkerStats;
+
+typedef struct {
+    float last[RAY_STAT_COUNT];                      /* Último frame */
+    float history[RAY_STATS_WINDOW][RAY_STAT_COUNT]; /* Últimos frames, circular */
+    int frames;                                      /* Entradas válidas de history */
+    int cursor;                                      /* Próxima entrada a escribir */
+} RAY_FrameStats;
+
+/* ============================================================================
+   TEXTURE CACHE - Graphs del FPG ya convertidos al formato de pixel destino
+   ============================================================================ */
+
+#define RAY_TEXTURE_EMPTY   0        /* Aún no se ha intentado cargar */
+#define RAY_TEXTURE_LOADED  1
+#define RAY_TEXTURE_MISSING -1       /* El graph no existe en el FPG */
+
+typedef struct {
+    uint32_t *pixels;                /* Texels en formato destino, fila a fila (suelos/techos) */
+    uint32_t *columns;               /* Copia traspuesta, columna a columna (paredes) o NULL */
+    int width, height;
+    int wmask, hmask;                /* width-1 / height-1 si son potencia de 2, si no -1 */
+    int state;                       /* RAY_TEXTURE_EMPTY / LOADED / MISSING */
+} RAY_Texture;
+
+typedef struct {
+    RAY_Texture textures[RAY_MAX_TEXTURES];  /* Indexado por ID de graph */
+    int fpg_id;                      /* FPG del que se convirtieron */
+    int ready;                       /* 1 tras ray_texture_cache_build */
+    int loaded;                      /* Número de texturas convertidas */
+    size_t bytes;                    /* Memoria usada por los texels */
+} RAY_TextureCache;
+
+/* ============================================================================
+   ÍNDICE DE THINWALLS - ThinWalls que cruza cada celda del grid
+   Se construye al cargar el mapa en formato CSR: los IDs de la celda c
+   están en items[cellStart[c] .. cellStart[c+1]).
+   ============================================================================ */
+
+typedef struct {
+    int width, height;               /* Celdas (las del grid del mapa) */
+    int *cellStart;                  /* width * height + 1 offsets en 'items' */
+    uint32_t *items;                 /* IDs de ThinWall por celda */
+    RAY_ThinWall **walls;            /* ID -> ThinWall */
+    int num_walls;
+    uint32_t *outside;               /* ThinWalls que salen del grid: se prueban siempre */
+    int num_outside;
+    uint32_t *stamps;                /* Por hilo: último rayo que probó cada ThinWall */
+    uint32_t frameStamp;             /* Sello del strip 0 en el frame actual */
+    uint32_t frameRays;              /* Sellos usados por el frame actual */
+} RAY_ThinWallGrid;
+
 /* ============================================================================
    ESTADO DEL MOTOR
    ============================================================================ */
@@ -226,6 +589,20 @@ typedef struct {
     
     /* Ángulos precalculados */
     float *stripAngles;
+    RAY_StripTrig *stripTrig;        /* cos/sin/1-cos por strip */
+    
+    /* Memoria temporal del frame */
+    RAY_FrameArena frameArena;
+    
+    /* Estadísticas del último frame */
+    uint64_t sortComparisons;        /* Comparaciones al ordenar hits */
+    RAY_WorkerStats workerStats[RAY_MAX_THREADS]; /* Contadores del frame en curso por hilo */
+    RAY_FrameStats stats;            /* Último frame y media móvil (libmod_ray_stats.c) */
+    
+    /* Física a paso fijo (RAY_PHYSICS_STEP) */
+    uint64_t physicsCounter;         /* SDL_GetPerformanceCounter del frame anterior, 0 = reiniciar */
+    double physicsAccumulator;       /* Tiempo real aún sin simular, en segundos */
+    float physicsAlpha;              /* Fracción de paso para interpolar el render [0, 1) */
     
     /* Raycaster */
     RAY_Raycaster raycaster;
@@ -233,10 +610,14 @@ typedef struct {
     /* Cámara */
     RAY_Camera camera;
     
-    /* Sprites */
+    /* Sprites (array denso, ver libmod_ray_sprites.c) */
     RAY_Sprite *sprites;
     int num_sprites;
     int sprites_capacity;
+    int *spriteSlotOf;               /* Por índice denso: su slot */
+    RAY_SpriteSlot *spriteSlots;     /* Por slot: índice denso y generación */
+    int spriteSlotCount;             /* Slots creados hasta ahora */
+    int spriteFreeSlot;              /* Lista de slots libres (-1 = vacía) */
     
     /* ThinWalls */
     RAY_ThinWall **thinWalls;        /* Array de punteros */
@@ -247,15 +628,18 @@ typedef struct {
     RAY_ThickWall **thickWalls;      /* Array de punteros */
     int num_thick_walls;
     int thick_walls_capacity;
+    RAY_ThinWallGrid thinWallGrid;   /* Índice por celdas de sus ThinWalls */
     
     
     /* Grids de suelo y techo - POR NIVEL (0, 1, 2) */
     int *floorGrids[3];                  /* Grids de suelo por nivel [level][x + y * width] */
     int *ceilingGrids[3];                /* Grids de techo por nivel [level][x + y * width] */
     float *floorHeightGrids[3];          /* Grids de altura de suelo por nivel [level][x + y * width] */
+    RAY_MapFile mapFile;                 /* Archivo v7 del que salen los grids (si lo hay) */
+    RAY_World world;                     /* Chunks del mapa cargado */
     
     /* Puertas */
-    RAY_Door *doors;                 /* Estado de puertas [x + y * width] */
+    RAY_DoorTable doorTable;         /* Estado de puertas por celda */
     
     /* Spawn Flags */
     RAY_SpawnFlag *spawn_flags;      /* Array de spawn flags */
@@ -264,6 +648,7 @@ typedef struct {
     
     /* FPG de texturas */
     int fpg_id;
+    RAY_TextureCache textureCache;   /* Texels convertidos al cargar el mapa */
     
     /* Skybox */
     int skyTextureID;  /* ID de textura para el cielo (0 = color sólido) */
@@ -272,6 +657,7 @@ typedef struct {
     int drawMiniMap;
     int drawTexturedFloor;
     int drawCeiling;
+    int floorMode;                   /* RAY_FLOOR_MODE_COLUMNS / RAY_FLOOR_MODE_SPANS */
     int drawWalls;
     int drawWeapon;
     int fogOn;
@@ -283,6 +669,9 @@ typedef struct {
     uint8_t fog_r, fog_g, fog_b;  /* Color del fog (RGB) */
     float fog_start_distance;     /* Distancia donde empieza el fog */
     float fog_end_distance;       /* Distancia donde el fog es completo */
+    uint8_t fogTable[RAY_FOG_TABLE_SIZE]; /* Factor 0-255 por distancia (ray_fog_build) */
+    float fogTableScale;          /* Entradas de fogTable por unidad de distancia */
+    uint32_t fogColor;            /* fog_r/g/b empaquetado como los texels */
     
     /* Minimapa configuration */
     int minimap_size;             /* Tamaño del minimapa en pixels */
@@ -354,6 +743,12 @@ extern int64_t libmod_ray_get_flag_y(INSTANCE *my, int64_t *params);
 extern int64_t libmod_ray_get_flag_z(INSTANCE *my, int64_t *params);
 extern int64_t libmod_ray_update_sprite_position(INSTANCE *my, int64_t *params);
 extern int64_t libmod_ray_set_minimap(INSTANCE *my, int64_t *params);
+extern int64_t libmod_ray_set_threads(INSTANCE *my, int64_t *params);
+extern int64_t libmod_ray_set_floor_mode(INSTANCE *my, int64_t *params);
+extern int64_t libmod_ray_set_chunk_budget(INSTANCE *my, int64_t *params);
+
+/* Estadísticas */
+extern int64_t libmod_ray_get_stats(INSTANCE *my, int64_t *params);
 
 /* ============================================================================
    FUNCIONES INTERNAS - Declaraciones
@@ -361,28 +756,121 @@ extern int64_t libmod_ray_set_minimap(INSTANCE *my, int64_t *params);
 
 /* Raycasting */
 void ray_raycaster_create_grids(RAY_Raycaster *rc, int width, int height, int count, int tileSize);
+void ray_strip_ray(RAY_Ray *ray, int strip, float playerRot, float cosRot, float sinRot);
 void ray_raycaster_raycast(RAY_Raycaster *rc, RAY_RayHit *hits, int *num_hits,
                            int playerX, int playerY, float playerZ,
-                           float playerRot, float stripAngle, int stripIdx,
-                           RAY_Sprite *sprites, int num_sprites);
+                           const RAY_Ray *ray);
 float ray_screen_distance(float screenWidth, float fovRadians);
 float ray_strip_angle(float screenX, float screenDistance);
 float ray_strip_screen_height(float screenDistance, float correctDistance, float tileSize);
 
 /* ThinWalls Raycasting */
 void ray_find_intersecting_thin_walls(RAY_RayHit *hits, int *num_hits,
+                                      RAY_RayHitCold *cold, int *num_cold,
                                       RAY_ThickWall **thickWalls, int num_thick_walls,
                                       float playerX, float playerY,
-                                      float rayEndX, float rayEndY);
+                                      float rayEndX, float rayEndY,
+                                      uint32_t rayStamp, int worker);
 void ray_raycast_thin_walls(RAY_RayHit *hits, int *num_hits,
+                            RAY_RayHitCold *cold, int *num_cold,
                             RAY_ThickWall **thickWalls, int num_thick_walls,
                             float playerX, float playerY, float playerZ,
                             float playerRot, float stripAngle, int stripIdx,
-                            int gridWidth, int tileSize);
-int ray_find_sibling_at_angle(RAY_RayHit *rayHit, float originAngle, float playerRot,
+                            int worker, int gridWidth, int tileSize);
+int ray_find_sibling_at_angle(RAY_RayHitCold *rayHit, float originAngle, float playerRot,
                                float playerX, float playerY,
                                int gridWidth, int tileSize);
 
+/* Frame arena */
+int ray_arena_init(RAY_FrameArena *arena, size_t capacity);
+void ray_arena_free(RAY_FrameArena *arena);
+int ray_arena_begin_frame(RAY_FrameArena *arena, size_t needed);
+void *ray_arena_alloc(RAY_FrameArena *arena, size_t size);
+void ray_arena_end_frame(RAY_FrameArena *arena);
+size_t ray_arena_frame_bytes(int rayCount, int spriteCount);
+
+/* Hilos del render */
+int ray_threads_init(int count);
+void ray_threads_shutdown(void);
+int ray_threads_count(void);
+void ray_threads_run(int items, int band, RAY_ThreadJob job, void *ctx);
+
+/* Sprites */
+int ray_sprite_store_init(int capacity);
+void ray_sprite_store_free(void);
+void ray_sprite_store_clear(void);
+RAY_Sprite *ray_sprite_alloc(int64_t *handle);
+int ray_sprite_index(int64_t handle);
+RAY_Sprite *ray_sprite_get(int64_t handle);
+void ray_sprite_remove_at(int index);
+void ray_sprite_collect(void);
+
+/* Caché de tramos de sprites */
+RAY_SpriteRLE *ray_sprite_rle_get(GRAPH *graph);
+RAY_SpriteRLE *ray_sprite_rle_for(RAY_Sprite *sprite, GRAPH *graph);
+void ray_sprite_rle_cache_free(void);
+
+/* Índice de ThinWalls */
+void ray_thin_wall_grid_build(void);
+void ray_thin_wall_grid_free(void);
+void ray_thin_wall_grid_begin_frame(int rayCount);
+
+/* Física a paso fijo */
+void ray_update_physics(float delta_time);
+void ray_physics_advance(void);
+void ray_camera_snap(void);
+void ray_sprite_snap(RAY_Sprite *sprite);
+
+/* Puertas */
+int ray_door_table_build(void);
+void ray_door_table_free(void);
+RAY_Door *ray_door_at(int cell);
+void ray_door_toggle(RAY_Door *door);
+void ray_update_doors(float delta_time);
+
+int ray_door_register(int cell);
+
+/* Minimapa */
+void ray_minimap_invalidate(void);
+void ray_minimap_invalidate_cell(int x, int y);
+void ray_minimap_invalidate_area(int x, int y, int w, int h);
+void ray_minimap_free(void);
+
+/* Archivo de mapa (v1-v6 en libmod_ray_map.c, v7 en libmod_ray_mapfile.c) */
+int ray_load_map_from_file(const char *filename, int fpg_id);
+int ray_map_file_open(RAY_MapFile *file, const char *filename);
+void ray_map_file_close(RAY_MapFile *file);
+int ray_load_map_sectioned(const char *filename);
+void ray_free_map(void);
+void ray_map_free_source_grids(void);
+void ray_map_release_grids(void);
+int ray_map_decode(uint32_t codec, const uint8_t *src, uint64_t size, void *dst, size_t bytes);
+int ray_map_clean_grid(int *grid, int cells);
+
+/* Mundo por chunks */
+int ray_world_build_flat(void);
+int ray_world_stream(const void *table, int count, const uint8_t *data, uint64_t size);
+void ray_world_update(void);
+void ray_world_free(void);
+
+/* Estadísticas del frame */
+void ray_stats_begin_frame(void);
+void ray_stats_commit(float *values);
+void ray_stats_reset(void);
+double ray_stats_ms(uint64_t ticks);
+
+/* Fog */
+void ray_fog_init(void);
+void ray_fog_build(void);
+void ray_fog_blend_span(uint32_t *pixels, const uint8_t *factors, int count);
+
+/* Texture cache */
+void ray_texture_cache_build(int fpg_id);
+void ray_texture_cache_free(void);
+RAY_Texture *ray_texture_load(int graph_id);
+RAY_Texture *ray_texture_load_wall(int graph_id);
+void ray_texture_cache_load_cells(const RAY_Cell *cells, size_t count);
+
 /* Shape */
 int ray_lines_intersect(float x1, float y1, float x2, float y2,
                         float x3, float y3, float x4, float y4,
@@ -0,0 +1,117 @@
+/*
+ * libmod_ray_arena.c - Frame Arena
+ * Memoria temporal del frame: se reserva una vez en RAY_INIT y se reutiliza
+ * en cada frame, de modo que en régimen estable no hay llamadas al heap.
+ */
+
+#include "libmod_ray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* Redondear al alineamiento de la arena (línea de caché) */
+static size_t ray_arena_align(size_t size)
+{
+    return (size + (RAY_ARENA_ALIGN - 1)) & ~(size_t)(RAY_ARENA_ALIGN - 1);
+}
+
+/* ============================================================================
+   CICLO DE VIDA
+   ============================================================================ */
+
+int ray_arena_init(RAY_FrameArena *arena, size_t capacity)
+{
+    memset(arena, 0, sizeof(RAY_FrameArena));
+
+    capacity = ray_arena_align(capacity);
+    if (capacity == 0) {
+        return 1;
+    }
+
+    arena->base = (uint8_t*)malloc(capacity);
+    if (!arena->base) {
+        fprintf(stderr, "RAY: Error al reservar frame arena (%zu bytes)\n", capacity);
+        return 0;
+    }
+    arena->capacity = capacity;
+    return 1;
+}
+
+void ray_arena_free(RAY_FrameArena *arena)
+{
+    if (arena->base) {
+        free(arena->base);
+    }
+    memset(arena, 0, sizeof(RAY_FrameArena));
+}
+
+/* ============================================================================
+   USO POR FRAME
+   ============================================================================ */
+
+/* Prepara la arena para un frame que necesita 'needed' bytes.
+ * Solo toca el heap si la reserva actual no alcanza (p.ej. cambió rayCount). */
+int ray_arena_begin_frame(RAY_FrameArena *arena, size_t needed)
+{
+    needed = ray_arena_align(needed);
+
+    if (needed > arena->capacity) {
+        /* El contenido no sobrevive entre frames: no hace falta realloc */
+        uint8_t *block = (uint8_t*)malloc(needed);
+        if (!block) {
+            fprintf(stderr, "RAY: Error al ampliar frame arena a %zu bytes\n", needed);
+            return 0;
+        }
+        if (arena->base) {
+            free(arena->base);
+        }
+        arena->base = block;
+        arena->capacity = needed;
+        arena->grow_count++;
+        printf("RAY: Frame arena ampliada a %zu bytes\n", needed);
+    }
+
+    arena->used = 0;
+    return 1;
+}
+
+void *ray_arena_alloc(RAY_FrameArena *arena, size_t size)
+{
+    size = ray_arena_align(size);
+    if (!arena->base || arena->used + size > arena->capacity) {
+        return NULL;
+    }
+
+    void *ptr = arena->base + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+void ray_arena_end_frame(RAY_FrameArena *arena)
+{
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+}
+
+/* Bytes que necesita ray_render_frame para un rayCount y número de sprites */
+size_t ray_arena_frame_bytes(int rayCount, int spriteCount)
+{
+    if (rayCount <= 0) return 0;
+    if (spriteCount < 0) spriteCount = 0;
+
+    size_t count = (size_t)rayCount;
+    return ray_arena_align(count * RAY_MAX_RAYHITS * sizeof(RAY_RayHit)) +  /* hits */
+           ray_arena_align(count * RAY_MAX_COLD_HITS * sizeof(RAY_RayHitCold)) + /* cold */
+           ray_arena_align(count * RAY_MAX_RAYHITS * sizeof(uint16_t)) +    /* hit_order */
+           ray_arena_align((size_t)RAY_MAX_THREADS * 2 * RAY_MAX_RAYHITS *
+                           sizeof(RAY_HitKey)) +                            /* claves de orden por hilo */
+           ray_arena_align(count * sizeof(int)) +                           /* rayhit_counts */
+           ray_arena_align(count * sizeof(float)) +                         /* z_buffer */
+           ray_arena_align(count * sizeof(int)) * 2 +                       /* floor_start, ceiling_end */
+           ray_arena_align((size_t)spriteCount * 2 * sizeof(RAY_HitKey)) +  /* orden de sprites */
+           ray_arena_align((size_t)spriteCount * sizeof(RAY_SpriteProjection)) + /* sprites visibles */
+           ray_arena_align(((size_t)spriteCount + 1) * 3 * sizeof(float)) + /* posiciones simuladas */
+           ray_arena_align((count + RAY_ZTILE_STRIPS - 1) / RAY_ZTILE_STRIPS *
+                           sizeof(float)) * 2;                              /* z-buffer min/max por tile */
+}
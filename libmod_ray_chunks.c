@@ -0,0 +1,831 @@
+/*
+ * libmod_ray_chunks.c - Mundo por chunks
+ * El motor lee las celdas del mapa a través de g_engine.world, siempre
+ * empaquetadas en RAY_Cell. Un mapa normal es un único chunk que se
+ * empaqueta al cargar a partir de sus grids. Un .raymap
+ * guardado por chunks (RAY_SECTION_CHUNKS) no se carga entero:
+ * ray_world_update, al principio de cada frame, carga en el momento los
+ * chunks que rodean a la cámara y encola en un hilo de carga los de
+ * alrededor, empezando por los que quedan delante y siguiendo unos cuantos
+ * más en la dirección en la que mira.
+ *
+ * La memoria para chunks es fija (RAY_SET_CHUNK_BUDGET): un slot por chunk
+ * residente. Sin slots libres se expulsa el chunk residente que hace más
+ * tiempo que no se pide (LRU); un chunk no residente se dibuja con su proxy.
+ *
+ * El hilo de carga solo descomprime y empaqueta en el slot del chunk. Publicarlo
+ * (punteros, puertas y minimapa) lo hace siempre el hilo principal en
+ * ray_world_update, así que el render nunca ve un chunk a medio cargar.
+ * Las puertas se quedan en la tabla aunque su chunk se expulse: su estado
+ * se conserva al volver a cargarlo.
+ */
+
+#include "libmod_ray.h"
+#include "libmod_ray_mapfile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+extern RAY_Engine g_engine;
+
+/* Estado de carga de cada chunk */
+#define RAY_CHUNK_EMPTY    0         /* Sin datos: se dibuja el proxy */
+#define RAY_CHUNK_QUEUED   1         /* Con slot, esperando al hilo de carga */
+#define RAY_CHUNK_LOADING  2         /* El hilo de carga lo está descomprimiendo */
+#define RAY_CHUNK_LOADED   3         /* Descomprimido, pendiente de publicar */
+#define RAY_CHUNK_RESIDENT 4         /* Publicado: lo lee el render */
+#define RAY_CHUNK_FAILED   5         /* Datos inválidos: se queda con el proxy */
+
+#define RAY_CHUNK_MIN_SLOTS 16       /* Aunque el presupuesto no dé para más */
+#define RAY_CHUNK_MAX_RADIUS 8       /* Radio máximo, en chunks, del anillo de precarga */
+
+/* Bitmaps de un chunk de 64x64, por nivel */
+#define RAY_CHUNK_OCCUPANCY_WORDS (RAY_MAPFILE_CHUNK_CELLS / 64)
+#define RAY_CHUNK_BLOCK_STRIDE (RAY_MAPFILE_CHUNK_SIZE >> RAY_CHUNK_BLOCK_SHIFT)
+#define RAY_CHUNK_BLOCK_WORDS ((RAY_CHUNK_BLOCK_STRIDE * RAY_CHUNK_BLOCK_STRIDE + 63) / 64)
+
+typedef struct {
+    int index;
+    float key;                       /* Prioridad: menor = antes */
+} RAY_ChunkWant;
+
+typedef struct {
+    /* Directorio y bloques, dentro de la proyección del archivo */
+    const RAY_MapFileChunk *table;
+    const uint8_t *data;
+    uint64_t dataSize;
+    int count;                       /* Chunks del mapa */
+    int levels;                      /* Niveles con paredes en el archivo */
+    size_t blockBytes;               /* Un bloque descomprimido */
+    uint8_t *scratch[2];             /* Bloque descomprimido: hilo de carga y principal */
+
+    /* Slots */
+    RAY_Cell *memory;                /* numSlots * slotCells */
+    size_t slotCells;                /* RAY_Cell de un chunk empaquetado */
+    uint64_t *bits;                  /* numSlots * slotWords: ocupación y bloques */
+    size_t slotWords;
+    uint32_t *slotLevelMask;         /* Niveles con pared del chunk de cada slot */
+    int numSlots;
+    int *slotChunk;                  /* Chunk de cada slot, -1 = libre */
+
+    /* Por chunk */
+    int *slotOf;                     /* -1 = sin slot */
+    uint8_t *state;                  /* RAY_CHUNK_*; con 'lock' si lo ve el hilo de carga */
+    uint8_t *inQueue;                /* 1 = tiene una entrada en 'queue' */
+    uint32_t *lastWanted;            /* Último ray_world_update que lo pidió */
+    uint32_t frame;
+
+    /* Chunks pedidos en el ray_world_update actual, por prioridad */
+    RAY_ChunkWant *wants;
+    int numWants;
+    int radius;                      /* Anillo de precarga alrededor de la cámara */
+
+    /* Hilo de carga */
+    SDL_Thread *thread;
+    SDL_sem *wake;                   /* Un post por chunk encolado */
+    SDL_sem *finished;               /* Un post cuando termina el chunk 'waiting' */
+    int waiting;                     /* Chunk que espera el hilo principal, -1 = ninguno */
+    SDL_SpinLock lock;               /* Protege state, inQueue, queue, done y waiting */
+    int *queue;                      /* Anillo de 'count' entradas */
+    int queueHead, queueSize;
+    int *done;                       /* Terminados (LOADED o FAILED) sin publicar */
+    int numDone;
+    int quit;
+} RAY_ChunkStream;
+
+static RAY_ChunkStream g_stream;
+
+/* ============================================================================
+   EMPAQUETADO
+   ============================================================================ */
+
+/* Redondeo al entero más cercano (floor de x + 0.5) sin pasar por libm */
+static int16_t ray_cell_fixed(float value, float scale, int *clamped)
+{
+    float q = value * scale + 0.5f;
+    if (!(q < 32768.0f && q >= -32768.0f)) {
+        (*clamped)++;
+        return q > 0.0f ? 32767 : -32768;
+    }
+    int i = (int)q;
+    if ((float)i > q) i--;
+    return (int16_t)i;
+}
+
+static uint16_t ray_cell_id(int id, int *clamped)
+{
+    if (id <= 0) return 0;
+    if (id > 0xFFFF) {
+        (*clamped)++;
+        return 0;
+    }
+    return (uint16_t)id;
+}
+
+/* Un nivel de las celdas [first, end) en 'dst' (la celda i en
+ * dst[i * levels]). Cualquier grid puede ser NULL; sin altura, o con
+ * altura 0, la pared es de un tile. Devuelve los valores que no caben en
+ * el registro */
+static int ray_cell_pack_level(RAY_Cell *dst, int levels, int first, int end, const int *walls,
+                               const float *heights, const float *zOffsets, const int *floors,
+                               const int *ceilings, const float *floorHeights)
+{
+    const float tileSize = (float)g_engine.raycaster.tileSize;
+    int clamped = 0;
+
+    for (int i = first; i < end; i++) {
+        RAY_Cell *cell = &dst[(size_t)i * levels];
+        int wall = walls ? walls[i] : 0;
+        float height = heights && heights[i] != 0.0f ? heights[i] : tileSize;
+
+        cell->wall = ray_cell_id(wall, &clamped);
+        cell->flags = (cell->wall ? RAY_CELL_WALL : 0) | (ray_is_door(cell->wall) ? RAY_CELL_DOOR : 0);
+        cell->floor = ray_cell_id(floors ? floors[i] : 0, &clamped);
+        cell->ceiling = ray_cell_id(ceilings ? ceilings[i] : 0, &clamped);
+        cell->height = ray_cell_fixed(height, RAY_CELL_HEIGHT_SCALE, &clamped);
+        cell->zOffset = ray_cell_fixed(zOffsets ? zOffsets[i] : 0.0f, RAY_CELL_HEIGHT_SCALE, &clamped);
+        cell->floorHeight = ray_cell_fixed(floorHeights ? floorHeights[i] : 0.0f,
+                                           RAY_CELL_FLOOR_SCALE, &clamped);
+        cell->reserved = 0;
+    }
+    return clamped;
+}
+
+/* Celdas que se empaquetan de una vez en todos los niveles antes de pasar
+ * a las siguientes, para escribir cada línea de 'dst' mientras sigue en caché */
+#define RAY_CELL_PACK_BLOCK 1024
+
+/* RAY_Cell por celda: los niveles con paredes y, como mínimo, los tres de
+ * suelo y techo */
+static int ray_world_levels(int gridCount)
+{
+    return gridCount > 3 ? gridCount : 3;
+}
+
+/* ============================================================================
+   OCUPACIÓN
+   ============================================================================ */
+
+/* Palabras de 64 bits para 'bits' bits */
+static int ray_bits_words(int bits)
+{
+    return (bits + 63) >> 6;
+}
+
+/* Bitmaps de ocupación y de bloques de 8x8 de 'rows' filas de 'stride'
+ * celdas empaquetadas. 'occupancy' y 'blocks' tienen occupancyWords y
+ * blockWords palabras por nivel. Devuelve los niveles (< 32) con pared */
+static uint32_t ray_chunk_build_bits(const RAY_Cell *cells, int levels, int stride, int rows,
+                                     uint64_t *occupancy, int occupancyWords,
+                                     uint64_t *blocks, int blockWords, int blockStride)
+{
+    uint32_t levelMask = 0;
+
+    memset(occupancy, 0, (size_t)levels * occupancyWords * sizeof(uint64_t));
+    memset(blocks, 0, (size_t)levels * blockWords * sizeof(uint64_t));
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < stride; x++) {
+            int cell = y * stride + x;
+            int block = (y >> RAY_CHUNK_BLOCK_SHIFT) * blockStride + (x >> RAY_CHUNK_BLOCK_SHIFT);
+            const RAY_Cell *rec = cells + (size_t)cell * levels;
+            for (int level = 0; level < levels; level++) {
+                if (!(rec[level].flags & RAY_CELL_WALL)) continue;
+                occupancy[level * occupancyWords + (cell >> 6)] |= (uint64_t)1 << (cell & 63);
+                blocks[level * blockWords + (block >> 6)] |= (uint64_t)1 << (block & 63);
+                if (level < 32) levelMask |= 1u << level;
+            }
+        }
+    }
+    return levelMask;
+}
+
+/* ============================================================================
+   MAPA NORMAL: UN SOLO CHUNK
+   ============================================================================ */
+
+/* Chunk único con todo el mapa, empaquetado desde los grids del
+ * raycaster y de suelo/techo. Se llama cuando ya están cargados; si sale
+ * bien los grids se liberan, porque todo lee ya de los RAY_Cell */
+int ray_world_build_flat(void)
+{
+    RAY_World *world = &g_engine.world;
+    RAY_Raycaster *rc = &g_engine.raycaster;
+
+    ray_world_free();
+
+    int levels = ray_world_levels(rc->gridCount);
+    int count = rc->gridWidth * rc->gridHeight;
+    RAY_Chunk *chunk = (RAY_Chunk*)calloc(1, sizeof(RAY_Chunk));
+    RAY_Cell *cells = (RAY_Cell*)malloc((size_t)count * levels * sizeof(RAY_Cell));
+    int occupancyWords = ray_bits_words(count);
+    int blockStride = (rc->gridWidth + 7) >> RAY_CHUNK_BLOCK_SHIFT;
+    int blockWords = ray_bits_words(blockStride * ((rc->gridHeight + 7) >> RAY_CHUNK_BLOCK_SHIFT));
+    uint64_t *bits = (uint64_t*)malloc((size_t)levels * (occupancyWords + blockWords) * sizeof(uint64_t));
+    if (!chunk || !cells || !bits) {
+        fprintf(stderr, "RAY: Error al asignar memoria para el mundo\n");
+        free(chunk);
+        free(cells);
+        free(bits);
+        return 0;
+    }
+
+    int clamped = 0;
+    for (int first = 0; first < count; first += RAY_CELL_PACK_BLOCK) {
+        int end = first + RAY_CELL_PACK_BLOCK < count ? first + RAY_CELL_PACK_BLOCK : count;
+        for (int level = 0; level < levels; level++) {
+            int walled = rc->grids && level < rc->gridCount;
+            int flat = level < 3;
+            clamped += ray_cell_pack_level(cells + level, levels, first, end,
+                                           walled ? rc->grids[level] : NULL,
+                                           walled && rc->heightGrids ? rc->heightGrids[level] : NULL,
+                                           walled && rc->zOffsetGrids ? rc->zOffsetGrids[level] : NULL,
+                                           flat ? g_engine.floorGrids[level] : NULL,
+                                           flat ? g_engine.ceilingGrids[level] : NULL,
+                                           flat ? g_engine.floorHeightGrids[level] : NULL);
+        }
+    }
+    if (clamped > 0) {
+        fprintf(stderr, "RAY: %d valores del mapa no caben en una celda y se han recortado\n", clamped);
+    }
+
+    chunk->cells = cells;
+    chunk->stride = rc->gridWidth;
+    chunk->numCells = count;
+    chunk->occupancy = bits;
+    chunk->blocks = bits + (size_t)levels * occupancyWords;
+    chunk->occupancyWords = occupancyWords;
+    chunk->blockWords = blockWords;
+    chunk->blockStride = blockStride;
+    chunk->levelMask = ray_chunk_build_bits(cells, levels, rc->gridWidth, rc->gridHeight,
+                                            chunk->occupancy, occupancyWords,
+                                            chunk->blocks, blockWords, blockStride);
+    chunk->resident = 1;
+
+    /* Un chunk tan grande como el mapa: (x >> shift) es siempre 0 */
+    int size = rc->gridWidth > rc->gridHeight ? rc->gridWidth : rc->gridHeight;
+    int shift = 0;
+    while ((1 << shift) < size) shift++;
+
+    world->chunks = chunk;
+    world->chunksX = 1;
+    world->chunksY = 1;
+    world->shift = shift;
+    world->mask = (1 << shift) - 1;
+    world->levels = levels;
+    world->levelMask = chunk->levelMask;
+    world->streaming = 0;
+    world->resident = 1;
+    world->loads = 0;
+
+    ray_map_free_source_grids();
+    return 1;
+}
+
+/* ============================================================================
+   HILO DE CARGA
+   ============================================================================ */
+
+/* Descomprime el chunk en 'block' y lo empaqueta en su slot. Solo lee el
+ * archivo y escribe en 'block' y en el slot */
+static int ray_chunk_decode(int index, int slot, uint8_t *block)
+{
+    const RAY_MapFileChunk *entry = &g_stream.table[index];
+    RAY_Cell *dst = g_stream.memory + (size_t)slot * g_stream.slotCells;
+    int levels = g_stream.levels;
+
+    if (entry->offset > g_stream.dataSize || entry->size > g_stream.dataSize - entry->offset) {
+        return 0;
+    }
+    if (ray_map_decode(entry->codec, g_stream.data + entry->offset, entry->size,
+                       block, g_stream.blockBytes) <= 0) {
+        return 0;
+    }
+
+    /* Planos del bloque: paredes, altura y Z-offset por nivel y después
+     * suelo, techo y altura de suelo de los niveles 0-2 */
+    for (int level = 0; level < levels; level++) {
+        ray_map_clean_grid((int*)(block + (size_t)3 * level * RAY_MAPFILE_CHUNK_CELLS * 4),
+                           RAY_MAPFILE_CHUNK_CELLS);
+    }
+
+    int worldLevels = ray_world_levels(levels);
+    for (int first = 0; first < RAY_MAPFILE_CHUNK_CELLS; first += RAY_CELL_PACK_BLOCK) {
+        for (int level = 0; level < worldLevels; level++) {
+            const uint8_t *planes[6] = { NULL };
+            for (int p = 0; p < 3 && level < levels; p++) {
+                planes[p] = block + (size_t)(3 * level + p) * RAY_MAPFILE_CHUNK_CELLS * 4;
+            }
+            for (int p = 0; p < 3 && level < 3; p++) {
+                planes[3 + p] = block + (size_t)(3 * levels + 3 * level + p) * RAY_MAPFILE_CHUNK_CELLS * 4;
+            }
+
+            /* Lo que no cabe se recorta sin avisar: no hay consola desde este hilo */
+            ray_cell_pack_level(dst + level, worldLevels, first, first + RAY_CELL_PACK_BLOCK,
+                                (const int*)planes[0], (const float*)planes[1], (const float*)planes[2],
+                                (const int*)planes[3], (const int*)planes[4], (const float*)planes[5]);
+        }
+    }
+
+    uint64_t *occupancy = g_stream.bits + (size_t)slot * g_stream.slotWords;
+    g_stream.slotLevelMask[slot] =
+        ray_chunk_build_bits(dst, worldLevels, RAY_MAPFILE_CHUNK_SIZE, RAY_MAPFILE_CHUNK_SIZE,
+                             occupancy, RAY_CHUNK_OCCUPANCY_WORDS,
+                             occupancy + (size_t)worldLevels * RAY_CHUNK_OCCUPANCY_WORDS,
+                             RAY_CHUNK_BLOCK_WORDS, RAY_CHUNK_BLOCK_STRIDE);
+    return 1;
+}
+
+static int ray_chunk_loader_main(void *data)
+{
+    (void)data;
+
+    for (;;) {
+        SDL_SemWait(g_stream.wake);
+
+        /* Siguiente chunk que siga encolado (los cancelados se saltan) */
+        int index = -1;
+        SDL_AtomicLock(&g_stream.lock);
+        if (g_stream.quit) {
+            SDL_AtomicUnlock(&g_stream.lock);
+            break;
+        }
+        while (g_stream.queueSize > 0 && index < 0) {
+            int c = g_stream.queue[g_stream.queueHead];
+            g_stream.queueHead = (g_stream.queueHead + 1) % g_stream.count;
+            g_stream.queueSize--;
+            g_stream.inQueue[c] = 0;
+            if (g_stream.state[c] == RAY_CHUNK_QUEUED) {
+                g_stream.state[c] = RAY_CHUNK_LOADING;
+                index = c;
+            }
+        }
+        int slot = index >= 0 ? g_stream.slotOf[index] : -1;
+        SDL_AtomicUnlock(&g_stream.lock);
+        if (index < 0) continue;
+
+        int ok = ray_chunk_decode(index, slot, g_stream.scratch[0]);
+
+        SDL_AtomicLock(&g_stream.lock);
+        g_stream.state[index] = ok ? RAY_CHUNK_LOADED : RAY_CHUNK_FAILED;
+        g_stream.done[g_stream.numDone++] = index;
+        int waited = g_stream.waiting == index;
+        if (waited) g_stream.waiting = -1;
+        SDL_AtomicUnlock(&g_stream.lock);
+        if (waited) SDL_SemPost(g_stream.finished);
+    }
+    return 0;
+}
+
+/* ============================================================================
+   SLOTS Y PUBLICACIÓN (hilo principal)
+   ============================================================================ */
+
+/* El hilo de carga cambia 'state' con el lock: aquí se lee y se escribe
+ * también con él */
+static int ray_chunk_get_state(int index)
+{
+    SDL_AtomicLock(&g_stream.lock);
+    int state = g_stream.state[index];
+    SDL_AtomicUnlock(&g_stream.lock);
+    return state;
+}
+
+static void ray_chunk_set_state(int index, int state)
+{
+    SDL_AtomicLock(&g_stream.lock);
+    g_stream.state[index] = (uint8_t)state;
+    SDL_AtomicUnlock(&g_stream.lock);
+}
+
+static void ray_chunk_area(int index, int *x, int *y)
+{
+    *x = (index % g_engine.world.chunksX) << g_engine.world.shift;
+    *y = (index / g_engine.world.chunksX) << g_engine.world.shift;
+}
+
+static void ray_chunk_release_slot(int index)
+{
+    int slot = g_stream.slotOf[index];
+    if (slot < 0) return;
+    g_stream.slotChunk[slot] = -1;
+    g_stream.slotOf[index] = -1;
+}
+
+/* El chunk vuelve a su proxy y deja libre su slot */
+static void ray_chunk_evict(int index)
+{
+    RAY_World *world = &g_engine.world;
+    RAY_Chunk *chunk = &world->chunks[index];
+
+    chunk->resident = 0;
+    chunk->cells = NULL;
+    chunk->occupancy = NULL;
+    chunk->blocks = NULL;
+    chunk->levelMask = 0;
+    world->resident--;
+
+    ray_chunk_set_state(index, RAY_CHUNK_EMPTY);
+    ray_chunk_release_slot(index);
+
+    int x, y;
+    ray_chunk_area(index, &x, &y);
+    ray_minimap_invalidate_area(x, y, RAY_MAPFILE_CHUNK_SIZE, RAY_MAPFILE_CHUNK_SIZE);
+}
+
+/* Slot libre, o el del chunk residente que hace más que no se pide;
+ * -1 si todos los slots están en uso este frame */
+static int ray_chunk_alloc_slot(void)
+{
+    int best = -1;
+    for (int slot = 0; slot < g_stream.numSlots; slot++) {
+        int c = g_stream.slotChunk[slot];
+        if (c < 0) return slot;
+        if (g_stream.lastWanted[c] == g_stream.frame || ray_chunk_get_state(c) != RAY_CHUNK_RESIDENT) continue;
+        if (best < 0 || g_stream.lastWanted[c] < g_stream.lastWanted[g_stream.slotChunk[best]]) {
+            best = slot;
+        }
+    }
+    if (best < 0) return -1;
+
+    ray_chunk_evict(g_stream.slotChunk[best]);
+    return best;
+}
+
+static int ray_chunk_assign_slot(int index)
+{
+    if (g_stream.slotOf[index] >= 0) return 1;
+
+    int slot = ray_chunk_alloc_slot();
+    if (slot < 0) return 0;
+    g_stream.slotChunk[slot] = index;
+    g_stream.slotOf[index] = slot;
+    return 1;
+}
+
+/* Chunk ya descomprimido (o fallido): lo hace visible al render */
+static void ray_chunk_publish(int index)
+{
+    RAY_World *world = &g_engine.world;
+    RAY_Chunk *chunk = &world->chunks[index];
+
+    int state = ray_chunk_get_state(index);
+    if (state == RAY_CHUNK_FAILED) {
+        fprintf(stderr, "RAY: Chunk %d inválido, se queda con su proxy\n", index);
+        ray_chunk_release_slot(index);
+        return;
+    }
+    if (state != RAY_CHUNK_LOADED) return;
+
+    int slot = g_stream.slotOf[index];
+    chunk->cells = g_stream.memory + (size_t)slot * g_stream.slotCells;
+    chunk->occupancy = g_stream.bits + (size_t)slot * g_stream.slotWords;
+    chunk->blocks = chunk->occupancy + (size_t)world->levels * RAY_CHUNK_OCCUPANCY_WORDS;
+    chunk->levelMask = g_stream.slotLevelMask[slot];
+    world->levelMask |= chunk->levelMask;
+    chunk->resident = 1;
+    ray_chunk_set_state(index, RAY_CHUNK_RESIDENT);
+    world->resident++;
+    world->loads++;
+
+    /* Puertas del chunk (las que ya estaban conservan su estado) */
+    int x0, y0;
+    ray_chunk_area(index, &x0, &y0);
+    for (int level = 0; level < g_stream.levels; level++) {
+        for (int i = 0; i < RAY_MAPFILE_CHUNK_CELLS; i++) {
+            if (!(ray_chunk_levels(world, chunk, i)[level].flags & RAY_CELL_DOOR)) continue;
+            int x = x0 + (i & world->mask);
+            int y = y0 + (i >> world->shift);
+            if (!ray_door_register(x + y * g_engine.raycaster.gridWidth)) {
+                fprintf(stderr, "RAY: Error al asignar memoria para doors\n");
+                break;
+            }
+        }
+    }
+
+    /* Texturas que el chunk trae nuevas, antes de que lo vean los hilos del render */
+    ray_texture_cache_load_cells(chunk->cells, (size_t)RAY_MAPFILE_CHUNK_CELLS * world->levels);
+
+    ray_minimap_invalidate_area(x0, y0, RAY_MAPFILE_CHUNK_SIZE, RAY_MAPFILE_CHUNK_SIZE);
+}
+
+/* Publica lo que el hilo de carga ha terminado desde la última vez */
+static void ray_chunk_publish_done(void)
+{
+    for (;;) {
+        int index = -1;
+        SDL_AtomicLock(&g_stream.lock);
+        if (g_stream.numDone > 0) index = g_stream.done[--g_stream.numDone];
+        SDL_AtomicUnlock(&g_stream.lock);
+        if (index < 0) break;
+        ray_chunk_publish(index);
+    }
+}
+
+/* Residente ya: lo que esté encolado se carga aquí mismo y lo que esté
+ * cargando el hilo se espera hasta que el hilo avisa de que ha terminado */
+static void ray_chunk_require(int index)
+{
+    SDL_AtomicLock(&g_stream.lock);
+    int state = g_stream.state[index];
+    if (state == RAY_CHUNK_QUEUED) {
+        g_stream.state[index] = state = RAY_CHUNK_EMPTY;   /* El hilo se lo saltará */
+    } else if (state == RAY_CHUNK_LOADING) {
+        g_stream.waiting = index;
+    }
+    SDL_AtomicUnlock(&g_stream.lock);
+
+    if (state == RAY_CHUNK_LOADING) {
+        SDL_SemWait(g_stream.finished);
+        ray_chunk_publish_done();
+        return;
+    }
+    if (state == RAY_CHUNK_LOADED) {
+        ray_chunk_publish_done();
+        return;
+    }
+    if (state != RAY_CHUNK_EMPTY || !ray_chunk_assign_slot(index)) return;
+
+    int ok = ray_chunk_decode(index, g_stream.slotOf[index], g_stream.scratch[1]);
+    ray_chunk_set_state(index, ok ? RAY_CHUNK_LOADED : RAY_CHUNK_FAILED);
+    ray_chunk_publish(index);
+}
+
+/* Al hilo de carga; 0 si no queda slot */
+static int ray_chunk_enqueue(int index)
+{
+    if (!ray_chunk_assign_slot(index)) return 0;
+
+    int post = 0;
+    SDL_AtomicLock(&g_stream.lock);
+    g_stream.state[index] = RAY_CHUNK_QUEUED;
+    if (!g_stream.inQueue[index]) {
+        int tail = (g_stream.queueHead + g_stream.queueSize) % g_stream.count;
+        g_stream.queue[tail] = index;
+        g_stream.queueSize++;
+        g_stream.inQueue[index] = 1;
+        post = 1;
+    }
+    SDL_AtomicUnlock(&g_stream.lock);
+
+    if (post) SDL_SemPost(g_stream.wake);
+    return 1;
+}
+
+/* ============================================================================
+   CHUNKS PEDIDOS POR LA CÁMARA
+   ============================================================================ */
+
+static void ray_chunk_want(int cx, int cy, float key)
+{
+    RAY_World *world = &g_engine.world;
+    if (cx < 0 || cy < 0 || cx >= world->chunksX || cy >= world->chunksY) return;
+
+    int index = cx + cy * world->chunksX;
+    if (g_stream.lastWanted[index] == g_stream.frame) return;
+    g_stream.lastWanted[index] = g_stream.frame;
+
+    RAY_ChunkWant *want = &g_stream.wants[g_stream.numWants++];
+    want->index = index;
+    want->key = key;
+}
+
+static int ray_chunk_want_compare(const void *a, const void *b)
+{
+    float ka = ((const RAY_ChunkWant*)a)->key;
+    float kb = ((const RAY_ChunkWant*)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+/* Anillo de 'radius' chunks alrededor de la cámara, ordenado por cercanía
+ * a un punto por delante de ella, y después una franja de tres chunks de
+ * ancho que sigue la dirección de la mirada */
+static void ray_chunk_collect_wants(int cx, int cy)
+{
+    float hx = cosf(g_engine.camera.rot);
+    float hy = -sinf(g_engine.camera.rot);
+    int radius = g_stream.radius;
+    float ax = hx * radius * 0.5f;
+    float ay = hy * radius * 0.5f;
+
+    g_stream.numWants = 0;
+    for (int dy = -radius; dy <= radius; dy++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+            float kx = dx - ax, ky = dy - ay;
+            ray_chunk_want(cx + dx, cy + dy, kx * kx + ky * ky);
+        }
+    }
+    qsort(g_stream.wants, g_stream.numWants, sizeof(RAY_ChunkWant), ray_chunk_want_compare);
+
+    for (int step = radius + 1; step <= 2 * radius; step++) {
+        int px = cx + (int)floorf(hx * step + 0.5f);
+        int py = cy + (int)floorf(hy * step + 0.5f);
+        int ox = (int)floorf(-hy + 0.5f);
+        int oy = (int)floorf(hx + 0.5f);
+        ray_chunk_want(px, py, 0.0f);
+        ray_chunk_want(px + ox, py + oy, 0.0f);
+        ray_chunk_want(px - ox, py - oy, 0.0f);
+    }
+}
+
+void ray_world_update(void)
+{
+    RAY_World *world = &g_engine.world;
+    if (!world->streaming) return;
+
+    g_stream.frame++;
+    ray_chunk_publish_done();
+
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    int cellX = (int)floorf(g_engine.camera.x / rc->tileSize);
+    int cellY = (int)floorf(g_engine.camera.y / rc->tileSize);
+    cellX = cellX < 0 ? 0 : (cellX >= rc->gridWidth ? rc->gridWidth - 1 : cellX);
+    cellY = cellY < 0 ? 0 : (cellY >= rc->gridHeight ? rc->gridHeight - 1 : cellY);
+    int cx = cellX >> world->shift;
+    int cy = cellY >> world->shift;
+
+    ray_chunk_collect_wants(cx, cy);
+
+    /* Lo encolado que ya no se pide deja libre su slot */
+    for (int slot = 0; slot < g_stream.numSlots; slot++) {
+        int c = g_stream.slotChunk[slot];
+        if (c < 0 || g_stream.lastWanted[c] == g_stream.frame) continue;
+        SDL_AtomicLock(&g_stream.lock);
+        int cancel = g_stream.state[c] == RAY_CHUNK_QUEUED;
+        if (cancel) g_stream.state[c] = RAY_CHUNK_EMPTY;
+        SDL_AtomicUnlock(&g_stream.lock);
+        if (cancel) ray_chunk_release_slot(c);
+    }
+
+    /* La celda de la cámara y sus vecinas no pueden esperar al hilo */
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int x = cx + dx, y = cy + dy;
+            if (x < 0 || y < 0 || x >= world->chunksX || y >= world->chunksY) continue;
+            ray_chunk_require(x + y * world->chunksX);
+        }
+    }
+
+    for (int i = 0; i < g_stream.numWants; i++) {
+        int index = g_stream.wants[i].index;
+        if (ray_chunk_get_state(index) != RAY_CHUNK_EMPTY) continue;
+        if (!ray_chunk_enqueue(index)) break;
+    }
+}
+
+/* ============================================================================
+   MAPA POR CHUNKS
+   ============================================================================ */
+
+/* Prepara el streaming de un mapa por chunks: 'table' son 'count'
+ * RAY_MapFileChunk y 'data' la sección de bloques, ambos dentro de la
+ * proyección del archivo. Ningún chunk queda residente hasta el primer
+ * ray_world_update */
+int ray_world_stream(const void *table, int count, const uint8_t *data, uint64_t size)
+{
+    RAY_World *world = &g_engine.world;
+    RAY_Raycaster *rc = &g_engine.raycaster;
+
+    ray_world_free();
+
+    int levels = rc->gridCount;
+    size_t blockBytes = (size_t)RAY_MAPFILE_CHUNK_PLANES(levels) * RAY_MAPFILE_CHUNK_CELLS * 4;
+    size_t slotCells = (size_t)ray_world_levels(levels) * RAY_MAPFILE_CHUNK_CELLS;
+    size_t slotWords = (size_t)ray_world_levels(levels) * (RAY_CHUNK_OCCUPANCY_WORDS + RAY_CHUNK_BLOCK_WORDS);
+    size_t slotBytes = slotCells * sizeof(RAY_Cell) + slotWords * sizeof(uint64_t);
+    size_t budget = world->budget > 0 ? world->budget : RAY_CHUNK_DEFAULT_BUDGET;
+    int slots = (int)(budget / slotBytes);
+    if (slots < RAY_CHUNK_MIN_SLOTS) slots = RAY_CHUNK_MIN_SLOTS;
+    if (slots > count) slots = count;
+
+    /* Anillo de precarga: como mucho medio presupuesto */
+    int radius = 1;
+    while (radius < RAY_CHUNK_MAX_RADIUS && (2 * radius + 3) * (2 * radius + 3) <= slots / 2) radius++;
+
+    g_stream.table = (const RAY_MapFileChunk*)table;
+    g_stream.data = data;
+    g_stream.dataSize = size;
+    g_stream.count = count;
+    g_stream.levels = levels;
+    g_stream.blockBytes = blockBytes;
+    g_stream.slotCells = slotCells;
+    g_stream.slotWords = slotWords;
+    g_stream.numSlots = slots;
+    g_stream.radius = radius;
+
+    world->chunks = (RAY_Chunk*)calloc(count, sizeof(RAY_Chunk));
+    g_stream.memory = (RAY_Cell*)malloc(slotCells * sizeof(RAY_Cell) * slots);
+    g_stream.bits = (uint64_t*)malloc(slotWords * sizeof(uint64_t) * slots);
+    g_stream.slotLevelMask = (uint32_t*)calloc(slots, sizeof(uint32_t));
+    g_stream.scratch[0] = (uint8_t*)malloc(blockBytes);
+    g_stream.scratch[1] = (uint8_t*)malloc(blockBytes);
+    g_stream.slotChunk = (int*)malloc(slots * sizeof(int));
+    g_stream.slotOf = (int*)malloc(count * sizeof(int));
+    g_stream.state = (uint8_t*)calloc(count, 1);
+    g_stream.inQueue = (uint8_t*)calloc(count, 1);
+    g_stream.lastWanted = (uint32_t*)calloc(count, sizeof(uint32_t));
+    g_stream.wants = (RAY_ChunkWant*)malloc(((2 * radius + 1) * (2 * radius + 1) + 3 * radius) *
+                                            sizeof(RAY_ChunkWant));
+    g_stream.queue = (int*)malloc(count * sizeof(int));
+    g_stream.done = (int*)malloc(count * sizeof(int));
+    g_stream.wake = SDL_CreateSemaphore(0);
+    g_stream.finished = SDL_CreateSemaphore(0);
+    g_stream.waiting = -1;
+    if (!world->chunks || !g_stream.memory || !g_stream.bits || !g_stream.slotLevelMask ||
+        !g_stream.scratch[0] || !g_stream.scratch[1] ||
+        !g_stream.slotChunk || !g_stream.slotOf || !g_stream.state ||
+        !g_stream.inQueue || !g_stream.lastWanted || !g_stream.wants || !g_stream.queue ||
+        !g_stream.done || !g_stream.wake || !g_stream.finished) {
+        fprintf(stderr, "RAY: Error al asignar memoria para %d chunks\n", slots);
+        ray_world_free();
+        return 0;
+    }
+
+    for (int slot = 0; slot < slots; slot++) g_stream.slotChunk[slot] = -1;
+
+    world->chunksX = RAY_MAPFILE_CHUNKS(rc->gridWidth);
+    world->chunksY = RAY_MAPFILE_CHUNKS(rc->gridHeight);
+    world->shift = RAY_MAPFILE_CHUNK_SHIFT;
+    world->mask = RAY_MAPFILE_CHUNK_SIZE - 1;
+    world->levels = ray_world_levels(levels);
+    world->streaming = 1;
+    for (int i = 0; i < count; i++) {
+        RAY_Chunk *chunk = &world->chunks[i];
+        chunk->stride = RAY_MAPFILE_CHUNK_SIZE;
+        chunk->numCells = RAY_MAPFILE_CHUNK_CELLS;
+        chunk->occupancyWords = RAY_CHUNK_OCCUPANCY_WORDS;
+        chunk->blockWords = RAY_CHUNK_BLOCK_WORDS;
+        chunk->blockStride = RAY_CHUNK_BLOCK_STRIDE;
+        chunk->proxyWall = g_stream.table[i].proxyWall;
+        /* Los proxies son paredes del nivel 0 */
+        if (chunk->proxyWall) world->levelMask |= 1u;
+        chunk->proxyFloor = g_stream.table[i].proxyFloor;
+        chunk->proxyCeiling = g_stream.table[i].proxyCeiling;
+        g_stream.slotOf[i] = -1;
+    }
+
+    g_stream.thread = SDL_CreateThread(ray_chunk_loader_main, "ray_chunks", NULL);
+    if (!g_stream.thread) {
+        fprintf(stderr, "RAY: No se pudo crear el hilo de carga de chunks: %s\n", SDL_GetError());
+        ray_world_free();
+        return 0;
+    }
+
+    printf("RAY: Mapa por chunks: %dx%d chunks, %d slots de %zu KB, precarga a %d chunks\n",
+           world->chunksX, world->chunksY, slots, slotBytes / 1024, radius);
+    return 1;
+}
+
+/* Para el hilo de carga y suelta los chunks; el presupuesto se conserva */
+void ray_world_free(void)
+{
+    RAY_World *world = &g_engine.world;
+
+    if (g_stream.thread) {
+        SDL_AtomicLock(&g_stream.lock);
+        g_stream.quit = 1;
+        SDL_AtomicUnlock(&g_stream.lock);
+        SDL_SemPost(g_stream.wake);
+        SDL_WaitThread(g_stream.thread, NULL);
+    }
+    if (g_stream.wake) SDL_DestroySemaphore(g_stream.wake);
+    if (g_stream.finished) SDL_DestroySemaphore(g_stream.finished);
+
+    free(g_stream.memory);
+    free(g_stream.bits);
+    free(g_stream.slotLevelMask);
+    free(g_stream.scratch[0]);
+    free(g_stream.scratch[1]);
+    free(g_stream.slotChunk);
+    free(g_stream.slotOf);
+    free(g_stream.state);
+    free(g_stream.inQueue);
+    free(g_stream.lastWanted);
+    free(g_stream.wants);
+    free(g_stream.queue);
+    free(g_stream.done);
+    memset(&g_stream, 0, sizeof(RAY_ChunkStream));
+
+    size_t budget = world->budget;
+    if (world->chunks && !world->streaming) {
+        free(world->chunks[0].cells);
+        free(world->chunks[0].occupancy);
+    }
+    free(world->chunks);
+    memset(world, 0, sizeof(RAY_World));
+    world->budget = budget;
+}
+
+/* ============================================================================
+   FUNCIÓN EXPORTADA
+   ============================================================================ */
+
+/* RAY_SET_CHUNK_BUDGET(megabytes): memoria para chunks residentes de los
+ * mapas por chunks; se aplica al cargar el siguiente mapa. 0 = por defecto */
+int64_t libmod_ray_set_chunk_budget(INSTANCE *my, int64_t *params)
+{
+    int64_t megabytes = params[0];
+    if (megabytes < 0) return 0;
+    g_engine.world.budget = (size_t)megabytes * 1024 * 1024;
+    return 1;
+}
@@ -0,0 +1,239 @@
+/*
+ * libmod_ray_doors.c - Tabla de puertas
+ * Solo unas pocas celdas del mapa son puertas. Al cargar el mapa se recorren
+ * los chunks residentes y cada celda con ID de puerta (ray_is_door) recibe
+ * un RAY_Door en un array compacto; una tabla hash de direccionamiento
+ * abierto traduce celda (x + y * width) a puerta. Las puertas que se están
+ * moviendo están además en una lista de activas, que es lo único que
+ * recorre ray_update_doors cada frame.
+ */
+
+#include "libmod_ray.h"
+#include "libmod_ray_trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+extern RAY_Engine g_engine;
+
+#define RAY_DOOR_EMPTY -1
+
+static uint32_t ray_door_hash(int cell)
+{
+    return (uint32_t)cell * 0x9E3779B1u;
+}
+
+/* Posición en la tabla de la celda, o del hueco donde iría */
+static int ray_door_slot(const RAY_DoorTable *table, int cell)
+{
+    uint32_t mask = (uint32_t)table->capacity - 1;
+    uint32_t h = ray_door_hash(cell) & mask;
+    while (table->cells[h] != RAY_DOOR_EMPTY && table->cells[h] != cell) {
+        h = (h + 1) & mask;
+    }
+    return (int)h;
+}
+
+/* ============================================================================
+   CONSTRUCCIÓN AL CARGAR EL MAPA
+   ============================================================================ */
+
+/* Tabla hash al doble de capacidad; 'doors' y 'active' crecen con ella */
+static int ray_door_table_grow(RAY_DoorTable *table)
+{
+    int capacity = table->capacity ? table->capacity * 2 : 16;
+    int *cells = (int*)malloc(capacity * sizeof(int));
+    int *slots = (int*)malloc(capacity * sizeof(int));
+    RAY_Door *doors = (RAY_Door*)malloc((capacity / 2) * sizeof(RAY_Door));
+    int *active = (int*)malloc((capacity / 2) * sizeof(int));
+    if (!cells || !slots || !doors || !active) {
+        /* La tabla se queda como estaba */
+        free(cells);
+        free(slots);
+        free(doors);
+        free(active);
+        return 0;
+    }
+
+    if (table->count > 0) memcpy(doors, table->doors, table->count * sizeof(RAY_Door));
+    if (table->numActive > 0) memcpy(active, table->active, table->numActive * sizeof(int));
+    free(table->doors);
+    free(table->active);
+    table->doors = doors;
+    table->active = active;
+
+    for (int i = 0; i < capacity; i++) {
+        cells[i] = RAY_DOOR_EMPTY;
+    }
+    int *old_cells = table->cells;
+    int *old_slots = table->slots;
+    int old_capacity = table->capacity;
+    table->cells = cells;
+    table->slots = slots;
+    table->capacity = capacity;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_cells[i] == RAY_DOOR_EMPTY) continue;
+        int h = ray_door_slot(table, old_cells[i]);
+        table->cells[h] = old_cells[i];
+        table->slots[h] = old_slots[i];
+    }
+    free(old_cells);
+    free(old_slots);
+    return 1;
+}
+
+/* Puerta cerrada en la celda si aún no la tiene. Carga factor <= 1/2 */
+int ray_door_register(int cell)
+{
+    RAY_DoorTable *table = &g_engine.doorTable;
+    if (table->count * 2 >= table->capacity && !ray_door_table_grow(table)) return 0;
+
+    int h = ray_door_slot(table, cell);
+    if (table->cells[h] != RAY_DOOR_EMPTY) return 1;
+
+    RAY_Door *door = &table->doors[table->count];
+    door->state = 0;            /* Cerrada */
+    door->offset = 0.0f;        /* Sin offset */
+    door->animating = 0;        /* No animándose */
+    door->anim_speed = 2.0f;    /* Velocidad de animación */
+    door->cell = cell;
+    table->cells[h] = cell;
+    table->slots[h] = table->count++;
+    return 1;
+}
+
+/* Puertas de los chunks residentes; las de un mapa por chunks se añaden
+ * al cargar cada chunk (libmod_ray_chunks.c) */
+int ray_door_table_build(void)
+{
+    ray_door_table_free();
+
+    const RAY_World *world = &g_engine.world;
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    int cells = rc->gridWidth * rc->gridHeight;
+    if (!world->chunks || cells <= 0) return 1;
+
+    /* Celdas con puerta en algún nivel, en una sola pasada por las celdas */
+    int *doorCells = NULL;
+    int numDoorCells = 0, capacity = 0;
+    for (int y = 0; y < rc->gridHeight; y++) {
+        for (int x = 0; x < rc->gridWidth; x++) {
+            const RAY_Chunk *chunk = ray_world_chunk(world, x, y);
+            if (!chunk->resident) {
+                x |= world->mask;            /* Resto de la fila del chunk */
+                continue;
+            }
+            const RAY_Cell *cell = ray_chunk_levels(world, chunk, ray_chunk_cell(world, chunk, x, y));
+            int door = 0;
+            for (int level = 0; level < rc->gridCount && !door; level++) {
+                door = (cell[level].flags & RAY_CELL_DOOR) != 0;
+            }
+            if (!door) continue;
+
+            if (numDoorCells == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                int *grown = (int*)realloc(doorCells, capacity * sizeof(int));
+                if (!grown) {
+                    fprintf(stderr, "RAY: Error al asignar memoria para doors\n");
+                    free(doorCells);
+                    return 0;
+                }
+                doorCells = grown;
+            }
+            doorCells[numDoorCells++] = x + y * rc->gridWidth;
+        }
+    }
+
+    /* Nivel a nivel; una puerta por celda aunque el ID se repita en varios niveles */
+    for (int level = 0; level < rc->gridCount; level++) {
+        for (int i = 0; i < numDoorCells; i++) {
+            int x = doorCells[i] % rc->gridWidth;
+            int y = doorCells[i] / rc->gridWidth;
+            const RAY_Chunk *chunk = ray_world_chunk(world, x, y);
+            const RAY_Cell *cell = ray_chunk_levels(world, chunk, ray_chunk_cell(world, chunk, x, y));
+            if (!(cell[level].flags & RAY_CELL_DOOR)) continue;
+            if (!ray_door_register(doorCells[i])) {
+                fprintf(stderr, "RAY: Error al asignar memoria para doors\n");
+                free(doorCells);
+                ray_door_table_free();
+                return 0;
+            }
+        }
+    }
+    free(doorCells);
+
+    if (g_engine.doorTable.count > 0) {
+        printf("RAY: %d puertas en %d celdas\n", g_engine.doorTable.count, cells);
+    }
+    return 1;
+}
+
+void ray_door_table_free(void)
+{
+    RAY_DoorTable *table = &g_engine.doorTable;
+    free(table->cells);
+    free(table->slots);
+    free(table->doors);
+    free(table->active);
+    memset(table, 0, sizeof(RAY_DoorTable));
+}
+
+/* ============================================================================
+   CONSULTA Y ANIMACIÓN
+   ============================================================================ */
+
+/* Puerta de la celda x + y * width, o NULL si la celda no es una puerta */
+RAY_Door *ray_door_at(int cell)
+{
+    const RAY_DoorTable *table = &g_engine.doorTable;
+    if (table->count == 0) return NULL;
+
+    int h = ray_door_slot(table, cell);
+    return table->cells[h] == cell ? &table->doors[table->slots[h]] : NULL;
+}
+
+/* Cambia el estado de la puerta y la añade a las activas */
+void ray_door_toggle(RAY_Door *door)
+{
+    RAY_DoorTable *table = &g_engine.doorTable;
+
+    door->state = !door->state;
+    if (!door->animating) {
+        door->animating = 1;
+        table->active[table->numActive++] = (int)(door - table->doors);
+    }
+}
+
+void ray_update_doors(float delta_time) {
+    RAY_DoorTable *table = &g_engine.doorTable;
+    if (!g_engine.initialized) return;
+
+    for (int a = table->numActive - 1; a >= 0; a--) {
+        RAY_Door *door = &table->doors[table->active[a]];
+
+        /* Calcular incremento de offset basado en velocidad y delta time */
+        float increment = door->anim_speed * delta_time;
+
+        if (door->state == 1) {
+            /* Abriendo - incrementar offset hacia 1.0 */
+            door->offset += increment;
+            if (door->offset >= 1.0f) {
+                door->offset = 1.0f;
+                door->animating = 0; /* Animación completa */
+            }
+        } else {
+            /* Cerrando - decrementar offset hacia 0.0 */
+            door->offset -= increment;
+            if (door->offset <= 0.0f) {
+                door->offset = 0.0f;
+                door->animating = 0; /* Animación completa */
+            }
+        }
+        RAY_TRACE(RAY_TRACE_DOOR_ANIM, door->cell, door->state, door->animating, 0, door->offset);
+
+        /* Animación terminada: sale de la lista (el último ocupa su sitio) */
+        if (!door->animating) {
+            table->active[a] = table->active[--table->numActive];
+        }
+    }
+}
@@ -14,6 +14,29 @@
 
 /* Constantes exportadas */
 DLCONSTANT __bgdexport(libmod_ray, constants_def)[] = {
+    { "RAY_FLOOR_COLUMNS", TYPE_INT, RAY_FLOOR_MODE_COLUMNS },
+    { "RAY_FLOOR_SPANS", TYPE_INT, RAY_FLOOR_MODE_SPANS },
+    { "RAY_STAT_FRAME_MS", TYPE_INT, RAY_STAT_FRAME_MS },
+    { "RAY_STAT_PHYSICS_MS", TYPE_INT, RAY_STAT_PHYSICS_MS },
+    { "RAY_STAT_SKY_MS", TYPE_INT, RAY_STAT_SKY_MS },
+    { "RAY_STAT_STRIPS_MS", TYPE_INT, RAY_STAT_STRIPS_MS },
+    { "RAY_STAT_RAYCAST_MS", TYPE_INT, RAY_STAT_RAYCAST_MS },
+    { "RAY_STAT_FLOOR_MS", TYPE_INT, RAY_STAT_FLOOR_MS },
+    { "RAY_STAT_WALLS_MS", TYPE_INT, RAY_STAT_WALLS_MS },
+    { "RAY_STAT_SPRITES_MS", TYPE_INT, RAY_STAT_SPRITES_MS },
+    { "RAY_STAT_MINIMAP_MS", TYPE_INT, RAY_STAT_MINIMAP_MS },
+    { "RAY_STAT_HITS_AVG", TYPE_INT, RAY_STAT_HITS_AVG },
+    { "RAY_STAT_HITS_MAX", TYPE_INT, RAY_STAT_HITS_MAX },
+    { "RAY_STAT_PIXELS", TYPE_INT, RAY_STAT_PIXELS },
+    { "RAY_STAT_TEXTURE_SAMPLES", TYPE_INT, RAY_STAT_TEXTURE_SAMPLES },
+    { "RAY_STAT_SPRITES_DRAWN", TYPE_INT, RAY_STAT_SPRITES_DRAWN },
+    { "RAY_STAT_SPRITES_CULLED", TYPE_INT, RAY_STAT_SPRITES_CULLED },
+    { "RAY_STAT_THIN_WALL_TESTS", TYPE_INT, RAY_STAT_THIN_WALL_TESTS },
+    { "RAY_STAT_SORT_COMPARISONS", TYPE_INT, RAY_STAT_SORT_COMPARISONS },
+    { "RAY_STAT_ARENA_BYTES", TYPE_INT, RAY_STAT_ARENA_BYTES },
+    { "RAY_STAT_CHUNKS_MS", TYPE_INT, RAY_STAT_CHUNKS_MS },
+    { "RAY_STAT_CHUNK_LOADS", TYPE_INT, RAY_STAT_CHUNK_LOADS },
+    { "RAY_STAT_CHUNKS_RESIDENT", TYPE_INT, RAY_STAT_CHUNKS_RESIDENT },
     { NULL, 0, 0 }
 };
 
@@ -39,12 +62,17 @@ DLSYSFUNCS __bgdexport(libmod_ray, functions_exports)[] = {
     FUNC("RAY_SET_FOG", "IIIIFF", TYPE_INT, libmod_ray_set_fog),
     FUNC("RAY_SET_DRAW_MINIMAP", "I", TYPE_INT, libmod_ray_set_draw_minimap),
     FUNC("RAY_SET_MINIMAP", "IIIIF", TYPE_INT, libmod_ray_set_minimap),
+    FUNC("RAY_SET_THREADS", "I", TYPE_INT, libmod_ray_set_threads),
+    FUNC("RAY_SET_FLOOR_MODE", "I", TYPE_INT, libmod_ray_set_floor_mode),
+    FUNC("RAY_SET_CHUNK_BUDGET", "I", TYPE_INT, libmod_ray_set_chunk_budget),
+    FUNC("RAY_GET_STATS", "II", TYPE_FLOAT, libmod_ray_get_stats),
     FUNC("RAY_SET_DRAW_WEAPON", "I", TYPE_INT, libmod_ray_set_draw_weapon),
     FUNC("RAY_SET_SKY_TEXTURE", "I", TYPE_INT, libmod_ray_set_sky_texture),
     FUNC("RAY_SET_BILLBOARD", "II", TYPE_INT, libmod_ray_set_billboard),
     FUNC("RAY_CHECK_COLLISION", "FFF", TYPE_INT, libmod_ray_check_collision),
     FUNC("RAY_TOGGLE_DOOR", "", TYPE_INT, libmod_ray_toggle_door),
     FUNC("RAY_ADD_SPRITE", "IFFFIII", TYPE_INT, libmod_ray_add_sprite),
+    FUNC("RAY_REMOVE_SPRITE", "I", TYPE_INT, libmod_ray_remove_sprite),
     FUNC("RAY_SET_FLAG", "I", TYPE_INT, libmod_ray_set_flag),
     FUNC("RAY_CLEAR_FLAG", "", TYPE_INT, libmod_ray_clear_flag),
     FUNC("RAY_GET_FLAG_X", "I", TYPE_FLOAT, libmod_ray_get_flag_x),
@@ -0,0 +1,189 @@
+/*
+ * libmod_ray_fog.c - Fog precalculado
+ * RAY_SET_FOG rellena una tabla de factores de 8 bits indexada por distancia
+ * cuantizada, de modo que el render no divide por el rango del fog en cada
+ * pixel: factor = fogTable[(distancia - inicio) * fogTableScale].
+ *
+ * La mezcla de un tramo de pixels con sus factores se hace con enteros:
+ * canal = (canal * (255 - f) + fog * f) / 255, redondeado. Hay una versión
+ * escalar de referencia y otras SSE2/AVX2 que mezclan 4/8 pixels a la vez;
+ * en RAY_INIT se elige la mejor que soporte la CPU. El alpha no se toca.
+ */
+
+#include "libmod_ray.h"
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RAY_FOG_X86 1
+#include <immintrin.h>
+#endif
+
+extern RAY_Engine g_engine;
+
+typedef void (*RAY_FogSpanFunc)(uint32_t *pixels, const uint8_t *factors, int count, uint32_t fog);
+
+/* ============================================================================
+   TABLA
+   ============================================================================ */
+
+/* Se llama desde RAY_SET_FOG y al iniciar. La entrada i corresponde a la
+ * distancia fog_start + i / fogTableScale; la última es el fog completo y
+ * cubre todo lo que queda más allá de fog_end. */
+void ray_fog_build(void)
+{
+    float range = g_engine.fog_end_distance - g_engine.fog_start_distance;
+
+    g_engine.fogColor = ((uint32_t)g_engine.fog_r << 16) |
+                        ((uint32_t)g_engine.fog_g << 8) |
+                        (uint32_t)g_engine.fog_b;
+
+    if (range <= 0.0f) {
+        /* Sin rango: fog completo desde fog_start */
+        g_engine.fogTableScale = 0.0f;
+        for (int i = 0; i < RAY_FOG_TABLE_SIZE; i++) {
+            g_engine.fogTable[i] = 255;
+        }
+        return;
+    }
+
+    g_engine.fogTableScale = (RAY_FOG_TABLE_SIZE - 1) / range;
+    for (int i = 0; i < RAY_FOG_TABLE_SIZE; i++) {
+        g_engine.fogTable[i] = (uint8_t)((i * 255 + (RAY_FOG_TABLE_SIZE - 1) / 2) /
+                                         (RAY_FOG_TABLE_SIZE - 1));
+    }
+}
+
+/* ============================================================================
+   MEZCLA DE TRAMOS
+   ============================================================================ */
+
+/* Referencia: pixel a pixel, la misma cuenta que ray_fog_pixel del render */
+static void ray_fog_span_scalar(uint32_t *pixels, const uint8_t *factors, int count, uint32_t fog)
+{
+    for (int i = 0; i < count; i++) {
+        uint32_t f = factors[i];
+        if (f == 0) continue;
+        uint32_t inv = 255 - f;
+        uint32_t pixel = pixels[i];
+        uint32_t out = pixel & 0xFF000000u;
+        for (int shift = 0; shift < 24; shift += 8) {
+            uint32_t v = ((pixel >> shift) & 0xFF) * inv + ((fog >> shift) & 0xFF) * f + 128;
+            out |= ((v + (v >> 8)) >> 8) << shift;
+        }
+        pixels[i] = out;
+    }
+}
+
+#ifdef RAY_FOG_X86
+
+/* Con canales de 16 bits: (c * (255 - f) + fog * f + 128) * 257 >> 16 es la
+ * división por 255 redondeada, exacta para todo el rango (máx 65153). Los
+ * factores se repiten en los 3 canales de color de cada pixel y se ponen a 0
+ * en el alpha, que así sale igual que entra. */
+
+__attribute__((target("sse2")))
+static inline __m128i ray_fog_mix_sse2(__m128i c, __m128i f, __m128i fog)
+{
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), f);
+    __m128i v = _mm_add_epi16(_mm_mullo_epi16(c, inv), _mm_mullo_epi16(fog, f));
+    v = _mm_add_epi16(v, _mm_set1_epi16(128));
+    return _mm_mulhi_epu16(v, _mm_set1_epi16(257));
+}
+
+__attribute__((target("sse2")))
+static void ray_fog_span_sse2(uint32_t *pixels, const uint8_t *factors, int count, uint32_t fog)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color_mask = _mm_set1_epi64x(0x0000FFFFFFFFFFFFll);
+    const __m128i fog16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)(fog & 0x00FFFFFFu)), zero);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t f4;
+        memcpy(&f4, factors + i, sizeof(f4));
+        if (f4 == 0) continue;
+
+        /* f0..f3 -> cada uno repetido en los 4 canales de su pixel */
+        __m128i f = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)f4), zero), zero);
+        f = _mm_or_si128(f, _mm_slli_epi32(f, 16));
+        __m128i f_lo = _mm_and_si128(_mm_unpacklo_epi32(f, f), color_mask);
+        __m128i f_hi = _mm_and_si128(_mm_unpackhi_epi32(f, f), color_mask);
+
+        __m128i p = _mm_loadu_si128((const __m128i*)(pixels + i));
+        __m128i lo = ray_fog_mix_sse2(_mm_unpacklo_epi8(p, zero), f_lo, fog16);
+        __m128i hi = ray_fog_mix_sse2(_mm_unpackhi_epi8(p, zero), f_hi, fog16);
+        _mm_storeu_si128((__m128i*)(pixels + i), _mm_packus_epi16(lo, hi));
+    }
+    ray_fog_span_scalar(pixels + i, factors + i, count - i, fog);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ray_fog_mix_avx2(__m256i c, __m256i f, __m256i fog)
+{
+    __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), f);
+    __m256i v = _mm256_add_epi16(_mm256_mullo_epi16(c, inv), _mm256_mullo_epi16(fog, f));
+    v = _mm256_add_epi16(v, _mm256_set1_epi16(128));
+    return _mm256_mulhi_epu16(v, _mm256_set1_epi16(257));
+}
+
+__attribute__((target("avx2")))
+static void ray_fog_span_avx2(uint32_t *pixels, const uint8_t *factors, int count, uint32_t fog)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i color_mask = _mm256_set1_epi64x(0x0000FFFFFFFFFFFFll);
+    const __m256i fog16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)(fog & 0x00FFFFFFu)), zero);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t f8;
+        memcpy(&f8, factors + i, sizeof(f8));
+        if (f8 == 0) continue;
+
+        /* Los unpack de AVX2 van por mitades de 128 bits: lo = pixels 0,1,4,5
+         * y hi = 2,3,6,7, y los factores se reparten igual */
+        __m256i f = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(factors + i)));
+        f = _mm256_or_si256(f, _mm256_slli_epi32(f, 16));
+        __m256i f_lo = _mm256_and_si256(_mm256_unpacklo_epi32(f, f), color_mask);
+        __m256i f_hi = _mm256_and_si256(_mm256_unpackhi_epi32(f, f), color_mask);
+
+        __m256i p = _mm256_loadu_si256((const __m256i*)(pixels + i));
+        __m256i lo = ray_fog_mix_avx2(_mm256_unpacklo_epi8(p, zero), f_lo, fog16);
+        __m256i hi = ray_fog_mix_avx2(_mm256_unpackhi_epi8(p, zero), f_hi, fog16);
+        _mm256_storeu_si256((__m256i*)(pixels + i), _mm256_packus_epi16(lo, hi));
+    }
+    ray_fog_span_scalar(pixels + i, factors + i, count - i, fog);
+}
+
+#endif /* RAY_FOG_X86 */
+
+static RAY_FogSpanFunc g_fog_span = ray_fog_span_scalar;
+
+/* Elegir la mezcla según la CPU. Se llama una vez desde RAY_INIT. */
+void ray_fog_init(void)
+{
+    const char *kernel = "escalar";
+    g_fog_span = ray_fog_span_scalar;
+
+#ifdef RAY_FOG_X86
+    if (SDL_HasAVX2()) {
+        g_fog_span = ray_fog_span_avx2;
+        kernel = "AVX2";
+    } else if (SDL_HasSSE2()) {
+        g_fog_span = ray_fog_span_sse2;
+        kernel = "SSE2";
+    }
+#endif
+
+    ray_fog_build();
+    printf("RAY: Fog con mezcla %s\n", kernel);
+}
+
+/* Mezcla 'count' pixels con el color del fog, cada uno con su factor */
+void ray_fog_blend_span(uint32_t *pixels, const uint8_t *factors, int count)
+{
+    if (count > 0) {
+        g_fog_span(pixels, factors, count, g_engine.fogColor);
+    }
+}
@@ -1,9 +1,11 @@
 /*
  * libmod_ray_map.c - Map Loading System
- * Implements loading of .raymap binary format (version 1 and 2)
+ * Implements loading of .raymap binary format (versions 1 to 6).
+ * Version 7 (sectioned, mmap-able) is loaded by libmod_ray_mapfile.c.
  */
 
 #include "libmod_ray.h"
+#include "libmod_ray_mapfile.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -80,6 +82,12 @@ int ray_load_map_from_file(const char *filename, int fpg_id)
         return 0;
     }
     
+    /* v7: cabecera fija + directorio de secciones, se proyecta con mmap */
+    if (header.version == RAY_MAPFILE_VERSION) {
+        fclose(f);
+        return ray_load_map_sectioned(filename);
+    }
+    
     /* Verificar versión */
     if (header.version < 1 || header.version > 6) {
         fprintf(stderr, "RAY: Versión de mapa no soportada: %u\n", header.version);
@@ -116,6 +124,7 @@ int ray_load_map_from_file(const char *filename, int fpg_id)
         g_engine.camera.x = header.camera_x;
         g_engine.camera.y = header.camera_y;
         g_engine.camera.z = header.camera_z;
+        ray_camera_snap();
         g_engine.camera.rot = header.camera_rot;
         g_engine.camera.pitch = header.camera_pitch;
         
@@ -264,9 +273,10 @@ int ray_load_map_from_file(const char *filename, int fpg_id)
 
 
     /* Leer sprites */
-    g_engine.num_sprites = 0;
-    for (uint32_t i = 0; i < header.num_sprites && i < RAY_MAX_SPRITES; i++) {
+    ray_sprite_store_clear();
+    for (uint32_t i = 0; i < header.num_sprites; i++) {
         RAY_Sprite sprite;
+        memset(&sprite, 0, sizeof(RAY_Sprite));
         
         /* Leer datos del sprite */
         if (fread(&sprite.textureID, sizeof(int), 1, f) != 1 ||
@@ -295,8 +305,18 @@ int ray_load_map_from_file(const char *filename, int fpg_id)
         sprite.jumping = 0;
         sprite.heightJumped = 0;
         sprite.rayhit = 0;
-        
-        g_engine.sprites[g_engine.num_sprites++] = sprite;
+        sprite.flag_id = -1;
+        
+        RAY_Sprite *slot = ray_sprite_alloc(NULL);
+        if (!slot) {
+            /* Saltar el resto (8 campos de 4 bytes) para seguir leyendo el archivo */
+            uint32_t dropped = header.num_sprites - i;
+            fprintf(stderr, "RAY: %u sprites del mapa no caben y se descartan\n", dropped);
+            fseek(f, (long)(dropped - 1) * 32, SEEK_CUR);
+            break;
+        }
+        ray_sprite_snap(&sprite);
+        *slot = sprite;
     }
     
     /* Saltar ThinWalls standalone (el editor no los maneja) */
@@ -529,22 +549,12 @@ int ray_load_map_from_file(const char *filename, int fpg_id)
         }
     }
     
-    /* Inicializar array de puertas */
-    g_engine.doors = (RAY_Door*)calloc(header.map_width * header.map_height, sizeof(RAY_Door));
-    if (!g_engine.doors) {
-        fprintf(stderr, "RAY: Error al asignar memoria para doors\n");
+    /* Un único chunk sobre los grids y, con él, la tabla de puertas */
+    if (!ray_world_build_flat() || !ray_door_table_build()) {
         fclose(f);
         return 0;
     }
     
-    /* Inicializar todas las puertas */
-    for (int i = 0; i < header.map_width * header.map_height; i++) {
-        g_engine.doors[i].state = 0;        /* Cerrada */
-        g_engine.doors[i].offset = 0.0f;    /* Sin offset */
-        g_engine.doors[i].animating = 0;    /* No animándose */
-        g_engine.doors[i].anim_speed = 2.0f; /* Velocidad de animación */
-    }
-    
     /* Leer spawn flags si es versión 3+ */
     if (header.version >= 3 && header.num_spawn_flags > 0) {
         printf("RAY: Leyendo %d spawn flags...\n", header.num_spawn_flags);
@@ -617,27 +627,32 @@ int64_t libmod_ray_load_map(INSTANCE *my, int64_t *params) {
     
     g_engine.fpg_id = fpg_id;
     
+    /* Un mapa anterior se libera antes de cargar el nuevo */
+    if (g_engine.world.chunks) {
+        libmod_ray_free_map(my, NULL);
+    }
+    
     int result = ray_load_map_from_file(filename, fpg_id);
     
+    /* Convertir una sola vez las texturas que usa el mapa */
+    if (result) {
+        ray_texture_cache_build(fpg_id);
+        ray_thin_wall_grid_build();
+        ray_minimap_invalidate();
+        
+        /* El tiempo de carga no cuenta como tiempo de juego */
+        g_engine.physicsCounter = 0;
+        g_engine.physicsAccumulator = 0.0;
+        ray_stats_reset();
+    }
+    
     string_discard(params[0]);
     return result;
 }
 
-int64_t libmod_ray_free_map(INSTANCE *my, int64_t *params) {
-    if (!g_engine.initialized) return 0;
-    
-    /* Liberar grids */
-    if (g_engine.raycaster.grids) {
-        for (int i = 0; i < g_engine.raycaster.gridCount; i++) {
-            if (g_engine.raycaster.grids[i]) {
-                free(g_engine.raycaster.grids[i]);
-                g_engine.raycaster.grids[i] = NULL;
-            }
-        }
-        free(g_engine.raycaster.grids);
-        g_engine.raycaster.grids = NULL;
-    }
-    
+/* Suelta todo lo que instala la carga de un mapa; también deshace una
+ * carga que ha fallado a medias */
+void ray_free_map(void) {
     /* Liberar thin walls */
     for (int i = 0; i < g_engine.num_thin_walls; i++) {
         if (g_engine.thinWalls[i]) {
@@ -656,31 +671,27 @@ int64_t libmod_ray_free_map(INSTANCE *my, int64_t *params) {
         }
     }
     g_engine.num_thick_walls = 0;
+    ray_thin_wall_grid_free();
+    ray_minimap_free();
     
-    /* Liberar floor/ceiling grids por nivel */
-    for (int level = 0; level < 3; level++) {
-        if (g_engine.floorGrids[level]) {
-            free(g_engine.floorGrids[level]);
-            g_engine.floorGrids[level] = NULL;
-        }
-        if (g_engine.ceilingGrids[level]) {
-            free(g_engine.ceilingGrids[level]);
-            g_engine.ceilingGrids[level] = NULL;
-        }
-        if (g_engine.floorHeightGrids[level]) {
-            free(g_engine.floorHeightGrids[level]);
-            g_engine.floorHeightGrids[level] = NULL;
-        }
-    }
+    /* Liberar grids (y cerrar el archivo v7 al que pueden apuntar) */
+    ray_map_release_grids();
     
     /* Liberar doors */
-    if (g_engine.doors) {
-        free(g_engine.doors);
-        g_engine.doors = NULL;
-    }
+    ray_door_table_free();
+    
+    /* Limpiar sprites (los handles anteriores dejan de ser válidos) */
+    ray_sprite_store_clear();
+    ray_sprite_rle_cache_free();
+    
+    /* Liberar texturas convertidas */
+    ray_texture_cache_free();
+}
+
+int64_t libmod_ray_free_map(INSTANCE *my, int64_t *params) {
+    if (!g_engine.initialized) return 0;
     
-    /* Limpiar sprites */
-    g_engine.num_sprites = 0;
+    ray_free_map();
     
     printf("RAY: Mapa liberado\n");
     return 1;
@@ -0,0 +1,627 @@
+/*
+ * libmod_ray_mapfile.c - Carga de mapas .raymap v7 (libmod_ray_mapfile.h)
+ * El archivo se proyecta en memoria (mmap en POSIX, MapViewOfFile en
+ * Windows) y los grids del mapa apuntan directamente a sus secciones.
+ * La proyección es privada (copy-on-write): el motor puede escribir en los
+ * grids como siempre y solo se copian las páginas que se tocan. Sin mmap
+ * el archivo se lee entero con un único fread y se usa igual.
+ * Los grids comprimidos (RLE, o deflate con RAY_HAVE_ZLIB) se
+ * descomprimen al cargar en memoria propia.
+ *
+ * Los grids se sueltan en cuanto ray_world_build_flat los empaqueta
+ * (ray_map_free_source_grids libera los que no apuntan a la proyección) y,
+ * leídas las demás secciones, la proyección de un mapa normal se cierra.
+ * Solo un mapa por chunks mantiene g_engine.mapFile abierto mientras está
+ * cargado; ray_map_release_grids suelta el mundo y cierra la proyección.
+ * Un mapa guardado por chunks no carga grids aquí: se entrega el directorio
+ * de chunks a libmod_ray_chunks.c, que los lee de la proyección según se
+ * mueve la cámara.
+ */
+
+#include "libmod_ray.h"
+#include "libmod_ray_mapfile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#ifdef RAY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define RAY_MAPFILE_MMAP
+#endif
+
+extern RAY_Engine g_engine;
+
+/* ============================================================================
+   PROYECCIÓN DEL ARCHIVO
+   ============================================================================ */
+
+/* Sin mmap: todo el archivo en un bloque, de una sola lectura */
+static int ray_map_file_read(RAY_MapFile *file, const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 0;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size > 0) {
+        file->base = (uint8_t*)malloc((size_t)size);
+        if (file->base && fread(file->base, (size_t)size, 1, f) != 1) {
+            free(file->base);
+            file->base = NULL;
+        }
+    }
+    fclose(f);
+
+    if (!file->base) return 0;
+    file->size = (size_t)size;
+    file->mapped = 0;
+    return 1;
+}
+
+int ray_map_file_open(RAY_MapFile *file, const char *filename)
+{
+    memset(file, 0, sizeof(RAY_MapFile));
+
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+            if (mapping) {
+                /* La vista mantiene viva la proyección al cerrar los handles */
+                file->base = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+            if (file->base) {
+                file->size = (size_t)size.QuadPart;
+                file->mapped = 1;
+            }
+        }
+        CloseHandle(handle);
+        if (file->base) return 1;
+    }
+#elif defined(RAY_MAPFILE_MMAP)
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE, fd, 0);
+            if (base != MAP_FAILED) {
+                file->base = (uint8_t*)base;
+                file->size = (size_t)st.st_size;
+                file->mapped = 1;
+            }
+        }
+        close(fd);
+        if (file->base) return 1;
+    }
+#endif
+
+    return ray_map_file_read(file, filename);
+}
+
+void ray_map_file_close(RAY_MapFile *file)
+{
+    if (file->base) {
+        if (!file->mapped) {
+            free(file->base);
+        }
+#if defined(_WIN32)
+        else {
+            UnmapViewOfFile(file->base);
+        }
+#elif defined(RAY_MAPFILE_MMAP)
+        else {
+            munmap(file->base, file->size);
+        }
+#endif
+    }
+    memset(file, 0, sizeof(RAY_MapFile));
+}
+
+/* 1 si 'p' apunta dentro del archivo (no se libera con free) */
+static int ray_map_file_contains(const RAY_MapFile *file, const void *p)
+{
+    const uint8_t *b = (const uint8_t*)p;
+    return file->base && b >= file->base && b < file->base + file->size;
+}
+
+/* ============================================================================
+   SECCIONES
+   ============================================================================ */
+
+typedef struct {
+    const RAY_MapFileHeader *header;
+    const RAY_MapFileSection *sections;
+    const RAY_MapFile *file;
+} RAY_MapDirectory;
+
+/* Lectura secuencial de una sección de registros de tamaño variable */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} RAY_MapCursor;
+
+static int ray_map_cursor_read(RAY_MapCursor *cursor, void *dst, size_t size)
+{
+    if ((size_t)(cursor->end - cursor->p) < size) return 0;
+    memcpy(dst, cursor->p, size);
+    cursor->p += size;
+    return 1;
+}
+
+/* Sección de ese tipo y nivel, o NULL; comprueba que cabe en el archivo */
+static const RAY_MapFileSection *ray_map_find_section(const RAY_MapDirectory *dir,
+                                                      uint32_t type, uint32_t level)
+{
+    for (uint32_t i = 0; i < dir->header->num_sections; i++) {
+        const RAY_MapFileSection *s = &dir->sections[i];
+        if (s->type != type || s->level != level) continue;
+        if (s->offset > dir->file->size || s->size > dir->file->size - s->offset) {
+            fprintf(stderr, "RAY: Sección %u del nivel %u fuera del archivo\n", type, level);
+            return NULL;
+        }
+        return s;
+    }
+    return NULL;
+}
+
+#ifdef RAY_HAVE_ZLIB
+/* Stream deflate descomprimido directamente en 'dst' (exactamente 'bytes') */
+static int ray_map_inflate(const uint8_t *src, uint64_t size, void *dst, size_t bytes)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (inflateInit(&stream) != Z_OK) return 0;
+
+    stream.next_in = (Bytef*)src;
+    stream.avail_in = (uInt)size;
+    stream.next_out = (Bytef*)dst;
+    stream.avail_out = (uInt)bytes;
+    int result = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+
+    return result == Z_STREAM_END && stream.avail_out == 0;
+}
+#endif
+
+/* Bloque comprimido con 'codec' descomprimido en exactamente 'bytes' de
+ * 'dst'. También lo usa el hilo de carga de chunks: no toca g_engine.
+ * -1 si el codec no está soportado, 0 si los datos no encajan */
+int ray_map_decode(uint32_t codec, const uint8_t *src, uint64_t size, void *dst, size_t bytes)
+{
+    switch (codec) {
+        case RAY_MAPFILE_CODEC_RAW:
+            if (size != bytes) return 0;
+            memcpy(dst, src, bytes);
+            return 1;
+
+        case RAY_MAPFILE_CODEC_RLE:
+            return ray_mapfile_rle_decode(src, size, (uint32_t*)dst, (uint32_t)(bytes / 4));
+
+#ifdef RAY_HAVE_ZLIB
+        case RAY_MAPFILE_CODEC_DEFLATE:
+            return ray_map_inflate(src, size, dst, bytes);
+#endif
+
+        default:
+            return -1;
+    }
+}
+
+/* Grid de w*h elementos de 4 bytes, o NULL si no está. Las secciones RAW
+ * se usan desde el archivo; las comprimidas se descomprimen directamente
+ * en un grid nuevo, sin buffer intermedio */
+static void *ray_map_section_grid(const RAY_MapDirectory *dir, uint32_t type, uint32_t level)
+{
+    const RAY_MapFileSection *s = ray_map_find_section(dir, type, level);
+    if (!s) return NULL;
+
+    uint64_t cells = (uint64_t)dir->header->map_width * dir->header->map_height;
+    const uint8_t *src = dir->file->base + s->offset;
+
+    if (s->codec == RAY_MAPFILE_CODEC_RAW) {
+        if (s->size == cells * 4 && (s->offset & 3) == 0) return (void*)src;
+        fprintf(stderr, "RAY: Sección %u del nivel %u inválida\n", type, level);
+        return NULL;
+    }
+
+    void *grid = malloc((size_t)cells * 4);
+    int ok = grid ? ray_map_decode(s->codec, src, s->size, grid, (size_t)cells * 4) : 0;
+    if (ok < 0) {
+        fprintf(stderr, "RAY: Sección %u del nivel %u con codec %u no soportado\n",
+                type, level, s->codec);
+    } else if (!ok) {
+        fprintf(stderr, "RAY: Sección %u del nivel %u inválida\n", type, level);
+    }
+    if (ok <= 0) {
+        free(grid);
+        return NULL;
+    }
+    return grid;
+}
+
+static int *ray_map_int_grid(const RAY_MapDirectory *dir, uint32_t type, uint32_t level)
+{
+    int *grid = (int*)ray_map_section_grid(dir, type, level);
+    if (grid) return grid;
+    return (int*)calloc((size_t)dir->header->map_width * dir->header->map_height, sizeof(int));
+}
+
+static float *ray_map_float_grid(const RAY_MapDirectory *dir, uint32_t type, uint32_t level,
+                                 float fill)
+{
+    float *grid = (float*)ray_map_section_grid(dir, type, level);
+    if (grid) return grid;
+
+    size_t cells = (size_t)dir->header->map_width * dir->header->map_height;
+    grid = (float*)calloc(cells, sizeof(float));
+    if (grid && fill != 0.0f) {
+        for (size_t i = 0; i < cells; i++) grid[i] = fill;
+    }
+    return grid;
+}
+
+/* IDs fuera de rango (< 0 o > 2000) se ponen a 0 como en los formatos
+ * anteriores; solo se escribe (y se copia la página) si hay alguno */
+int ray_map_clean_grid(int *grid, int cells)
+{
+    int cleaned = 0;
+    for (int i = 0; i < cells; i++) {
+        if (grid[i] < 0 || grid[i] > 2000) {
+            grid[i] = 0;
+            cleaned++;
+        }
+    }
+    return cleaned;
+}
+
+static int ray_map_load_grids(const RAY_MapDirectory *dir)
+{
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    int levels = (int)dir->header->num_levels;
+    size_t cells = (size_t)dir->header->map_width * dir->header->map_height;   /* Acotado en la cabecera */
+
+    rc->gridWidth = (int)dir->header->map_width;
+    rc->gridHeight = (int)dir->header->map_height;
+    rc->gridCount = levels;
+    rc->tileSize = RAY_TILE_SIZE;
+    rc->grids = (int**)calloc(levels, sizeof(int*));
+    rc->heightGrids = (float**)calloc(levels, sizeof(float*));
+    rc->zOffsetGrids = (float**)calloc(levels, sizeof(float*));
+    if (!rc->grids || !rc->heightGrids || !rc->zOffsetGrids) return 0;
+
+    for (int level = 0; level < levels; level++) {
+        rc->grids[level] = ray_map_int_grid(dir, RAY_SECTION_GRID, level);
+        rc->heightGrids[level] = ray_map_float_grid(dir, RAY_SECTION_HEIGHT, level,
+                                                    (float)RAY_TILE_SIZE);
+        rc->zOffsetGrids[level] = ray_map_float_grid(dir, RAY_SECTION_ZOFFSET, level, 0.0f);
+        if (!rc->grids[level] || !rc->heightGrids[level] || !rc->zOffsetGrids[level]) return 0;
+
+        int cleaned = ray_map_clean_grid(rc->grids[level], (int)cells);
+        if (cleaned > 0) {
+            printf("RAY: Limpiados %d valores corruptos en grid nivel %d\n", cleaned, level);
+        }
+    }
+
+    for (int level = 0; level < 3; level++) {
+        g_engine.floorGrids[level] = ray_map_int_grid(dir, RAY_SECTION_FLOOR, level);
+        g_engine.ceilingGrids[level] = ray_map_int_grid(dir, RAY_SECTION_CEILING, level);
+        g_engine.floorHeightGrids[level] = ray_map_float_grid(dir, RAY_SECTION_FLOOR_HEIGHT,
+                                                              level, 0.0f);
+        if (!g_engine.floorGrids[level] || !g_engine.ceilingGrids[level] ||
+            !g_engine.floorHeightGrids[level]) return 0;
+    }
+    return 1;
+}
+
+/* Mapa por chunks: solo el directorio; los grids los va cargando
+ * libmod_ray_chunks.c desde la proyección según se mueve la cámara */
+static int ray_map_load_chunks(const RAY_MapDirectory *dir)
+{
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    const RAY_MapFileSection *table = ray_map_find_section(dir, RAY_SECTION_CHUNKS, 0);
+    const RAY_MapFileSection *data = ray_map_find_section(dir, RAY_SECTION_CHUNK_DATA, 0);
+
+    rc->gridWidth = (int)dir->header->map_width;
+    rc->gridHeight = (int)dir->header->map_height;
+    rc->gridCount = (int)dir->header->num_levels;
+    rc->tileSize = RAY_TILE_SIZE;
+
+    uint32_t count = (uint32_t)(RAY_MAPFILE_CHUNKS(dir->header->map_width) *
+                                RAY_MAPFILE_CHUNKS(dir->header->map_height));
+    if (!table || !data || table->count != count ||
+        table->size < (uint64_t)count * sizeof(RAY_MapFileChunk) || (table->offset & 7) != 0) {
+        fprintf(stderr, "RAY: Directorio de chunks inválido\n");
+        return 0;
+    }
+
+    return ray_world_stream(dir->file->base + table->offset, (int)count,
+                            dir->file->base + data->offset, data->size);
+}
+
+static void ray_map_load_sprites(const RAY_MapDirectory *dir)
+{
+    ray_sprite_store_clear();
+
+    const RAY_MapFileSection *s = ray_map_find_section(dir, RAY_SECTION_SPRITES, 0);
+    if (!s) return;
+
+    const RAY_MapFileSprite *records = (const RAY_MapFileSprite*)(dir->file->base + s->offset);
+    uint32_t count = (uint32_t)(s->size / sizeof(RAY_MapFileSprite));
+    if (s->count < count) count = s->count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        RAY_Sprite sprite;
+        memset(&sprite, 0, sizeof(RAY_Sprite));
+        sprite.textureID = records[i].textureID;
+        sprite.x = records[i].x;
+        sprite.y = records[i].y;
+        sprite.z = records[i].z;
+        sprite.w = records[i].w;
+        sprite.h = records[i].h;
+        sprite.level = records[i].level;
+        sprite.rot = records[i].rot;
+        sprite.flag_id = -1;
+
+        RAY_Sprite *slot = ray_sprite_alloc(NULL);
+        if (!slot) {
+            fprintf(stderr, "RAY: %u sprites del mapa no caben y se descartan\n", count - i);
+            break;
+        }
+        ray_sprite_snap(&sprite);
+        *slot = sprite;
+    }
+}
+
+/* Un ThickWall en el formato de v6: campos, puntos (TRIANGLE/QUAD) y ThinWalls */
+static RAY_ThickWall *ray_map_read_thick_wall(RAY_MapCursor *cursor)
+{
+    RAY_ThickWall *tw = (RAY_ThickWall*)malloc(sizeof(RAY_ThickWall));
+    if (!tw) return NULL;
+    ray_thick_wall_init(tw);
+
+    int ok = ray_map_cursor_read(cursor, &tw->type, sizeof(int)) &&
+             ray_map_cursor_read(cursor, &tw->slopeType, sizeof(int)) &&
+             ray_map_cursor_read(cursor, &tw->slope, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->x, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->y, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->w, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->h, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->ceilingTextureID, sizeof(int)) &&
+             ray_map_cursor_read(cursor, &tw->floorTextureID, sizeof(int)) &&
+             ray_map_cursor_read(cursor, &tw->startHeight, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->endHeight, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &tw->invertedSlope, sizeof(int));
+
+    if (ok && (tw->type == 2 || tw->type == 3)) {  /* TRIANGLE o QUAD */
+        int num_points = 0;
+        ok = ray_map_cursor_read(cursor, &num_points, sizeof(int)) && num_points >= 0 &&
+             (size_t)num_points * 8 <= (size_t)(cursor->end - cursor->p);
+        if (ok && num_points > 0) {
+            tw->points = (RAY_Point*)malloc(num_points * sizeof(RAY_Point));
+            ok = tw->points != NULL;
+            for (int p = 0; ok && p < num_points; p++) {
+                ok = ray_map_cursor_read(cursor, &tw->points[p].x, sizeof(float)) &&
+                     ray_map_cursor_read(cursor, &tw->points[p].y, sizeof(float));
+            }
+            tw->num_points = num_points;
+        }
+    }
+
+    int num_thin_walls = 0;
+    ok = ok && ray_map_cursor_read(cursor, &num_thin_walls, sizeof(int)) && num_thin_walls >= 0 &&
+         (size_t)num_thin_walls * 40 <= (size_t)(cursor->end - cursor->p);
+    if (ok && num_thin_walls > 0) {
+        tw->thinWalls = (RAY_ThinWall*)malloc(num_thin_walls * sizeof(RAY_ThinWall));
+        ok = tw->thinWalls != NULL;
+        tw->thin_walls_capacity = num_thin_walls;
+    }
+    for (int t = 0; ok && t < num_thin_walls; t++) {
+        RAY_ThinWall *thin = &tw->thinWalls[t];
+        ok = ray_map_cursor_read(cursor, &thin->x1, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->y1, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->x2, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->y2, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->wallType, sizeof(int)) &&
+             ray_map_cursor_read(cursor, &thin->horizontal, sizeof(int)) &&
+             ray_map_cursor_read(cursor, &thin->height, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->z, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->slope, sizeof(float)) &&
+             ray_map_cursor_read(cursor, &thin->hidden, sizeof(int));
+        thin->thickWall = tw;
+        if (ok) tw->num_thin_walls++;
+    }
+
+    if (!ok) {
+        ray_thick_wall_free(tw);
+        free(tw);
+        return NULL;
+    }
+    return tw;
+}
+
+static int ray_map_load_thick_walls(const RAY_MapDirectory *dir)
+{
+    g_engine.num_thick_walls = 0;
+
+    const RAY_MapFileSection *s = ray_map_find_section(dir, RAY_SECTION_THICK_WALLS, 0);
+    if (!s) return 1;
+
+    RAY_MapCursor cursor;
+    cursor.p = dir->file->base + s->offset;
+    cursor.end = cursor.p + s->size;
+
+    for (uint32_t i = 0; i < s->count && i < RAY_MAX_THICK_WALLS; i++) {
+        RAY_ThickWall *tw = ray_map_read_thick_wall(&cursor);
+        if (!tw) {
+            fprintf(stderr, "RAY: Error leyendo thick wall %u\n", i);
+            return 0;
+        }
+        g_engine.thickWalls[g_engine.num_thick_walls++] = tw;
+    }
+    return 1;
+}
+
+static void ray_map_load_spawn_flags(const RAY_MapDirectory *dir)
+{
+    const RAY_MapFileSection *s = ray_map_find_section(dir, RAY_SECTION_SPAWN_FLAGS, 0);
+    if (!s) return;
+
+    const RAY_MapFileSpawnFlag *records =
+        (const RAY_MapFileSpawnFlag*)(dir->file->base + s->offset);
+    uint32_t count = (uint32_t)(s->size / sizeof(RAY_MapFileSpawnFlag));
+    if (s->count < count) count = s->count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (g_engine.num_spawn_flags >= g_engine.spawn_flags_capacity) {
+            fprintf(stderr, "RAY: Capacidad de spawn flags excedida\n");
+            break;
+        }
+        RAY_SpawnFlag *flag = &g_engine.spawn_flags[g_engine.num_spawn_flags++];
+        flag->flag_id = records[i].flag_id;
+        flag->x = records[i].x;
+        flag->y = records[i].y;
+        flag->z = records[i].z;
+        flag->level = records[i].level;
+        flag->occupied = 0;
+        flag->process_ptr = NULL;
+    }
+}
+
+/* ============================================================================
+   CARGA
+   ============================================================================ */
+
+int ray_load_map_sectioned(const char *filename)
+{
+    RAY_MapFile *file = &g_engine.mapFile;
+    if (!ray_map_file_open(file, filename)) {
+        fprintf(stderr, "RAY: No se puede abrir mapa: %s\n", filename);
+        return 0;
+    }
+
+    RAY_MapDirectory dir;
+    dir.file = file;
+    dir.header = (const RAY_MapFileHeader*)file->base;
+
+    const RAY_MapFileHeader *header = dir.header;
+    if (file->size < sizeof(RAY_MapFileHeader) ||
+        memcmp(header->magic, RAY_MAPFILE_MAGIC, 7) != 0 ||
+        header->version != RAY_MAPFILE_VERSION ||
+        header->header_size < sizeof(RAY_MapFileHeader) ||
+        header->header_size > file->size ||
+        (uint64_t)header->num_sections * sizeof(RAY_MapFileSection) >
+            file->size - header->header_size ||
+        header->map_width == 0 || header->map_height == 0 || header->num_levels == 0 ||
+        (uint64_t)header->map_width * header->map_height > INT_MAX / sizeof(float)) {
+        fprintf(stderr, "RAY: Cabecera v%d inválida en %s\n", RAY_MAPFILE_VERSION, filename);
+        ray_map_file_close(file);
+        return 0;
+    }
+    dir.sections = (const RAY_MapFileSection*)(file->base + header->header_size);
+
+    printf("RAY: Cargando mapa v%u %ux%u con %u niveles, %u secciones (%s)\n",
+           header->version, header->map_width, header->map_height, header->num_levels,
+           header->num_sections, file->mapped ? "mmap" : "en memoria");
+
+    if (header->flags & RAY_MAPFILE_FLAG_CAMERA) {
+        g_engine.camera.x = header->camera_x;
+        g_engine.camera.y = header->camera_y;
+        g_engine.camera.z = header->camera_z;
+        ray_camera_snap();
+        g_engine.camera.rot = header->camera_rot;
+        g_engine.camera.pitch = header->camera_pitch;
+        g_engine.skyTextureID = header->skyTextureID;
+    }
+
+    int chunked = ray_map_find_section(&dir, RAY_SECTION_CHUNKS, 0) != NULL;
+    if (chunked ? !ray_map_load_chunks(&dir) : !ray_map_load_grids(&dir) || !ray_world_build_flat()) {
+        fprintf(stderr, "RAY: Error al cargar los grids del mapa\n");
+        ray_free_map();
+        return 0;
+    }
+
+    /* Un fallo deja el motor sin mapa, nunca con medio mapa instalado */
+    ray_map_load_sprites(&dir);
+    if (!ray_map_load_thick_walls(&dir) || !ray_door_table_build()) {
+        ray_free_map();
+        return 0;
+    }
+    ray_map_load_spawn_flags(&dir);
+
+    /* Un mapa normal ya está copiado entero (celdas empaquetadas, sprites,
+     * ThickWalls y spawn flags): el archivo no se vuelve a leer. Uno por
+     * chunks lo necesita abierto mientras esté cargado */
+    if (!chunked) ray_map_file_close(file);
+
+    /* Chunks alrededor de la cámara inicial (sin efecto en un mapa normal) */
+    ray_world_update();
+
+    printf("RAY: Mapa cargado: %d sprites, %d ThickWalls, %d spawn flags, %d puertas\n",
+           g_engine.num_sprites, g_engine.num_thick_walls, g_engine.num_spawn_flags,
+           g_engine.doorTable.count);
+    return 1;
+}
+
+/* ============================================================================
+   LIBERACIÓN
+   ============================================================================ */
+
+static void ray_map_free_grid(void *grid)
+{
+    if (grid && !ray_map_file_contains(&g_engine.mapFile, grid)) {
+        free(grid);
+    }
+}
+
+/* Grids de origen del raycaster y de suelo/techo, cargados desde
+ * cualquier versión. Una vez empaquetados en el mundo nadie más los lee */
+void ray_map_free_source_grids(void)
+{
+    RAY_Raycaster *rc = &g_engine.raycaster;
+
+    for (int level = 0; level < rc->gridCount; level++) {
+        if (rc->grids) ray_map_free_grid(rc->grids[level]);
+        if (rc->heightGrids) ray_map_free_grid(rc->heightGrids[level]);
+        if (rc->zOffsetGrids) ray_map_free_grid(rc->zOffsetGrids[level]);
+    }
+    free(rc->grids);
+    free(rc->heightGrids);
+    free(rc->zOffsetGrids);
+    rc->grids = NULL;
+    rc->heightGrids = NULL;
+    rc->zOffsetGrids = NULL;
+
+    for (int level = 0; level < 3; level++) {
+        ray_map_free_grid(g_engine.floorGrids[level]);
+        ray_map_free_grid(g_engine.ceilingGrids[level]);
+        ray_map_free_grid(g_engine.floorHeightGrids[level]);
+        g_engine.floorGrids[level] = NULL;
+        g_engine.ceilingGrids[level] = NULL;
+        g_engine.floorHeightGrids[level] = NULL;
+    }
+}
+
+/* Mundo, grids de origen y proyección del mapa */
+void ray_map_release_grids(void)
+{
+    /* El hilo de carga lee de la proyección: se para antes de cerrarla */
+    ray_world_free();
+    ray_map_free_source_grids();
+    ray_map_file_close(&g_engine.mapFile);
+}
@@ -0,0 +1,480 @@
+/*
+ * libmod_ray_mapfile.h - Formato .raymap v7
+ * Cabecera fija, directorio de secciones y las secciones, cada una
+ * empezando en un múltiplo de RAY_MAPFILE_ALIGN desde el inicio del
+ * archivo. Así el cargador puede proyectar el archivo con mmap y dejar los
+ * grids apuntando a la proyección, sin copiarlos.
+ *
+ *   RAY_MapFileHeader                    64 bytes
+ *   RAY_MapFileSection x num_sections    32 bytes cada una
+ *   secciones                            alineadas a RAY_MAPFILE_ALIGN
+ *
+ * Todo en little-endian. Una sección de tipo desconocido se ignora al
+ * cargar y una que falta toma el valor por defecto (grids a 0, alturas a
+ * RAY_TILE_SIZE), así que se pueden añadir tipos sin cambiar de versión.
+ * Las secciones de grid pueden ir comprimidas (RAY_MapFileSection.codec):
+ * RLE de palabras de 32 bits o deflate (zlib). Esas el cargador las
+ * descomprime directamente en el grid de destino; las RAW se usan desde la
+ * proyección. El resto de secciones van siempre en RAW.
+ *
+ * Un mapa grande puede guardar sus grids por chunks de
+ * RAY_MAPFILE_CHUNK_SIZE x RAY_MAPFILE_CHUNK_SIZE celdas en lugar de en
+ * secciones de grid: RAY_SECTION_CHUNKS es el directorio y
+ * RAY_SECTION_CHUNK_DATA los bloques, cada uno comprimido por separado.
+ * El motor solo carga los chunks que hay alrededor de la cámara.
+ *
+ * Lo incluyen el módulo y las herramientas que escriben mapas
+ * (tools/map_builder.c, tools/raymap_editor, bench/ray_map_bench.c). Con
+ * RAY_MAPFILE_WRITER definido antes del include añade un escritor en C.
+ */
+
+#ifndef __LIBMOD_RAY_MAPFILE_H
+#define __LIBMOD_RAY_MAPFILE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define RAY_MAPFILE_MAGIC "RAYMAP\x1a"
+#define RAY_MAPFILE_VERSION 7
+#define RAY_MAPFILE_ALIGN 64
+
+/* RAY_MapFileSection.codec */
+#define RAY_MAPFILE_CODEC_RAW 0
+#define RAY_MAPFILE_CODEC_RLE 1         /* ray_mapfile_rle_encode/decode */
+#define RAY_MAPFILE_CODEC_DEFLATE 2     /* Stream zlib; el módulo necesita RAY_HAVE_ZLIB */
+
+/* RAY_MapFileHeader.flags */
+#define RAY_MAPFILE_FLAG_CAMERA 0x1     /* camera_* y skyTextureID son válidos */
+
+/* Tipos de sección; las de grid llevan el nivel en RAY_MapFileSection.level */
+typedef enum {
+    RAY_SECTION_GRID = 1,           /* int32[w*h] paredes del nivel */
+    RAY_SECTION_HEIGHT = 2,         /* float[w*h] altura de pared del nivel */
+    RAY_SECTION_ZOFFSET = 3,        /* float[w*h] Z-offset de pared del nivel */
+    RAY_SECTION_FLOOR = 4,          /* int32[w*h] textura de suelo del nivel */
+    RAY_SECTION_CEILING = 5,        /* int32[w*h] textura de techo del nivel */
+    RAY_SECTION_FLOOR_HEIGHT = 6,   /* float[w*h] altura de suelo del nivel */
+    RAY_SECTION_SPRITES = 7,        /* RAY_MapFileSprite[count] */
+    RAY_SECTION_THICK_WALLS = 8,    /* count ThickWalls serializados como en v6 */
+    RAY_SECTION_SPAWN_FLAGS = 9,    /* RAY_MapFileSpawnFlag[count] */
+    RAY_SECTION_CHUNKS = 10,        /* RAY_MapFileChunk[count], fila a fila de chunks */
+    RAY_SECTION_CHUNK_DATA = 11     /* Bloques de los chunks (RAY_MapFileChunk.offset) */
+} RAY_MapSectionType;
+
+/* Secciones de w*h valores de 32 bits: las únicas que se comprimen */
+#define RAY_MAPFILE_IS_GRID(type) ((type) >= RAY_SECTION_GRID && (type) <= RAY_SECTION_FLOOR_HEIGHT)
+
+typedef struct {
+    char magic[8];                  /* RAY_MAPFILE_MAGIC */
+    uint32_t version;               /* RAY_MAPFILE_VERSION */
+    uint32_t header_size;           /* sizeof(RAY_MapFileHeader); luego el directorio */
+    uint32_t map_width;
+    uint32_t map_height;
+    uint32_t num_levels;
+    uint32_t num_sections;
+    float camera_x;
+    float camera_y;
+    float camera_z;
+    float camera_rot;
+    float camera_pitch;
+    int32_t skyTextureID;           /* 0 = sin skybox */
+    uint32_t flags;                 /* RAY_MAPFILE_FLAG_* */
+    uint32_t reserved;
+} RAY_MapFileHeader;
+
+typedef struct {
+    uint32_t type;                  /* RAY_MapSectionType */
+    uint32_t level;                 /* Nivel de los grids, 0 en el resto */
+    uint64_t offset;                /* Desde el inicio del archivo, múltiplo de RAY_MAPFILE_ALIGN */
+    uint64_t size;                  /* Bytes de la sección en el archivo */
+    uint32_t count;                 /* Celdas, sprites, ThickWalls o flags */
+    uint32_t codec;                 /* RAY_MAPFILE_CODEC_*; 'size' es el tamaño comprimido */
+} RAY_MapFileSection;
+
+typedef struct {
+    int32_t textureID;
+    float x, y, z;
+    int32_t w, h;
+    int32_t level;
+    float rot;
+} RAY_MapFileSprite;
+
+typedef struct {
+    int32_t flag_id;
+    float x, y, z;
+    int32_t level;
+} RAY_MapFileSpawnFlag;
+
+/* ============================================================================
+   CHUNKS
+   Un bloque descomprimido son RAY_MAPFILE_CHUNK_PLANES(niveles) planos de
+   RAY_MAPFILE_CHUNK_CELLS valores de 32 bits, fila a fila: paredes, altura
+   y Z-offset de cada nivel y después suelo, techo y altura de suelo de los
+   niveles 0-2. Las celdas de un chunk del borde que caen fuera del mapa
+   van a 0. El proxy es lo que el motor dibuja mientras el chunk no está
+   cargado.
+   ============================================================================ */
+
+#define RAY_MAPFILE_CHUNK_SHIFT 6
+#define RAY_MAPFILE_CHUNK_SIZE (1 << RAY_MAPFILE_CHUNK_SHIFT)
+#define RAY_MAPFILE_CHUNK_CELLS (RAY_MAPFILE_CHUNK_SIZE * RAY_MAPFILE_CHUNK_SIZE)
+#define RAY_MAPFILE_CHUNK_PLANES(levels) (3 * (levels) + 9)
+#define RAY_MAPFILE_CHUNKS(cells) (((cells) + RAY_MAPFILE_CHUNK_SIZE - 1) >> RAY_MAPFILE_CHUNK_SHIFT)
+
+typedef struct {
+    uint64_t offset;                /* Desde el inicio de RAY_SECTION_CHUNK_DATA */
+    uint32_t size;                  /* Bytes guardados */
+    uint16_t codec;                 /* RAY_MAPFILE_CODEC_* */
+    uint16_t proxyWall;             /* Pared más frecuente (sin puertas), 0 = chunk sin paredes */
+    uint16_t proxyFloor;            /* Suelo más frecuente del nivel 0 */
+    uint16_t proxyCeiling;          /* Techo más frecuente del nivel 0 */
+    uint32_t reserved;
+} RAY_MapFileChunk;
+
+/* El layout es el del archivo: que el compilador no meta relleno */
+typedef char RAY_MapFileHeaderSizeCheck[sizeof(RAY_MapFileHeader) == 64 ? 1 : -1];
+typedef char RAY_MapFileSectionSizeCheck[sizeof(RAY_MapFileSection) == 32 ? 1 : -1];
+typedef char RAY_MapFileSpriteSizeCheck[sizeof(RAY_MapFileSprite) == 32 ? 1 : -1];
+typedef char RAY_MapFileSpawnFlagSizeCheck[sizeof(RAY_MapFileSpawnFlag) == 20 ? 1 : -1];
+typedef char RAY_MapFileChunkSizeCheck[sizeof(RAY_MapFileChunk) == 24 ? 1 : -1];
+
+/* Siguiente offset alineado para una sección */
+#define RAY_MAPFILE_ALIGN_UP(offset) \
+    (((offset) + (RAY_MAPFILE_ALIGN - 1)) & ~(uint64_t)(RAY_MAPFILE_ALIGN - 1))
+
+/* ============================================================================
+   RLE DE PALABRAS DE 32 BITS
+   Cada tramo empieza con una palabra: con el bit alto a 1, los 31 bits
+   bajos repiten la palabra siguiente; con el bit alto a 0, son el número
+   de palabras literales que siguen. Las repeticiones de 3 o más van como
+   tramo repetido, así que la salida nunca pasa de count + 1 palabras.
+   ============================================================================ */
+
+#define RAY_MAPFILE_RLE_REPEAT 0x80000000u
+#define RAY_MAPFILE_RLE_BOUND(count) ((count) + 1)
+
+/* Comprime 'count' palabras en 'dst' (RAY_MAPFILE_RLE_BOUND palabras);
+ * devuelve las palabras escritas */
+static inline uint32_t ray_mapfile_rle_encode(const uint32_t *src, uint32_t count, uint32_t *dst)
+{
+    uint32_t out = 0, literal = 0, i = 0;
+
+    while (i <= count) {
+        uint32_t run = 0;
+        if (i < count) {
+            run = 1;
+            while (i + run < count && src[i + run] == src[i] && run < ~RAY_MAPFILE_RLE_REPEAT) run++;
+            if (run < 3) {
+                i += run;
+                continue;
+            }
+        }
+
+        /* Cerrar el tramo literal pendiente antes de la repetición o al final */
+        if (i > literal) {
+            dst[out++] = i - literal;
+            for (uint32_t k = literal; k < i; k++) dst[out++] = src[k];
+        }
+        if (i == count) break;
+
+        dst[out++] = RAY_MAPFILE_RLE_REPEAT | run;
+        dst[out++] = src[i];
+        i += run;
+        literal = i;
+    }
+    return out;
+}
+
+/* Descomprime 'size' bytes en exactamente 'count' palabras de 'dst';
+ * 0 si los datos no encajan */
+static inline int ray_mapfile_rle_decode(const void *src, uint64_t size, uint32_t *dst, uint32_t count)
+{
+    const uint8_t *p = (const uint8_t*)src;
+    const uint8_t *end = p + size;
+    uint32_t n = 0;
+
+    while (n < count) {
+        uint32_t word, len;
+        if (end - p < 4) return 0;
+        memcpy(&word, p, 4);
+        p += 4;
+        len = word & ~RAY_MAPFILE_RLE_REPEAT;
+        if (len > count - n) return 0;
+
+        if (word & RAY_MAPFILE_RLE_REPEAT) {
+            uint32_t value;
+            if (end - p < 4) return 0;
+            memcpy(&value, p, 4);
+            p += 4;
+            for (uint32_t k = 0; k < len; k++) dst[n++] = value;
+        } else {
+            if ((uint64_t)(end - p) < (uint64_t)len * 4) return 0;
+            memcpy(dst + n, p, (size_t)len * 4);
+            p += (size_t)len * 4;
+            n += len;
+        }
+    }
+    return p == end;
+}
+
+#ifdef RAY_MAPFILE_WRITER
+
+/* ============================================================================
+   ESCRITOR (herramientas en C)
+   Las secciones se añaden con ray_mapfile_writer_add, que comprime las de
+   grid con el codec del escritor si así ocupan menos (o, para un mapa por
+   chunks, con ray_mapfile_writer_add_chunks), y se escriben todas con
+   ray_mapfile_writer_save. Deflate solo con RAY_HAVE_ZLIB (-lz).
+   ============================================================================ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef RAY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define RAY_MAPFILE_MAX_SECTIONS 64
+
+typedef struct {
+    RAY_MapFileHeader header;
+    RAY_MapFileSection entries[RAY_MAPFILE_MAX_SECTIONS];
+    const void *data[RAY_MAPFILE_MAX_SECTIONS];   /* Bytes a escribir de cada sección */
+    void *packed[RAY_MAPFILE_MAX_SECTIONS];       /* Copia comprimida, propiedad del escritor */
+    uint32_t codec;                               /* Codec para las secciones de grid */
+} RAY_MapFileWriter;
+
+static inline int ray_mapfile_writer_init(RAY_MapFileWriter *writer, uint32_t width, uint32_t height,
+                                          uint32_t levels, uint32_t codec)
+{
+    memset(writer, 0, sizeof(RAY_MapFileWriter));
+    memcpy(writer->header.magic, RAY_MAPFILE_MAGIC, 8);
+    writer->header.version = RAY_MAPFILE_VERSION;
+    writer->header.header_size = sizeof(RAY_MapFileHeader);
+    writer->header.map_width = width;
+    writer->header.map_height = height;
+    writer->header.num_levels = levels;
+    writer->codec = codec;
+#ifndef RAY_HAVE_ZLIB
+    if (codec == RAY_MAPFILE_CODEC_DEFLATE) return 0;
+#endif
+    return codec <= RAY_MAPFILE_CODEC_DEFLATE;
+}
+
+/* Copia comprimida de 'size' bytes, o NULL si no ocupa menos que el original */
+static inline void *ray_mapfile_pack(uint32_t codec, const void *data, uint64_t size, uint64_t *packed_size)
+{
+    void *packed = NULL;
+    *packed_size = size;
+
+    if (codec == RAY_MAPFILE_CODEC_RLE) {
+        uint32_t count = (uint32_t)(size / 4);
+        packed = malloc((size_t)RAY_MAPFILE_RLE_BOUND(count) * 4);
+        if (packed) *packed_size = (uint64_t)ray_mapfile_rle_encode((const uint32_t*)data, count,
+                                                                    (uint32_t*)packed) * 4;
+    }
+#ifdef RAY_HAVE_ZLIB
+    else if (codec == RAY_MAPFILE_CODEC_DEFLATE) {
+        uLongf bound = compressBound((uLong)size);
+        packed = malloc(bound);
+        if (packed && compress2((Bytef*)packed, &bound, (const Bytef*)data, (uLong)size,
+                                Z_BEST_COMPRESSION) == Z_OK) {
+            *packed_size = bound;
+        } else {
+            *packed_size = size;
+        }
+    }
+#endif
+
+    if (packed && *packed_size >= size) {
+        free(packed);
+        packed = NULL;
+        *packed_size = size;
+    }
+    return packed;
+}
+
+static inline int ray_mapfile_writer_add(RAY_MapFileWriter *writer, uint32_t type, uint32_t level,
+                                         const void *data, uint64_t size, uint32_t count)
+{
+    uint32_t i = writer->header.num_sections;
+    if (i >= RAY_MAPFILE_MAX_SECTIONS) return 0;
+
+    RAY_MapFileSection *entry = &writer->entries[i];
+    entry->type = type;
+    entry->level = level;
+    entry->size = size;
+    entry->count = count;
+    entry->codec = RAY_MAPFILE_CODEC_RAW;
+    writer->data[i] = data;
+
+    if (RAY_MAPFILE_IS_GRID(type) && writer->codec != RAY_MAPFILE_CODEC_RAW) {
+        writer->packed[i] = ray_mapfile_pack(writer->codec, data, size, &entry->size);
+        if (writer->packed[i]) {
+            entry->codec = writer->codec;
+            writer->data[i] = writer->packed[i];
+        }
+    }
+    writer->header.num_sections++;
+    return 1;
+}
+
+static inline int ray_mapfile_compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Valor no nulo más frecuente de 'values' (se reordena) por debajo de 'limit' */
+static inline uint16_t ray_mapfile_chunk_mode(uint32_t *values, uint32_t count, uint32_t limit)
+{
+    uint32_t best = 0, best_run = 0;
+    qsort(values, count, 4, ray_mapfile_compare_u32);
+    for (uint32_t i = 0; i < count; ) {
+        uint32_t run = 1;
+        while (i + run < count && values[i + run] == values[i]) run++;
+        if (values[i] != 0 && values[i] < limit && run > best_run) {
+            best = values[i];
+            best_run = run;
+        }
+        i += run;
+    }
+    return (uint16_t)(best <= 0xFFFF ? best : 0);
+}
+
+/* Secciones de un mapa por chunks. 'planes' son los grids completos
+ * (map_width x map_height) en el orden de RAY_MAPFILE_CHUNK_PLANES, NULL
+ * para un plano a 0. Cada chunk se comprime con el codec del escritor y
+ * el proxy de pared excluye las puertas (IDs >= 1000) */
+static inline int ray_mapfile_writer_add_chunks(RAY_MapFileWriter *writer, const void *const *planes)
+{
+    uint32_t width = writer->header.map_width, height = writer->header.map_height;
+    uint32_t levels = writer->header.num_levels;
+    uint32_t chunks_x = RAY_MAPFILE_CHUNKS(width), chunks_y = RAY_MAPFILE_CHUNKS(height);
+    uint32_t count = chunks_x * chunks_y, num_planes = RAY_MAPFILE_CHUNK_PLANES(levels);
+    uint64_t chunk_bytes = (uint64_t)num_planes * RAY_MAPFILE_CHUNK_CELLS * 4;
+    uint32_t i = writer->header.num_sections;
+    if (i + 2 > RAY_MAPFILE_MAX_SECTIONS) return 0;
+
+    RAY_MapFileChunk *table = (RAY_MapFileChunk*)calloc(count, sizeof(RAY_MapFileChunk));
+    uint32_t *block = (uint32_t*)malloc((size_t)chunk_bytes);
+    uint32_t *scratch = (uint32_t*)malloc((size_t)RAY_MAPFILE_CHUNK_CELLS * (levels + 1) * 4);
+    uint8_t *data = NULL;
+    uint64_t data_size = 0, data_capacity = 0;
+    int ok = table && block && scratch;
+
+    for (uint32_t c = 0; ok && c < count; c++) {
+        uint32_t x0 = (c % chunks_x) << RAY_MAPFILE_CHUNK_SHIFT;
+        uint32_t y0 = (c / chunks_x) << RAY_MAPFILE_CHUNK_SHIFT;
+
+        /* Bloque sin comprimir, con las celdas fuera del mapa a 0 */
+        memset(block, 0, (size_t)chunk_bytes);
+        for (uint32_t p = 0; p < num_planes; p++) {
+            const uint32_t *plane = (const uint32_t*)planes[p];
+            if (!plane) continue;
+            uint32_t *dst = block + (size_t)p * RAY_MAPFILE_CHUNK_CELLS;
+            for (uint32_t y = 0; y < RAY_MAPFILE_CHUNK_SIZE && y0 + y < height; y++) {
+                uint32_t n = width - x0 < RAY_MAPFILE_CHUNK_SIZE ? width - x0 : RAY_MAPFILE_CHUNK_SIZE;
+                memcpy(dst + y * RAY_MAPFILE_CHUNK_SIZE, plane + (size_t)(y0 + y) * width + x0, n * 4);
+            }
+        }
+
+        /* Proxies: paredes de todos los niveles, suelo y techo del nivel 0 */
+        RAY_MapFileChunk *entry = &table[c];
+        for (uint32_t level = 0; level < levels; level++) {
+            memcpy(scratch + level * RAY_MAPFILE_CHUNK_CELLS,
+                   block + (size_t)3 * level * RAY_MAPFILE_CHUNK_CELLS, RAY_MAPFILE_CHUNK_CELLS * 4);
+        }
+        entry->proxyWall = ray_mapfile_chunk_mode(scratch, levels * RAY_MAPFILE_CHUNK_CELLS, 1000);
+        memcpy(scratch, block + (size_t)(3 * levels) * RAY_MAPFILE_CHUNK_CELLS, RAY_MAPFILE_CHUNK_CELLS * 4);
+        entry->proxyFloor = ray_mapfile_chunk_mode(scratch, RAY_MAPFILE_CHUNK_CELLS, 0xFFFFFFFFu);
+        memcpy(scratch, block + (size_t)(3 * levels + 1) * RAY_MAPFILE_CHUNK_CELLS, RAY_MAPFILE_CHUNK_CELLS * 4);
+        entry->proxyCeiling = ray_mapfile_chunk_mode(scratch, RAY_MAPFILE_CHUNK_CELLS, 0xFFFFFFFFu);
+
+        uint64_t size = chunk_bytes;
+        void *packed = writer->codec != RAY_MAPFILE_CODEC_RAW ?
+                       ray_mapfile_pack(writer->codec, block, chunk_bytes, &size) : NULL;
+        const void *bytes = packed ? packed : block;
+
+        /* Bloques alineados a 4 para leer los de raw en su sitio */
+        uint64_t offset = (data_size + 3) & ~(uint64_t)3;
+        if (offset + size > data_capacity) {
+            uint64_t capacity = data_capacity ? data_capacity * 2 : chunk_bytes * 4;
+            while (capacity < offset + size) capacity *= 2;
+            uint8_t *grown = (uint8_t*)realloc(data, (size_t)capacity);
+            if (!grown) {
+                free(packed);
+                ok = 0;
+                break;
+            }
+            memset(grown + data_capacity, 0, (size_t)(capacity - data_capacity));
+            data = grown;
+            data_capacity = capacity;
+        }
+        memcpy(data + offset, bytes, (size_t)size);
+        entry->offset = offset;
+        entry->size = (uint32_t)size;
+        entry->codec = (uint16_t)(packed ? writer->codec : RAY_MAPFILE_CODEC_RAW);
+        data_size = offset + size;
+        free(packed);
+    }
+
+    free(block);
+    free(scratch);
+    if (!ok) {
+        free(table);
+        free(data);
+        return 0;
+    }
+
+    /* El escritor se queda con las dos copias y las libera en writer_free */
+    writer->packed[i] = table;
+    writer->packed[i + 1] = data;
+    ray_mapfile_writer_add(writer, RAY_SECTION_CHUNKS, 0, table,
+                           (uint64_t)count * sizeof(RAY_MapFileChunk), count);
+    ray_mapfile_writer_add(writer, RAY_SECTION_CHUNK_DATA, 0, data, data_size, count);
+    return 1;
+}
+
+/* Cabecera, directorio y secciones, cada una alineada a RAY_MAPFILE_ALIGN */
+static inline int ray_mapfile_writer_save(RAY_MapFileWriter *writer, const char *filename)
+{
+    static const uint8_t zeros[RAY_MAPFILE_ALIGN];
+    uint32_t count = writer->header.num_sections;
+
+    uint64_t offset = RAY_MAPFILE_ALIGN_UP(sizeof(RAY_MapFileHeader) +
+                                           count * sizeof(RAY_MapFileSection));
+    for (uint32_t i = 0; i < count; i++) {
+        writer->entries[i].offset = offset;
+        offset = RAY_MAPFILE_ALIGN_UP(offset + writer->entries[i].size);
+    }
+
+    FILE *out = fopen(filename, "wb");
+    if (!out) return 0;
+
+    int ok = fwrite(&writer->header, sizeof(RAY_MapFileHeader), 1, out) == 1 &&
+             fwrite(writer->entries, sizeof(RAY_MapFileSection), count, out) == count;
+    uint64_t pos = sizeof(RAY_MapFileHeader) + count * sizeof(RAY_MapFileSection);
+
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const RAY_MapFileSection *entry = &writer->entries[i];
+        size_t pad = (size_t)(entry->offset - pos);
+        ok = fwrite(zeros, 1, pad, out) == pad &&
+             (entry->size == 0 || fwrite(writer->data[i], (size_t)entry->size, 1, out) == 1);
+        pos = entry->offset + entry->size;
+    }
+
+    if (fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+static inline void ray_mapfile_writer_free(RAY_MapFileWriter *writer)
+{
+    for (int i = 0; i < RAY_MAPFILE_MAX_SECTIONS; i++) {
+        free(writer->packed[i]);
+        writer->packed[i] = NULL;
+    }
+}
+
+#endif /* RAY_MAPFILE_WRITER */
+
+#endif /* __LIBMOD_RAY_MAPFILE_H */
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 
 /* ============================================================================
    RAYCASTER - GRID MANAGEMENT
@@ -56,42 +57,36 @@ float ray_strip_screen_height(float screenDistance, float correctDistance, float
    RAYCASTER - HELPER FUNCTIONS
    ============================================================================ */
 
-static int any_space_below(RAY_Raycaster *rc, int x, int y, int z)
+/* 'cells' son los niveles de la celda (ray_chunk_levels) */
+static int any_space_below(const RAY_Cell *cells, int z)
 {
     if (z == 0) {
-        int *grid = rc->grids[0];
-        if (x >= 0 && y >= 0) {
-            if (ray_is_door(grid[x + y * rc->gridWidth])) {
-                return 1;
-            }
+        if (cells[0].flags & RAY_CELL_DOOR) {
+            return 1;
         }
     }
     
     for (int level = z - 1; level >= 0; level--) {
-        int *grid = rc->grids[level];
-        int gridOffset = x + y * rc->gridWidth;
-        if (grid[gridOffset] == 0 || ray_is_door(grid[gridOffset])) {
+        if (cells[level].wall == 0 || (cells[level].flags & RAY_CELL_DOOR)) {
             return 1;
         }
     }
     return 0;
 }
 
-static int any_space_above(RAY_Raycaster *rc, int x, int y, int z)
+static int any_space_above(const RAY_Cell *cells, int z)
 {
     /* MODIFICADO: Siempre retornar 1 para permitir renderizado multi-nivel */
     return 1;
 }
 
-static int needs_next_wall(RAY_Raycaster *rc, float playerZ, int x, int y, int z, float wallZOffset, float wallHeight)
+static int needs_next_wall(RAY_Raycaster *rc, const RAY_Cell *cells, float playerZ,
+                           int z, float wallZOffset, float wallHeight)
 {
     /* Siempre permitir puertas */
     if (z == 0) {
-        int *grid = rc->grids[0];
-        if (x >= 0 && y >= 0) {
-            if (ray_is_door(grid[x + y * rc->gridWidth])) {
-                return 1;
-            }
+        if (cells[0].flags & RAY_CELL_DOOR) {
+            return 1;
         }
     }
     
@@ -127,297 +122,213 @@ static int needs_next_wall(RAY_Raycaster *rc, float playerZ, int x, int y, int z
     int eyeBelowWall = eyeHeight < wallBottom;
     
     if (eyeAboveWall) {
-        return any_space_above(rc, x, y, z);
+        return any_space_above(cells, z);
     }
     if (eyeBelowWall) {
-        return any_space_below(rc, x, y, z);
+        return any_space_below(cells, z);
     }
     
     return 0;
 }
 
-/* Usar fmod para texturas (compatible con motor original) */
-static float fmod2(float a, int b)
+/* ============================================================================
+   RAYCASTER - RAYOS POR STRIP
+   ============================================================================ */
+
+/* Rayo de un strip para el frame actual: las tablas de RAY_INIT dan
+ * cos/sin del ángulo del strip y aquí solo se rota por la cámara */
+void ray_strip_ray(RAY_Ray *ray, int strip, float playerRot, float cosRot, float sinRot)
 {
-    return fmodf(a, (float)b);
+    extern RAY_Engine g_engine;
+    const RAY_StripTrig *trig = &g_engine.stripTrig[strip];
+    
+    float angle = playerRot + g_engine.stripAngles[strip];
+    while (angle < 0) angle += RAY_TWO_PI;
+    while (angle >= RAY_TWO_PI) angle -= RAY_TWO_PI;
+    
+    /* cos/sin de (rot + stripAngle); Y del mapa crece hacia abajo */
+    ray->angle = angle;
+    ray->dirX = cosRot * trig->cosAngle - sinRot * trig->sinAngle;
+    ray->dirY = -(sinRot * trig->cosAngle + cosRot * trig->sinAngle);
+    ray->cosStrip = trig->cosAngle;
 }
 
 /* ============================================================================
    RAYCASTER - MAIN RAYCAST FUNCTION
+   Un único recorrido DDA por las celdas que cruza el rayo, avanzando siempre
+   por la línea de grid (vertical u horizontal) más cercana, hasta salir del
+   grid. Cada celda se prueba en todos los niveles que siguen activos; un
+   nivel deja de buscar en su primera pared opaca de altura completa. Como
+   cada celda se visita una sola vez no hay hits duplicados que eliminar.
+   Todo lo que se lee de una celda está en sus RAY_Cell, uno por nivel y
+   seguidos en memoria.
+   Un chunk aún sin cargar con proxy es una pared opaca que corta todos los
+   niveles; sin proxy (chunk sin paredes) el rayo lo cruza.
+   Los niveles sin ninguna pared en el mundo no se buscan, y antes de leer
+   una celda se miran los bitmaps del chunk: un bloque de 8x8 sin paredes en
+   los niveles activos se cruza sin volver a leer memoria, y una celda vacía
+   no se lee. El DDA sigue avanzando celda a celda para que las distancias
+   no cambien.
    ============================================================================ */
 
+/* Hit de pared de grid en la celda (mapX, mapY) a distancia 'dist' */
+static void ray_grid_hit(RAY_RayHit *rayHit, const RAY_Ray *ray, float px, float py,
+                         int mapX, int mapY, int level, int wallType, float dist,
+                         int horizontal, float tileSize)
+{
+    int right = ray->dirX > 0.0f;
+    int up = ray->dirY < 0.0f;
+    
+    /* Coordenada de textura dentro del tile en el punto de impacto */
+    float texX;
+    if (horizontal) {
+        texX = px + ray->dirX * dist - mapX * tileSize;
+        texX = up ? tileSize - texX : texX;
+    } else {
+        texX = py + ray->dirY * dist - mapY * tileSize;
+        texX = right ? texX : tileSize - texX;
+    }
+    
+    rayHit->wallType = wallType;
+    rayHit->wallX = (int16_t)mapX;
+    rayHit->wallY = (int16_t)mapY;
+    rayHit->level = (uint8_t)level;
+    rayHit->distance = dist;
+    rayHit->cold = RAY_HIT_NO_COLD;   /* Las paredes de grid no tienen parte fría */
+    rayHit->wallHeight = tileSize;
+    rayHit->wallZOffset = 0.0f;
+    rayHit->correctDistance = dist * ray->cosStrip;
+    rayHit->flags = horizontal ? RAY_HIT_HORIZONTAL : 0;
+    rayHit->tileX = texX;
+}
+
 void ray_raycaster_raycast(RAY_Raycaster *rc, RAY_RayHit *hits, int *num_hits,
                            int playerX, int playerY, float playerZ,
-                           float playerRot, float stripAngle, int stripIdx,
-                           RAY_Sprite *sprites, int num_sprites)
+                           const RAY_Ray *ray)
 {
-    extern RAY_Engine g_engine;  // Para acceder a floorHeightGrids
+    extern RAY_Engine g_engine;  // Para acceder a los chunks del mapa
+    const RAY_World *world = &g_engine.world;
     
-    if (!rc->grids || rc->gridCount == 0) {
+    if (!world->chunks || rc->gridCount == 0) {
         *num_hits = 0;
         return;
     }
     
     int hit_count = 0;
     const int max_hits = RAY_MAX_RAYHITS;
+    const float tileSize = (float)rc->tileSize;
+    
+    int right = ray->dirX > 0.0f;
+    
+    /* Celda inicial */
+    float px = (float)playerX;
+    float py = (float)playerY;
+    int mapX = (int)floorf(px / tileSize);
+    int mapY = (int)floorf(py / tileSize);
+    
+    /* Distancia a lo largo del rayo entre dos líneas del mismo eje y
+     * distancia hasta la primera línea de cada eje */
+    int stepX = right ? 1 : -1;
+    int stepY = ray->dirY > 0.0f ? 1 : -1;
+    float deltaX = ray->dirX != 0.0f ? fabsf(tileSize / ray->dirX) : FLT_MAX;
+    float deltaY = ray->dirY != 0.0f ? fabsf(tileSize / ray->dirY) : FLT_MAX;
+    float sideX = FLT_MAX;
+    float sideY = FLT_MAX;
+    if (ray->dirX != 0.0f) {
+        sideX = right ? ((mapX + 1) * tileSize - px) / ray->dirX
+                      : (px - mapX * tileSize) / -ray->dirX;
+    }
+    if (ray->dirY != 0.0f) {
+        sideY = ray->dirY > 0.0f ? ((mapY + 1) * tileSize - py) / ray->dirY
+                                 : (py - mapY * tileSize) / -ray->dirY;
+    }
     
-    /* Calcular ángulo del rayo */
-    float rayAngle = stripAngle + playerRot;
-    while (rayAngle < 0) rayAngle += RAY_TWO_PI;
-    while (rayAngle >= RAY_TWO_PI) rayAngle -= RAY_TWO_PI;
-    
-    /* Determinar cuadrante */
-    int right = (rayAngle < RAY_TWO_PI * 0.25f && rayAngle >= 0) ||
-                (rayAngle > RAY_TWO_PI * 0.75f);
-    int up = rayAngle < RAY_TWO_PI * 0.5f && rayAngle >= 0;
-    
-    /* Iterar por cada nivel del grid */
-    for (int level = 0; level < rc->gridCount; level++) {
-        int *grid = rc->grids[level];
-        
-        /* ========================================
-           VERTICAL LINES CHECKING
-           ======================================== */
-        
-        /* Find x coordinate of vertical lines on the right and left */
-        float vx = 0;
-        if (right) {
-            vx = floorf(playerX / rc->tileSize) * rc->tileSize + rc->tileSize;
+    /* Niveles que siguen buscando paredes */
+    int levels = rc->gridCount < 32 ? rc->gridCount : 32;
+    uint32_t active = (levels == 32) ? 0xFFFFFFFFu : ((1u << levels) - 1u);
+    active &= world->levelMask;
+    
+    /* Bloque de 8x8 sin paredes que está cruzando el rayo. Los niveles
+     * activos solo disminuyen, así que sigue vacío hasta salir de él */
+    int emptyX = -1, emptyY = -1;
+    
+    while (active) {
+        /* Avanzar a la línea de grid más cercana */
+        float dist;
+        int horizontal;
+        if (sideX < sideY) {
+            dist = sideX;
+            sideX += deltaX;
+            mapX += stepX;
+            horizontal = 0;
         } else {
-            vx = floorf(playerX / rc->tileSize) * rc->tileSize - 1;
+            dist = sideY;
+            sideY += deltaY;
+            mapY += stepY;
+            horizontal = 1;
         }
         
-        /* Calculate y coordinate of those lines */
-        float vy = playerY + (playerX - vx) * tanf(rayAngle);
-        
-        /* Calculate stepping vector for each line */
-        float stepx = right ? rc->tileSize : -rc->tileSize;
-        float stepy = rc->tileSize * tanf(rayAngle);
-        
-        if (right) {
-            stepy = -stepy;
+        /* Límites reales del grid (sin tope de pasos) */
+        if (mapX < 0 || mapX >= rc->gridWidth ||
+            mapY < 0 || mapY >= rc->gridHeight) {
+            break;
         }
-        
-        /* Recorrer líneas verticales */
-        for (int step = 0; step < 300; step++) 
-        {
-            int wallY = (int)floorf(vy / rc->tileSize);
-            int wallX = (int)floorf(vx / rc->tileSize);
-            
-            /* Verificar que wallX y wallY estén dentro de los límites del grid */
-            if (wallX < 0 || wallX >= rc->gridWidth || 
-                wallY < 0 || wallY >= rc->gridHeight) {
-                break; /* Salir del loop si estamos fuera del mapa */
-            }
-            
-            int wallOffset = wallX + wallY * rc->gridWidth;
-            
-            /* Check if current cell is a wall (treat doors like normal walls) */
-            if (grid[wallOffset] > 0) {
-                
-                float distX = playerX - vx;
-                float distY = playerY - vy;
-                float blockDist = distX * distX + distY * distY;
-                
-                if (blockDist > 0 && hit_count < max_hits) {
-                    float texX = fmod2(vy, rc->tileSize);
-                    texX = right ? texX : rc->tileSize - texX;
-                    
-                    RAY_RayHit *rayHit = &hits[hit_count];
-                    rayHit->x = vx;
-                    rayHit->y = vy;
-                    rayHit->rayAngle = rayAngle;
-                    rayHit->strip = stripIdx;
-                    rayHit->wallType = grid[wallOffset];
-                    rayHit->wallX = wallX;
-                    rayHit->wallY = wallY;
-                    rayHit->level = level;
-                    rayHit->up = up;
-                    rayHit->right = right;
-                    rayHit->distance = sqrtf(blockDist);
-                    rayHit->sortdistance = rayHit->distance;
-                    rayHit->sprite = NULL;
-                    rayHit->thinWall = NULL;
-                    
-                    /* Hit! Calcular altura y Z-offset desde los grids */
-                    float wallHeight = rc->tileSize; // Default height
-                    float wallZOffset = 0.0f; // Default Z-offset
-                    if (rc->heightGrids && rc->heightGrids[level]) {
-                        wallHeight = rc->heightGrids[level][wallX + wallY * rc->gridWidth];
-                        // Si wallHeight es 0, usar default (para mapas antiguos)
-                        if (wallHeight == 0.0f) {
-                            wallHeight = rc->tileSize;
-                        }
-                    }
-                    if (rc->zOffsetGrids && rc->zOffsetGrids[level]) {
-                        wallZOffset = rc->zOffsetGrids[level][wallX + wallY * rc->gridWidth];
-                    }
-                    
-                    // IMPORTANTE: Sumar altura del suelo para que z=0 empiece desde el suelo
-                    extern RAY_Engine g_engine;
-                    if (g_engine.floorHeightGrids[level]) {
-                        float floor_height = g_engine.floorHeightGrids[level][wallX + wallY * rc->gridWidth];
-                        wallZOffset += floor_height * rc->tileSize;
-                    }
-                    
-                    rayHit->wallHeight = wallHeight;
-                    rayHit->wallZOffset = wallZOffset;
-                    rayHit->invertedZ = 0; // Sin slope
-                    
-                    rayHit->correctDistance = rayHit->distance * cosf(stripAngle);
-                    rayHit->horizontal = 0;
-                    rayHit->tileX = texX;
-                    
-                    hit_count++;
-                    
-                    int gaps = needs_next_wall(rc, playerZ, wallX, wallY, level, wallZOffset, wallHeight);
-                    if (!gaps) {
-                        break;
-                    }
-                }
-            }
-            
-            vx += stepx;
-            vy += stepy;
+        if ((mapX >> RAY_CHUNK_BLOCK_SHIFT) == emptyX && (mapY >> RAY_CHUNK_BLOCK_SHIFT) == emptyY) {
+            continue;
         }
         
-        /* ========================================
-           HORIZONTAL LINES CHECKING
-           ======================================== */
-        
-        /* Encontrar coordenada Y de líneas horizontales */
-        float hy = 0;
-        if (up) {
-            hy = floorf(playerY / rc->tileSize) * rc->tileSize - 1;
-        } else {
-            hy = floorf(playerY / rc->tileSize) * rc->tileSize + rc->tileSize;
+        const RAY_Chunk *chunk = ray_world_chunk(world, mapX, mapY);
+        if (!chunk->resident) {
+            if (!chunk->proxyWall) continue;
+            if (dist > 0.0f && hit_count < max_hits) {
+                ray_grid_hit(&hits[hit_count++], ray, px, py, mapX, mapY, 0,
+                             chunk->proxyWall, dist, horizontal, tileSize);
+            }
+            break;
         }
         
-        /* Calcular coordenada X */
-        float hx = playerX + (playerY - hy) / tanf(rayAngle);
-        stepy = up ? -rc->tileSize : rc->tileSize;
-        stepx = rc->tileSize / tanf(rayAngle);
-        
-        if (!up) {
-            stepx = -stepx;
+        int localX = mapX & world->mask;
+        int localY = mapY & world->mask;
+        int block = (localY >> RAY_CHUNK_BLOCK_SHIFT) * chunk->blockStride + (localX >> RAY_CHUNK_BLOCK_SHIFT);
+        if (!ray_chunk_bits_any(chunk->blocks, chunk->blockWords, active, levels, block)) {
+            emptyX = mapX >> RAY_CHUNK_BLOCK_SHIFT;
+            emptyY = mapY >> RAY_CHUNK_BLOCK_SHIFT;
+            continue;
         }
+        int cell = localY * chunk->stride + localX;
+        if (!ray_chunk_bits_any(chunk->occupancy, chunk->occupancyWords, active, levels, cell)) continue;
+        const RAY_Cell *cells = ray_chunk_levels(world, chunk, cell);
         
-        /* Recorrer líneas horizontales */
-        for (int step = 0; step < 300; step++) 
-        {
-            int wallY = (int)floorf(hy / rc->tileSize);
-            int wallX = (int)floorf(hx / rc->tileSize);
+        for (int level = 0; level < levels; level++) {
+            if (!(active & (1u << level))) continue;
             
-            if (wallX < 0 || wallX >= rc->gridWidth || 
-                wallY < 0 || wallY >= rc->gridHeight) {
-                break; 
-            }
+            /* Check if current cell is a wall (treat doors like normal walls) */
+            const RAY_Cell *cell = &cells[level];
+            if (!(cell->flags & RAY_CELL_WALL)) continue;
+            if (dist <= 0.0f || hit_count >= max_hits) continue;
             
-            int wallOffset = wallX + wallY * rc->gridWidth;
+            RAY_RayHit *rayHit = &hits[hit_count];
+            ray_grid_hit(rayHit, ray, px, py, mapX, mapY, level, cell->wall, dist,
+                         horizontal, tileSize);
             
-            if (grid[wallOffset] > 0) {
-                
-                float distX = playerX - hx;
-                float distY = playerY - hy;
-                float blockDist = distX * distX + distY * distY;
-                
-                if (blockDist > 0 && hit_count < max_hits) {
-                    float texX = fmod2(hx, rc->tileSize);
-                    texX = up ? rc->tileSize - texX : texX;
-                    
-                    RAY_RayHit *rayHit = &hits[hit_count];
-                    rayHit->x = hx;
-                    rayHit->y = hy;
-                    rayHit->rayAngle = rayAngle;
-                    rayHit->strip = stripIdx;
-                    rayHit->wallType = grid[wallOffset];
-                    rayHit->wallX = wallX;
-                    rayHit->wallY = wallY;
-                    rayHit->level = level;
-                    rayHit->up = up;
-                    rayHit->right = right;
-                    rayHit->distance = sqrtf(blockDist);
-                    rayHit->sortdistance = rayHit->distance;
-                    rayHit->sprite = NULL;
-                    rayHit->thinWall = NULL;
-                    
-                    /* Hit! Calcular altura y Z-offset desde los grids */
-                    float wallHeight = rc->tileSize; // Default height
-                    float wallZOffset = 0.0f; // Default Z-offset
-                    if (rc->heightGrids && rc->heightGrids[level]) {
-                        wallHeight = rc->heightGrids[level][wallX + wallY * rc->gridWidth];
-                        // Si wallHeight es 0, usar default (para mapas antiguos)
-                        if (wallHeight == 0.0f) {
-                            wallHeight = rc->tileSize;
-                        }
-                    }
-                    if (rc->zOffsetGrids && rc->zOffsetGrids[level]) {
-                        wallZOffset = rc->zOffsetGrids[level][wallX + wallY * rc->gridWidth];
-                    }
-                    
-                    // IMPORTANTE: Sumar altura del suelo para que z=0 empiece desde el suelo
-                    if (g_engine.floorHeightGrids[level]) {
-                        float floor_height = g_engine.floorHeightGrids[level][wallX + wallY * rc->gridWidth];
-                        wallZOffset += floor_height * rc->tileSize;
-                    }
-                    
-                    rayHit->wallHeight = wallHeight;
-                    rayHit->wallZOffset = wallZOffset;
-                    rayHit->invertedZ = 0; 
-                    
-                    rayHit->correctDistance = rayHit->distance * cosf(stripAngle);
-                    rayHit->horizontal = 1;
-                    rayHit->tileX = texX;
-                    
-                    hit_count++;
-                    
-                    int gaps = needs_next_wall(rc, playerZ, wallX, wallY, level, wallZOffset, wallHeight);
-                    if (!gaps) {
-                        break;
-                    }
-                }
-            }
+            /* Hit! La altura ya viene con el valor por defecto (un tile) */
+            float wallHeight = ray_cell_height(cell);
             
-            hx += stepx;
-            hy += stepy;
-        }
-    } // CIERRE DEL BUCLE DE NIVELES
-    
-    
-    /* ========================================
-       DEDUPLICACIÓN DE HITS
-       ======================================== */
-    
-    for (int i = 0; i < hit_count; i++) {
-        if (hits[i].wallType == 0) continue; 
-        
-        for (int j = i + 1; j < hit_count; j++) {
-            if (hits[j].wallType == 0) continue; 
+            // IMPORTANTE: Sumar altura del suelo para que z=0 empiece desde el suelo
+            float wallZOffset = ray_cell_z_offset(cell) + ray_cell_floor_height(cell) * tileSize;
             
-            if (hits[i].wallX == hits[j].wallX && 
-                hits[i].wallY == hits[j].wallY &&
-                hits[i].level == hits[j].level) {
-                
-                if (hits[i].distance < hits[j].distance) {
-                    hits[j].wallType = 0; 
-                } else {
-                    hits[i].wallType = 0; 
-                    break; 
-                }
-            }
-        }
-    }
-    
-    int write_idx = 0;
-    for (int read_idx = 0; read_idx < hit_count; read_idx++) {
-        if (hits[read_idx].wallType != 0) {
-            if (write_idx != read_idx) {
-                hits[write_idx] = hits[read_idx];
+            rayHit->wallHeight = wallHeight;
+            rayHit->wallZOffset = wallZOffset;
+            
+            hit_count++;
+            
+            /* Este nivel termina en la primera pared opaca de altura completa */
+            int gaps = needs_next_wall(rc, cells, playerZ, level, wallZOffset, wallHeight);
+            if (!gaps && wallHeight >= tileSize && wallZOffset <= 0.0f) {
+                active &= ~(1u << level);
             }
-            write_idx++;
         }
     }
-    hit_count = write_idx;
     
     *num_hits = hit_count;
 } 
@@ -426,68 +337,159 @@ void ray_raycaster_raycast(RAY_Raycaster *rc, RAY_RayHit *hits, int *num_hits,
    THINWALLS RAYCASTING HELPERS
    ============================================================================ */
 
-/* Helper: Encuentra intersecciones para ThinWalls */
+/* Prueba un ThinWall contra el rayo y añade el hit (parte caliente y fría) */
+static void ray_test_thin_wall(RAY_RayHit *hits, int *hit_count,
+                               RAY_RayHitCold *cold, int *cold_count,
+                               RAY_ThinWall *thinWall,
+                               float playerX, float playerY,
+                               float rayEndX, float rayEndY)
+{
+    if (thinWall->hidden) return;
+    
+    float ix = 0, iy = 0;
+    int hitFound = ray_lines_intersect(thinWall->x1, thinWall->y1,
+                                       thinWall->x2, thinWall->y2,
+                                       playerX, playerY,
+                                       rayEndX, rayEndY,
+                                       &ix, &iy);
+    
+    if (hitFound && *hit_count < RAY_MAX_RAYHITS && *cold_count < RAY_MAX_COLD_HITS) {
+        float distX = playerX - ix;
+        float distY = playerY - iy;
+        float squaredDistance = distX * distX + distY * distY;
+        float distance = sqrtf(squaredDistance);
+        
+        if (distance > 0.1f) {
+            RAY_RayHit *rayHit = &hits[*hit_count];
+            rayHit->distance = distance;
+            rayHit->wallHeight = thinWall->height;
+            rayHit->wallZOffset = 0.0f;
+            rayHit->wallType = thinWall->wallType;
+            rayHit->wallX = (int16_t)floorf(ix / RAY_TILE_SIZE);
+            rayHit->wallY = (int16_t)floorf(iy / RAY_TILE_SIZE);
+            rayHit->level = 0;
+            rayHit->flags = RAY_HIT_THIN_WALL | (thinWall->horizontal ? RAY_HIT_HORIZONTAL : 0);
+            rayHit->cold = (uint16_t)*cold_count;
+            
+            RAY_RayHitCold *rayCold = &cold[*cold_count];
+            memset(rayCold, 0, sizeof(RAY_RayHitCold));
+            rayCold->thinWall = thinWall;
+            rayCold->x = ix;
+            rayCold->y = iy;
+            
+            (*hit_count)++;
+            (*cold_count)++;
+        }
+    }
+}
+
+/* Prueba un ThinWall del índice si este rayo aún no lo ha probado.
+ * Devuelve 1 si lo ha probado. */
+static int ray_test_indexed_thin_wall(RAY_ThinWallGrid *grid, uint32_t id,
+                                      uint32_t *stamps, uint32_t rayStamp,
+                                      RAY_RayHit *hits, int *hit_count,
+                                      RAY_RayHitCold *cold, int *cold_count,
+                                      float playerX, float playerY,
+                                      float rayEndX, float rayEndY)
+{
+    if (stamps[id] == rayStamp) return 0;
+    stamps[id] = rayStamp;
+    ray_test_thin_wall(hits, hit_count, cold, cold_count, grid->walls[id],
+                       playerX, playerY, rayEndX, rayEndY);
+    return 1;
+}
+
+/* Helper: Encuentra intersecciones para ThinWalls.
+ * Con el índice por celdas solo se prueban los ThinWalls de las celdas que
+ * recorre el segmento (playerX, playerY) -> (rayEndX, rayEndY); sin índice,
+ * o con la cámara fuera del grid, se prueban todos. */
 void ray_find_intersecting_thin_walls(RAY_RayHit *hits, int *num_hits,
+                                      RAY_RayHitCold *cold, int *num_cold,
                                       RAY_ThickWall **thickWalls, int num_thick_walls,
                                       float playerX, float playerY,
-                                      float rayEndX, float rayEndY)
+                                      float rayEndX, float rayEndY,
+                                      uint32_t rayStamp, int worker)
 {
+    extern RAY_Engine g_engine;
     int hit_count = *num_hits;
-    const int max_hits = RAY_MAX_RAYHITS;
-    
-    for (int tw_idx = 0; tw_idx < num_thick_walls; tw_idx++) {
-        RAY_ThickWall *thickWall = thickWalls[tw_idx];
-        if (!thickWall) continue;
-        
-        for (int thin_idx = 0; thin_idx < thickWall->num_thin_walls; thin_idx++) {
-            RAY_ThinWall *thinWall = &thickWall->thinWalls[thin_idx];
-            if (thinWall->hidden) continue;
+    int cold_count = *num_cold;
+    int tests = 0;
+    RAY_ThinWallGrid *grid = &g_engine.thinWallGrid;
+    int tileSize = g_engine.raycaster.tileSize > 0 ? g_engine.raycaster.tileSize : RAY_TILE_SIZE;
+    
+    int cellX = (int)floorf(playerX / tileSize);
+    int cellY = (int)floorf(playerY / tileSize);
+    
+    if (!grid->stamps || cellX < 0 || cellX >= grid->width || cellY < 0 || cellY >= grid->height) {
+        for (int tw_idx = 0; tw_idx < num_thick_walls; tw_idx++) {
+            RAY_ThickWall *thickWall = thickWalls[tw_idx];
+            if (!thickWall) continue;
             
-            float ix = 0, iy = 0;
-            int hitFound = ray_lines_intersect(thinWall->x1, thinWall->y1,
-                                               thinWall->x2, thinWall->y2,
-                                               playerX, playerY,
-                                               rayEndX, rayEndY,
-                                               &ix, &iy);
-            
-            if (hitFound && hit_count < max_hits) {
-                float distX = playerX - ix;
-                float distY = playerY - iy;
-                float squaredDistance = distX * distX + distY * distY;
-                float distance = sqrtf(squaredDistance);
-                
-                if (distance > 0.1f) {
-                    RAY_RayHit *rayHit = &hits[hit_count];
-                    rayHit->thinWall = thinWall;
-                    rayHit->x = ix;
-                    rayHit->y = iy;
-                    rayHit->squaredDistance = squaredDistance;
-                    rayHit->distance = distance;
-                    rayHit->sprite = NULL;
-                    rayHit->wallHeight = thinWall->height;
-                    rayHit->wallType = thinWall->wallType;
-                    rayHit->horizontal = thinWall->horizontal;
-                    rayHit->invertedZ = 0;
-                    rayHit->siblingWallHeight = 0;
-                    rayHit->siblingDistance = 0;
-                    rayHit->siblingCorrectDistance = 0;
-                    rayHit->siblingThinWallZ = 0;
-                    rayHit->siblingInvertedZ = 0;
-                    
-                    hit_count++;
-                }
+            for (int thin_idx = 0; thin_idx < thickWall->num_thin_walls; thin_idx++) {
+                ray_test_thin_wall(hits, &hit_count, cold, &cold_count,
+                                   &thickWall->thinWalls[thin_idx],
+                                   playerX, playerY, rayEndX, rayEndY);
             }
+            tests += thickWall->num_thin_walls;
         }
+        g_engine.workerStats[worker].thinWallTests += tests;
+        *num_hits = hit_count;
+        *num_cold = cold_count;
+        return;
     }
     
+    uint32_t *stamps = grid->stamps + (size_t)worker * grid->num_walls;
+    
+    /* ThinWalls que salen del grid: no están en ninguna celda */
+    for (int i = 0; i < grid->num_outside; i++) {
+        tests += ray_test_indexed_thin_wall(grid, grid->outside[i], stamps, rayStamp,
+                                            hits, &hit_count, cold, &cold_count,
+                                            playerX, playerY, rayEndX, rayEndY);
+    }
+    
+    /* DDA sobre el segmento, con t en [0, 1] */
+    float dx = rayEndX - playerX;
+    float dy = rayEndY - playerY;
+    int stepX = dx > 0.0f ? 1 : -1;
+    int stepY = dy > 0.0f ? 1 : -1;
+    float deltaX = (dx != 0.0f) ? fabsf(tileSize / dx) : FLT_MAX;
+    float deltaY = (dy != 0.0f) ? fabsf(tileSize / dy) : FLT_MAX;
+    float sideX = (dx > 0.0f) ? ((cellX + 1) * tileSize - playerX) / dx
+                : (dx < 0.0f) ? (cellX * tileSize - playerX) / dx : FLT_MAX;
+    float sideY = (dy > 0.0f) ? ((cellY + 1) * tileSize - playerY) / dy
+                : (dy < 0.0f) ? (cellY * tileSize - playerY) / dy : FLT_MAX;
+    
+    for (;;) {
+        int cell = cellX + cellY * grid->width;
+        for (int i = grid->cellStart[cell]; i < grid->cellStart[cell + 1]; i++) {
+            tests += ray_test_indexed_thin_wall(grid, grid->items[i], stamps, rayStamp,
+                                                hits, &hit_count, cold, &cold_count,
+                                                playerX, playerY, rayEndX, rayEndY);
+        }
+        
+        if (sideX < sideY) {
+            if (sideX > 1.0f) break;
+            sideX += deltaX;
+            cellX += stepX;
+            if (cellX < 0 || cellX >= grid->width) break;
+        } else {
+            if (sideY > 1.0f) break;
+            sideY += deltaY;
+            cellY += stepY;
+            if (cellY < 0 || cellY >= grid->height) break;
+        }
+    }
+    
+    g_engine.workerStats[worker].thinWallTests += tests;
     *num_hits = hit_count;
+    *num_cold = cold_count;
 }
 
 /* ============================================================================
    FIND SIBLING AT ANGLE
    Exact 1:1 port of RayHit::findSiblingAtAngle() from raycasting.cpp lines 48-111
    ============================================================================ */
-int ray_find_sibling_at_angle(RAY_RayHit *rayHit, float originAngle, float playerRot,
+int ray_find_sibling_at_angle(RAY_RayHitCold *rayHit, float originAngle, float playerRot,
                                float playerX, float playerY,
                                int gridWidth, int tileSize)
 {
@@ -575,11 +577,13 @@ int ray_find_sibling_at_angle(RAY_RayHit *rayHit, float originAngle, float playe
    ============================================================================ */
 
 void ray_raycast_thin_walls(RAY_RayHit *hits, int *num_hits,  
+                            RAY_RayHitCold *cold, int *num_cold,  
                             RAY_ThickWall **thickWalls, int num_thick_walls,  
                             float playerX, float playerY, float playerZ,  
                             float playerRot, float stripAngle, int stripIdx,  
-                            int gridWidth, int tileSize)  
+                            int worker, int gridWidth, int tileSize)  
 {  
+    extern RAY_Engine g_engine;  
     if (num_thick_walls == 0) return;  
       
     float rayAngle = stripAngle + playerRot;  
@@ -600,23 +604,24 @@ void ray_raycast_thin_walls(RAY_RayHit *hits, int *num_hits,
       
     /* Encontrar ThinWalls */  
     int initial_hits = *num_hits;  
-    ray_find_intersecting_thin_walls(hits, num_hits, thickWalls, num_thick_walls,  
-                                     playerX, playerY, vx, vy);  
+    ray_find_intersecting_thin_walls(hits, num_hits, cold, num_cold,  
+                                     thickWalls, num_thick_walls,  
+                                     playerX, playerY, vx, vy,  
+                                     g_engine.thinWallGrid.frameStamp + (uint32_t)stripIdx,  
+                                     worker);  
       
     /* Procesar hits */  
     for (int i = initial_hits; i < *num_hits; i++) {  
         RAY_RayHit *rayHit = &hits[i];  
-        RAY_ThinWall *thinWall = rayHit->thinWall;  
+        RAY_RayHitCold *rayCold = &cold[rayHit->cold];  
+        RAY_ThinWall *thinWall = rayCold->thinWall;  
         
         rayHit->wallHeight = thinWall->height;  
-        rayHit->strip = stripIdx;  
           
         /* Texture Coords */  
-        float dto = roundf(ray_thin_wall_distance_to_origin(thinWall, rayHit->x, rayHit->y));  
+        float dto = roundf(ray_thin_wall_distance_to_origin(thinWall, rayCold->x, rayCold->y));  
         rayHit->tileX = ((int)dto) % tileSize;  
-        rayHit->horizontal = thinWall->horizontal;  
         rayHit->wallType = thinWall->wallType;  
-        rayHit->rayAngle = rayAngle;  
           
         if (rayHit->distance > 0) {  
             rayHit->correctDistance = rayHit->distance * cosf(playerRot - rayAngle);  
@@ -633,16 +638,17 @@ void ray_raycast_thin_walls(RAY_RayHit *hits, int *num_hits,
     
     /* SIBLING SYSTEM */
     for (int i = initial_hits; i < *num_hits; i++) {  
-        RAY_RayHit *rayHit = &hits[i];  
+        if (hits[i].wallType == 0) continue;
+        RAY_RayHitCold *rayCold = &cold[hits[i].cold];  
         
         /* En el port original de C++, se busca. Aquí simplificamos */
-        ray_find_sibling_at_angle(rayHit, rayAngle, playerRot, playerX, playerY, gridWidth, tileSize);
+        ray_find_sibling_at_angle(rayCold, rayAngle, playerRot, playerX, playerY, gridWidth, tileSize);
     }
       
-    /* Compactar */  
+    /* Compactar (solo la parte caliente; la fría sigue indexada por 'cold') */  
     int write_idx = 0;  
     for (int read_idx = 0; read_idx < *num_hits; read_idx++) {  
-        if (hits[read_idx].wallType != 0 || hits[read_idx].sprite != NULL) {  
+        if (hits[read_idx].wallType != 0) {  
             if (write_idx != read_idx) {  
                 hits[write_idx] = hits[read_idx];  
             }  
@@ -4,6 +4,7 @@
  */
 
 #include "libmod_ray.h"
+#include "libmod_ray_trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -13,165 +14,320 @@
 /* Forward declarations */
 extern RAY_Engine g_engine;
 extern SDL_PixelFormat *gPixelFormat;
-extern void ray_update_physics(float delta_time);
 
 /* ============================================================================
    FOG SYSTEM
    ============================================================================ */
 
+/* Factor 0-255 de fog a una distancia, desde la tabla de ray_fog_build */
+static inline uint8_t ray_fog_factor(float distance)
+{
+    float t = (distance - g_engine.fog_start_distance) * g_engine.fogTableScale;
+    if (distance < g_engine.fog_start_distance) return 0;
+    if (!(t < RAY_FOG_TABLE_SIZE - 1)) return g_engine.fogTable[RAY_FOG_TABLE_SIZE - 1];
+    return g_engine.fogTable[(int)t];
+}
+
+/* Mezcla de un pixel con el color del fog; la misma cuenta entera que
+ * ray_fog_blend_span, que es la que se usa con tramos enteros */
+static inline uint32_t ray_fog_blend(uint32_t pixel, uint32_t f)
+{
+    uint32_t fog = g_engine.fogColor;
+    uint32_t inv = 255 - f;
+    uint32_t out = pixel & 0xFF000000u;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t v = ((pixel >> shift) & 0xFF) * inv + ((fog >> shift) & 0xFF) * f + 128;
+        out |= ((v + (v >> 8)) >> 8) << shift;
+    }
+    return out;
+}
+
 static uint32_t ray_fog_pixel(uint32_t pixel, float distance)
 {
-    if (!g_engine.fogOn || distance < g_engine.fog_start_distance) {
+    if (!g_engine.fogOn) {
         return pixel;
     }
     
-    /* Extraer componentes RGBA */
-    uint8_t r = (pixel >> 16) & 0xFF;
-    uint8_t g = (pixel >> 8) & 0xFF;
-    uint8_t b = pixel & 0xFF;
-    uint8_t a = (pixel >> 24) & 0xFF;
-    
-    /* Calcular factor de fog */
-    float fog_range = g_engine.fog_end_distance - g_engine.fog_start_distance;
-    float fog_factor = (distance - g_engine.fog_start_distance) / fog_range;
-    if (fog_factor > 1.0f) fog_factor = 1.0f;
+    uint8_t f = ray_fog_factor(distance);
+    return f ? ray_fog_blend(pixel, f) : pixel;
+}
+
+/* ============================================================================
+   FRAMEBUFFER - Escritura directa sobre el GRAPH destino
+   Se obtiene el puntero y el pitch una vez por frame; cada span se recorta
+   una sola vez y se escribe con un puntero con stride, sin pasar por
+   gr_put_pixel (que repite recorte y despacho de formato en cada pixel).
+   ============================================================================ */
+
+typedef struct {
+    uint32_t *pixels;                /* Primer pixel del GRAPH destino */
+    int pitch;                       /* Pixels por fila */
+    int width, height;
+} RAY_Framebuffer;
+
+static RAY_Framebuffer g_fb = {0};
+
+static int ray_fb_bind(RAY_Framebuffer *fb, GRAPH *dest)
+{
+    memset(fb, 0, sizeof(RAY_Framebuffer));
     
-    /* Interpolar entre color original y color de fog */
-    r = (uint8_t)(r * (1.0f - fog_factor) + g_engine.fog_r * fog_factor);
-    g = (uint8_t)(g * (1.0f - fog_factor) + g_engine.fog_g * fog_factor);
-    b = (uint8_t)(b * (1.0f - fog_factor) + g_engine.fog_b * fog_factor);
+    SDL_Surface *surface = dest->surface;
+    if (!surface || !surface->pixels || surface->format->BytesPerPixel != 4) {
+        return 0;
+    }
     
-    return (a << 24) | (r << 16) | (g << 8) | b;
+    fb->pixels = (uint32_t*)surface->pixels;
+    fb->pitch = surface->pitch / 4;
+    fb->width = (int)dest->width;
+    fb->height = (int)dest->height;
+    return 1;
+}
+
+/* Marcar el GRAPH como modificado. Se ha escrito directamente en la
+ * superficie, sin pasar por gr_put_pixel, así que libbggfx no sabe que su
+ * textura ya no vale: el flag hace que la vuelva a subir al dibujarlo */
+static void ray_fb_commit(RAY_Framebuffer *fb, GRAPH *dest)
+{
+    if (fb->pixels) {
+        dest->texture_must_update = 1;
+    }
+}
+
+/* Recortar el rango de columnas [x, x + count) contra el ancho del destino */
+static inline int ray_fb_clip_columns(const RAY_Framebuffer *fb, int x, int count, int *x0)
+{
+    int x1 = x + count;
+    if (x < 0) x = 0;
+    if (x1 > fb->width) x1 = fb->width;
+    *x0 = x;
+    return x1 - x;
+}
+
+/* Rellenar una fila de 'count' pixels (el strip completo de un rayo) */
+static inline void ray_fb_fill_row(uint32_t *dst, int count, uint32_t pixel)
+{
+    switch (count) {
+        case 1: dst[0] = pixel; return;
+        case 2: dst[0] = pixel; dst[1] = pixel; return;
+        default:
+            for (int i = 0; i < count; i++) dst[i] = pixel;
+            return;
+    }
 }
 
 /* ============================================================================
    MINIMAPA
+   El fondo, el borde y las celdas solo cambian al cargar el mapa o al tocar
+   una celda: se pintan una vez en una capa propia que cada frame se copia
+   fila a fila, y encima se dibujan los marcadores. Las celdas que cambian
+   (RAY_TOGGLE_DOOR) se marcan con ray_minimap_invalidate_cell, y los chunks
+   que se cargan o expulsan con ray_minimap_invalidate_area; se repintan
+   solas en el siguiente frame.
    ============================================================================ */
 
+#define RAY_MINIMAP_MAX_DIRTY 64     /* Más zonas pendientes: repintar todo */
+
+/* Rectángulo de celdas pendiente de repintar */
+typedef struct {
+    int x, y, w, h;
+} RAY_MinimapArea;
+
+typedef struct {
+    uint32_t *pixels;                /* size * size pixels */
+    int size;
+    const RAY_Chunk *chunks;         /* Mapa del que se pintó la capa */
+    int gridWidth, gridHeight;
+    float scale;
+    int valid;                       /* 0 = repintar la capa entera */
+    RAY_MinimapArea dirty[RAY_MINIMAP_MAX_DIRTY];
+    int numDirty;
+} RAY_MinimapLayer;
+
+static RAY_MinimapLayer g_minimap = {0};
+
+void ray_minimap_invalidate(void)
+{
+    g_minimap.valid = 0;
+    g_minimap.numDirty = 0;
+}
+
+void ray_minimap_invalidate_area(int x, int y, int w, int h)
+{
+    if (!g_minimap.valid) return;
+    
+    /* Recortar al grid */
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > g_minimap.gridWidth) w = g_minimap.gridWidth - x;
+    if (y + h > g_minimap.gridHeight) h = g_minimap.gridHeight - y;
+    if (w <= 0 || h <= 0) return;
+    
+    for (int i = 0; i < g_minimap.numDirty; i++) {
+        const RAY_MinimapArea *area = &g_minimap.dirty[i];
+        if (area->x == x && area->y == y && area->w == w && area->h == h) return;
+    }
+    if (g_minimap.numDirty >= RAY_MINIMAP_MAX_DIRTY) {
+        ray_minimap_invalidate();
+        return;
+    }
+    RAY_MinimapArea *area = &g_minimap.dirty[g_minimap.numDirty++];
+    area->x = x;
+    area->y = y;
+    area->w = w;
+    area->h = h;
+}
+
+void ray_minimap_invalidate_cell(int x, int y)
+{
+    ray_minimap_invalidate_area(x, y, 1, 1);
+}
+
+void ray_minimap_free(void)
+{
+    free(g_minimap.pixels);
+    memset(&g_minimap, 0, sizeof(RAY_MinimapLayer));
+}
+
+/* Rellenar un rectángulo de la capa, recortado a su tamaño */
+static void ray_minimap_fill(int x, int y, int w, int h, uint32_t color)
+{
+    int x1 = x + w, y1 = y + h;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 > g_minimap.size) x1 = g_minimap.size;
+    if (y1 > g_minimap.size) y1 = g_minimap.size;
+    
+    for (int py = y; py < y1; py++) {
+        uint32_t *row = g_minimap.pixels + (size_t)py * g_minimap.size;
+        for (int px = x; px < x1; px++) row[px] = color;
+    }
+}
+
+static void ray_minimap_paint_cell(int gx, int gy)
+{
+    int cell = gx + gy * g_minimap.gridWidth;
+    int cell_value = ray_world_wall(&g_engine.world, 0, gx, gy);
+    
+    int map_x = (int)(gx * RAY_TILE_SIZE * g_minimap.scale);
+    int map_y = (int)(gy * RAY_TILE_SIZE * g_minimap.scale);
+    int cell_size = (int)(RAY_TILE_SIZE * g_minimap.scale);
+    if (cell_size < 1) cell_size = 1;
+    
+    /* Color según tipo de celda */
+    uint32_t fill_color = 0xFF202020;  /* Gris muy oscuro (vacío) */
+    uint32_t grid_color = 0xFF404040;  /* Gris oscuro (líneas de grid) */
+    
+    if (cell_value > 0 && cell_value < 1000) {
+        fill_color = 0xFFC0C0FF;  /* Azul claro (pared) */
+        grid_color = 0xFF8080C0;  /* Azul medio (borde de pared) */
+    } else if (cell_value >= 1000) {
+        fill_color = 0xFF00FFFF;  /* Cyan brillante (puerta) */
+        grid_color = 0xFF00C0C0;  /* Cyan oscuro (borde de puerta) */
+        RAY_Door *door = ray_door_at(cell);
+        if (door && door->state) {
+            fill_color = 0xFF202020;  /* Puerta abierta: se ve el paso */
+        }
+    }
+    
+    /* Borde de la celda (grid) y relleno */
+    ray_minimap_fill(map_x, map_y, cell_size, cell_size, grid_color);
+    ray_minimap_fill(map_x + 1, map_y + 1, cell_size - 2, cell_size - 2, fill_color);
+}
+
+/* Pintar la capa entera para el mapa y tamaño actuales */
+static int ray_minimap_bake(const RAY_Chunk *chunks, int grid_width, int grid_height, int size)
+{
+    if (size != g_minimap.size || !g_minimap.pixels) {
+        free(g_minimap.pixels);
+        g_minimap.pixels = (uint32_t*)malloc((size_t)size * size * sizeof(uint32_t));
+        g_minimap.size = g_minimap.pixels ? size : 0;
+        if (!g_minimap.pixels) return 0;
+    }
+    
+    g_minimap.chunks = chunks;
+    g_minimap.gridWidth = grid_width;
+    g_minimap.gridHeight = grid_height;
+    g_minimap.numDirty = 0;
+    
+    /* Escala para que todo el mapa quepa en el minimapa */
+    float scale_x = size / (float)(grid_width * RAY_TILE_SIZE);
+    float scale_y = size / (float)(grid_height * RAY_TILE_SIZE);
+    g_minimap.scale = (scale_x < scale_y) ? scale_x : scale_y;
+    
+    /* Fondo negro opaco y borde blanco */
+    ray_minimap_fill(0, 0, size, size, 0xFF000000);
+    ray_minimap_fill(0, 0, size, 1, 0xFFFFFFFF);
+    ray_minimap_fill(0, size - 1, size, 1, 0xFFFFFFFF);
+    ray_minimap_fill(0, 0, 1, size, 0xFFFFFFFF);
+    ray_minimap_fill(size - 1, 0, 1, size, 0xFFFFFFFF);
+    
+    for (int gy = 0; gy < grid_height; gy++) {
+        for (int gx = 0; gx < grid_width; gx++) {
+            ray_minimap_paint_cell(gx, gy);
+        }
+    }
+    
+    g_minimap.valid = 1;
+    return 1;
+}
+
+/* Pixel de un marcador, recortado al minimapa y al destino */
+static inline void ray_minimap_plot(int x, int y, uint32_t color)
+{
+    if (x < g_engine.minimap_x || x >= g_engine.minimap_x + g_minimap.size ||
+        y < g_engine.minimap_y || y >= g_engine.minimap_y + g_minimap.size) {
+        return;
+    }
+    if ((unsigned)x >= (unsigned)g_fb.width || (unsigned)y >= (unsigned)g_fb.height) {
+        return;
+    }
+    g_fb.pixels[(size_t)y * g_fb.pitch + x] = color;
+}
+
 static void ray_draw_minimap(GRAPH *dest)
 {
-    if (!g_engine.drawMiniMap || !g_engine.raycaster.grids || !g_engine.raycaster.grids[0]) {
+    (void)dest;
+    if (!g_engine.drawMiniMap || !g_engine.world.chunks) {
         return;
     }
     
-    int *grid = g_engine.raycaster.grids[0];
+    const RAY_Chunk *chunks = g_engine.world.chunks;
     int grid_width = g_engine.raycaster.gridWidth;
     int grid_height = g_engine.raycaster.gridHeight;
-    
     int minimap_x = g_engine.minimap_x;
     int minimap_y = g_engine.minimap_y;
     int minimap_size = g_engine.minimap_size;
-    float scale = g_engine.minimap_scale;
-    
-    /* MINIMAPA ESTÁTICO - Mostrar TODO el mapa */
-    /* El punto rojo se mueve, el mapa NO se mueve */
-    int start_x = 0;
-    int start_y = 0;
-    int end_x = grid_width;
-    int end_y = grid_height;
-    
-    /* Calcular escala para que todo el mapa quepa en el minimapa */
-    float map_world_width = grid_width * RAY_TILE_SIZE;
-    float map_world_height = grid_height * RAY_TILE_SIZE;
-    
-    /* Usar la escala más pequeña para que todo quepa */
-    float scale_x = minimap_size / map_world_width;
-    float scale_y = minimap_size / map_world_height;
-    scale = (scale_x < scale_y) ? scale_x : scale_y;
-    
-    /* Fondo del minimapa (negro opaco) */
-    uint32_t bg_color = 0xFF000000;  /* Negro opaco */
-    for (int y = 0; y < minimap_size; y++) {
-        for (int x = 0; x < minimap_size; x++) {
-            int screen_x = minimap_x + x;
-            int screen_y = minimap_y + y;
-            if (screen_x >= 0 && screen_x < g_engine.displayWidth &&
-                screen_y >= 0 && screen_y < g_engine.displayHeight) {
-                gr_put_pixel(dest, screen_x, screen_y, bg_color);
+    if (minimap_size <= 0 || grid_width <= 0 || grid_height <= 0 || !g_fb.pixels) return;
+    
+    /* Capa estática: entera si cambió el mapa o el tamaño, si no solo las
+     * celdas marcadas */
+    if (!g_minimap.valid || g_minimap.size != minimap_size || g_minimap.chunks != chunks ||
+        g_minimap.gridWidth != grid_width || g_minimap.gridHeight != grid_height) {
+        if (!ray_minimap_bake(chunks, grid_width, grid_height, minimap_size)) return;
+    } else {
+        for (int i = 0; i < g_minimap.numDirty; i++) {
+            const RAY_MinimapArea *area = &g_minimap.dirty[i];
+            for (int gy = area->y; gy < area->y + area->h; gy++) {
+                for (int gx = area->x; gx < area->x + area->w; gx++) {
+                    ray_minimap_paint_cell(gx, gy);
+                }
             }
         }
+        g_minimap.numDirty = 0;
     }
     
-    /* Borde blanco del minimapa */
-    uint32_t border_color = 0xFFFFFFFF;
-    for (int i = 0; i < minimap_size; i++) {
-        /* Borde superior e inferior */
-        gr_put_pixel(dest, minimap_x + i, minimap_y, border_color);
-        gr_put_pixel(dest, minimap_x + i, minimap_y + minimap_size - 1, border_color);
-        /* Borde izquierdo y derecho */
-        gr_put_pixel(dest, minimap_x, minimap_y + i, border_color);
-        gr_put_pixel(dest, minimap_x + minimap_size - 1, minimap_y + i, border_color);
+    /* Copiar la capa fila a fila */
+    int x0 = minimap_x < 0 ? 0 : minimap_x;
+    int x1 = minimap_x + minimap_size < g_fb.width ? minimap_x + minimap_size : g_fb.width;
+    int y0 = minimap_y < 0 ? 0 : minimap_y;
+    int y1 = minimap_y + minimap_size < g_fb.height ? minimap_y + minimap_size : g_fb.height;
+    for (int y = y0; y < y1 && x1 > x0; y++) {
+        memcpy(g_fb.pixels + (size_t)y * g_fb.pitch + x0,
+               g_minimap.pixels + (size_t)(y - minimap_y) * minimap_size + (x0 - minimap_x),
+               (size_t)(x1 - x0) * sizeof(uint32_t));
     }
     
-    
-    /* Dibujar celdas del mapa con grid */
-    for (int gy = start_y; gy < end_y; gy++) {
-        for (int gx = start_x; gx < end_x; gx++) {
-            if (gx < 0 || gx >= grid_width || gy < 0 || gy >= grid_height) continue;
-            
-            int cell_value = grid[gx + gy * grid_width];
-            
-            /* Calcular posición en el minimapa (mapa estático) */
-            float cell_world_x = gx * RAY_TILE_SIZE;
-            float cell_world_y = gy * RAY_TILE_SIZE;
-            
-            int map_x = (int)(cell_world_x * scale);
-            int map_y = (int)(cell_world_y * scale);
-            int cell_size = (int)(RAY_TILE_SIZE * scale);
-            if (cell_size < 1) cell_size = 1;
-            
-            /* Color según tipo de celda */
-            uint32_t fill_color = 0xFF202020;  /* Gris muy oscuro (vacío) */
-            uint32_t grid_color = 0xFF404040;  /* Gris oscuro (líneas de grid) */
-            
-            if (cell_value > 0 && cell_value < 1000) {
-                fill_color = 0xFFC0C0FF;  /* Azul claro (pared) */
-                grid_color = 0xFF8080C0;  /* Azul medio (borde de pared) */
-            } else if (cell_value >= 1000) {
-                fill_color = 0xFF00FFFF;  /* Cyan brillante (puerta) */
-                grid_color = 0xFF00C0C0;  /* Cyan oscuro (borde de puerta) */
-            }
-            
-            /* Dibujar relleno de celda */
-            for (int dy = 1; dy < cell_size - 1; dy++) {
-                for (int dx = 1; dx < cell_size - 1; dx++) {
-                    int screen_x = minimap_x + map_x + dx;
-                    int screen_y = minimap_y + map_y + dy;
-                    if (screen_x >= minimap_x && screen_x < minimap_x + minimap_size &&
-                        screen_y >= minimap_y && screen_y < minimap_y + minimap_size) {
-                        gr_put_pixel(dest, screen_x, screen_y, fill_color);
-                    }
-                }
-            }
-            
-            /* Dibujar bordes de celda (grid) */
-            for (int i = 0; i < cell_size; i++) {
-                /* Borde superior e inferior */
-                int top_x = minimap_x + map_x + i;
-                int top_y = minimap_y + map_y;
-                int bottom_y = minimap_y + map_y + cell_size - 1;
-                
-                if (top_x >= minimap_x && top_x < minimap_x + minimap_size) {
-                    if (top_y >= minimap_y && top_y < minimap_y + minimap_size)
-                        gr_put_pixel(dest, top_x, top_y, grid_color);
-                    if (bottom_y >= minimap_y && bottom_y < minimap_y + minimap_size)
-                        gr_put_pixel(dest, top_x, bottom_y, grid_color);
-                }
-                
-                /* Borde izquierdo y derecho */
-                int left_x = minimap_x + map_x;
-                int right_x = minimap_x + map_x + cell_size - 1;
-                int side_y = minimap_y + map_y + i;
-                
-                if (side_y >= minimap_y && side_y < minimap_y + minimap_size) {
-                    if (left_x >= minimap_x && left_x < minimap_x + minimap_size)
-                        gr_put_pixel(dest, left_x, side_y, grid_color);
-                    if (right_x >= minimap_x && right_x < minimap_x + minimap_size)
-                        gr_put_pixel(dest, right_x, side_y, grid_color);
-                }
-            }
-        }
-    }
+    float scale = g_minimap.scale;
     
     /* Dibujar sprites (Santas) */
     for (int i = 0; i < g_engine.num_sprites; i++) {
@@ -180,31 +336,20 @@ static void ray_draw_minimap(GRAPH *dest)
         
         int sprite_grid_x = (int)(sprite->x / RAY_TILE_SIZE);
         int sprite_grid_y = (int)(sprite->y / RAY_TILE_SIZE);
+        if (sprite_grid_x < 0 || sprite_grid_x >= grid_width ||
+            sprite_grid_y < 0 || sprite_grid_y >= grid_height) continue;
         
-        if (sprite_grid_x >= start_x && sprite_grid_x < end_x &&
-            sprite_grid_y >= start_y && sprite_grid_y < end_y) {
-            
-            /* Calcular posición en minimapa estático */
-            int map_x = (int)(sprite->x * scale);
-            int map_y = (int)(sprite->y * scale);
-            
-            /* Dibujar punto cyan para sprite (Santas) */
-            uint32_t sprite_color = 0xFF00FFFF;  /* Cyan */
-            int sprite_size = 5;
-            for (int dy = -sprite_size; dy <= sprite_size; dy++) {
-                for (int dx = -sprite_size; dx <= sprite_size; dx++) {
-                    int screen_x = minimap_x + map_x + dx;
-                    int screen_y = minimap_y + map_y + dy;
-                    if (screen_x >= minimap_x && screen_x < minimap_x + minimap_size &&
-                        screen_y >= minimap_y && screen_y < minimap_y + minimap_size) {
-                        gr_put_pixel(dest, screen_x, screen_y, sprite_color);
-                    }
-                }
+        /* Punto cyan para el sprite */
+        int map_x = (int)(sprite->x * scale);
+        int map_y = (int)(sprite->y * scale);
+        int sprite_size = 5;
+        for (int dy = -sprite_size; dy <= sprite_size; dy++) {
+            for (int dx = -sprite_size; dx <= sprite_size; dx++) {
+                ray_minimap_plot(minimap_x + map_x + dx, minimap_y + map_y + dy, 0xFF00FFFF);
             }
         }
     }
     
-    
     /* Dibujar cámara (punto rojo) en su posición real del mapa */
     /* Posición de la cámara en el mundo */
     float camera_world_x = g_engine.camera.x;
@@ -223,23 +368,10 @@ static void ray_draw_minimap(GRAPH *dest)
         float t = i / dir_length;
         int line_x = minimap_x + player_map_x + (int)(dir_x * t);
         int line_y = minimap_y + player_map_y + (int)(dir_y * t);
-        if (line_x >= minimap_x && line_x < minimap_x + minimap_size &&
-            line_y >= minimap_y && line_y < minimap_y + minimap_size) {
-            gr_put_pixel(dest, line_x, line_y, 0xFFFFFF00);  /* Amarillo */
-        }
+        ray_minimap_plot(line_x, line_y, 0xFFFFFF00);  /* Amarillo */
     }
     
-    /* DEBUG: Imprimir posición del punto rojo */
-    static int debug_count = 0;
-    if (debug_count < 5) {
-        printf("MINIMAPA: camera=(%.1f, %.1f) scale=%.3f -> map_pos=(%d, %d) minimap_area=(%d,%d,%d,%d)\n",
-               camera_world_x, camera_world_y, scale,
-               player_map_x, player_map_y,
-               minimap_x, minimap_y, minimap_x + minimap_size, minimap_y + minimap_size);
-        printf("PUNTO ROJO: Se dibujará en screen=(%d, %d) con radio 20\n", 
-               minimap_x + player_map_x, minimap_y + player_map_y);
-        debug_count++;
-    }
+    RAY_TRACE(RAY_TRACE_MINIMAP, player_map_x, player_map_y, minimap_x, minimap_y, scale);
     
     
     /* Dibujar punto del jugador - CÍRCULO BLANCO */
@@ -251,12 +383,8 @@ static void ray_draw_minimap(GRAPH *dest)
         for (int dx = -player_size; dx <= player_size; dx++) {
             /* Solo dibujar si está dentro del círculo */
             if (dx*dx + dy*dy <= player_size*player_size) {
-                int screen_x = minimap_x + player_map_x + dx;
-                int screen_y = minimap_y + player_map_y + dy;
-                if (screen_x >= minimap_x && screen_x < minimap_x + minimap_size &&
-                    screen_y >= minimap_y && screen_y < minimap_y + minimap_size) {
-                    gr_put_pixel(dest, screen_x, screen_y, player_color);
-                }
+                ray_minimap_plot(minimap_x + player_map_x + dx, minimap_y + player_map_y + dy,
+                                 player_color);
             }
         }
     }
@@ -266,23 +394,49 @@ static void ray_draw_minimap(GRAPH *dest)
    TEXTURE SAMPLING
    ============================================================================ */
 
-static uint32_t ray_sample_texture(GRAPH *texture, int tex_x, int tex_y)
+/* Texels ya convertidos al formato destino por la texture cache. Las
+ * texturas potencia de 2 se repiten con sus máscaras, sin comprobar
+ * límites; las demás devuelven negro fuera de rango */
+static inline uint32_t ray_sample_texture(const RAY_Texture *texture, int tex_x, int tex_y)
 {
-    if (!texture || tex_x < 0 || tex_y < 0 || 
-        tex_x >= texture->width || tex_y >= texture->height) {
+    if ((texture->wmask | texture->hmask) >= 0) {
+        return texture->pixels[(tex_y & texture->hmask) * texture->width + (tex_x & texture->wmask)];
+    }
+    if ((unsigned)tex_x >= (unsigned)texture->width ||
+        (unsigned)tex_y >= (unsigned)texture->height) {
         return 0xFF000000; /* Negro opaco */
     }
-    
-    uint32_t pixel = gr_get_pixel(texture, tex_x, tex_y);
-    
-    /* Extraer componentes RGB usando el formato de pixel */
-    extern SDL_PixelFormat *gPixelFormat;
-    uint8_t r = (pixel >> gPixelFormat->Rshift) & 0xFF;
-    uint8_t g = (pixel >> gPixelFormat->Gshift) & 0xFF;
-    uint8_t b = (pixel >> gPixelFormat->Bshift) & 0xFF;
-    
-    /* Retornar color opaco usando SDL_MapRGB */
-    return SDL_MapRGB(gPixelFormat, r, g, b);
+    return texture->pixels[tex_y * texture->width + tex_x];
+}
+
+/* Columna traspuesta de una textura de pared: texel 'tex_y' de la columna */
+static inline uint32_t ray_sample_column(const RAY_Texture *texture, const uint32_t *column, int tex_y)
+{
+    if (!column || (unsigned)tex_y >= (unsigned)texture->height) {
+        return 0xFF000000; /* Negro opaco */
+    }
+    return column[tex_y];
+}
+
+/* Textura de la caché por ID de graph. Solo lee: NULL si no está
+ * convertida (las convierte el hilo principal, libmod_ray_textures.c) */
+static inline RAY_Texture *ray_texture_get(int graph_id)
+{
+    if (graph_id > 0 && graph_id < RAY_MAX_TEXTURES &&
+        g_engine.textureCache.textures[graph_id].state == RAY_TEXTURE_LOADED) {
+        return &g_engine.textureCache.textures[graph_id];
+    }
+    return NULL;
+}
+
+/* Igual, para paredes: exige la copia por columnas */
+static inline RAY_Texture *ray_texture_get_wall(int graph_id)
+{
+    if (graph_id > 0 && graph_id < RAY_MAX_TEXTURES &&
+        g_engine.textureCache.textures[graph_id].columns) {
+        return &g_engine.textureCache.textures[graph_id];
+    }
+    return NULL;
 }
 
 
@@ -316,26 +470,28 @@ static SDL_Rect ray_strip_screen_rect(float viewDist, RAY_RayHit *rayHit, float
 
 /* Slope drawing functions removed - slopes no longer supported */
 
-static void ray_draw_wall_strip(GRAPH *dest, RAY_RayHit *rayHit, 
+static void ray_draw_wall_strip(GRAPH *dest, const RAY_RayHit *rayHit, 
+                                const RAY_RayHitCold *rayCold, int strip,
                                 int wall_screen_height, float player_screen_z,
-                                GRAPH *wall_texture, int horizontal)
+                                const RAY_Texture *wall_texture, int horizontal,
+                                RAY_WorkerStats *stats)
 {
     int default_wall_screen_height = ray_strip_screen_height(g_engine.viewDist, 
                                                              rayHit->correctDistance, 
                                                              RAY_TILE_SIZE);
     
     int screen_y;
-    if (rayHit->thinWall) {
+    if (rayCold) {
         screen_y = (g_engine.displayHeight - (int)default_wall_screen_height) / 2;
         
         if (rayHit->wallHeight != RAY_TILE_SIZE) {
             screen_y += ((int)default_wall_screen_height - wall_screen_height);
         }
         
-        if (rayHit->thinWall->z > 0) {
+        if (rayCold->thinWall->z > 0) {
             int z_screen_height = ray_strip_screen_height(g_engine.viewDist,
                                                          rayHit->correctDistance,
-                                                         rayHit->thinWall->z);
+                                                         rayCold->thinWall->z);
             screen_y -= z_screen_height;
         }
         
@@ -356,39 +512,48 @@ static void ray_draw_wall_strip(GRAPH *dest, RAY_RayHit *rayHit,
         screen_y = floor_start_y - wall_screen_height;
     }
     
-    static int coord_debug = 0;
-    if (coord_debug < 3) {
-        int reference_wall_height = ray_strip_screen_height(g_engine.viewDist, rayHit->correctDistance, RAY_TILE_SIZE);
-        int floor_start_y = (g_engine.displayHeight - reference_wall_height) / 2 + reference_wall_height + (int)player_screen_z + (int)g_engine.camera.pitch;
-        printf("COORD_DEBUG: wall_h=%d, ref_h=%d, screen_y=%d, floor_start_y=%d\n",
-               wall_screen_height, reference_wall_height, screen_y, floor_start_y);
-        coord_debug++;
-    }
+    RAY_TRACE(RAY_TRACE_WALL_COORD, wall_screen_height,
+              ray_strip_screen_height(g_engine.viewDist, rayHit->correctDistance, RAY_TILE_SIZE),
+              screen_y,
+              (g_engine.displayHeight + ray_strip_screen_height(g_engine.viewDist, rayHit->correctDistance, RAY_TILE_SIZE)) / 2 +
+              (int)player_screen_z + (int)g_engine.camera.pitch, 0);
     
-    int screen_x = rayHit->strip * g_engine.stripWidth;
+    int screen_x = strip * g_engine.stripWidth;
     
     int texture_x = (int)rayHit->tileX;
     if (texture_x < 0) texture_x = 0;
     if (texture_x >= RAY_TEXTURE_SIZE) texture_x = RAY_TEXTURE_SIZE - 1;
     
-    for (int y = 0; y < wall_screen_height; y++) {
+    /* Toda la columna de textura es contigua en la copia traspuesta */
+    const uint32_t *column = NULL;
+    if (texture_x < wall_texture->width) {
+        column = wall_texture->columns + (size_t)texture_x * wall_texture->height;
+    }
+    
+    /* Recortar el span una sola vez */
+    int x0;
+    int columns = ray_fb_clip_columns(&g_fb, screen_x, g_engine.stripWidth, &x0);
+    if (columns <= 0) return;
+    
+    int y_start = screen_y < 0 ? 0 : screen_y;
+    int y_end = screen_y + wall_screen_height;
+    if (y_end > g_fb.height) y_end = g_fb.height;
+    if (y_end > y_start) {
+        stats->samples += y_end - y_start;
+        stats->pixels += (uint64_t)(y_end - y_start) * columns;
+    }
+    
+    uint32_t *dst = g_fb.pixels + (size_t)y_start * g_fb.pitch + x0;
+    for (int draw_y = y_start; draw_y < y_end; draw_y++, dst += g_fb.pitch) {
+        int y = draw_y - screen_y;
         float texture_y_f = ((float)y / wall_screen_height) * RAY_TEXTURE_SIZE;
         
         int texture_y = (int)texture_y_f;
         if (texture_y < 0) texture_y = 0;
         if (texture_y >= RAY_TEXTURE_SIZE) texture_y = RAY_TEXTURE_SIZE - 1;
         
-        uint32_t pixel = ray_sample_texture(wall_texture, texture_x, texture_y);
-        
-        int draw_y = screen_y + y;
-        if (draw_y >= 0 && draw_y < dest->height) {
-            for (int w = 0; w < g_engine.stripWidth; w++) {
-                int draw_x = screen_x + w;
-                if (draw_x >= 0 && draw_x < dest->width) {
-                    gr_put_pixel(dest, draw_x, draw_y, pixel);
-                }
-            }
-        }
+        uint32_t pixel = ray_sample_column(wall_texture, column, texture_y);
+        ray_fb_fill_row(dst, columns, pixel);
     }
 }
 
@@ -396,18 +561,59 @@ static void ray_draw_wall_strip(GRAPH *dest, RAY_RayHit *rayHit,
    FLOOR AND CEILING RENDERING
    ============================================================================ */
 
-static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
-                                         int wall_screen_height, float player_screen_z)
+/* Límites del suelo y del techo de un strip según la pared que lo recorta:
+ * el suelo se dibuja desde floor_start_y hacia abajo y el techo hasta
+ * ceiling_end_y (exclusivo). Compartido por el modo columnas y el de spans. */
+static void ray_floor_ceiling_bounds(int wall_screen_height, float player_screen_z,
+                                     int *floor_start_y, int *ceiling_end_y)
+{
+    float center_plane = g_engine.displayHeight / 2.0f;
+    
+    if (wall_screen_height == 0) {
+        // No hay paredes sólidas - renderizar desde el centro
+        *floor_start_y = (int)center_plane;
+    } else {
+        // Hay paredes - renderizar DESPUÉS de la pared
+        *floor_start_y = (g_engine.displayHeight - wall_screen_height) / 2 + wall_screen_height;
+        *floor_start_y += (int)player_screen_z;
+        
+        // Asegurar que no empiece antes del centro
+        if (*floor_start_y < center_plane) {
+            *floor_start_y = (int)center_plane;
+        }
+    }
+    
+    *ceiling_end_y = (g_engine.displayHeight - wall_screen_height) / 2;
+    *ceiling_end_y += (int)player_screen_z;
+}
+
+/* Dirección del rayo del strip, la misma que da ray_strip_ray: tabla del
+ * strip y cos/sin de la rotación del frame, sin trigonometría por strip */
+static inline void ray_strip_direction(int strip, float cos_rot, float sin_rot,
+                                       float *dir_x, float *dir_y)
+{
+    const RAY_StripTrig *trig = &g_engine.stripTrig[strip];
+    *dir_x = cos_rot * trig->cosAngle - sin_rot * trig->sinAngle;
+    *dir_y = -(sin_rot * trig->cosAngle + cos_rot * trig->sinAngle);
+}
+
+static void ray_draw_floor_ceiling_strip(GRAPH *dest, int strip, float dir_x, float dir_y,
+                                         int wall_screen_height, float player_screen_z,
+                                         RAY_WorkerStats *stats)
 {
-    if (!dest || !rayHit) return;
+    if (!dest) return;
     
-    int strip = rayHit->strip;
     int strip_width = g_engine.stripWidth;
     int screen_x = strip * strip_width;
     
+    /* Columnas del strip recortadas una vez para suelo y techo */
+    int x0;
+    int columns = ray_fb_clip_columns(&g_fb, screen_x, strip_width, &x0);
+    if (columns <= 0) return;
+    
     float eye_height = RAY_TILE_SIZE / 2.0f + g_engine.camera.z;
     float center_plane = g_engine.displayHeight / 2.0f;
-    float cos_factor = 1.0f / cosf(g_engine.camera.rot - rayHit->rayAngle);
+    float cos_factor = g_engine.stripTrig[strip].invCos;
     
     int texture_repeat = 2; /* Repetición de textura */
     
@@ -422,11 +628,6 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
     if (camera_level < 0) camera_level = 0;
     if (camera_level > 2) camera_level = 2;
     
-    /* Verificar si hay grid de suelo para este nivel */
-    if (!g_engine.floorGrids[camera_level]) {
-        return; // No floor data
-    }
-    
     /* Calcular Z relativo dentro del nivel actual (0-128) */
     float level_base_z = camera_level * RAY_TILE_SIZE;
     float relative_z = g_engine.camera.z - level_base_z;
@@ -437,28 +638,16 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
     /* Calcular center_plane relativo - ajustado por la altura dentro del nivel */
     float relative_center_plane = center_plane;
         
-        /* Calcular límite Y en pantalla para este nivel de suelo */
-        int floor_start_y;
-        
-        if (wall_screen_height == 0) {
-            // No hay paredes sólidas - renderizar desde el centro
-            floor_start_y = (int)relative_center_plane;
-        } else {
-            // Hay paredes - renderizar DESPUÉS de la pared
-            floor_start_y = (g_engine.displayHeight - wall_screen_height) / 2 + wall_screen_height;
-            floor_start_y += (int)player_screen_z;
-            
-            // Asegurar que no empiece antes del centro
-            if (floor_start_y < relative_center_plane) {
-                floor_start_y = (int)relative_center_plane;
-            }
-        }
+        /* Calcular límites Y en pantalla para suelo y techo */
+        int floor_start_y, ceiling_end_y;
+        ray_floor_ceiling_bounds(wall_screen_height, player_screen_z, &floor_start_y, &ceiling_end_y);
         
         /* Solo renderizar si este suelo es visible en pantalla */
-        if (floor_start_y >= g_engine.displayHeight) return;
+        if (floor_start_y >= g_fb.height) return;
+        if (floor_start_y < 0) floor_start_y = 0;
         
         /* Renderizar suelo con coordenadas relativas */
-        for (int screen_y = floor_start_y; screen_y < g_engine.displayHeight; screen_y++) {
+        for (int screen_y = floor_start_y; screen_y < g_fb.height; screen_y++) {
             if (screen_y - relative_center_plane <= 0) continue;
             
             /* Usar altura relativa dentro del nivel */
@@ -466,8 +655,8 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
             float straight_distance = g_engine.viewDist * ratio;
             float diagonal_distance = straight_distance * cos_factor;
             
-            float x_end = g_engine.camera.x + diagonal_distance * cosf(rayHit->rayAngle);
-            float y_end = g_engine.camera.y + diagonal_distance * -sinf(rayHit->rayAngle);
+            float x_end = g_engine.camera.x + diagonal_distance * dir_x;
+            float y_end = g_engine.camera.y + diagonal_distance * dir_y;
             
             int tile_x = (int)(x_end / RAY_TILE_SIZE);
             int tile_y = (int)(y_end / RAY_TILE_SIZE);
@@ -477,21 +666,15 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
                 continue;
             }
             
-            /* Obtener tipo de tile de suelo del nivel actual */
-            int floor_tile_type = g_engine.floorGrids[camera_level][tile_x + tile_y * g_engine.raycaster.gridWidth];
+            /* Obtener tipo de tile de suelo del nivel actual (0 sin grid de suelo) */
+            int floor_tile_type = ray_world_floor(&g_engine.world, camera_level, tile_x, tile_y);
             
-            // DEBUG: Verificar por qué no se renderiza el suelo
-            static int floor_debug = 0;
-            if (floor_debug < 5 && floor_tile_type > 0) {
-                printf("FLOOR_DEBUG: tile_type=%d, tile_pos=(%d,%d), screen_y=%d, floor_start_y=%d\n",
-                       floor_tile_type, tile_x, tile_y, screen_y, floor_start_y);
-                floor_debug++;
-            }
+            RAY_TRACE(RAY_TRACE_FLOOR_TILE, floor_tile_type, tile_x, tile_y, screen_y, 0);
             
             if (floor_tile_type <= 0) continue;
             
             /* Obtener textura del FPG */
-            GRAPH *floor_texture = bitmap_get(g_engine.fpg_id, floor_tile_type);
+            RAY_Texture *floor_texture = ray_texture_get(floor_tile_type);
             if (!floor_texture) continue;
             
             /* Calcular coordenadas de textura */
@@ -511,9 +694,9 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
             }
             
             /* Dibujar pixel(s) */
-            for (int sx = 0; sx < strip_width && screen_x + sx < g_engine.displayWidth; sx++) {
-                gr_put_pixel(dest, screen_x + sx, screen_y, pixel);
-            }
+            ray_fb_fill_row(g_fb.pixels + (size_t)screen_y * g_fb.pitch + x0, columns, pixel);
+            stats->samples++;
+            stats->pixels += columns;
         }
     
     
@@ -525,18 +708,10 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
     
     /* Usar nivel actual (ya calculado arriba) */
     
-    /* Verificar si hay grid de techo para este nivel */
-    if (!g_engine.ceilingGrids[camera_level]) {
-        return; // No ceiling data
-    }
-    
     /* Altura del techo relativa: siempre 128 desde el suelo del nivel */
     float relative_ceiling_height = RAY_TILE_SIZE;
     
-    int ceiling_end_y = (g_engine.displayHeight - wall_screen_height) / 2;
-    ceiling_end_y += (int)player_screen_z;
-    
-    for (int screen_y = 0; screen_y < ceiling_end_y && screen_y < g_engine.displayHeight; screen_y++) {
+    for (int screen_y = 0; screen_y < ceiling_end_y && screen_y < g_fb.height; screen_y++) {
         if (relative_center_plane - screen_y <= 0) continue;
         
         /* Distancia relativa al techo */
@@ -550,8 +725,8 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
         float diagonal_distance = straight_distance * cos_factor;
         
         /* Calcular posición en el mundo */
-        float x_end = g_engine.camera.x + diagonal_distance * cosf(rayHit->rayAngle);
-        float y_end = g_engine.camera.y + diagonal_distance * -sinf(rayHit->rayAngle);
+        float x_end = g_engine.camera.x + diagonal_distance * dir_x;
+        float y_end = g_engine.camera.y + diagonal_distance * dir_y;
         
         /* Calcular tile basándose en la posición proyectada */
         int tile_x = (int)(x_end / RAY_TILE_SIZE);
@@ -563,12 +738,12 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
         }
         
         /* Obtener tipo de tile de techo del nivel actual */
-        int ceiling_tile_type = g_engine.ceilingGrids[camera_level][tile_x + tile_y * g_engine.raycaster.gridWidth];
+        int ceiling_tile_type = ray_world_ceiling(&g_engine.world, camera_level, tile_x, tile_y);
         
         if (ceiling_tile_type <= 0) continue;
         
         /* Obtener textura del FPG */
-        GRAPH *ceiling_texture = bitmap_get(g_engine.fpg_id, ceiling_tile_type);
+        RAY_Texture *ceiling_texture = ray_texture_get(ceiling_tile_type);
         if (!ceiling_texture) continue;
         
         /* Calcular coordenadas de textura */
@@ -588,159 +763,542 @@ static void ray_draw_floor_ceiling_strip(GRAPH *dest, RAY_RayHit *rayHit,
         }
         
         /* Dibujar pixel(s) */
-        for (int sx = 0; sx < strip_width && screen_x + sx < g_engine.displayWidth; sx++) {
-            gr_put_pixel(dest, screen_x + sx, screen_y, pixel);
-        }
+        ray_fb_fill_row(g_fb.pixels + (size_t)screen_y * g_fb.pitch + x0, columns, pixel);
+        stats->samples++;
+        stats->pixels += columns;
     }
 
 }
 
 
 /* ============================================================================
-   SPRITE RENDERING
+   FLOOR AND CEILING RENDERING - SPANS POR FILAS
+   Todos los pixels de una fila de suelo o techo están a la misma distancia
+   recta de la cámara: se calcula una vez por fila y la posición en el mundo
+   avanza linealmente de strip en strip (tan(stripAngle) = screenX / viewDist
+   es lineal en el strip). Cada fila se recorta en spans contra los límites
+   por strip que dejó la fase de raycast.
    ============================================================================ */
 
-static int ray_sprite_sorter(const void *a, const void *b)
+/* ¿Le toca esta fila al suelo/techo del strip? */
+static inline int ray_flat_row_visible(int screen_y, const int *bounds, int strip, int is_floor)
 {
-    const RAY_Sprite *sa = (const RAY_Sprite*)a;
-    const RAY_Sprite *sb = (const RAY_Sprite*)b;
-    
-    /* Ordenar de más lejano a más cercano */
-    if (sa->distance > sb->distance) return -1;
-    if (sa->distance < sb->distance) return 1;
-    return 0;
+    return is_floor ? screen_y >= bounds[strip] : screen_y < bounds[strip];
 }
 
-static void ray_draw_sprites(GRAPH *dest, float *z_buffer)
+#define RAY_FOG_ROW_CHUNK 512         /* Pixels de fog que se mezclan de una vez */
+
+/* Spans de una fila sobre el suelo o el techo de 'level', a
+ * 'plane_distance' unidades del ojo y 'row_offset' filas del horizonte */
+static void ray_draw_flat_row(int screen_y, int level, float plane_distance,
+                              float row_offset, const int *bounds, int is_floor,
+                              RAY_WorkerStats *stats)
 {
-    if (!dest || !z_buffer) return;
+    const RAY_World *world = &g_engine.world;
+    int ray_count = g_engine.rayCount;
+    int strip_width = g_engine.stripWidth;
+    int grid_width = g_engine.raycaster.gridWidth;
+    int grid_height = g_engine.raycaster.gridHeight;
     
-    /* Calcular distancias de sprites */
-    for (int i = 0; i < g_engine.num_sprites; i++) {
-        RAY_Sprite *sprite = &g_engine.sprites[i];
-        if (sprite->hidden || sprite->cleanup) continue;
-        
-        float dx = sprite->x - g_engine.camera.x;
-        float dy = sprite->y - g_engine.camera.y;
-        sprite->distance = sqrtf(dx * dx + dy * dy);
-    }
+    /* Distancia recta de la fila (la misma para todos los strips) */
+    float straight_distance = g_engine.viewDist * plane_distance / row_offset;
+    float scale = straight_distance / g_engine.viewDist;
     
-    /* Ordenar sprites por distancia */
-    qsort(g_engine.sprites, g_engine.num_sprites, sizeof(RAY_Sprite), ray_sprite_sorter);
+    /* Punto del mundo en el strip 0 y avance por strip:
+     * cámara + straight_distance * (dirección - perpendicular * tan(stripAngle)) */
+    float cos_rot = cosf(g_engine.camera.rot);
+    float sin_rot = sinf(g_engine.camera.rot);
+    float screen_x0 = (float)((ray_count / 2) * strip_width);
+    float world_x0 = g_engine.camera.x + straight_distance * cos_rot - scale * sin_rot * screen_x0;
+    float world_y0 = g_engine.camera.y - straight_distance * sin_rot - scale * cos_rot * screen_x0;
+    float step_x = scale * sin_rot * strip_width;
+    float step_y = scale * cos_rot * strip_width;
     
-    /* Renderizar sprites */
-    for (int i = 0; i < g_engine.num_sprites; i++) {
-        RAY_Sprite *sprite = &g_engine.sprites[i];
-        if (sprite->hidden || sprite->cleanup || sprite->distance == 0) continue;
-        
-        /* Calcular ángulo del sprite relativo a la cámara */
-        float dx = sprite->x - g_engine.camera.x;
-        float dy = sprite->y - g_engine.camera.y;
-        float sprite_angle = atan2f(-dy, dx);  // Invertir dy
-        
-        /* Normalizar ángulo */
-        while (sprite_angle - g_engine.camera.rot > M_PI) sprite_angle -= RAY_TWO_PI;
-        while (sprite_angle - g_engine.camera.rot < -M_PI) sprite_angle += RAY_TWO_PI;
-        
-        float angle_diff = sprite_angle - g_engine.camera.rot;
-        
-        /* Verificar si el sprite está en el FOV */
-        if (fabsf(angle_diff) > g_engine.fovRadians / 2.0f + 0.5f) continue;
-        
-        /* Calcular posición en pantalla */
-        float sprite_screen_x = tanf(angle_diff) * g_engine.viewDist;
-        int screen_x = g_engine.displayWidth / 2 - (int)sprite_screen_x;
-        
-        /* Calcular tamaño en pantalla */
-        float sprite_screen_height = (g_engine.viewDist / sprite->distance) * sprite->h;
-        float sprite_screen_width = (g_engine.viewDist / sprite->distance) * sprite->w;
-        
-        /* Calcular posición Z en pantalla */
-        float sprite_z_offset = sprite->z - g_engine.camera.z;
-        float sprite_screen_z = (g_engine.viewDist / sprite->distance) * sprite_z_offset;
-        
-        int screen_y = g_engine.displayHeight / 2 - (int)(sprite_screen_height / 2) + (int)sprite_screen_z;
+    uint32_t *row = g_fb.pixels + (size_t)screen_y * g_fb.pitch;
+    int last_tile_type = 0;
+    RAY_Texture *texture = NULL;
+    
+    /* Tramo pendiente de fog: columnas [fog_x, fog_x + fog_count) */
+    uint8_t fog_factors[RAY_FOG_ROW_CHUNK];
+    int fog_x = 0;
+    int fog_count = 0;
+    
+    int strip = 0;
+    while (strip < ray_count) {
+        /* Siguiente span de strips donde la fila es suelo/techo visible */
+        while (strip < ray_count && !ray_flat_row_visible(screen_y, bounds, strip, is_floor)) strip++;
+        int span_start = strip;
+        while (strip < ray_count && ray_flat_row_visible(screen_y, bounds, strip, is_floor)) strip++;
         
-        /* ========================================
-           BILLBOARD - Calcular frame basado en ángulo
-           ======================================== */
-        int billboard_frame = -1;  // -1 = no usar billboard
+        float world_x = world_x0 + span_start * step_x;
+        float world_y = world_y0 + span_start * step_y;
         
-        if (g_engine.billboard_enabled && g_engine.billboard_directions > 0 && sprite->process_ptr != NULL) {
-            /* Calcular ángulo del sprite hacia la cámara */
-            float angle_to_camera = atan2f(dy, dx);
+        for (int s = span_start; s < strip; s++, world_x += step_x, world_y += step_y) {
+            int tile_x = (int)(world_x / RAY_TILE_SIZE);
+            int tile_y = (int)(world_y / RAY_TILE_SIZE);
             
-            /* Calcular ángulo relativo considerando la rotación del sprite */
-            float relative_angle = angle_to_camera - sprite->rot;
+            if (tile_x < 0 || tile_x >= grid_width ||
+                tile_y < 0 || tile_y >= grid_height) {
+                continue;
+            }
             
-            /* Normalizar a rango [0, 2π] */
-            while (relative_angle < 0) relative_angle += RAY_TWO_PI;
-            while (relative_angle >= RAY_TWO_PI) relative_angle -= RAY_TWO_PI;
+            int tile_type = is_floor ? ray_world_floor(world, level, tile_x, tile_y)
+                                     : ray_world_ceiling(world, level, tile_x, tile_y);
+            if (tile_type <= 0) continue;
             
-            /* Convertir ángulo a índice de dirección (0 a num_directions-1) */
-            float angle_per_direction = RAY_TWO_PI / g_engine.billboard_directions;
-            billboard_frame = (int)((relative_angle + angle_per_direction / 2.0f) / angle_per_direction);
-            billboard_frame = billboard_frame % g_engine.billboard_directions;
-        }
-        
-        /* Obtener textura del sprite */
-        GRAPH *sprite_texture = NULL;
-        
-        /* Si el sprite está vinculado a un proceso, usar su graph dinámico */
-        if (sprite->process_ptr != NULL) {
-            /* Si billboard está activo y tenemos un FPG, usar el frame calculado */
-            if (billboard_frame >= 0 && g_engine.fpg_id > 0) {
-                /* Obtener el gráfico directamente del FPG usando el frame billboard */
-                sprite_texture = bitmap_get(g_engine.fpg_id, billboard_frame);
+            /* Las baldosas contiguas suelen repetir textura */
+            if (tile_type != last_tile_type) {
+                texture = ray_texture_get(tile_type);
+                last_tile_type = tile_type;
             }
+            if (!texture) continue;
             
-            /* Si no obtuvimos textura con billboard, usar instance_graph normal */
-            if (!sprite_texture) {
-                sprite_texture = instance_graph(sprite->process_ptr);
-            }
+            /* Calcular coordenadas de textura */
+            int x = ((int)world_x) % RAY_TILE_SIZE;
+            int y = ((int)world_y) % RAY_TILE_SIZE;
+            if (x < 0) x += RAY_TILE_SIZE;
+            if (y < 0) y += RAY_TILE_SIZE;
             
-            /* Si el proceso no tiene graph válido, usar textureID como fallback */
-            if (!sprite_texture && sprite->textureID > 0) {
-                sprite_texture = bitmap_get(g_engine.fpg_id, sprite->textureID);
-            }
-        } else {
-            /* Sprite estático - usar textureID del FPG */
-            sprite_texture = bitmap_get(g_engine.fpg_id, sprite->textureID);
-        }
-        
-        if (!sprite_texture) continue;
-        
-        /* Renderizar sprite */
-        int start_x = screen_x - (int)(sprite_screen_width / 2);
-        int end_x = screen_x + (int)(sprite_screen_width / 2);
-        
-        for (int sx = start_x; sx < end_x; sx++) {
-            if (sx < 0 || sx >= g_engine.displayWidth) continue;
+            int texture_x = (x * texture->width) / RAY_TILE_SIZE;
+            int texture_y = (y * texture->height) / RAY_TILE_SIZE;
             
-            /* Z-buffer check */
-            int strip = sx / g_engine.stripWidth;
-            if (strip >= 0 && strip < g_engine.rayCount) {
-                if (z_buffer[strip] > 0 && sprite->distance > z_buffer[strip]) {
-                    continue; /* Sprite detrás de una pared */
-                }
-            }
+            uint32_t pixel = ray_sample_texture(texture, texture_x, texture_y);
             
-            /* Calcular coordenada de textura X */
-            float tex_x_f = ((float)(sx - start_x) / sprite_screen_width) * sprite_texture->width;
-            int tex_x = (int)tex_x_f;
-            if (tex_x < 0 || tex_x >= sprite_texture->width) continue;
+            int x0;
+            int columns = ray_fb_clip_columns(&g_fb, s * strip_width, strip_width, &x0);
+            if (columns <= 0) continue;
             
-            /* Renderizar columna del sprite */
-            for (int sy = screen_y; sy < screen_y + (int)sprite_screen_height; sy++) {
-                if (sy < 0 || sy >= g_engine.displayHeight) continue;
-                
-                /* Calcular coordenada de textura Y */
+            /* Fog (distancia diagonal = distancia en el plano): se acumulan
+             * los factores de los strips contiguos y se mezcla el tramo
+             * entero de una vez */
+            uint8_t f = 0;
+            if (g_engine.fogOn) {
+                float dx = world_x - g_engine.camera.x;
+                float dy = world_y - g_engine.camera.y;
+                f = ray_fog_factor(sqrtf(dx * dx + dy * dy));
+            }
+            if (fog_count > 0 && (f == 0 || fog_x + fog_count != x0 ||
+                                  fog_count + columns > RAY_FOG_ROW_CHUNK)) {
+                ray_fog_blend_span(row + fog_x, fog_factors, fog_count);
+                fog_count = 0;
+            }
+            if (f && columns > RAY_FOG_ROW_CHUNK) {
+                pixel = ray_fog_blend(pixel, f);
+            } else if (f) {
+                if (fog_count == 0) fog_x = x0;
+                memset(fog_factors + fog_count, f, columns);
+                fog_count += columns;
+            }
+            
+            ray_fb_fill_row(row + x0, columns, pixel);
+            stats->samples++;
+            stats->pixels += columns;
+        }
+    }
+    
+    if (fog_count > 0) {
+        ray_fog_blend_span(row + fog_x, fog_factors, fog_count);
+    }
+}
+
+/* Filas [first, last) de suelo y techo del nivel de la cámara */
+static void ray_draw_floor_ceiling_rows(const int *floor_start, const int *ceiling_end,
+                                        int first, int last, RAY_WorkerStats *stats)
+{
+    /* Mismo sistema relativo por nivel que ray_draw_floor_ceiling_strip */
+    int camera_level = (int)(g_engine.camera.z / RAY_TILE_SIZE);
+    if (camera_level < 0) camera_level = 0;
+    if (camera_level > 2) camera_level = 2;
+    
+    float center_plane = g_engine.displayHeight / 2.0f;
+    float relative_z = g_engine.camera.z - camera_level * RAY_TILE_SIZE;
+    float relative_eye_height = RAY_TILE_SIZE / 2.0f + relative_z;
+    float distance_to_ceiling = RAY_TILE_SIZE - relative_eye_height;
+    
+    for (int screen_y = first; screen_y < last && screen_y < g_fb.height; screen_y++) {
+        if (screen_y - center_plane > 0) {
+            ray_draw_flat_row(screen_y, camera_level, relative_eye_height,
+                              screen_y - center_plane, floor_start, 1, stats);
+        } else if (center_plane - screen_y > 0 && distance_to_ceiling > 0.1f) {
+            ray_draw_flat_row(screen_y, camera_level, distance_to_ceiling,
+                              center_plane - screen_y, ceiling_end, 0, stats);
+        }
+    }
+}
+
+/* ============================================================================
+   ORDEN POR DISTANCIA
+   Los hits de un strip y los sprites se dibujan del más lejano al más
+   cercano. En lugar de intercambiar structs completos se ordena un array
+   compacto de claves (distancia, índice): inserción para pocos elementos y
+   radix sobre los bits del float para muchos. Los dos son estables, como
+   el bubble sort al que sustituyen: a igual distancia se conserva el orden
+   en que el raycaster emitió los hits.
+   ============================================================================ */
+
+#define RAY_SORT_INSERTION_MAX 32
+
+/* Distancia -> entero que ordenado de menor a mayor da el orden lejano->cercano */
+static inline uint32_t ray_hit_sort_key(float distance)
+{
+    union { float f; uint32_t u; } bits;
+    bits.f = distance + 0.0f;        /* -0.0 -> +0.0: iguales como en la comparación float */
+    uint32_t u = (bits.u & 0x80000000u) ? ~bits.u : (bits.u | 0x80000000u);
+    return ~u;
+}
+
+static int ray_sort_keys_insertion(RAY_HitKey *keys, int count)
+{
+    int comparisons = 0;
+    for (int i = 1; i < count; i++) {
+        RAY_HitKey item = keys[i];
+        int j = i;
+        while (j > 0) {
+            comparisons++;
+            if (keys[j - 1].key <= item.key) break;
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = item;
+    }
+    return comparisons;
+}
+
+/* LSD radix de 8 bits; salta las pasadas en que todas las claves comparten
+ * el byte. Devuelve el array (keys o scratch) donde queda el resultado. */
+static RAY_HitKey *ray_sort_keys_radix(RAY_HitKey *keys, RAY_HitKey *scratch, int count)
+{
+    RAY_HitKey *src = keys;
+    RAY_HitKey *dst = scratch;
+    
+    for (int shift = 0; shift < 32; shift += 8) {
+        int offsets[256] = {0};
+        for (int i = 0; i < count; i++) {
+            offsets[(src[i].key >> shift) & 0xFF]++;
+        }
+        if (offsets[(src[0].key >> shift) & 0xFF] == count) continue;
+        
+        int total = 0;
+        for (int b = 0; b < 256; b++) {
+            int bucket = offsets[b];
+            offsets[b] = total;
+            total += bucket;
+        }
+        for (int i = 0; i < count; i++) {
+            dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        
+        RAY_HitKey *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    return src;
+}
+
+/* Ordena las 'count' claves de 'scratch' (que tiene sitio para 2 * count).
+ * Devuelve dónde quedó el resultado y suma las comparaciones hechas. */
+static RAY_HitKey *ray_sort_keys(RAY_HitKey *scratch, int count, int *comparisons)
+{
+    if (count <= RAY_SORT_INSERTION_MAX) {
+        *comparisons += ray_sort_keys_insertion(scratch, count);
+        return scratch;
+    }
+    return ray_sort_keys_radix(scratch, scratch + count, count);
+}
+
+/* Escribe en 'order' los índices de los hits de lejano a cercano.
+ * 'scratch' tiene sitio para 2 * num_hits claves. Devuelve las comparaciones. */
+static int ray_sort_hits(const RAY_RayHit *hits, int num_hits, uint16_t *order, RAY_HitKey *scratch)
+{
+    for (int i = 0; i < num_hits; i++) {
+        scratch[i].key = ray_hit_sort_key(hits[i].distance);
+        scratch[i].index = (uint32_t)i;
+    }
+    
+    int comparisons = 0;
+    RAY_HitKey *keys = ray_sort_keys(scratch, num_hits, &comparisons);
+    
+    for (int i = 0; i < num_hits; i++) {
+        order[i] = (uint16_t)keys[i].index;
+    }
+    return comparisons;
+}
+
+/* ============================================================================
+   SPRITE RENDERING
+   ============================================================================ */
+
+/* Z-buffer jerárquico: distancia mínima y máxima de pared por cada
+ * RAY_ZTILE_STRIPS strips. Un z <= 0 no tapa nada (igual que en el test
+ * por columna), así que cuenta como infinito. */
+static void ray_build_z_tiles(const float *z_buffer, int count, float *zmin, float *zmax)
+{
+    int tiles = (count + RAY_ZTILE_STRIPS - 1) / RAY_ZTILE_STRIPS;
+    for (int t = 0; t < tiles; t++) {
+        int first = t * RAY_ZTILE_STRIPS;
+        int last = first + RAY_ZTILE_STRIPS;
+        if (last > count) last = count;
+        
+        float lo = FLT_MAX, hi = 0.0f;
+        for (int i = first; i < last; i++) {
+            float z = z_buffer[i] > 0 ? z_buffer[i] : FLT_MAX;
+            if (z < lo) lo = z;
+            if (z > hi) hi = z;
+        }
+        zmin[t] = lo;
+        zmax[t] = hi;
+    }
+}
+
+/* Culling de un sprite: transformación a espacio de cámara, rechazo por
+ * frustum y por el z-buffer jerárquico. Devuelve 0 si no se ve nada.
+ * Las cuentas dan el mismo rectángulo que la proyección por ángulos
+ * (tan(atan2(l, d)) = l / d) sin atan2f ni tanf. */
+static int ray_cull_sprite(RAY_Sprite *sprite, float cos_rot, float sin_rot, float tan_limit,
+                           const float *zmin, const float *zmax, RAY_SpriteProjection *proj)
+{
+    float dx = sprite->x - g_engine.camera.x;
+    float dy = sprite->y - g_engine.camera.y;
+    
+    /* Espacio de cámara (el eje Y del mundo está invertido respecto al ángulo) */
+    float depth = dx * cos_rot - dy * sin_rot;
+    float lateral = -dx * sin_rot - dy * cos_rot;
+    
+    /* Frustum: mismo margen que el test de ángulo (FOV/2 + 0.5 rad) */
+    if (depth <= 0.0f) return 0;
+    if (fabsf(lateral) > depth * tan_limit) return 0;
+    
+    sprite->distance = sqrtf(dx * dx + dy * dy);
+    if (sprite->distance == 0) return 0;
+    
+    /* Rectángulo en pantalla */
+    float sprite_screen_x = lateral / depth * g_engine.viewDist;
+    int screen_x = g_engine.displayWidth / 2 - (int)sprite_screen_x;
+    
+    float scale = g_engine.viewDist / sprite->distance;
+    proj->screen_h = scale * sprite->h;
+    proj->screen_w = scale * sprite->w;
+    
+    float sprite_screen_z = scale * (sprite->z - g_engine.camera.z);
+    proj->screen_y = g_engine.displayHeight / 2 - (int)(proj->screen_h / 2) + (int)sprite_screen_z;
+    
+    proj->origin_x = screen_x - (int)(proj->screen_w / 2);
+    proj->start_x = proj->origin_x < 0 ? 0 : proj->origin_x;
+    proj->end_x = screen_x + (int)(proj->screen_w / 2);
+    if (proj->end_x > g_fb.width) proj->end_x = g_fb.width;
+    proj->sy_start = proj->screen_y < 0 ? 0 : proj->screen_y;
+    proj->sy_end = proj->screen_y + (int)proj->screen_h;
+    if (proj->sy_end > g_fb.height) proj->sy_end = g_fb.height;
+    
+    if (proj->start_x >= proj->end_x || proj->sy_start >= proj->sy_end) return 0;
+    
+    /* Oclusión: si está detrás de la pared más lejana de todos los tiles que
+     * cubre, ninguna columna pasaría el test; si está delante de la más
+     * cercana, ninguna columna necesita el test */
+    proj->test_z = 1;
+    int s0 = proj->start_x / g_engine.stripWidth;
+    int s1 = (proj->end_x - 1) / g_engine.stripWidth;
+    if (s1 < g_engine.rayCount) {
+        float lo = FLT_MAX, hi = 0.0f;
+        for (int t = s0 / RAY_ZTILE_STRIPS; t <= s1 / RAY_ZTILE_STRIPS; t++) {
+            if (zmin[t] < lo) lo = zmin[t];
+            if (zmax[t] > hi) hi = zmax[t];
+        }
+        if (sprite->distance > hi) return 0;
+        if (sprite->distance <= lo) proj->test_z = 0;
+    }
+    return 1;
+}
+
+/* Fila de textura de la fila de pantalla 'sy' (misma cuenta que el bucle
+ * texel a texel, para que los dos caminos den los mismos pixels) */
+static inline int ray_sprite_tex_y(int sy, int screen_y, float screen_h, int tex_h)
+{
+    return (int)(((float)(sy - screen_y) / screen_h) * tex_h);
+}
+
+/* Columna de sprite a partir de sus tramos opacos: los huecos
+ * transparentes se saltan de una vez y solo se recorren las filas de
+ * pantalla que caen dentro de un tramo */
+static void ray_draw_sprite_column_rle(const RAY_SpriteRLE *rle, int tex_x, int sx,
+                                       int screen_y, float screen_h,
+                                       int sy_start, int sy_end, float distance,
+                                       RAY_WorkerStats *stats)
+{
+    int tex_h = rle->height;
+    int drawn = 0;
+    
+    /* Todo el sprite está a la misma distancia: un solo factor de fog */
+    uint8_t fog = g_engine.fogOn ? ray_fog_factor(distance) : 0;
+    
+    for (int i = rle->columnSpans[tex_x]; i < rle->columnSpans[tex_x + 1]; i++) {
+        const RAY_SpriteSpan *span = &rle->spans[i];
+        int span_end = span->start + span->length;
+        
+        /* Primera fila de pantalla del tramo: estimación y ajuste exacto */
+        int sy = screen_y + (int)((float)span->start * screen_h / tex_h);
+        if (sy < sy_start) sy = sy_start;
+        while (sy > sy_start && ray_sprite_tex_y(sy - 1, screen_y, screen_h, tex_h) >= span->start) sy--;
+        while (sy < sy_end && ray_sprite_tex_y(sy, screen_y, screen_h, tex_h) < span->start) sy++;
+        if (sy >= sy_end) break;
+        
+        const uint32_t *texels = rle->pixels + span->offset - span->start;
+        uint32_t *dst = g_fb.pixels + (size_t)sy * g_fb.pitch + sx;
+        for (; sy < sy_end; sy++, dst += g_fb.pitch) {
+            int tex_y = ray_sprite_tex_y(sy, screen_y, screen_h, tex_h);
+            if (tex_y >= span_end) break;
+            
+            uint32_t pixel = texels[tex_y];
+            *dst = fog ? ray_fog_blend(pixel, fog) : pixel;
+            drawn++;
+        }
+    }
+    
+    stats->samples += drawn;
+    stats->pixels += drawn;
+}
+
+/* 'scratch' tiene sitio para 2 * num_sprites claves y 'visible' para
+ * num_sprites proyecciones (frame arena). Devuelve en 'drawn' y 'culled'
+ * los sprites dibujados y los descartados por el culling. */
+static void ray_draw_sprites(GRAPH *dest, float *z_buffer, const float *zmin, const float *zmax,
+                             RAY_HitKey *scratch, RAY_SpriteProjection *visible,
+                             RAY_WorkerStats *stats, int *drawn, int *culled)
+{
+    *drawn = 0;
+    *culled = 0;
+    if (!dest || !z_buffer || !scratch || !visible) return;
+    
+    float cos_rot = cosf(g_engine.camera.rot);
+    float sin_rot = sinf(g_engine.camera.rot);
+    float limit = g_engine.fovRadians / 2.0f + 0.5f;
+    float tan_limit = limit < (float)M_PI / 2.0f - 0.01f ? tanf(limit) : FLT_MAX;
+    
+    /* Culling y claves de orden; los sprites no se mueven, solo se ordenan
+     * las claves (distancia, índice en 'visible') */
+    int count = 0;
+    for (int i = 0; i < g_engine.num_sprites; i++) {
+        RAY_Sprite *sprite = &g_engine.sprites[i];
+        if (sprite->hidden || sprite->cleanup) continue;
+        
+        RAY_SpriteProjection *proj = &visible[count];
+        if (!ray_cull_sprite(sprite, cos_rot, sin_rot, tan_limit, zmin, zmax, proj)) {
+            (*culled)++;
+            continue;
+        }
+        
+        proj->sprite = i;
+        scratch[count].key = ray_hit_sort_key(sprite->distance);
+        scratch[count].index = (uint32_t)count;
+        count++;
+    }
+    
+    /* Ordenar de más lejano a más cercano */
+    int comparisons = 0;
+    RAY_HitKey *order = ray_sort_keys(scratch, count, &comparisons);
+    g_engine.sortComparisons += (uint64_t)comparisons;
+    
+    /* Renderizar sprites */
+    for (int k = 0; k < count; k++) {
+        const RAY_SpriteProjection *proj = &visible[order[k].index];
+        RAY_Sprite *sprite = &g_engine.sprites[proj->sprite];
+        float dx = sprite->x - g_engine.camera.x;
+        float dy = sprite->y - g_engine.camera.y;
+        
+        /* ========================================
+           BILLBOARD - Calcular frame basado en ángulo
+           ======================================== */
+        int billboard_frame = -1;  // -1 = no usar billboard
+        
+        if (g_engine.billboard_enabled && g_engine.billboard_directions > 0 && sprite->process_ptr != NULL) {
+            /* Calcular ángulo del sprite hacia la cámara */
+            float angle_to_camera = atan2f(dy, dx);
+            
+            /* Calcular ángulo relativo considerando la rotación del sprite */
+            float relative_angle = angle_to_camera - sprite->rot;
+            
+            /* Normalizar a rango [0, 2π] */
+            while (relative_angle < 0) relative_angle += RAY_TWO_PI;
+            while (relative_angle >= RAY_TWO_PI) relative_angle -= RAY_TWO_PI;
+            
+            /* Convertir ángulo a índice de dirección (0 a num_directions-1) */
+            float angle_per_direction = RAY_TWO_PI / g_engine.billboard_directions;
+            billboard_frame = (int)((relative_angle + angle_per_direction / 2.0f) / angle_per_direction);
+            billboard_frame = billboard_frame % g_engine.billboard_directions;
+        }
+        
+        /* Obtener textura del sprite */
+        GRAPH *sprite_texture = NULL;
+        
+        /* Si el sprite está vinculado a un proceso, usar su graph dinámico */
+        if (sprite->process_ptr != NULL) {
+            /* Si billboard está activo y tenemos un FPG, usar el frame calculado */
+            if (billboard_frame >= 0 && g_engine.fpg_id > 0) {
+                /* Obtener el gráfico directamente del FPG usando el frame billboard */
+                sprite_texture = bitmap_get(g_engine.fpg_id, billboard_frame);
+            }
+            
+            /* Si no obtuvimos textura con billboard, usar instance_graph normal */
+            if (!sprite_texture) {
+                sprite_texture = instance_graph(sprite->process_ptr);
+            }
+            
+            /* Si el proceso no tiene graph válido, usar textureID como fallback */
+            if (!sprite_texture && sprite->textureID > 0) {
+                sprite_texture = bitmap_get(g_engine.fpg_id, sprite->textureID);
+            }
+        } else {
+            /* Sprite estático - usar textureID del FPG */
+            sprite_texture = bitmap_get(g_engine.fpg_id, sprite->textureID);
+        }
+        
+        if (!sprite_texture) continue;
+        (*drawn)++;
+        
+        /* Tramos opacos del graph (NULL: se muestrea texel a texel) */
+        const RAY_SpriteRLE *rle = ray_sprite_rle_for(sprite, sprite_texture);
+        
+        /* Renderizar sprite (origin_x es el borde sin recortar, para la textura) */
+        int origin_x = proj->origin_x;
+        int screen_y = proj->screen_y;
+        int sy_start = proj->sy_start;
+        int sy_end = proj->sy_end;
+        float sprite_screen_width = proj->screen_w;
+        float sprite_screen_height = proj->screen_h;
+        
+        for (int sx = proj->start_x; sx < proj->end_x; sx++) {
+            
+            /* Z-buffer check */
+            int strip = sx / g_engine.stripWidth;
+            if (proj->test_z && strip >= 0 && strip < g_engine.rayCount) {
+                if (z_buffer[strip] > 0 && sprite->distance > z_buffer[strip]) {
+                    continue; /* Sprite detrás de una pared */
+                }
+            }
+            
+            /* Calcular coordenada de textura X */
+            float tex_x_f = ((float)(sx - origin_x) / sprite_screen_width) * sprite_texture->width;
+            int tex_x = (int)tex_x_f;
+            if (tex_x < 0 || tex_x >= sprite_texture->width) continue;
+            
+            if (rle) {
+                ray_draw_sprite_column_rle(rle, tex_x, sx, screen_y, sprite_screen_height,
+                                           sy_start, sy_end, sprite->distance, stats);
+                continue;
+            }
+            
+            /* Renderizar columna del sprite */
+            uint32_t *dst = g_fb.pixels + (size_t)sy_start * g_fb.pitch + sx;
+            for (int sy = sy_start; sy < sy_end; sy++, dst += g_fb.pitch) {
+                
+                /* Calcular coordenada de textura Y */
                 float tex_y_f = ((float)(sy - screen_y) / sprite_screen_height) * sprite_texture->height;
                 int tex_y = (int)tex_y_f;
                 if (tex_y < 0 || tex_y >= sprite_texture->height) continue;
                 
                 /* Obtener pixel directamente del gráfico (respeta color key) */
                 uint32_t pixel = gr_get_pixel(sprite_texture, tex_x, tex_y);
+                stats->samples++;
                 
                 /* Verificar transparencia - comparar con color key del gráfico */
                 /* En BennuGD, el pixel 0 suele ser el color transparente */
@@ -751,12 +1309,498 @@ static void ray_draw_sprites(GRAPH *dest, float *z_buffer)
                     pixel = ray_fog_pixel(pixel, sprite->distance);
                 }
                 
-                gr_put_pixel(dest, sx, sy, pixel);
+                *dst = pixel;
+                stats->pixels++;
             }
         }
     }
 }
 
+/* ============================================================================
+   STRIPS DEL FRAME
+   Cada strip solo escribe sus propios hits, su entrada del z-buffer y sus
+   columnas del framebuffer, así que los strips se pueden repartir entre
+   hilos sin cambiar ni un pixel del resultado.
+   ============================================================================ */
+
+typedef struct {
+    GRAPH *dest;
+    RAY_RayHit *all_rayhits;
+    RAY_RayHitCold *all_cold;        /* Por strip: RAY_MAX_COLD_HITS datos de ThinWall */
+    int *rayhit_counts;
+    float *z_buffer;
+    float cos_rot, sin_rot;          /* Rotación de la cámara, una vez por frame */
+    uint16_t *hit_order;             /* Por strip: índices de hits de lejano a cercano */
+    RAY_HitKey *sort_keys;           /* Por hilo: 2 * RAY_MAX_RAYHITS claves de trabajo */
+    uint64_t sort_comparisons[RAY_MAX_THREADS];
+    int *floor_start;                /* Modo spans: primera fila de suelo por strip */
+    int *ceiling_end;                /* Modo spans: fin del techo por strip */
+    int spans;                       /* Suelo/techo por filas en una fase aparte */
+} RAY_FrameJob;
+
+/* Raycast del strip: hits de grid y ThinWalls, z-buffer y orden de dibujo.
+ * Devuelve las comparaciones hechas al ordenar. */
+static int ray_cast_strip(const RAY_FrameJob *frame, int strip, int worker)
+{
+    float strip_angle = g_engine.stripAngles[strip];  
+    int num_hits = 0;  
+    int num_cold = 0;  
+      
+    RAY_Ray ray;  
+    ray_strip_ray(&ray, strip, g_engine.camera.rot, frame->cos_rot, frame->sin_rot);  
+      
+    ray_raycaster_raycast(&g_engine.raycaster,  
+                         &frame->all_rayhits[strip * RAY_MAX_RAYHITS],  
+                         &num_hits,  
+                         (int)g_engine.camera.x,  
+                         (int)g_engine.camera.y,  
+                         g_engine.camera.z,  
+                         &ray);  
+      
+    /* Raycast ThinWalls (slopes/ramps) */  
+    if (g_engine.num_thick_walls > 0) {  
+        ray_raycast_thin_walls(&frame->all_rayhits[strip * RAY_MAX_RAYHITS],  
+                              &num_hits,  
+                              &frame->all_cold[strip * RAY_MAX_COLD_HITS],  
+                              &num_cold,  
+                              g_engine.thickWalls,  
+                              g_engine.num_thick_walls,  
+                              g_engine.camera.x,  
+                              g_engine.camera.y,  
+                              g_engine.camera.z,  
+                              g_engine.camera.rot,  
+                              strip_angle,  
+                              strip,  
+                              worker,  
+                              g_engine.raycaster.gridWidth,  
+                              g_engine.raycaster.tileSize);  
+    }  
+      
+    frame->rayhit_counts[strip] = num_hits;  
+      
+#ifdef RAY_ENABLE_TRACE  
+    for (int h = 0; h < num_hits; h++) {  
+        const RAY_RayHit *hit = &frame->all_rayhits[strip * RAY_MAX_RAYHITS + h];  
+        RAY_TRACE(RAY_TRACE_STRIP_HIT, strip, h, hit->level, hit->wallType, hit->distance);  
+    }  
+#endif  
+      
+    // Actualizar z-buffer con el hit más cercano  
+    for (int h = 0; h < num_hits; h++) {  
+        RAY_RayHit *hit = &frame->all_rayhits[strip * RAY_MAX_RAYHITS + h];  
+        if (hit->wallType > 0 && hit->distance < frame->z_buffer[strip]) {  
+            frame->z_buffer[strip] = hit->distance;  
+        }  
+    }  
+    
+    /* Orden de dibujo por distancia (más lejano primero) */  
+    return ray_sort_hits(&frame->all_rayhits[strip * RAY_MAX_RAYHITS], num_hits,  
+                         &frame->hit_order[strip * RAY_MAX_RAYHITS],  
+                         &frame->sort_keys[worker * 2 * RAY_MAX_RAYHITS]);  
+}
+
+/* Suelo y techo del strip, recortados contra la pared más cercana */
+static void ray_render_strip_floor(const RAY_FrameJob *frame, int x, RAY_WorkerStats *stats)
+{
+    int num_hits = frame->rayhit_counts[x];  
+    RAY_RayHit *hits = &frame->all_rayhits[x * RAY_MAX_RAYHITS];  
+    const uint16_t *order = &frame->hit_order[x * RAY_MAX_RAYHITS];  
+      
+    // Calcular parámetros de renderizado basados en el hit más cercano QUE NO SEA PUERTA  
+    int wall_screen_height = 0;  // Por defecto 0 para que el suelo se vea completo  
+    float player_screen_z = 0.0f;  
+      
+    // Buscar si hay puertas en este strip  
+    int has_door = 0;  
+    for (int h = 0; h < num_hits; h++) {  
+        if (ray_is_door(hits[h].wallType)) {  
+            has_door = 1;  
+            break;  
+        }  
+    }  
+      
+    // Si hay una puerta, SIEMPRE usar wall_height=0 para ver el suelo completo  
+    if (has_door) {  
+        wall_screen_height = 0;  // Ver suelo completo a través de puertas  
+        RAY_TRACE(RAY_TRACE_FLOOR_DOOR, x, 0, 0, 0, 0);  
+    } else {
+        // No hay puertas - buscar pared más cercana para clipear correctamente
+        // IGNORAR ThinWalls Y paredes flotantes (wallZOffset > 0) para que el suelo se vea debajo
+        RAY_RayHit *closest_wall = NULL;
+        for (int k = num_hits - 1; k >= 0; k--) {
+            int h = order[k];
+            
+            // Ignorar ThinWalls
+            if (hits[h].flags & RAY_HIT_THIN_WALL) continue;
+            
+            // NUEVO: Ignorar paredes flotantes (que no llegan al suelo)
+            // Solo paredes que empiezan en el suelo (wallZOffset == 0) deben clipear floor/ceiling
+            float player_height = 64.0f;
+            float player_top = g_engine.camera.z + player_height;
+            
+            // Si el jugador está por debajo del inicio de la pared, esta pared no debe clipear
+            if (player_top < hits[h].wallZOffset) {
+                continue;  // Esta es una pared flotante, ignorarla para clipping
+            }
+            
+            // Esta pared sí llega al nivel del jugador, usarla para clipear
+            closest_wall = &hits[h];
+            break;
+        }
+          
+        if (closest_wall) {
+            wall_screen_height = (int)ray_strip_screen_height(g_engine.viewDist,
+                                                               closest_wall->correctDistance,
+                                                               RAY_TILE_SIZE);
+              
+            player_screen_z = ray_strip_screen_height(g_engine.viewDist,
+                                                      closest_wall->correctDistance,
+                                                      g_engine.camera.z);
+        } else {
+            // No hay hits de paredes normales - espacio abierto o solo ThinWalls/paredes flotantes
+            wall_screen_height = 0;
+        }
+    }  
+      
+    // Modo spans: solo guardar los límites, las filas se dibujan después  
+    if (frame->spans) {  
+        ray_floor_ceiling_bounds(wall_screen_height, player_screen_z,  
+                                 &frame->floor_start[x], &frame->ceiling_end[x]);  
+        return;  
+    }  
+      
+    // Renderizar suelo y techo para este strip  
+    // CORREGIDO: Usar OR (||) en lugar de AND (&&) para permitir renderizado independiente  
+    if (g_engine.drawTexturedFloor || g_engine.drawCeiling) {  
+        float dir_x, dir_y;
+        ray_strip_direction(x, frame->cos_rot, frame->sin_rot, &dir_x, &dir_y);
+        ray_draw_floor_ceiling_strip(frame->dest, x, dir_x, dir_y,
+                                     wall_screen_height, player_screen_z, stats);
+    }  
+}
+
+/* Paredes del strip de atrás hacia adelante (los hits ya vienen ordenados) */
+static void ray_render_strip_walls(const RAY_FrameJob *frame, int x, RAY_WorkerStats *stats)
+{
+    int num_hits = frame->rayhit_counts[x];  
+    RAY_RayHit *hits = &frame->all_rayhits[x * RAY_MAX_RAYHITS];  
+    const uint16_t *order = &frame->hit_order[x * RAY_MAX_RAYHITS];  
+      
+    /* Esto permite ver niveles superiores mientras el más cercano tapa lo que está detrás */  
+    for (int h = 0; h < num_hits; h++) {  
+        RAY_RayHit *rayHit = &hits[order[h]];  
+          
+        if (rayHit->wallType == 0) continue;  
+          
+        /* FILTRADO MULTINIVEL SIMPLIFICADO:  
+         * Determinar si la cámara está "dentro" de un edificio cerrado  
+         * verificando si hay techo en la posición de la cámara.  
+         */  
+        int camera_level = (int)(g_engine.camera.z / RAY_TILE_SIZE);  
+        if (camera_level < 0) camera_level = 0;  
+        if (camera_level > 2) camera_level = 2;  
+          
+        /* Verificar si hay techo en la posición de la cámara */  
+        int camera_tile_x = (int)(g_engine.camera.x / RAY_TILE_SIZE);  
+        int camera_tile_y = (int)(g_engine.camera.y / RAY_TILE_SIZE);  
+        int is_inside = 0;  
+          
+        if (camera_tile_x >= 0 && camera_tile_x < g_engine.raycaster.gridWidth &&  
+            camera_tile_y >= 0 && camera_tile_y < g_engine.raycaster.gridHeight) {  
+            int ceiling_tile = ray_world_ceiling(&g_engine.world, camera_level, camera_tile_x, camera_tile_y);  
+            is_inside = (ceiling_tile > 0);  // Hay techo = estamos dentro  
+        }  
+          
+        /* Si estamos dentro, solo renderizar el nivel actual */  
+        if (is_inside && rayHit->level != camera_level) {  
+            continue;  
+        }  
+        /* Si estamos fuera, renderizar todos los niveles */  
+          
+          
+        // Calcular altura de pared en pantalla  
+        // Usar wallHeight del rayHit (que viene de heightGrids o thinWall)  
+        float wall_height_to_use = rayHit->wallHeight;  
+          
+        int wall_screen_height = (int)ray_strip_screen_height(g_engine.viewDist,  
+                                                               rayHit->correctDistance,  
+                                                               wall_height_to_use);  
+          
+        float player_screen_z = ray_strip_screen_height(g_engine.viewDist,  
+                                                       rayHit->correctDistance,  
+                                                       g_engine.camera.z);  
+          
+          
+        // Aplicar Z-offset de la pared (altura base)
+        // Las paredes empiezan DESDE wallZOffset hacia arriba
+        float wall_z_offset_screen = ray_strip_screen_height(g_engine.viewDist,
+                                                             rayHit->correctDistance,
+                                                             rayHit->wallZOffset);
+        player_screen_z -= wall_z_offset_screen;  // RESTAR para elevar la pared (coordenadas de pantalla invertidas)
+          
+        // Convertir ID de puerta a ID de textura  
+        int texture_id = rayHit->wallType;  
+        int is_door = ray_is_door(texture_id);  
+        float door_offset = 0.0f;  
+          
+        if (is_door) {  
+            /* Obtener estado de la puerta */  
+            int door_grid_offset = rayHit->wallX + rayHit->wallY * g_engine.raycaster.gridWidth;  
+            RAY_Door *door = ray_door_at(door_grid_offset);  
+            if (door) {  
+                door_offset = door->offset;  
+            }  
+              
+            // Puertas verticales: 1001-1500 → restar 1000  
+            // Puertas horizontales: 1501+ → restar 1500  
+            if (ray_is_vertical_door(texture_id)) {  
+                texture_id = texture_id - 1000;  
+            } else {  
+                texture_id = texture_id - 1500;  
+            }  
+              
+            RAY_TRACE(RAY_TRACE_DOOR_HIT, x, rayHit->wallType,
+                      rayHit->wallX + rayHit->wallY * g_engine.raycaster.gridWidth, texture_id, door_offset);  
+        }  
+          
+        // Obtener textura de pared  
+        RAY_Texture *wall_texture = ray_texture_get_wall(texture_id);  
+        RAY_TRACE(RAY_TRACE_WALL_TEXTURE, x, texture_id, wall_texture != NULL, g_engine.drawWalls, 0);  
+          
+        // Renderizar pared  
+        if (g_engine.drawWalls && wall_texture) {  
+            /* Aplicar offset de animación */  
+            if (is_door && door_offset > 0.0f) {  
+                /* Para puertas VERTICALES, deslizar horizontalmente (modificar tileX) */  
+                if (ray_is_vertical_door(rayHit->wallType)) {  
+                    /* Modificar tileX para crear efecto de deslizamiento horizontal */  
+                    rayHit->tileX += door_offset * RAY_TILE_SIZE;  
+                      
+                    /* Si tileX sale del rango de la textura, la puerta está "fuera de vista" */  
+                    if (rayHit->tileX >= RAY_TILE_SIZE) {  
+                        /* Puerta completamente abierta - no renderizar */  
+                        RAY_TRACE(RAY_TRACE_DOOR_SLIDE, x, rayHit->wallType, 1, 0, door_offset);  
+                        goto skip_wall_render;  
+                    }  
+                }   
+                /* Para puertas HORIZONTALES, deslizar verticalmente (reducir altura) */  
+                else {  
+                    /* Reducir altura de pared para crear efecto de deslizamiento vertical */  
+                    int original_height = wall_screen_height;  
+                    wall_screen_height = (int)(wall_screen_height * (1.0f - door_offset));  
+                      
+                    /* Ajustar player_screen_z para que la puerta se deslice desde abajo hacia arriba */  
+                    /* RESTAR la diferencia para que suba en lugar de bajar */  
+                    player_screen_z -= (original_height - wall_screen_height);  
+                      
+                    /* Si la altura es muy pequeña, no renderizar */  
+                    if (wall_screen_height < 2) {  
+                        RAY_TRACE(RAY_TRACE_DOOR_SLIDE, x, rayHit->wallType, 0, 0, door_offset);  
+                        goto skip_wall_render;  
+                    }  
+                }  
+                RAY_TRACE(RAY_TRACE_DOOR_SLIDE, x, rayHit->wallType,
+                          ray_is_vertical_door(rayHit->wallType), 1, door_offset);  
+            }  
+              
+            const RAY_RayHitCold *rayCold = (rayHit->cold != RAY_HIT_NO_COLD)  
+                ? &frame->all_cold[x * RAY_MAX_COLD_HITS + rayHit->cold] : NULL;  
+            ray_draw_wall_strip(frame->dest, rayHit, rayCold, x, wall_screen_height, player_screen_z,  
+                               wall_texture, rayHit->flags & RAY_HIT_HORIZONTAL, stats);  
+              
+            /* NUEVO: Renderizar cara inferior de paredes flotantes */
+            /* Renderizar como superficie horizontal (estilo techo) a la altura del wallZOffset */
+            if (rayHit->wallZOffset > 0.0f && wall_texture) {
+                float player_height = 64.0f;
+                float player_top = g_engine.camera.z + player_height;
+                
+                /* Solo renderizar si estamos debajo de la pared */
+                if (player_top < rayHit->wallZOffset) {
+                    /* Renderizar superficie horizontal usando proyección de techo */
+                    float eye_height = RAY_TILE_SIZE / 2.0f + g_engine.camera.z;
+                    float surface_height = rayHit->wallZOffset;  /* Altura FIJA de la superficie */
+                    float distance_to_surface = surface_height - eye_height;
+                    
+                    if (distance_to_surface > 0.1f) {
+                        float center_plane = g_engine.displayHeight / 2.0f;
+                        float cos_factor = g_engine.stripTrig[x].invCos;
+                        float dir_x, dir_y;
+                        ray_strip_direction(x, frame->cos_rot, frame->sin_rot, &dir_x, &dir_y);
+                        
+                        /* CORREGIDO: Calcular posición Y fija basada en la altura absoluta */
+                        /* No usar rayHit->correctDistance que varía con la distancia */
+                        /* En su lugar, renderizar como el techo - para cada línea Y de pantalla */
+                        
+                        /* Calcular rango aproximado donde se vería esta superficie */
+                        /* Esto es solo para limitar el área de renderizado */
+                        int screen_y_start = 0;
+                        int screen_y_end = (int)center_plane;  /* Solo la mitad superior de la pantalla */
+                        
+                        int screen_x = x * g_engine.stripWidth;
+                        int x0;
+                        int columns = ray_fb_clip_columns(&g_fb, screen_x, g_engine.stripWidth, &x0);
+                        
+                        /* Renderizar cada línea de la superficie horizontal */
+                        for (int screen_y = screen_y_start; screen_y < screen_y_end && screen_y < g_engine.displayHeight; screen_y++) {
+                            if (center_plane - screen_y <= 0) continue;
+                            
+                            /* Proyección horizontal - igual que el techo */
+                            /* Calcular a qué distancia está el punto que se proyecta en esta línea Y */
+                            float ratio_y = distance_to_surface / (center_plane - screen_y);
+                            float straight_distance = g_engine.viewDist * ratio_y;
+                            float diagonal_distance = straight_distance * cos_factor;
+                            
+                            /* Calcular posición en el mundo */
+                            float x_end = g_engine.camera.x + diagonal_distance * dir_x;
+                            float y_end = g_engine.camera.y + diagonal_distance * dir_y;
+                            
+                            /* Verificar si este punto está dentro del tile de la pared */
+                            int tile_x = (int)(x_end / RAY_TILE_SIZE);
+                            int tile_y = (int)(y_end / RAY_TILE_SIZE);
+                            
+                            /* Solo renderizar si estamos sobre el tile de esta pared */
+                            if (tile_x == rayHit->wallX && tile_y == rayHit->wallY) {
+                                /* Calcular coordenadas de textura */
+                                int tex_world_x = ((int)x_end) % RAY_TILE_SIZE;
+                                int tex_world_y = ((int)y_end) % RAY_TILE_SIZE;
+                                if (tex_world_x < 0) tex_world_x += RAY_TILE_SIZE;
+                                if (tex_world_y < 0) tex_world_y += RAY_TILE_SIZE;
+                                
+                                int texture_x = (tex_world_x * wall_texture->width) / RAY_TILE_SIZE;
+                                int texture_y = (tex_world_y * wall_texture->height) / RAY_TILE_SIZE;
+                                
+                                uint32_t pixel = ray_sample_texture(wall_texture, texture_x, texture_y);
+                                
+                                /* Aplicar fog */
+                                if (g_engine.fogOn) {
+                                    pixel = ray_fog_pixel(pixel, diagonal_distance);
+                                }
+                                
+                                /* Dibujar pixel(s) */
+                                if (columns > 0) {
+                                    ray_fb_fill_row(g_fb.pixels + (size_t)screen_y * g_fb.pitch + x0, columns, pixel);
+                                    stats->samples++;
+                                    stats->pixels += columns;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+              
+            /* Slopes no longer supported - draw as normal wall */
+        }  
+          
+        skip_wall_render:;  
+          
+        // Suelo ya renderizado ANTES de las paredes  
+    }  
+}
+
+/* Trabajo del pool: rango [first, last) de strips completo.
+ * Suelo antes que paredes dentro de cada strip, igual que en el render
+ * de un solo hilo (los strips no comparten columnas). En modo spans el
+ * suelo va por filas, así que las paredes esperan a su propia fase. */
+static void ray_render_strips_job(void *ctx, int first, int last, int worker)
+{
+    RAY_FrameJob *frame = (RAY_FrameJob*)ctx;
+    RAY_WorkerStats *stats = &g_engine.workerStats[worker];
+    uint64_t comparisons = 0;
+    
+    for (int strip = first; strip < last; strip++) {
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        comparisons += ray_cast_strip(frame, strip, worker);
+        uint64_t t1 = SDL_GetPerformanceCounter();
+        ray_render_strip_floor(frame, strip, stats);
+        uint64_t t2 = SDL_GetPerformanceCounter();
+        stats->raycastTicks += t1 - t0;
+        stats->floorTicks += t2 - t1;
+        if (!frame->spans) {
+            ray_render_strip_walls(frame, strip, stats);
+            stats->wallTicks += SDL_GetPerformanceCounter() - t2;
+        }
+    }
+    frame->sort_comparisons[worker] += comparisons;
+}
+
+/* Modo spans: filas [first, last) de suelo y techo (las filas no comparten pixels) */
+static void ray_render_rows_job(void *ctx, int first, int last, int worker)
+{
+    const RAY_FrameJob *frame = (const RAY_FrameJob*)ctx;
+    RAY_WorkerStats *stats = &g_engine.workerStats[worker];
+    
+    uint64_t start = SDL_GetPerformanceCounter();
+    ray_draw_floor_ceiling_rows(frame->floor_start, frame->ceiling_end, first, last, stats);
+    stats->floorTicks += SDL_GetPerformanceCounter() - start;
+}
+
+/* Modo spans: paredes de los strips [first, last) encima del suelo ya dibujado */
+static void ray_render_walls_job(void *ctx, int first, int last, int worker)
+{
+    const RAY_FrameJob *frame = (const RAY_FrameJob*)ctx;
+    RAY_WorkerStats *stats = &g_engine.workerStats[worker];
+    
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (int strip = first; strip < last; strip++) {
+        ray_render_strip_walls(frame, strip, stats);
+    }
+    stats->wallTicks += SDL_GetPerformanceCounter() - start;
+}
+
+/* ============================================================================
+   INTERPOLACIÓN
+   La física avanza a paso fijo y el render puede ir más rápido o más lento:
+   cámara y sprites se dibujan entre prev_* y su posición simulada según
+   physicsAlpha. El render lee x/y/z directamente, así que durante el frame
+   se ponen ahí las posiciones interpoladas y se guardan las simuladas en
+   'saved' (3 floats para la cámara y 3 por sprite) para restaurarlas.
+   Lo que mueve el script entre pasos (RAY_MOVE_*, RAY_STRAFE_*,
+   RAY_UPDATE_SPRITE_POSITION) pone también prev_* y se dibuja sin retraso.
+   ============================================================================ */
+
+static inline float ray_lerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+static void ray_interpolate_begin(float *saved)
+{
+    float alpha = g_engine.physicsAlpha;
+    RAY_Camera *camera = &g_engine.camera;
+    
+    saved[0] = camera->x;
+    saved[1] = camera->y;
+    saved[2] = camera->z;
+    camera->x = ray_lerp(camera->prev_x, saved[0], alpha);
+    camera->y = ray_lerp(camera->prev_y, saved[1], alpha);
+    camera->z = ray_lerp(camera->prev_z, saved[2], alpha);
+    
+    for (int i = 0; i < g_engine.num_sprites; i++) {
+        RAY_Sprite *sprite = &g_engine.sprites[i];
+        float *s = saved + 3 * (i + 1);
+        s[0] = sprite->x;
+        s[1] = sprite->y;
+        s[2] = sprite->z;
+        sprite->x = ray_lerp(sprite->prev_x, s[0], alpha);
+        sprite->y = ray_lerp(sprite->prev_y, s[1], alpha);
+        sprite->z = ray_lerp(sprite->prev_z, s[2], alpha);
+    }
+}
+
+static void ray_interpolate_end(const float *saved)
+{
+    g_engine.camera.x = saved[0];
+    g_engine.camera.y = saved[1];
+    g_engine.camera.z = saved[2];
+    
+    for (int i = 0; i < g_engine.num_sprites; i++) {
+        const float *s = saved + 3 * (i + 1);
+        g_engine.sprites[i].x = s[0];
+        g_engine.sprites[i].y = s[1];
+        g_engine.sprites[i].z = s[2];
+    }
+}
+
 /* ============================================================================
    MAIN RENDER FUNCTION
    ============================================================================ */
@@ -771,7 +1815,7 @@ void ray_render_frame(GRAPH *dest)
         return;  
     }  
       
-    if (!g_engine.raycaster.grids) {  
+    if (!g_engine.world.chunks) {  
         return;  
     }  
       
@@ -780,8 +1824,30 @@ void ray_render_frame(GRAPH *dest)
         return;  
     }  
       
-    /* Actualizar física y animaciones (asumiendo ~60 FPS) */  
-    ray_update_physics(1.0f / 60.0f);  
+    /* Puntero y pitch del destino, una vez por frame */  
+    if (!ray_fb_bind(&g_fb, dest)) {  
+        fprintf(stderr, "RAY_RENDER: El GRAPH destino no es de 32 bits o no tiene superficie\n");  
+        return;  
+    }  
+      
+    /* Estadísticas: cada fase se mide con el contador de alta resolución */  
+    float stats[RAY_STAT_COUNT];  
+    memset(stats, 0, sizeof(stats));  
+    ray_stats_begin_frame();  
+    uint64_t frame_start = SDL_GetPerformanceCounter();  
+      
+    /* Física y animaciones a paso fijo según el tiempo real */  
+    ray_physics_advance();  
+    uint64_t chunks_start = SDL_GetPerformanceCounter();  
+    stats[RAY_STAT_PHYSICS_MS] = (float)ray_stats_ms(chunks_start - frame_start);  
+      
+    /* Chunks alrededor de la cámara ya movida (solo mapas por chunks) */  
+    ray_world_update();  
+    uint64_t sky_start = SDL_GetPerformanceCounter();  
+    stats[RAY_STAT_CHUNKS_MS] = (float)ray_stats_ms(sky_start - chunks_start);  
+    stats[RAY_STAT_CHUNK_LOADS] = (float)g_engine.world.loads;  
+    stats[RAY_STAT_CHUNKS_RESIDENT] = (float)g_engine.world.resident;  
+    g_engine.world.loads = 0;  
       
     /* Limpiar buffer con color de cielo (como en OLD) */  
     uint32_t sky_color = 0x87CEEB; /* Sky blue: RGB(135, 206, 235) */  
@@ -790,7 +1856,7 @@ void ray_render_frame(GRAPH *dest)
     /* Renderizar cielo - skybox o color sólido */  
     if (g_engine.skyTextureID > 0) {  
         /* Renderizar skybox texture */  
-        GRAPH *sky_texture = bitmap_get(g_engine.fpg_id, g_engine.skyTextureID);  
+        RAY_Texture *sky_texture = ray_texture_get(g_engine.skyTextureID);  
         if (sky_texture) {  
             /* Skybox panorámico simple  
              * La textura representa 360° horizontalmente  
@@ -815,15 +1881,17 @@ void ray_render_frame(GRAPH *dest)
                 if (tex_x < 0) tex_x = 0;  
                   
                 /* Dibujar columna vertical */  
-                for (int y = 0; y < sky_height; y++) {  
+                uint32_t *dst = g_fb.pixels + x;  
+                for (int y = 0; y < sky_height; y++, dst += g_fb.pitch) {  
                     /* Mapear Y de pantalla a Y de textura */  
                     int tex_y = (y * sky_texture->height) / sky_height;  
                     if (tex_y >= sky_texture->height) tex_y = sky_texture->height - 1;  
                       
-                    uint32_t pixel = ray_sample_texture(sky_texture, tex_x, tex_y);  
-                    gr_put_pixel(dest, x, y, pixel);  
+                    *dst = ray_sample_texture(sky_texture, tex_x, tex_y);  
                 }  
             }  
+            g_engine.workerStats[0].samples += (uint64_t)dest->width * sky_height;  
+            g_engine.workerStats[0].pixels += (uint64_t)dest->width * sky_height;  
         } else {  
             /* Si no se encuentra la textura, usar color sólido */  
             uint32_t sky_color = 0x87CEEB;  
@@ -835,20 +1903,40 @@ void ray_render_frame(GRAPH *dest)
         gr_clear_as(dest, sky_color);  
     }  
       
-    /* Crear buffer de rayhits */  
-    RAY_RayHit *all_rayhits = (RAY_RayHit*)malloc(g_engine.rayCount * RAY_MAX_RAYHITS * sizeof(RAY_RayHit));  
-    int *rayhit_counts = (int*)calloc(g_engine.rayCount, sizeof(int));  
-    float *z_buffer = (float*)malloc(g_engine.rayCount * sizeof(float));  
+    stats[RAY_STAT_SKY_MS] = (float)ray_stats_ms(SDL_GetPerformanceCounter() - sky_start);  
       
-    if (!all_rayhits || !rayhit_counts || !z_buffer) {  
+    /* Buffers del frame desde la arena del motor (sin heap en régimen estable) */  
+    RAY_FrameArena *arena = &g_engine.frameArena;  
+    if (!ray_arena_begin_frame(arena, ray_arena_frame_bytes(g_engine.rayCount, g_engine.num_sprites))) {  
         fprintf(stderr, "RAY_RENDER: Error allocating buffers\n");  
-        if (all_rayhits) free(all_rayhits);  
-        if (rayhit_counts) free(rayhit_counts);  
-        if (z_buffer) free(z_buffer);  
         return;  
     }  
       
-    /* Buffers allocated */  
+    RAY_RayHit *all_rayhits = (RAY_RayHit*)ray_arena_alloc(arena, (size_t)g_engine.rayCount * RAY_MAX_RAYHITS * sizeof(RAY_RayHit));  
+    RAY_RayHitCold *all_cold = (RAY_RayHitCold*)ray_arena_alloc(arena, (size_t)g_engine.rayCount * RAY_MAX_COLD_HITS * sizeof(RAY_RayHitCold));  
+    int *rayhit_counts = (int*)ray_arena_alloc(arena, g_engine.rayCount * sizeof(int));  
+    float *z_buffer = (float*)ray_arena_alloc(arena, g_engine.rayCount * sizeof(float));  
+    uint16_t *hit_order = (uint16_t*)ray_arena_alloc(arena, (size_t)g_engine.rayCount * RAY_MAX_RAYHITS * sizeof(uint16_t));  
+    RAY_HitKey *sort_keys = (RAY_HitKey*)ray_arena_alloc(arena, (size_t)RAY_MAX_THREADS * 2 * RAY_MAX_RAYHITS * sizeof(RAY_HitKey));  
+    int *floor_start = (int*)ray_arena_alloc(arena, g_engine.rayCount * sizeof(int));  
+    int *ceiling_end = (int*)ray_arena_alloc(arena, g_engine.rayCount * sizeof(int));  
+    RAY_HitKey *sprite_keys = (RAY_HitKey*)ray_arena_alloc(arena, (size_t)g_engine.num_sprites * 2 * sizeof(RAY_HitKey));  
+    RAY_SpriteProjection *sprite_visible = (RAY_SpriteProjection*)ray_arena_alloc(arena, (size_t)g_engine.num_sprites * sizeof(RAY_SpriteProjection));  
+    int z_tiles = (g_engine.rayCount + RAY_ZTILE_STRIPS - 1) / RAY_ZTILE_STRIPS;  
+    float *z_tile_min = (float*)ray_arena_alloc(arena, z_tiles * sizeof(float));  
+    float *z_tile_max = (float*)ray_arena_alloc(arena, z_tiles * sizeof(float));  
+    float *simulated = (float*)ray_arena_alloc(arena, ((size_t)g_engine.num_sprites + 1) * 3 * sizeof(float));  
+      
+    if (!all_rayhits || !all_cold || !rayhit_counts || !z_buffer || !hit_order || !sort_keys ||  
+        !floor_start || !ceiling_end || !z_tile_min || !z_tile_max || !simulated ||  
+        (g_engine.num_sprites > 0 && (!sprite_keys || !sprite_visible))) {  
+        fprintf(stderr, "RAY_RENDER: Error allocating buffers\n");  
+        return;  
+    }  
+    
+    /* Dibujar en la posición interpolada; se restaura al acabar el frame */  
+    ray_interpolate_begin(simulated);  
+    memset(rayhit_counts, 0, g_engine.rayCount * sizeof(int));  
       
     // Inicializar z-buffer  
     for (int i = 0; i < g_engine.rayCount; i++) {  
@@ -861,464 +1949,69 @@ void ray_render_frame(GRAPH *dest)
     }  
       
     // ========================================  
-    // RAYCAST PHASE  
-    // ========================================  
-      
-    for (int strip = 0; strip < g_engine.rayCount; strip++) {  
-        float strip_angle = g_engine.stripAngles[strip];  
-        int num_hits = 0;  
-          
-        ray_raycaster_raycast(&g_engine.raycaster,  
-                             &all_rayhits[strip * RAY_MAX_RAYHITS],  
-                             &num_hits,  
-                             (int)g_engine.camera.x,  
-                             (int)g_engine.camera.y,  
-                             g_engine.camera.z,  
-                             g_engine.camera.rot,  
-                             strip_angle,  
-                             strip,  
-                             g_engine.sprites,  
-                             g_engine.num_sprites);  
-          
-        /* Raycast ThinWalls (slopes/ramps) */  
-        extern RAY_Engine g_engine;  
-        if (g_engine.num_thick_walls > 0) {  
-            ray_raycast_thin_walls(&all_rayhits[strip * RAY_MAX_RAYHITS],  
-                                  &num_hits,  
-                                  g_engine.thickWalls,  
-                                  g_engine.num_thick_walls,  
-                                  g_engine.camera.x,  
-                                  g_engine.camera.y,  
-                                  g_engine.camera.z,  
-                                  g_engine.camera.rot,  
-                                  strip_angle,  
-                                  strip,  
-                                  g_engine.raycaster.gridWidth,  
-                                  g_engine.raycaster.tileSize);  
-        }  
-          
-        rayhit_counts[strip] = num_hits;  
-          
-        // DEBUG: Verificar hits multinivel  
-        static int debug_count = 0;  
-        if (debug_count < 5 && num_hits > 0) {  
-            printf("RAY_DEBUG: Strip %d tiene %d hits:\n", strip, num_hits);  
-            for (int h = 0; h < num_hits; h++) {  
-                RAY_RayHit *hit = &all_rayhits[strip * RAY_MAX_RAYHITS + h];  
-                printf("  Hit %d: level=%d, wallType=%d, distance=%.2f\n",   
-                       h, hit->level, hit->wallType, hit->distance);  
-            }  
-            debug_count++;  
-        }  
-          
-        // Actualizar z-buffer con el hit más cercano  
-        for (int h = 0; h < num_hits; h++) {  
-            RAY_RayHit *hit = &all_rayhits[strip * RAY_MAX_RAYHITS + h];  
-            if (hit->wallType > 0 && hit->distance < z_buffer[strip]) {  
-                z_buffer[strip] = hit->distance;  
-            }  
-        }  
-    }  
-      
-    // ========================================  
-    // RENDER PHASE  
+    // STRIPS: RAYCAST, SUELO/TECHO Y PAREDES  
+    // Repartidos por bandas de columnas entre los hilos del render  
     // ========================================  
       
-    // Renderizar paredes, suelos y techos  
-    // ESTRATEGIA: Renderizar de atrás hacia adelante (farthest to nearest)  
-    // Esto permite ver niveles superiores flotantes mientras evita duplicados  
-      
-    for (int strip = 0; strip < g_engine.rayCount; strip++) {  
-        int num_hits = rayhit_counts[strip];  
-          
-        if (num_hits == 0) continue;  
-          
-        /* Ordenar hits por distancia (más lejano primero) usando bubble sort simple */  
-        RAY_RayHit *hits = &all_rayhits[strip * RAY_MAX_RAYHITS];  
-        for (int i = 0; i < num_hits - 1; i++) {  
-            for (int j = 0; j < num_hits - i - 1; j++) {  
-                if (hits[j].distance < hits[j + 1].distance) {  
-                    RAY_RayHit temp = hits[j];  
-                    hits[j] = hits[j + 1];  
-                    hits[j + 1] = temp;  
-                }  
-            }  
-        }  
-          
-    }  
+    RAY_FrameJob frame;  
+    memset(&frame, 0, sizeof(frame));  
+    frame.dest = dest;  
+    frame.all_rayhits = all_rayhits;
+    frame.all_cold = all_cold;  
+    frame.rayhit_counts = rayhit_counts;  
+    frame.z_buffer = z_buffer;  
+    frame.cos_rot = cosf(g_engine.camera.rot);  
+    frame.sin_rot = sinf(g_engine.camera.rot);  
+    frame.hit_order = hit_order;  
+    frame.sort_keys = sort_keys;  
+    frame.floor_start = floor_start;  
+    frame.ceiling_end = ceiling_end;  
+    frame.spans = g_engine.floorMode == RAY_FLOOR_MODE_SPANS &&  
+                  (g_engine.drawTexturedFloor || g_engine.drawCeiling);  
+    ray_thin_wall_grid_begin_frame(g_engine.rayCount);  
+    uint64_t strips_start = SDL_GetPerformanceCounter();  
+    ray_threads_run(g_engine.rayCount, RAY_THREAD_BAND, ray_render_strips_job, &frame);  
       
-    /* Recolectar todos los hits de todos los strips */  
-    int total_hits = 0;  
-    for (int x = 0; x < g_engine.rayCount; x++) {  
-        total_hits += rayhit_counts[x];  
+    if (frame.spans) {  
+        ray_threads_run(g_fb.height, RAY_THREAD_BAND, ray_render_rows_job, &frame);  
+        ray_threads_run(g_engine.rayCount, RAY_THREAD_BAND, ray_render_walls_job, &frame);  
     }  
+    uint64_t sprites_start = SDL_GetPerformanceCounter();  
+    stats[RAY_STAT_STRIPS_MS] = (float)ray_stats_ms(sprites_start - strips_start);  
       
-    /* Total hits calculated */  
-      
-    // ========================================  
-    // FLOOR AND CEILING RENDERING FIRST  
-    // Renderizar ANTES de las paredes para que las paredes se dibujen encima  
-    // ========================================  
-      
-    for (int x = 0; x < g_engine.rayCount; x++) {  
-        int num_hits = rayhit_counts[x];  
-        RAY_RayHit *hits = &all_rayhits[x * RAY_MAX_RAYHITS];  
-          
-        // Calcular parámetros de renderizado basados en el hit más cercano QUE NO SEA PUERTA  
-        int wall_screen_height = 0;  // Por defecto 0 para que el suelo se vea completo  
-        float player_screen_z = 0.0f;  
-          
-        // Crear un rayHit para este strip  
-        RAY_RayHit floor_hit;  
-        floor_hit.strip = x;  
-        floor_hit.rayAngle = g_engine.camera.rot + g_engine.stripAngles[x];  
-          
-        // Buscar si hay puertas en este strip  
-        int has_door = 0;  
-        for (int h = 0; h < num_hits; h++) {  
-            if (ray_is_door(hits[h].wallType)) {  
-                has_door = 1;  
-                break;  
-            }  
-        }  
-          
-        // Si hay una puerta, SIEMPRE usar wall_height=0 para ver el suelo completo  
-        if (has_door) {  
-            floor_hit.correctDistance = RAY_TILE_SIZE * 10.0f;  
-            wall_screen_height = 0;  // Ver suelo completo a través de puertas  
-              
-            static int debug_floor = 0;  
-            if (debug_floor < 3) {  
-                printf("RAY_FLOOR: Strip %d tiene PUERTA - forzando wall_height=0 para ver suelo\n", x);  
-                debug_floor++;  
-            }  
-        } else {
-            // No hay puertas - buscar pared más cercana para clipear correctamente
-            // IGNORAR ThinWalls Y paredes flotantes (wallZOffset > 0) para que el suelo se vea debajo
-            RAY_RayHit *closest_wall = NULL;
-            for (int h = num_hits - 1; h >= 0; h--) {
-                // Ignorar ThinWalls
-                if (hits[h].thinWall) continue;
-                
-                // NUEVO: Ignorar paredes flotantes (que no llegan al suelo)
-                // Solo paredes que empiezan en el suelo (wallZOffset == 0) deben clipear floor/ceiling
-                float player_height = 64.0f;
-                float player_top = g_engine.camera.z + player_height;
-                
-                // Si el jugador está por debajo del inicio de la pared, esta pared no debe clipear
-                if (player_top < hits[h].wallZOffset) {
-                    continue;  // Esta es una pared flotante, ignorarla para clipping
-                }
-                
-                // Esta pared sí llega al nivel del jugador, usarla para clipear
-                closest_wall = &hits[h];
-                break;
-            }
-              
-            if (closest_wall) {
-                floor_hit.correctDistance = closest_wall->correctDistance;
-                  
-                wall_screen_height = (int)ray_strip_screen_height(g_engine.viewDist,
-                                                                   closest_wall->correctDistance,
-                                                                   RAY_TILE_SIZE);
-                  
-                player_screen_z = ray_strip_screen_height(g_engine.viewDist,
-                                                          closest_wall->correctDistance,
-                                                          g_engine.camera.z);
-            } else {
-                // No hay hits de paredes normales - espacio abierto o solo ThinWalls/paredes flotantes
-                floor_hit.correctDistance = RAY_TILE_SIZE * 10.0f;
-                wall_screen_height = 0;
-            }
-        }  
-          
-        // Renderizar suelo y techo para este strip  
-        // CORREGIDO: Usar OR (||) en lugar de AND (&&) para permitir renderizado independiente  
-        if (g_engine.drawTexturedFloor || g_engine.drawCeiling) {  
-            ray_draw_floor_ceiling_strip(dest, &floor_hit, wall_screen_height, player_screen_z);  
-        }  
+    int hits_total = 0, hits_max = 0;  
+    for (int i = 0; i < g_engine.rayCount; i++) {  
+        hits_total += rayhit_counts[i];  
+        if (rayhit_counts[i] > hits_max) hits_max = rayhit_counts[i];  
     }  
+    stats[RAY_STAT_HITS_AVG] = (float)hits_total / g_engine.rayCount;  
+    stats[RAY_STAT_HITS_MAX] = (float)hits_max;  
       
-    // ========================================  
-    // WALL RENDERING  
-    // Renderizar paredes DESPUÉS del suelo  
-    // ========================================  
-      
-    /* Renderizar cada strip */  
-    for (int x = 0; x < g_engine.rayCount; x++) {  
-        int num_hits = rayhit_counts[x];  
-        RAY_RayHit *hits = &all_rayhits[x * RAY_MAX_RAYHITS];  
-          
-        /* Esto permite ver niveles superiores mientras el más cercano tapa lo que está detrás */  
-        for (int h = 0; h < num_hits; h++) {  
-            RAY_RayHit *rayHit = &hits[h];  
-              
-            if (rayHit->wallType == 0) continue;  
-              
-            /* FILTRADO MULTINIVEL SIMPLIFICADO:  
-             * Determinar si la cámara está "dentro" de un edificio cerrado  
-             * verificando si hay techo en la posición de la cámara.  
-             */  
-            int camera_level = (int)(g_engine.camera.z / RAY_TILE_SIZE);  
-            if (camera_level < 0) camera_level = 0;  
-            if (camera_level > 2) camera_level = 2;  
-              
-            /* Verificar si hay techo en la posición de la cámara */  
-            int camera_tile_x = (int)(g_engine.camera.x / RAY_TILE_SIZE);  
-            int camera_tile_y = (int)(g_engine.camera.y / RAY_TILE_SIZE);  
-            int is_inside = 0;  
-              
-            if (camera_tile_x >= 0 && camera_tile_x < g_engine.raycaster.gridWidth &&  
-                camera_tile_y >= 0 && camera_tile_y < g_engine.raycaster.gridHeight &&  
-                g_engine.ceilingGrids[camera_level]) {  
-                int camera_grid_offset = camera_tile_x + camera_tile_y * g_engine.raycaster.gridWidth;  
-                int ceiling_tile = g_engine.ceilingGrids[camera_level][camera_grid_offset];  
-                is_inside = (ceiling_tile > 0);  // Hay techo = estamos dentro  
-            }  
-              
-            /* Si estamos dentro, solo renderizar el nivel actual */  
-            if (is_inside && rayHit->level != camera_level) {  
-                continue;  
-            }  
-            /* Si estamos fuera, renderizar todos los niveles */  
-              
-              
-            // Calcular altura de pared en pantalla  
-            // Usar wallHeight del rayHit (que viene de heightGrids o thinWall)  
-            float wall_height_to_use = rayHit->wallHeight;  
-              
-            int wall_screen_height = (int)ray_strip_screen_height(g_engine.viewDist,  
-                                                                   rayHit->correctDistance,  
-                                                                   wall_height_to_use);  
-              
-            float player_screen_z = ray_strip_screen_height(g_engine.viewDist,  
-                                                           rayHit->correctDistance,  
-                                                           g_engine.camera.z);  
-              
-              
-            // Aplicar Z-offset de la pared (altura base)
-            // Las paredes empiezan DESDE wallZOffset hacia arriba
-            float wall_z_offset_screen = ray_strip_screen_height(g_engine.viewDist,
-                                                                 rayHit->correctDistance,
-                                                                 rayHit->wallZOffset);
-            player_screen_z -= wall_z_offset_screen;  // RESTAR para elevar la pared (coordenadas de pantalla invertidas)
-              
-            // Convertir ID de puerta a ID de textura  
-            int texture_id = rayHit->wallType;  
-            int is_door = ray_is_door(texture_id);  
-            float door_offset = 0.0f;  
-              
-            
-            static int door_detection_debug = 0;
-              
-            if (is_door) {  
-                /* Obtener estado de la puerta */  
-                int door_grid_offset = rayHit->wallX + rayHit->wallY * g_engine.raycaster.gridWidth;  
-                  
-                if (door_detection_debug < 5) {  
-                    printf("RAY_RENDER: Puerta detectada! wallType=%d, pos=(%d,%d), grid_offset=%d\n",  
-                           rayHit->wallType, rayHit->wallX, rayHit->wallY, door_grid_offset);  
-                    door_detection_debug++;  
-                }  
-                  
-                if (g_engine.doors && door_grid_offset >= 0 &&   
-                    door_grid_offset < g_engine.raycaster.gridWidth * g_engine.raycaster.gridHeight) {  
-                    RAY_Door *door = &g_engine.doors[door_grid_offset];  
-                    door_offset = door->offset;  
-                      
-                    if (door_detection_debug < 5) {  
-                        printf("RAY_RENDER: Door state=%d, offset=%.2f, animating=%d\n",  
-                               door->state, door->offset, door->animating);  
-                        door_detection_debug++;  
-                    }  
-                }  
-                  
-                // Puertas verticales: 1001-1500 → restar 1000  
-                // Puertas horizontales: 1501+ → restar 1500  
-                if (ray_is_vertical_door(texture_id)) {  
-                    texture_id = texture_id - 1000;  
-                } else {  
-                    texture_id = texture_id - 1500;  
-                }  
-                  
-                // DEBUG: Mostrar cuando se renderiza una puerta (solo primeras 3)  
-                static int door_render_count = 0;  
-                if (door_render_count < 3) {  
-                    printf("RAY_RENDER: Renderizando puerta ID=%d → textura=%d en strip %d, offset=%.2f\n",  
-                           rayHit->wallType, texture_id, x, door_offset);  
-                    door_render_count++;  
-                }  
-            }  
-              
-            // Obtener textura de pared  
-            GRAPH *wall_texture = bitmap_get(g_engine.fpg_id, texture_id);  
-              
-            // DEBUG: Verificar si la textura se cargó  
-            if (is_door) {  
-                static int texture_check_count = 0;  
-                if (texture_check_count < 3) {  
-                    printf("RAY_RENDER: Textura %d %s (fpg_id=%d)\n",  
-                           texture_id, wall_texture ? "CARGADA" : "NO ENCONTRADA", g_engine.fpg_id);  
-                    texture_check_count++;  
-                }  
-            }  
-            
-            // DEBUG: Verificar por qué no se renderizan las paredes
-            static int wall_render_debug = 0;
-            if (wall_render_debug < 3) {
-                printf("WALL_RENDER_DEBUG: drawWalls=%d, wall_texture=%p, texture_id=%d\n",
-                       g_engine.drawWalls, (void*)wall_texture, texture_id);
-                wall_render_debug++;
-            }
-              
-            // Renderizar pared  
-            if (g_engine.drawWalls && wall_texture) {  
-                /* Aplicar offset de animación */  
-                if (is_door && door_offset > 0.0f) {  
-                    static int door_offset_debug = 0;  
-                      
-                    /* Para puertas VERTICALES, deslizar horizontalmente (modificar tileX) */  
-                    if (ray_is_vertical_door(rayHit->wallType)) {  
-                        if (door_offset_debug < 10) {  
-                            printf("RAY_RENDER: Puerta VERTICAL - offset %.2f, tileX original=%.2f\n",   
-                                   door_offset, rayHit->tileX);  
-                            door_offset_debug++;  
-                        }  
-                          
-                        /* Modificar tileX para crear efecto de deslizamiento horizontal */  
-                        rayHit->tileX += door_offset * RAY_TILE_SIZE;  
-                          
-                        /* Si tileX sale del rango de la textura, la puerta está "fuera de vista" */  
-                        if (rayHit->tileX >= RAY_TILE_SIZE) {  
-                            /* Puerta completamente abierta - no renderizar */  
-                            if (door_offset_debug < 10) {  
-                                printf("RAY_RENDER: Puerta vertical fuera de vista\n");  
-                                door_offset_debug++;  
-                            }  
-                            goto skip_wall_render;  
-                        }  
-                    }   
-                    /* Para puertas HORIZONTALES, deslizar verticalmente (reducir altura) */  
-                    else {  
-                        if (door_offset_debug < 10) {  
-                            printf("RAY_RENDER: Puerta HORIZONTAL - offset %.2f, altura original=%d\n",   
-                                   door_offset, wall_screen_height);  
-                            door_offset_debug++;  
-                        }  
-                          
-                        /* Reducir altura de pared para crear efecto de deslizamiento vertical */  
-                        int original_height = wall_screen_height;  
-                        wall_screen_height = (int)(wall_screen_height * (1.0f - door_offset));  
-                          
-                        /* Ajustar player_screen_z para que la puerta se deslice desde abajo hacia arriba */  
-                        /* RESTAR la diferencia para que suba en lugar de bajar */  
-                        player_screen_z -= (original_height - wall_screen_height);  
-                          
-                        /* Si la altura es muy pequeña, no renderizar */  
-                        if (wall_screen_height < 2) {  
-                            if (door_offset_debug < 10) {  
-                                printf("RAY_RENDER: Puerta horizontal completamente abierta\n");  
-                                door_offset_debug++;  
-                            }  
-                            goto skip_wall_render;  
-                        }  
-                    }  
-                }  
-                  
-                ray_draw_wall_strip(dest, rayHit, wall_screen_height, player_screen_z,  
-                                   wall_texture, rayHit->horizontal);  
-                  
-                /* NUEVO: Renderizar cara inferior de paredes flotantes */
-                /* Renderizar como superficie horizontal (estilo techo) a la altura del wallZOffset */
-                if (rayHit->wallZOffset > 0.0f && wall_texture) {
-                    float player_height = 64.0f;
-                    float player_top = g_engine.camera.z + player_height;
-                    
-                    /* Solo renderizar si estamos debajo de la pared */
-                    if (player_top < rayHit->wallZOffset) {
-                        /* Renderizar superficie horizontal usando proyección de techo */
-                        float eye_height = RAY_TILE_SIZE / 2.0f + g_engine.camera.z;
-                        float surface_height = rayHit->wallZOffset;  /* Altura FIJA de la superficie */
-                        float distance_to_surface = surface_height - eye_height;
-                        
-                        if (distance_to_surface > 0.1f) {
-                            float center_plane = g_engine.displayHeight / 2.0f;
-                            float cos_factor = 1.0f / cosf(g_engine.camera.rot - rayHit->rayAngle);
-                            
-                            /* CORREGIDO: Calcular posición Y fija basada en la altura absoluta */
-                            /* No usar rayHit->correctDistance que varía con la distancia */
-                            /* En su lugar, renderizar como el techo - para cada línea Y de pantalla */
-                            
-                            /* Calcular rango aproximado donde se vería esta superficie */
-                            /* Esto es solo para limitar el área de renderizado */
-                            int screen_y_start = 0;
-                            int screen_y_end = (int)center_plane;  /* Solo la mitad superior de la pantalla */
-                            
-                            int screen_x = x * g_engine.stripWidth;
-                            
-                            /* Renderizar cada línea de la superficie horizontal */
-                            for (int screen_y = screen_y_start; screen_y < screen_y_end && screen_y < g_engine.displayHeight; screen_y++) {
-                                if (center_plane - screen_y <= 0) continue;
-                                
-                                /* Proyección horizontal - igual que el techo */
-                                /* Calcular a qué distancia está el punto que se proyecta en esta línea Y */
-                                float ratio_y = distance_to_surface / (center_plane - screen_y);
-                                float straight_distance = g_engine.viewDist * ratio_y;
-                                float diagonal_distance = straight_distance * cos_factor;
-                                
-                                /* Calcular posición en el mundo */
-                                float x_end = g_engine.camera.x + diagonal_distance * cosf(rayHit->rayAngle);
-                                float y_end = g_engine.camera.y + diagonal_distance * -sinf(rayHit->rayAngle);
-                                
-                                /* Verificar si este punto está dentro del tile de la pared */
-                                int tile_x = (int)(x_end / RAY_TILE_SIZE);
-                                int tile_y = (int)(y_end / RAY_TILE_SIZE);
-                                
-                                /* Solo renderizar si estamos sobre el tile de esta pared */
-                                if (tile_x == rayHit->wallX && tile_y == rayHit->wallY) {
-                                    /* Calcular coordenadas de textura */
-                                    int tex_world_x = ((int)x_end) % RAY_TILE_SIZE;
-                                    int tex_world_y = ((int)y_end) % RAY_TILE_SIZE;
-                                    if (tex_world_x < 0) tex_world_x += RAY_TILE_SIZE;
-                                    if (tex_world_y < 0) tex_world_y += RAY_TILE_SIZE;
-                                    
-                                    int texture_x = (tex_world_x * wall_texture->width) / RAY_TILE_SIZE;
-                                    int texture_y = (tex_world_y * wall_texture->height) / RAY_TILE_SIZE;
-                                    
-                                    uint32_t pixel = ray_sample_texture(wall_texture, texture_x, texture_y);
-                                    
-                                    /* Aplicar fog */
-                                    if (g_engine.fogOn) {
-                                        pixel = ray_fog_pixel(pixel, diagonal_distance);
-                                    }
-                                    
-                                    /* Dibujar pixel(s) */
-                                    for (int sx = 0; sx < g_engine.stripWidth && screen_x + sx < g_engine.displayWidth; sx++) {
-                                        gr_put_pixel(dest, screen_x + sx, screen_y, pixel);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                  
-                /* Slopes no longer supported - draw as normal wall */
-            }  
-              
-            skip_wall_render:;  
-              
-            // Suelo ya renderizado ANTES de las paredes  
-        }  
+    g_engine.sortComparisons = 0;  
+    for (int i = 0; i < RAY_MAX_THREADS; i++) {  
+        g_engine.sortComparisons += frame.sort_comparisons[i];  
     }  
       
     // Renderizar sprites (después de paredes)  
-    ray_draw_sprites(dest, z_buffer);  
+    ray_build_z_tiles(z_buffer, g_engine.rayCount, z_tile_min, z_tile_max);  
+    int sprites_drawn, sprites_culled;  
+    ray_draw_sprites(dest, z_buffer, z_tile_min, z_tile_max, sprite_keys, sprite_visible,  
+                     &g_engine.workerStats[0], &sprites_drawn, &sprites_culled);  
+    stats[RAY_STAT_SPRITES_DRAWN] = (float)sprites_drawn;  
+    stats[RAY_STAT_SPRITES_CULLED] = (float)sprites_culled;  
+    uint64_t minimap_start = SDL_GetPerformanceCounter();  
+    stats[RAY_STAT_SPRITES_MS] = (float)ray_stats_ms(minimap_start - sprites_start);  
       
     // Renderizar minimapa (al final, encima de todo)  
     ray_draw_minimap(dest);  
+    stats[RAY_STAT_MINIMAP_MS] = (float)ray_stats_ms(SDL_GetPerformanceCounter() - minimap_start);  
+      
+    ray_interpolate_end(simulated);  
+      
+    // Cerrar el frame (los buffers quedan en la arena para el siguiente)  
+    ray_arena_end_frame(arena);  
+    ray_fb_commit(&g_fb, dest);  
       
-    // Liberar memoria  
-    free(all_rayhits);  
-    free(rayhit_counts);  
-    free(z_buffer);  
+    stats[RAY_STAT_FRAME_MS] = (float)ray_stats_ms(SDL_GetPerformanceCounter() - frame_start);  
+    ray_stats_commit(stats);  
 }
@@ -0,0 +1,219 @@
+/*
+ * libmod_ray_sprite_rle.c - Sprite Span Cache
+ * Los graphs de sprites (billboards) son casi todo transparente. Cada graph
+ * se convierte una sola vez en columnas de tramos opacos: para cada columna,
+ * una lista de (y inicial, longitud) con sus texels ya leídos en el formato
+ * que devuelve gr_get_pixel. El render salta un tramo transparente de una
+ * vez y copia los opacos sin gr_get_pixel ni test de color key por texel.
+ *
+ * La caché se indexa por (GRAPH*, code, width, height). Cada sprite guarda
+ * además el último graph que usó; si su proceso cambia de graph se busca de
+ * nuevo. Al llenarse la caché se vacía entera y sube 'generation', lo que
+ * invalida los punteros guardados en los sprites.
+ */
+
+#include "libmod_ray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define RAY_SPRITE_RLE_MAX 4096      /* Graphs en caché antes de vaciarla */
+
+typedef struct {
+    RAY_SpriteRLE **slots;           /* Direccionamiento abierto, potencia de 2 */
+    int capacity;
+    int count;
+    uint32_t generation;
+} RAY_SpriteRLECache;
+
+static RAY_SpriteRLECache g_rle = { NULL, 0, 0, 1 };
+
+/* ============================================================================
+   CONVERSIÓN
+   ============================================================================ */
+
+static void ray_sprite_rle_destroy(RAY_SpriteRLE *rle)
+{
+    if (!rle) return;
+    free(rle->pixels);
+    free(rle->spans);
+    free(rle->columnSpans);
+    free(rle);
+}
+
+/* Tramos opacos columna a columna. Un pixel 0 es transparente, igual que
+ * en el bucle por texel al que sustituye. */
+static RAY_SpriteRLE *ray_sprite_rle_build(GRAPH *graph)
+{
+    int width = (int)graph->width;
+    int height = (int)graph->height;
+    if (width <= 0 || height <= 0 || height > 0xFFFF) return NULL;
+
+    uint32_t *texels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+    RAY_SpriteRLE *rle = (RAY_SpriteRLE*)calloc(1, sizeof(RAY_SpriteRLE));
+    if (!texels || !rle) {
+        free(texels);
+        free(rle);
+        return NULL;
+    }
+
+    /* Leer una vez y contar tramos y texels opacos */
+    int num_spans = 0;
+    size_t num_pixels = 0;
+    for (int x = 0; x < width; x++) {
+        uint32_t *column = texels + (size_t)x * height;
+        int opaque = 0;
+        for (int y = 0; y < height; y++) {
+            column[y] = (uint32_t)gr_get_pixel(graph, x, y);
+            if (column[y] != 0) {
+                if (!opaque) num_spans++;
+                num_pixels++;
+                opaque = 1;
+            } else {
+                opaque = 0;
+            }
+        }
+    }
+
+    rle->graph = graph;
+    rle->code = graph->code;
+    rle->width = width;
+    rle->height = height;
+    rle->columnSpans = (int*)malloc((width + 1) * sizeof(int));
+    rle->spans = (RAY_SpriteSpan*)malloc((num_spans > 0 ? num_spans : 1) * sizeof(RAY_SpriteSpan));
+    rle->pixels = (uint32_t*)malloc((num_pixels > 0 ? num_pixels : 1) * sizeof(uint32_t));
+    if (!rle->columnSpans || !rle->spans || !rle->pixels) {
+        free(texels);
+        ray_sprite_rle_destroy(rle);
+        return NULL;
+    }
+
+    int span = 0;
+    uint32_t offset = 0;
+    for (int x = 0; x < width; x++) {
+        const uint32_t *column = texels + (size_t)x * height;
+        rle->columnSpans[x] = span;
+        int y = 0;
+        while (y < height) {
+            if (column[y] == 0) { y++; continue; }
+            int start = y;
+            while (y < height && column[y] != 0) {
+                rle->pixels[offset + (y - start)] = column[y];
+                y++;
+            }
+            rle->spans[span].start = (uint16_t)start;
+            rle->spans[span].length = (uint16_t)(y - start);
+            rle->spans[span].offset = offset;
+            offset += (uint32_t)(y - start);
+            span++;
+        }
+    }
+    rle->columnSpans[width] = span;
+
+    free(texels);
+    return rle;
+}
+
+/* ============================================================================
+   CACHÉ
+   ============================================================================ */
+
+static uint32_t ray_sprite_rle_hash(const GRAPH *graph)
+{
+    uintptr_t p = (uintptr_t)graph;
+    p ^= p >> 17;
+    p *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (uint32_t)(p >> 16);
+}
+
+static int ray_sprite_rle_matches(const RAY_SpriteRLE *rle, const GRAPH *graph)
+{
+    return rle->graph == graph && rle->code == graph->code &&
+           rle->width == (int)graph->width && rle->height == (int)graph->height;
+}
+
+void ray_sprite_rle_cache_free(void)
+{
+    for (int i = 0; i < g_rle.capacity; i++) {
+        ray_sprite_rle_destroy(g_rle.slots[i]);
+    }
+    free(g_rle.slots);
+    g_rle.slots = NULL;
+    g_rle.capacity = 0;
+    g_rle.count = 0;
+    g_rle.generation++;
+}
+
+static int ray_sprite_rle_grow(void)
+{
+    int capacity = g_rle.capacity ? g_rle.capacity * 2 : 64;
+    RAY_SpriteRLE **slots = (RAY_SpriteRLE**)calloc(capacity, sizeof(RAY_SpriteRLE*));
+    if (!slots) return 0;
+
+    for (int i = 0; i < g_rle.capacity; i++) {
+        RAY_SpriteRLE *rle = g_rle.slots[i];
+        if (!rle) continue;
+        uint32_t h = ray_sprite_rle_hash(rle->graph) & (capacity - 1);
+        while (slots[h]) h = (h + 1) & (capacity - 1);
+        slots[h] = rle;
+    }
+    free(g_rle.slots);
+    g_rle.slots = slots;
+    g_rle.capacity = capacity;
+    return 1;
+}
+
+/* Tramos de un graph, convirtiéndolo la primera vez. NULL si no se puede. */
+RAY_SpriteRLE *ray_sprite_rle_get(GRAPH *graph)
+{
+    if (!graph) return NULL;
+
+    if (g_rle.count >= RAY_SPRITE_RLE_MAX) {
+        ray_sprite_rle_cache_free();
+    }
+    if ((g_rle.count + 1) * 4 > g_rle.capacity * 3 && !ray_sprite_rle_grow()) {
+        return NULL;
+    }
+
+    uint32_t mask = (uint32_t)g_rle.capacity - 1;
+    uint32_t h = ray_sprite_rle_hash(graph) & mask;
+    while (g_rle.slots[h]) {
+        RAY_SpriteRLE *rle = g_rle.slots[h];
+        if (rle->graph == graph) {
+            if (ray_sprite_rle_matches(rle, graph)) {
+                return rle;
+            }
+            /* Mismo puntero pero otro graph (liberado y reutilizado): rehacer
+             * en el mismo struct, que los sprites pueden tener guardado */
+            RAY_SpriteRLE *fresh = ray_sprite_rle_build(graph);
+            if (!fresh) return NULL;
+            free(rle->pixels);
+            free(rle->spans);
+            free(rle->columnSpans);
+            *rle = *fresh;
+            free(fresh);
+            return rle;
+        }
+        h = (h + 1) & mask;
+    }
+
+    RAY_SpriteRLE *rle = ray_sprite_rle_build(graph);
+    if (!rle) return NULL;
+    g_rle.slots[h] = rle;
+    g_rle.count++;
+    return rle;
+}
+
+/* Tramos del graph que dibuja un sprite este frame. Se reutiliza el
+ * resultado anterior del sprite mientras no cambie su graph. */
+RAY_SpriteRLE *ray_sprite_rle_for(RAY_Sprite *sprite, GRAPH *graph)
+{
+    if (sprite->rle && sprite->rleGeneration == g_rle.generation &&
+        ray_sprite_rle_matches(sprite->rle, graph)) {
+        return sprite->rle;
+    }
+
+    sprite->rle = ray_sprite_rle_get(graph);
+    sprite->rleGeneration = g_rle.generation;
+    return sprite->rle;
+}
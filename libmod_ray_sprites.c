@@ -0,0 +1,201 @@
+/*
+ * libmod_ray_sprites.c - Sprite Store
+ * Slot map de sprites: g_engine.sprites es un array denso [0, num_sprites)
+ * que se recorre sin huecos, y cada sprite tiene un slot fijo que guarda su
+ * posición actual en el array denso. Los handles que devuelve RAY_ADD_SPRITE
+ * son slot + generación: al borrar, el último sprite ocupa el hueco (solo se
+ * actualiza su slot) y la generación del slot liberado sube, así un handle
+ * viejo no apunta nunca a otro sprite.
+ *
+ * Con generación 0 el handle coincide con el slot, que para los primeros
+ * sprites es el mismo índice que devolvía RAY_ADD_SPRITE.
+ */
+
+#include "libmod_ray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+extern RAY_Engine g_engine;
+
+#define RAY_SPRITE_SLOT_MASK ((1 << RAY_SPRITE_SLOT_BITS) - 1)
+#define RAY_SPRITE_MAX_SLOTS (1 << RAY_SPRITE_SLOT_BITS)
+
+/* ============================================================================
+   CICLO DE VIDA
+   ============================================================================ */
+
+int ray_sprite_store_init(int capacity)
+{
+    ray_sprite_store_free();
+
+    if (capacity < 1) capacity = 1;
+    if (capacity > RAY_SPRITE_MAX_SLOTS) capacity = RAY_SPRITE_MAX_SLOTS;
+
+    g_engine.sprites = (RAY_Sprite*)calloc(capacity, sizeof(RAY_Sprite));
+    g_engine.spriteSlotOf = (int*)malloc(capacity * sizeof(int));
+    g_engine.spriteSlots = (RAY_SpriteSlot*)calloc(capacity, sizeof(RAY_SpriteSlot));
+    if (!g_engine.sprites || !g_engine.spriteSlotOf || !g_engine.spriteSlots) {
+        fprintf(stderr, "RAY: Error al reservar sprites (%d)\n", capacity);
+        ray_sprite_store_free();
+        return 0;
+    }
+
+    g_engine.sprites_capacity = capacity;
+    ray_sprite_store_clear();
+    return 1;
+}
+
+void ray_sprite_store_free(void)
+{
+    free(g_engine.sprites);
+    free(g_engine.spriteSlotOf);
+    free(g_engine.spriteSlots);
+    g_engine.sprites = NULL;
+    g_engine.spriteSlotOf = NULL;
+    g_engine.spriteSlots = NULL;
+    g_engine.sprites_capacity = 0;
+    g_engine.num_sprites = 0;
+    g_engine.spriteSlotCount = 0;
+    g_engine.spriteFreeSlot = -1;
+}
+
+/* Vaciar el store (al cargar/liberar un mapa). Las generaciones se
+ * conservan para que los handles del mapa anterior sigan sin ser válidos. */
+void ray_sprite_store_clear(void)
+{
+    for (int i = 0; i < g_engine.num_sprites; i++) {
+        int slot = g_engine.spriteSlotOf[i];
+        g_engine.spriteSlots[slot].generation++;
+    }
+    for (int slot = 0; slot < g_engine.spriteSlotCount; slot++) {
+        g_engine.spriteSlots[slot].used = 0;
+        g_engine.spriteSlots[slot].dense = (slot + 1 < g_engine.spriteSlotCount) ? slot + 1 : -1;
+    }
+    g_engine.spriteFreeSlot = g_engine.spriteSlotCount > 0 ? 0 : -1;
+    g_engine.num_sprites = 0;
+}
+
+/* Duplicar la capacidad. Los punteros a sprites no sobreviven a esta
+ * llamada; los handles sí. */
+static int ray_sprite_store_grow(void)
+{
+    int capacity = g_engine.sprites_capacity * 2;
+    if (capacity > RAY_SPRITE_MAX_SLOTS) capacity = RAY_SPRITE_MAX_SLOTS;
+    if (capacity <= g_engine.sprites_capacity) return 0;
+
+    /* Los tres arrays cambian juntos o no cambia ninguno */
+    RAY_Sprite *sprites = (RAY_Sprite*)malloc(capacity * sizeof(RAY_Sprite));
+    int *slotOf = (int*)malloc(capacity * sizeof(int));
+    RAY_SpriteSlot *slots = (RAY_SpriteSlot*)malloc(capacity * sizeof(RAY_SpriteSlot));
+    if (!sprites || !slotOf || !slots) {
+        free(sprites);
+        free(slotOf);
+        free(slots);
+        return 0;
+    }
+
+    if (g_engine.num_sprites > 0) {
+        memcpy(sprites, g_engine.sprites, g_engine.num_sprites * sizeof(RAY_Sprite));
+        memcpy(slotOf, g_engine.spriteSlotOf, g_engine.num_sprites * sizeof(int));
+    }
+    if (g_engine.spriteSlotCount > 0) {
+        memcpy(slots, g_engine.spriteSlots, g_engine.spriteSlotCount * sizeof(RAY_SpriteSlot));
+    }
+    free(g_engine.sprites);
+    free(g_engine.spriteSlotOf);
+    free(g_engine.spriteSlots);
+
+    g_engine.sprites = sprites;
+    g_engine.spriteSlotOf = slotOf;
+    g_engine.spriteSlots = slots;
+    g_engine.sprites_capacity = capacity;
+    return 1;
+}
+
+/* ============================================================================
+   ALTA, BAJA Y BÚSQUEDA
+   ============================================================================ */
+
+/* Añade un sprite a cero al final del array denso.
+ * Devuelve NULL si no hay memoria; si 'handle' no es NULL recibe su handle. */
+RAY_Sprite *ray_sprite_alloc(int64_t *handle)
+{
+    if (g_engine.num_sprites >= g_engine.sprites_capacity && !ray_sprite_store_grow()) {
+        fprintf(stderr, "RAY: Máximo de sprites alcanzado\n");
+        return NULL;
+    }
+
+    int slot = g_engine.spriteFreeSlot;
+    if (slot >= 0) {
+        g_engine.spriteFreeSlot = g_engine.spriteSlots[slot].dense;
+    } else {
+        slot = g_engine.spriteSlotCount++;
+        g_engine.spriteSlots[slot].generation = 0;
+    }
+
+    int index = g_engine.num_sprites++;
+    RAY_SpriteSlot *s = &g_engine.spriteSlots[slot];
+    s->dense = index;
+    s->used = 1;
+    g_engine.spriteSlotOf[index] = slot;
+
+    RAY_Sprite *sprite = &g_engine.sprites[index];
+    memset(sprite, 0, sizeof(RAY_Sprite));
+
+    if (handle) {
+        *handle = ((int64_t)s->generation << RAY_SPRITE_SLOT_BITS) | slot;
+    }
+    return sprite;
+}
+
+/* Índice denso de un handle, o -1 si el handle ya no es válido */
+int ray_sprite_index(int64_t handle)
+{
+    if (handle < 0) return -1;
+
+    int slot = (int)(handle & RAY_SPRITE_SLOT_MASK);
+    uint32_t generation = (uint32_t)(handle >> RAY_SPRITE_SLOT_BITS);
+    if (slot >= g_engine.spriteSlotCount) return -1;
+
+    const RAY_SpriteSlot *s = &g_engine.spriteSlots[slot];
+    if (!s->used || s->generation != generation) return -1;
+    return s->dense;
+}
+
+RAY_Sprite *ray_sprite_get(int64_t handle)
+{
+    int index = ray_sprite_index(handle);
+    return index >= 0 ? &g_engine.sprites[index] : NULL;
+}
+
+/* Quita el sprite de la posición densa 'index': el último ocupa su lugar */
+void ray_sprite_remove_at(int index)
+{
+    if (index < 0 || index >= g_engine.num_sprites) return;
+
+    int slot = g_engine.spriteSlotOf[index];
+    int last = --g_engine.num_sprites;
+    if (index != last) {
+        g_engine.sprites[index] = g_engine.sprites[last];
+        int moved = g_engine.spriteSlotOf[last];
+        g_engine.spriteSlotOf[index] = moved;
+        g_engine.spriteSlots[moved].dense = index;
+    }
+
+    RAY_SpriteSlot *s = &g_engine.spriteSlots[slot];
+    s->used = 0;
+    s->generation++;
+    s->dense = g_engine.spriteFreeSlot;
+    g_engine.spriteFreeSlot = slot;
+}
+
+/* Quita los sprites marcados con 'cleanup' */
+void ray_sprite_collect(void)
+{
+    for (int i = g_engine.num_sprites - 1; i >= 0; i--) {
+        if (g_engine.sprites[i].cleanup) {
+            ray_sprite_remove_at(i);
+        }
+    }
+}
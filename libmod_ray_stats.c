@@ -0,0 +1,99 @@
+/*
+ * libmod_ray_stats.c - Estadísticas del frame
+ * ray_render_frame mide con SDL_GetPerformanceCounter cada fase del frame.
+ * Dentro de la fase paralela cada hilo acumula tiempos y contadores en su
+ * propio RAY_WorkerStats (sin atómicos); al cerrar el frame se suman y se
+ * guardan en una ventana circular de RAY_STATS_WINDOW frames, de la que
+ * RAY_GET_STATS devuelve el último valor o la media.
+ *
+ * Los tiempos de raycast, suelo y paredes son tiempo de CPU sumado entre
+ * hilos: con 4 hilos pueden superar a RAY_STAT_STRIPS_MS, que es el tiempo
+ * real de la fase entera.
+ */
+
+#include "libmod_ray.h"
+#include <string.h>
+#include <SDL2/SDL.h>
+
+extern RAY_Engine g_engine;
+
+double ray_stats_ms(uint64_t ticks)
+{
+    return (double)ticks * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/* Contadores por hilo a cero; se llama al empezar cada frame */
+void ray_stats_begin_frame(void)
+{
+    memset(g_engine.workerStats, 0, sizeof(g_engine.workerStats));
+}
+
+/* Borra la historia (cambio de mapa) para que la media no mezcle escenas */
+void ray_stats_reset(void)
+{
+    memset(&g_engine.stats, 0, sizeof(RAY_FrameStats));
+}
+
+/* Cierra el frame: 'values' trae lo que mide ray_render_frame y aquí se
+ * completa con los contadores de los hilos */
+void ray_stats_commit(float *values)
+{
+    uint64_t raycast = 0, floor = 0, walls = 0;
+    uint64_t pixels = 0, samples = 0, thin_wall_tests = 0;
+
+    for (int i = 0; i < RAY_MAX_THREADS; i++) {
+        const RAY_WorkerStats *w = &g_engine.workerStats[i];
+        raycast += w->raycastTicks;
+        floor += w->floorTicks;
+        walls += w->wallTicks;
+        pixels += w->pixels;
+        samples += w->samples;
+        thin_wall_tests += w->thinWallTests;
+    }
+
+    values[RAY_STAT_RAYCAST_MS] = (float)ray_stats_ms(raycast);
+    values[RAY_STAT_FLOOR_MS] = (float)ray_stats_ms(floor);
+    values[RAY_STAT_WALLS_MS] = (float)ray_stats_ms(walls);
+    values[RAY_STAT_PIXELS] = (float)pixels;
+    values[RAY_STAT_TEXTURE_SAMPLES] = (float)samples;
+    values[RAY_STAT_THIN_WALL_TESTS] = (float)thin_wall_tests;
+    values[RAY_STAT_SORT_COMPARISONS] = (float)g_engine.sortComparisons;
+    values[RAY_STAT_ARENA_BYTES] = (float)g_engine.frameArena.used;
+
+    RAY_FrameStats *stats = &g_engine.stats;
+    memcpy(stats->last, values, sizeof(stats->last));
+    memcpy(stats->history[stats->cursor], values, sizeof(stats->last));
+    stats->cursor = (stats->cursor + 1) % RAY_STATS_WINDOW;
+    if (stats->frames < RAY_STATS_WINDOW) stats->frames++;
+}
+
+/* ============================================================================
+   FUNCIÓN EXPORTADA
+   ============================================================================ */
+
+/* RAY_GET_STATS(stat, media): último frame (media = 0) o media de los
+ * últimos RAY_STATS_WINDOW frames (media != 0) */
+int64_t libmod_ray_get_stats(INSTANCE *my, int64_t *params)
+{
+    int stat = (int)params[0];
+    int average = (int)params[1];
+    float value = 0.0f;
+
+    if (!g_engine.initialized || stat < 0 || stat >= RAY_STAT_COUNT) return 0;
+
+    const RAY_FrameStats *stats = &g_engine.stats;
+    if (!average) {
+        value = stats->last[stat];
+    } else if (stats->frames > 0) {
+        double sum = 0.0;
+        for (int i = 0; i < stats->frames; i++) {
+            sum += stats->history[i][stat];
+        }
+        value = (float)(sum / stats->frames);
+    }
+
+    /* El float va en los 4 bytes bajos del int64 devuelto */
+    int64_t result = 0;
+    memcpy(&result, &value, sizeof(float));
+    return result;
+}
@@ -0,0 +1,232 @@
+/*
+ * libmod_ray_textures.c - Texture Cache
+ * Convierte una sola vez (al cargar el mapa) los graphs del FPG que usa el
+ * mapa al formato de pixel destino, para que los bucles de render lean
+ * texels uint32 directamente sin gr_get_pixel ni SDL_MapRGB por muestra.
+ *
+ * Las texturas de pared guardan además una copia traspuesta: los strips de
+ * pared se dibujan de arriba a abajo con texture_x fijo, así una columna de
+ * pared es un recorrido lineal en memoria en lugar de un salto de fila por
+ * texel. Suelos y techos se muestrean por filas y usan la copia normal.
+ *
+ * Solo el hilo principal convierte: al cargar el mapa, al publicar un
+ * chunk (ray_chunk_publish) y al cambiar el cielo, siempre antes de la fase
+ * paralela del frame. Los hilos del render solo leen la caché; una textura
+ * sin convertir no se dibuja. bitmap_get y gr_get_pixel no son seguros
+ * desde varios hilos.
+ */
+
+#include "libmod_ray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+extern RAY_Engine g_engine;
+extern SDL_PixelFormat *gPixelFormat;
+
+/* ============================================================================
+   CONVERSIÓN
+   ============================================================================ */
+
+static int ray_texture_mask(int size)
+{
+    return (size > 0 && (size & (size - 1)) == 0) ? size - 1 : -1;
+}
+
+/* Convierte un graph al formato destino (misma conversión que hacía
+ * ray_sample_texture en cada muestra: extraer RGB y volver a mapear opaco) */
+static int ray_texture_convert(RAY_Texture *tex, GRAPH *graph)
+{
+    int width = (int)graph->width;
+    int height = (int)graph->height;
+    if (width <= 0 || height <= 0) return 0;
+
+    uint32_t *pixels = (uint32_t*)malloc((size_t)width * height * sizeof(uint32_t));
+    if (!pixels) return 0;
+
+    for (int y = 0; y < height; y++) {
+        uint32_t *row = pixels + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            uint32_t pixel = (uint32_t)gr_get_pixel(graph, x, y);
+            uint8_t r = (pixel >> gPixelFormat->Rshift) & 0xFF;
+            uint8_t g = (pixel >> gPixelFormat->Gshift) & 0xFF;
+            uint8_t b = (pixel >> gPixelFormat->Bshift) & 0xFF;
+            row[x] = SDL_MapRGB(gPixelFormat, r, g, b);
+        }
+    }
+
+    tex->pixels = pixels;
+    tex->width = width;
+    tex->height = height;
+    tex->wmask = ray_texture_mask(width);
+    tex->hmask = ray_texture_mask(height);
+    tex->state = RAY_TEXTURE_LOADED;
+
+    g_engine.textureCache.loaded++;
+    g_engine.textureCache.bytes += (size_t)width * height * sizeof(uint32_t);
+    return 1;
+}
+
+/* Generar la copia columna a columna a partir de la copia por filas */
+static int ray_texture_transpose(RAY_Texture *tex)
+{
+    if (tex->columns) return 1;
+
+    uint32_t *columns = (uint32_t*)malloc((size_t)tex->width * tex->height * sizeof(uint32_t));
+    if (!columns) return 0;
+
+    for (int y = 0; y < tex->height; y++) {
+        const uint32_t *row = tex->pixels + (size_t)y * tex->width;
+        for (int x = 0; x < tex->width; x++) {
+            columns[(size_t)x * tex->height + y] = row[x];
+        }
+    }
+
+    tex->columns = columns;
+    g_engine.textureCache.bytes += (size_t)tex->width * tex->height * sizeof(uint32_t);
+    return 1;
+}
+
+/* Convertir un graph que aún no está en la caché. Solo desde el hilo
+ * principal y con la caché construida; NULL si el graph no existe en el FPG */
+RAY_Texture *ray_texture_load(int graph_id)
+{
+    RAY_TextureCache *cache = &g_engine.textureCache;
+    if (!cache->ready || graph_id <= 0 || graph_id >= RAY_MAX_TEXTURES) return NULL;
+
+    RAY_Texture *tex = &cache->textures[graph_id];
+    if (tex->state == RAY_TEXTURE_LOADED) return tex;
+    if (tex->state == RAY_TEXTURE_MISSING) return NULL;
+
+    GRAPH *graph = bitmap_get(cache->fpg_id, graph_id);
+    if (!graph || !ray_texture_convert(tex, graph)) {
+        tex->state = RAY_TEXTURE_MISSING;
+        return NULL;
+    }
+    return tex;
+}
+
+/* Igual que ray_texture_load pero garantizando la copia por columnas */
+RAY_Texture *ray_texture_load_wall(int graph_id)
+{
+    RAY_Texture *tex = ray_texture_load(graph_id);
+    if (tex && !tex->columns && !ray_texture_transpose(tex)) return NULL;
+    return tex;
+}
+
+/* ============================================================================
+   CONSTRUCCIÓN AL CARGAR EL MAPA
+   ============================================================================ */
+
+/* ID de textura que usa una celda de pared (las puertas restan su base) */
+static int ray_wall_texture_id(int wallType)
+{
+    if (ray_is_vertical_door(wallType)) return wallType - 1000;
+    if (ray_is_horizontal_door(wallType)) return wallType - 1500;
+    return wallType;
+}
+
+#define RAY_TEXTURE_USED_FLAT 1     /* Muestreada por filas (suelo, techo, cielo) */
+#define RAY_TEXTURE_USED_WALL 2     /* Muestreada por columnas (pared) */
+
+static void ray_texture_cache_mark(uint8_t *used, int id, uint8_t usage)
+{
+    if (id > 0 && id < RAY_MAX_TEXTURES) used[id] |= usage;
+}
+
+/* Paredes, puertas, suelos y techos de 'count' RAY_Cell */
+static void ray_texture_cache_mark_cells(uint8_t *used, const RAY_Cell *cells, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        ray_texture_cache_mark(used, ray_wall_texture_id(cells[i].wall), RAY_TEXTURE_USED_WALL);
+        ray_texture_cache_mark(used, cells[i].floor, RAY_TEXTURE_USED_FLAT);
+        ray_texture_cache_mark(used, cells[i].ceiling, RAY_TEXTURE_USED_FLAT);
+    }
+}
+
+void ray_texture_cache_build(int fpg_id)
+{
+    ray_texture_cache_free();
+    g_engine.textureCache.fpg_id = fpg_id;
+    g_engine.textureCache.ready = 1;
+
+    uint8_t *used = (uint8_t*)calloc(RAY_MAX_TEXTURES, 1);
+    if (!used) return;
+
+    /* Chunks residentes (todo el mapa salvo en los mapas por chunks, cuyos
+     * chunks convierten sus texturas al publicarse) y proxies */
+    const RAY_World *world = &g_engine.world;
+    for (int i = 0; world->chunks && i < world->chunksX * world->chunksY; i++) {
+        const RAY_Chunk *chunk = &world->chunks[i];
+        ray_texture_cache_mark(used, ray_wall_texture_id(chunk->proxyWall), RAY_TEXTURE_USED_WALL);
+        ray_texture_cache_mark(used, chunk->proxyFloor, RAY_TEXTURE_USED_FLAT);
+        ray_texture_cache_mark(used, chunk->proxyCeiling, RAY_TEXTURE_USED_FLAT);
+        if (!chunk->resident) continue;
+        ray_texture_cache_mark_cells(used, chunk->cells, (size_t)chunk->numCells * world->levels);
+    }
+
+    /* ThickWalls y sus ThinWalls */
+    for (int i = 0; i < g_engine.num_thick_walls; i++) {
+        RAY_ThickWall *tw = g_engine.thickWalls[i];
+        if (!tw) continue;
+        ray_texture_cache_mark(used, tw->ceilingTextureID, RAY_TEXTURE_USED_FLAT);
+        ray_texture_cache_mark(used, tw->floorTextureID, RAY_TEXTURE_USED_FLAT);
+        for (int t = 0; t < tw->num_thin_walls; t++) {
+            ray_texture_cache_mark(used, tw->thinWalls[t].wallType, RAY_TEXTURE_USED_WALL);
+        }
+    }
+
+    /* Skybox */
+    ray_texture_cache_mark(used, g_engine.skyTextureID, RAY_TEXTURE_USED_FLAT);
+
+    for (int id = 1; id < RAY_MAX_TEXTURES; id++) {
+        if (used[id] & RAY_TEXTURE_USED_WALL) {
+            ray_texture_load_wall(id);
+        } else if (used[id]) {
+            ray_texture_load(id);
+        }
+    }
+    free(used);
+
+    printf("RAY: Texture cache - %d texturas convertidas (%zu bytes)\n",
+           g_engine.textureCache.loaded, g_engine.textureCache.bytes);
+}
+
+/* Texturas de 'count' RAY_Cell que aún no están convertidas: las de un
+ * chunk que se acaba de publicar. Hilo principal */
+void ray_texture_cache_load_cells(const RAY_Cell *cells, size_t count)
+{
+    const RAY_TextureCache *cache = &g_engine.textureCache;
+    if (!cache->ready) return;
+
+    for (size_t i = 0; i < count; i++) {
+        int wall = ray_wall_texture_id(cells[i].wall);
+        if (wall > 0 && wall < RAY_MAX_TEXTURES && !cache->textures[wall].columns &&
+            cache->textures[wall].state != RAY_TEXTURE_MISSING) {
+            ray_texture_load_wall(wall);
+        }
+        if (cells[i].floor > 0 && cells[i].floor < RAY_MAX_TEXTURES &&
+            cache->textures[cells[i].floor].state == RAY_TEXTURE_EMPTY) {
+            ray_texture_load(cells[i].floor);
+        }
+        if (cells[i].ceiling > 0 && cells[i].ceiling < RAY_MAX_TEXTURES &&
+            cache->textures[cells[i].ceiling].state == RAY_TEXTURE_EMPTY) {
+            ray_texture_load(cells[i].ceiling);
+        }
+    }
+}
+
+void ray_texture_cache_free(void)
+{
+    RAY_TextureCache *cache = &g_engine.textureCache;
+    for (int id = 0; id < RAY_MAX_TEXTURES; id++) {
+        if (cache->textures[id].pixels) {
+            free(cache->textures[id].pixels);
+        }
+        if (cache->textures[id].columns) {
+            free(cache->textures[id].columns);
+        }
+    }
+    memset(cache, 0, sizeof(RAY_TextureCache));
+}
@@ -0,0 +1,197 @@
+/*
+ * libmod_ray_thingrid.c - Índice espacial de ThinWalls
+ * Al cargar el mapa se reparte cada ThinWall de los ThickWalls en las celdas
+ * del grid que cruza. El raycast de ThinWalls recorre con un DDA las celdas
+ * que visita el rayo y solo prueba los ThinWalls de esas celdas, en lugar de
+ * todos los del mapa en cada strip.
+ *
+ * Un ThinWall que cruza varias celdas aparece en todas ellas; para probarlo
+ * una sola vez por rayo cada hilo guarda en 'stamps' el sello del último
+ * rayo que lo probó. El sello es frameStamp + strip: único por rayo dentro
+ * del frame y creciente entre frames, así no hay que limpiar nada por rayo.
+ */
+
+#include "libmod_ray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+extern RAY_Engine g_engine;
+
+/* Margen en unidades de mundo al repartir: un ThinWall sobre el borde de
+ * una celda, o que pasa rozando una esquina, cae también en la vecina */
+#define RAY_THIN_GRID_MARGIN 0.5f
+
+/* ============================================================================
+   REPARTO EN CELDAS
+   ============================================================================ */
+
+static int ray_thin_grid_clamp(int v, int max)
+{
+    return v < 0 ? 0 : (v > max ? max : v);
+}
+
+static int ray_thin_grid_inside(const RAY_ThinWallGrid *grid, const RAY_ThinWall *tw, int tileSize)
+{
+    float w = (float)grid->width * tileSize;
+    float h = (float)grid->height * tileSize;
+    return tw->x1 >= 0.0f && tw->x1 <= w && tw->y1 >= 0.0f && tw->y1 <= h &&
+           tw->x2 >= 0.0f && tw->x2 <= w && tw->y2 >= 0.0f && tw->y2 <= h;
+}
+
+/* Recorre las celdas que toca el segmento, fila a fila: en cada fila de
+ * celdas se calcula el tramo X del segmento dentro de esa franja de Y.
+ * Con 'items' == NULL solo cuenta (primera pasada del CSR). */
+static void ray_thin_grid_rasterize(RAY_ThinWallGrid *grid, const RAY_ThinWall *tw,
+                                    uint32_t id, int tileSize, int *cursor)
+{
+    float x1 = tw->x1, y1 = tw->y1, x2 = tw->x2, y2 = tw->y2;
+    float min_y = fminf(y1, y2) - RAY_THIN_GRID_MARGIN;
+    float max_y = fmaxf(y1, y2) + RAY_THIN_GRID_MARGIN;
+    int row0 = ray_thin_grid_clamp((int)floorf(min_y / tileSize), grid->height - 1);
+    int row1 = ray_thin_grid_clamp((int)floorf(max_y / tileSize), grid->height - 1);
+    float dy = y2 - y1;
+
+    for (int row = row0; row <= row1; row++) {
+        float xa, xb;
+        if (fabsf(dy) < 1e-6f) {
+            xa = fminf(x1, x2);
+            xb = fmaxf(x1, x2);
+        } else {
+            float ya = fmaxf((float)row * tileSize, min_y);
+            float yb = fminf((float)(row + 1) * tileSize, max_y);
+            float ta = (ya - y1) / dy;
+            float tb = (yb - y1) / dy;
+            ta = ta < 0.0f ? 0.0f : (ta > 1.0f ? 1.0f : ta);
+            tb = tb < 0.0f ? 0.0f : (tb > 1.0f ? 1.0f : tb);
+            xa = x1 + (x2 - x1) * ta;
+            xb = x1 + (x2 - x1) * tb;
+            if (xa > xb) { float t = xa; xa = xb; xb = t; }
+        }
+
+        int col0 = ray_thin_grid_clamp((int)floorf((xa - RAY_THIN_GRID_MARGIN) / tileSize), grid->width - 1);
+        int col1 = ray_thin_grid_clamp((int)floorf((xb + RAY_THIN_GRID_MARGIN) / tileSize), grid->width - 1);
+        for (int col = col0; col <= col1; col++) {
+            int cell = col + row * grid->width;
+            if (grid->items) {
+                grid->items[cursor[cell]++] = id;
+            } else {
+                grid->cellStart[cell + 1]++;
+            }
+        }
+    }
+}
+
+/* ============================================================================
+   CONSTRUCCIÓN AL CARGAR EL MAPA
+   ============================================================================ */
+
+void ray_thin_wall_grid_build(void)
+{
+    ray_thin_wall_grid_free();
+
+    RAY_ThinWallGrid *grid = &g_engine.thinWallGrid;
+    RAY_Raycaster *rc = &g_engine.raycaster;
+    int tileSize = rc->tileSize > 0 ? rc->tileSize : RAY_TILE_SIZE;
+
+    int total = 0;
+    for (int i = 0; i < g_engine.num_thick_walls; i++) {
+        if (g_engine.thickWalls[i]) total += g_engine.thickWalls[i]->num_thin_walls;
+    }
+    if (total == 0 || rc->gridWidth <= 0 || rc->gridHeight <= 0) return;
+
+    int cells = rc->gridWidth * rc->gridHeight;
+    grid->width = rc->gridWidth;
+    grid->height = rc->gridHeight;
+    grid->walls = (RAY_ThinWall**)malloc(total * sizeof(RAY_ThinWall*));
+    grid->outside = (uint32_t*)malloc(total * sizeof(uint32_t));
+    grid->cellStart = (int*)calloc(cells + 1, sizeof(int));
+    grid->stamps = (uint32_t*)calloc((size_t)RAY_MAX_THREADS * total, sizeof(uint32_t));
+    int *cursor = (int*)malloc(cells * sizeof(int));
+    if (!grid->walls || !grid->outside || !grid->cellStart || !grid->stamps || !cursor) {
+        fprintf(stderr, "RAY: Error al reservar el índice de ThinWalls\n");
+        free(cursor);
+        ray_thin_wall_grid_free();
+        return;
+    }
+
+    /* IDs estables: ThickWalls en orden y sus ThinWalls en orden */
+    for (int i = 0; i < g_engine.num_thick_walls; i++) {
+        RAY_ThickWall *thickWall = g_engine.thickWalls[i];
+        if (!thickWall) continue;
+        for (int t = 0; t < thickWall->num_thin_walls; t++) {
+            grid->walls[grid->num_walls++] = &thickWall->thinWalls[t];
+        }
+    }
+
+    /* Primera pasada: cuántos IDs caen en cada celda */
+    for (int id = 0; id < grid->num_walls; id++) {
+        RAY_ThinWall *tw = grid->walls[id];
+        if (!ray_thin_grid_inside(grid, tw, tileSize)) {
+            grid->outside[grid->num_outside++] = (uint32_t)id;
+            continue;
+        }
+        ray_thin_grid_rasterize(grid, tw, (uint32_t)id, tileSize, NULL);
+    }
+
+    for (int c = 0; c < cells; c++) {
+        grid->cellStart[c + 1] += grid->cellStart[c];
+    }
+
+    size_t entries = (size_t)grid->cellStart[cells];
+    grid->items = (uint32_t*)malloc((entries > 0 ? entries : 1) * sizeof(uint32_t));
+    if (!grid->items) {
+        fprintf(stderr, "RAY: Error al reservar el índice de ThinWalls\n");
+        free(cursor);
+        ray_thin_wall_grid_free();
+        return;
+    }
+
+    /* Segunda pasada: escribir los IDs */
+    memcpy(cursor, grid->cellStart, cells * sizeof(int));
+    for (int id = 0; id < grid->num_walls; id++) {
+        RAY_ThinWall *tw = grid->walls[id];
+        if (ray_thin_grid_inside(grid, tw, tileSize)) {
+            ray_thin_grid_rasterize(grid, tw, (uint32_t)id, tileSize, cursor);
+        }
+    }
+    free(cursor);
+
+    printf("RAY: Índice de ThinWalls - %d ThinWalls, %zu entradas en %d celdas, %d fuera del grid\n",
+           grid->num_walls, entries, cells, grid->num_outside);
+}
+
+void ray_thin_wall_grid_free(void)
+{
+    RAY_ThinWallGrid *grid = &g_engine.thinWallGrid;
+    free(grid->cellStart);
+    free(grid->items);
+    free(grid->walls);
+    free(grid->outside);
+    free(grid->stamps);
+    memset(grid, 0, sizeof(RAY_ThinWallGrid));
+}
+
+/* ============================================================================
+   USO POR FRAME
+   ============================================================================ */
+
+/* Reserva los sellos [frameStamp, frameStamp + rayCount) para este frame.
+ * Se llama desde el hilo principal antes de lanzar los strips. */
+void ray_thin_wall_grid_begin_frame(int rayCount)
+{
+    RAY_ThinWallGrid *grid = &g_engine.thinWallGrid;
+    if (!grid->stamps) return;
+
+    /* Saltar los sellos del frame anterior; al dar la vuelta el contador,
+     * limpiar para que no se repitan */
+    uint32_t next = grid->frameStamp + grid->frameRays;
+    if (grid->frameStamp == 0 || next < grid->frameStamp ||
+        next > UINT32_MAX - (uint32_t)rayCount) {
+        memset(grid->stamps, 0, (size_t)RAY_MAX_THREADS * grid->num_walls * sizeof(uint32_t));
+        next = 1;
+    }
+    grid->frameStamp = next;
+    grid->frameRays = (uint32_t)rayCount;
+}
@@ -0,0 +1,191 @@
+/*
+ * libmod_ray_threads.c - Render Thread Pool
+ * Los workers se crean una vez en RAY_INIT y duermen en un semáforo entre
+ * frames. ray_threads_run reparte un rango de strips en bandas de columnas:
+ * cada hilo empieza por un tramo contiguo de bandas (localidad) y, al
+ * terminarlo, roba bandas pendientes de los demás (reparto de carga cuando
+ * una zona de la pantalla tiene mucha más geometría que otra).
+ *
+ * El resultado no depende de qué hilo procese cada banda: cada strip solo
+ * escribe sus propios datos y columnas, así que la imagen es idéntica bit a
+ * bit a la del render con un solo hilo.
+ */
+
+#include "libmod_ray.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+/* ============================================================================
+   ESTADO DEL POOL
+   ============================================================================ */
+
+/* Bandas pendientes de un hilo: [next, end). El dueño y los ladrones
+ * reclaman con el mismo fetch-add, así cada banda se procesa una sola vez.
+ * Una cola por línea de caché para que los hilos no se pisen. */
+typedef struct {
+    SDL_atomic_t next;
+    int end;
+    char pad[RAY_ARENA_ALIGN - sizeof(SDL_atomic_t) - sizeof(int)];
+} RAY_BandQueue;
+
+typedef struct {
+    int count;                               /* Hilos totales (el 0 es el que llama) */
+    SDL_Thread *threads[RAY_MAX_THREADS];
+    SDL_sem *start[RAY_MAX_THREADS];         /* Un semáforo de arranque por worker */
+    SDL_sem *done;                           /* Los workers avisan al terminar */
+    RAY_BandQueue queues[RAY_MAX_THREADS];
+    int quit;
+
+    /* Trabajo en curso */
+    RAY_ThreadJob job;
+    void *ctx;
+    int items;
+    int band;
+} RAY_ThreadPool;
+
+static RAY_ThreadPool g_pool = { 1 };
+
+/* ============================================================================
+   WORKERS
+   ============================================================================ */
+
+static void ray_threads_drain(RAY_BandQueue *queue, int worker)
+{
+    for (;;) {
+        int band = SDL_AtomicAdd(&queue->next, 1);
+        if (band >= queue->end) return;
+
+        int first = band * g_pool.band;
+        int last = first + g_pool.band;
+        if (last > g_pool.items) last = g_pool.items;
+        g_pool.job(g_pool.ctx, first, last, worker);
+    }
+}
+
+/* Primero las bandas propias, después robar a los demás hilos en orden */
+static void ray_threads_work(int worker)
+{
+    ray_threads_drain(&g_pool.queues[worker], worker);
+    for (int i = 1; i < g_pool.count; i++) {
+        RAY_BandQueue *victim = &g_pool.queues[(worker + i) % g_pool.count];
+        if (SDL_AtomicGet(&victim->next) < victim->end) {
+            ray_threads_drain(victim, worker);
+        }
+    }
+}
+
+static int ray_threads_main(void *data)
+{
+    int worker = (int)(intptr_t)data;
+
+    for (;;) {
+        SDL_SemWait(g_pool.start[worker]);
+        if (g_pool.quit) break;
+        ray_threads_work(worker);
+        SDL_SemPost(g_pool.done);
+    }
+    return 0;
+}
+
+/* ============================================================================
+   CICLO DE VIDA
+   ============================================================================ */
+
+/* Crea el pool con 'count' hilos en total (<= 0: uno por CPU).
+ * Si no se pueden crear todos se sigue con los que haya; devuelve el total. */
+int ray_threads_init(int count)
+{
+    ray_threads_shutdown();
+
+    if (count <= 0) count = SDL_GetCPUCount();
+    if (count < 1) count = 1;
+    if (count > RAY_MAX_THREADS) count = RAY_MAX_THREADS;
+
+    if (count > 1) {
+        g_pool.done = SDL_CreateSemaphore(0);
+    }
+
+    for (int i = 1; i < count && g_pool.done; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "ray_render_%d", i);
+
+        g_pool.start[i] = SDL_CreateSemaphore(0);
+        if (!g_pool.start[i]) break;
+
+        g_pool.threads[i] = SDL_CreateThread(ray_threads_main, name, (void*)(intptr_t)i);
+        if (!g_pool.threads[i]) {
+            SDL_DestroySemaphore(g_pool.start[i]);
+            g_pool.start[i] = NULL;
+            break;
+        }
+        g_pool.count = i + 1;
+    }
+
+    if (g_pool.count < count) {
+        fprintf(stderr, "RAY: Solo se pudieron crear %d de %d hilos de render: %s\n",
+                g_pool.count, count, SDL_GetError());
+    }
+
+    printf("RAY: Render con %d hilo(s)\n", g_pool.count);
+    return g_pool.count;
+}
+
+void ray_threads_shutdown(void)
+{
+    g_pool.quit = 1;
+    for (int i = 1; i < g_pool.count; i++) {
+        SDL_SemPost(g_pool.start[i]);
+        SDL_WaitThread(g_pool.threads[i], NULL);
+        SDL_DestroySemaphore(g_pool.start[i]);
+    }
+    if (g_pool.done) {
+        SDL_DestroySemaphore(g_pool.done);
+    }
+
+    memset(&g_pool, 0, sizeof(RAY_ThreadPool));
+    g_pool.count = 1;
+}
+
+int ray_threads_count(void)
+{
+    return g_pool.count;
+}
+
+/* ============================================================================
+   EJECUCIÓN
+   ============================================================================ */
+
+/* Ejecuta 'job' sobre [0, items) en bandas de 'band' elementos y vuelve
+ * cuando han terminado todas. Solo se llama desde el hilo principal. */
+void ray_threads_run(int items, int band, RAY_ThreadJob job, void *ctx)
+{
+    if (items <= 0) return;
+    if (band < 1) band = 1;
+
+    int bands = (items + band - 1) / band;
+    if (g_pool.count <= 1 || bands < 2) {
+        job(ctx, 0, items, 0);
+        return;
+    }
+
+    g_pool.job = job;
+    g_pool.ctx = ctx;
+    g_pool.items = items;
+    g_pool.band = band;
+
+    /* Reparto inicial: un tramo contiguo de bandas por hilo */
+    for (int i = 0; i < g_pool.count; i++) {
+        SDL_AtomicSet(&g_pool.queues[i].next, bands * i / g_pool.count);
+        g_pool.queues[i].end = bands * (i + 1) / g_pool.count;
+    }
+
+    for (int i = 1; i < g_pool.count; i++) {
+        SDL_SemPost(g_pool.start[i]);
+    }
+    ray_threads_work(0);
+    for (int i = 1; i < g_pool.count; i++) {
+        SDL_SemWait(g_pool.done);
+    }
+}
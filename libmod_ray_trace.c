@@ -0,0 +1,119 @@
+/*
+ * libmod_ray_trace.c - Trazas de depuración (solo con RAY_ENABLE_TRACE)
+ * Cada hilo que registra un evento reclama la primera vez un buffer
+ * circular propio con un fetch-add; a partir de ahí solo escribe él, así
+ * que no hay locks ni atómicos por evento. Cuando el buffer se llena se
+ * pisan los eventos más viejos. El volcado se hace en RAY_SHUTDOWN, con
+ * los workers del render ya parados.
+ */
+
+#include "libmod_ray_trace.h"
+
+#ifdef RAY_ENABLE_TRACE
+
+#include "libmod_ray.h"
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+#define RAY_TRACE_RING_SIZE 4096                 /* Eventos por hilo, potencia de 2 */
+#define RAY_TRACE_MAX_RINGS (RAY_MAX_THREADS + 4) /* Workers + hilo principal y otros */
+
+#if defined(_MSC_VER)
+#define RAY_TRACE_TLS __declspec(thread)
+#else
+#define RAY_TRACE_TLS __thread
+#endif
+
+typedef struct {
+    uint64_t ticks;                  /* SDL_GetPerformanceCounter */
+    uint16_t event;
+    uint16_t ring;
+    int32_t a, b, c, d;
+    float f;
+} RAY_TraceRecord;
+
+typedef struct {
+    RAY_TraceRecord records[RAY_TRACE_RING_SIZE];
+    uint32_t head;                   /* Eventos escritos en total */
+} RAY_TraceRing;
+
+static RAY_TraceRing g_trace_rings[RAY_TRACE_MAX_RINGS];
+static SDL_atomic_t g_trace_claimed;
+static SDL_atomic_t g_trace_dropped;
+static RAY_TRACE_TLS RAY_TraceRing *t_ring = NULL;
+static RAY_TRACE_TLS int t_ring_failed = 0;
+
+static const char *g_trace_names[RAY_TRACE_EVENT_COUNT] = {
+    "STRIP_HIT",
+    "WALL_COORD",
+    "FLOOR_TILE",
+    "FLOOR_DOOR",
+    "DOOR_HIT",
+    "DOOR_SLIDE",
+    "WALL_TEXTURE",
+    "DOOR_ANIM",
+    "MINIMAP"
+};
+
+void ray_trace_record(int event, int32_t a, int32_t b, int32_t c, int32_t d, float f)
+{
+    RAY_TraceRing *ring = t_ring;
+    if (!ring) {
+        if (t_ring_failed) {
+            SDL_AtomicAdd(&g_trace_dropped, 1);
+            return;
+        }
+        int index = SDL_AtomicAdd(&g_trace_claimed, 1);
+        if (index >= RAY_TRACE_MAX_RINGS) {
+            t_ring_failed = 1;
+            SDL_AtomicAdd(&g_trace_dropped, 1);
+            return;
+        }
+        ring = t_ring = &g_trace_rings[index];
+    }
+
+    RAY_TraceRecord *r = &ring->records[ring->head & (RAY_TRACE_RING_SIZE - 1)];
+    r->ticks = SDL_GetPerformanceCounter();
+    r->event = (uint16_t)event;
+    r->ring = (uint16_t)(ring - g_trace_rings);
+    r->a = a;
+    r->b = b;
+    r->c = c;
+    r->d = d;
+    r->f = f;
+    ring->head++;
+}
+
+/* Volcar como texto, buffer a buffer y en orden de escritura */
+void ray_trace_dump(const char *path)
+{
+    int rings = SDL_AtomicGet(&g_trace_claimed);
+    if (rings > RAY_TRACE_MAX_RINGS) rings = RAY_TRACE_MAX_RINGS;
+    if (rings == 0) return;
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "RAY: No se pudo abrir %s para volcar las trazas\n", path);
+        return;
+    }
+
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    fprintf(f, "# ticks_us hilo evento a b c d f\n");
+    for (int i = 0; i < rings; i++) {
+        const RAY_TraceRing *ring = &g_trace_rings[i];
+        uint32_t count = ring->head < RAY_TRACE_RING_SIZE ? ring->head : RAY_TRACE_RING_SIZE;
+        for (uint32_t n = ring->head - count; n != ring->head; n++) {
+            const RAY_TraceRecord *r = &ring->records[n & (RAY_TRACE_RING_SIZE - 1)];
+            const char *name = r->event < RAY_TRACE_EVENT_COUNT ? g_trace_names[r->event] : "?";
+            fprintf(f, "%.1f %u %s %d %d %d %d %g\n",
+                    (double)r->ticks * 1000000.0 / frequency, (unsigned)r->ring, name,
+                    r->a, r->b, r->c, r->d, r->f);
+        }
+    }
+    fclose(f);
+
+    printf("RAY: Trazas volcadas en %s (%d hilos, %d eventos perdidos)\n",
+           path, rings, SDL_AtomicGet(&g_trace_dropped));
+}
+
+#endif /* RAY_ENABLE_TRACE */
@@ -0,0 +1,50 @@
+/*
+ * libmod_ray_trace.h - Trazas de depuración
+ * RAY_TRACE(evento, a, b, c, d, f) registra un evento con cuatro enteros y
+ * un float. Sin RAY_ENABLE_TRACE la macro no genera código (ni evalúa sus
+ * argumentos), así que puede quedarse en los bucles calientes del render.
+ *
+ * Con RAY_ENABLE_TRACE (cmake -DRAY_ENABLE_TRACE=ON) cada hilo escribe en
+ * su propio buffer circular, sin locks, y RAY_SHUTDOWN vuelca los eventos
+ * que queden en RAY_TRACE_FILE.
+ */
+
+#ifndef __LIBMOD_RAY_TRACE_H
+#define __LIBMOD_RAY_TRACE_H
+
+#include <stdint.h>
+
+/* Eventos: el significado de a, b, c, d y f está al lado de cada uno */
+typedef enum {
+    RAY_TRACE_STRIP_HIT,        /* strip, hit, level, wallType | distance */
+    RAY_TRACE_WALL_COORD,       /* wall_h, ref_h, screen_y, floor_start_y | - */
+    RAY_TRACE_FLOOR_TILE,       /* tile_type, tile_x, tile_y, screen_y | - */
+    RAY_TRACE_FLOOR_DOOR,       /* strip, -, -, - | - (suelo completo tras una puerta) */
+    RAY_TRACE_DOOR_HIT,         /* strip, wallType, celda, texture_id | offset */
+    RAY_TRACE_DOOR_SLIDE,       /* strip, wallType, vertical, visible | offset */
+    RAY_TRACE_WALL_TEXTURE,     /* strip, texture_id, cargada, drawWalls | - */
+    RAY_TRACE_DOOR_ANIM,        /* celda, state, animating, - | offset */
+    RAY_TRACE_MINIMAP,          /* map_x, map_y, minimap_x, minimap_y | scale */
+    RAY_TRACE_EVENT_COUNT
+} RAY_TraceEvent;
+
+#ifdef RAY_ENABLE_TRACE
+
+#ifndef RAY_TRACE_FILE
+#define RAY_TRACE_FILE "ray_trace.log"
+#endif
+
+void ray_trace_record(int event, int32_t a, int32_t b, int32_t c, int32_t d, float f);
+void ray_trace_dump(const char *path);
+
+#define RAY_TRACE(event, a, b, c, d, f) \
+    ray_trace_record((event), (int32_t)(a), (int32_t)(b), (int32_t)(c), (int32_t)(d), (float)(f))
+
+#else
+
+#define RAY_TRACE(event, a, b, c, d, f) ((void)0)
+#define ray_trace_dump(path) ((void)0)
+
+#endif /* RAY_ENABLE_TRACE */
+
+#endif /* __LIBMOD_RAY_TRACE_H */
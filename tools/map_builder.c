@@ -1,7 +1,8 @@
 /*
  * Herramienta para crear mapas .raymap desde archivos de texto
  * Compila con: gcc -o map_builder map_builder.c
- * Uso: ./map_builder config.txt output.raymap
+ *   (con deflate: gcc -DRAY_HAVE_ZLIB -o map_builder map_builder.c -lz)
+ * Uso: ./map_builder config.txt output.raymap [raw|rle|deflate] [chunks]
  */
 
 #include <stdio.h>
@@ -9,21 +10,12 @@
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#define RAY_MAPFILE_WRITER
+#include "../libmod_ray_mapfile.h"
 
 #define MAX_LINE 1024
 #define MAX_SPRITES 1000
 
-typedef struct {
-    char magic[8];
-    uint32_t version;
-    uint32_t map_width;
-    uint32_t map_height;
-    uint32_t num_levels;
-    uint32_t num_sprites;
-    uint32_t num_thin_walls;
-    uint32_t num_thick_walls;
-} RAY_MapHeader;
-
 typedef struct {
     float x, y, z;
     int texture_id;
@@ -283,7 +275,10 @@ int read_sprites(const char *filename, SpriteData *sprites, int *count) {
 
 int main(int argc, char *argv[]) {
     if (argc < 3) {
-        printf("Uso: %s <config.txt> <output.raymap>\n", argv[0]);
+        printf("Uso: %s <config.txt> <output.raymap> [raw|rle|deflate] [chunks]\n", argv[0]);
+        printf("\nEl tercer parámetro comprime los grids (por defecto raw)\n");
+        printf("'chunks' guarda los grids en chunks de %dx%d para mapas muy grandes\n",
+               RAY_MAPFILE_CHUNK_SIZE, RAY_MAPFILE_CHUNK_SIZE);
         printf("\nFormato del archivo de configuración:\n");
         printf("  grid0=nivel0.txt\n");
         printf("  grid1=nivel1.txt\n");
@@ -297,6 +292,19 @@ int main(int argc, char *argv[]) {
     const char *config_file = argv[1];
     const char *output_file = argv[2];
     
+    /* Codec de los grids y grids por chunks */
+    uint32_t codec = RAY_MAPFILE_CODEC_RAW;
+    int chunked = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "rle") == 0) codec = RAY_MAPFILE_CODEC_RLE;
+        else if (strcmp(argv[i], "deflate") == 0) codec = RAY_MAPFILE_CODEC_DEFLATE;
+        else if (strcmp(argv[i], "chunks") == 0) chunked = 1;
+        else if (strcmp(argv[i], "raw") != 0) {
+            fprintf(stderr, "Error: Codec desconocido: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    
     /* Obtener directorio del archivo de configuración */
     char config_dir[512];
     get_config_dir(config_file, config_dir, sizeof(config_dir));
@@ -454,13 +462,10 @@ int main(int argc, char *argv[]) {
         read_sprites(sprites_file, sprites, &num_sprites);
     }
     
-    /* Escribir archivo .raymap */
-    /* Eliminar archivo anterior si existe para evitar datos corruptos */
-    remove(output_file);
-    
-    FILE *out = fopen(output_file, "wb");
-    if (!out) {
-        fprintf(stderr, "Error: No se puede crear %s\n", output_file);
+    /* Escribir archivo .raymap (sin cámara: el juego la coloca con RAY_SET_CAMERA) */
+    RAY_MapFileWriter writer;
+    if (!ray_mapfile_writer_init(&writer, width, height, 3, codec)) {
+        fprintf(stderr, "Error: Codec no disponible (deflate necesita -DRAY_HAVE_ZLIB y -lz)\n");
         free(grid0);
         free(grid1);
         free(grid2);
@@ -473,46 +478,46 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    /* Header */
-    RAY_MapHeader header;
-    memcpy(header.magic, "RAYMAP\x1a", 7);
-    header.magic[7] = 0;
-    header.version = 1;
-    header.map_width = width;
-    header.map_height = height;
-    header.num_levels = 3;
-    header.num_sprites = num_sprites;
-    header.num_thin_walls = 0;
-    header.num_thick_walls = 0;
-    
-    fwrite(&header, sizeof(RAY_MapHeader), 1, out);
-    
-    /* Grids */
-    fwrite(grid0, sizeof(int), width * height, out);
-    fwrite(grid1, sizeof(int), width * height, out);
-    fwrite(grid2, sizeof(int), width * height, out);
-    
-    /* Sprites */
+    RAY_MapFileSprite sprite_records[MAX_SPRITES];
     for (int i = 0; i < num_sprites; i++) {
-        fwrite(&sprites[i].texture_id, sizeof(int), 1, out);
-        fwrite(&sprites[i].x, sizeof(float), 1, out);
-        fwrite(&sprites[i].y, sizeof(float), 1, out);
-        fwrite(&sprites[i].z, sizeof(float), 1, out);
-        fwrite(&sprites[i].w, sizeof(int), 1, out);
-        fwrite(&sprites[i].h, sizeof(int), 1, out);
-        fwrite(&sprites[i].level, sizeof(int), 1, out);
-        fwrite(&sprites[i].rot, sizeof(float), 1, out);
+        sprite_records[i].textureID = sprites[i].texture_id;
+        sprite_records[i].x = sprites[i].x;
+        sprite_records[i].y = sprites[i].y;
+        sprite_records[i].z = sprites[i].z;
+        sprite_records[i].w = sprites[i].w;
+        sprite_records[i].h = sprites[i].h;
+        sprite_records[i].level = sprites[i].level;
+        sprite_records[i].rot = sprites[i].rot;
     }
     
-    /* Floor y ceiling - 3 grids de cada uno */
-    for (int level = 0; level < 3; level++) {
-        fwrite(floor_grids[level], sizeof(int), width * height, out);
+    /* Grids, floor y ceiling por nivel (o por chunks), y sprites */
+    uint64_t grid_bytes = (uint64_t)width * height * sizeof(int);
+    const int *grids[3] = { grid0, grid1, grid2 };
+    int chunks_ok = 1;
+    if (chunked) {
+        const void *planes[RAY_MAPFILE_CHUNK_PLANES(3)] = { NULL };
+        for (int level = 0; level < 3; level++) {
+            planes[3 * level] = grids[level];
+            planes[9 + 3 * level] = floor_grids[level];
+            planes[9 + 3 * level + 1] = ceiling_grids[level];
+        }
+        chunks_ok = ray_mapfile_writer_add_chunks(&writer, planes);
+    }
+    for (int level = 0; level < 3 && !chunked; level++) {
+        ray_mapfile_writer_add(&writer, RAY_SECTION_GRID, level,
+                               grids[level], grid_bytes, width * height);
+        ray_mapfile_writer_add(&writer, RAY_SECTION_FLOOR, level,
+                               floor_grids[level], grid_bytes, width * height);
+        ray_mapfile_writer_add(&writer, RAY_SECTION_CEILING, level,
+                               ceiling_grids[level], grid_bytes, width * height);
     }
-    for (int level = 0; level < 3; level++) {
-        fwrite(ceiling_grids[level], sizeof(int), width * height, out);
+    if (num_sprites > 0) {
+        ray_mapfile_writer_add(&writer, RAY_SECTION_SPRITES, 0, sprite_records,
+                               num_sprites * sizeof(RAY_MapFileSprite), num_sprites);
     }
     
-    fclose(out);
+    int written = chunks_ok && ray_mapfile_writer_save(&writer, output_file);
+    ray_mapfile_writer_free(&writer);
     
     /* Limpiar */
     free(grid0);
@@ -525,11 +530,19 @@ int main(int argc, char *argv[]) {
     free(floor_grids);
     free(ceiling_grids);
     
+    if (!written) {
+        fprintf(stderr, "Error: No se pudo escribir %s\n", output_file);
+        return 1;
+    }
+    
     printf("\n=== Mapa creado exitosamente ===\n");
     printf("Archivo: %s\n", output_file);
     printf("Dimensiones: %dx%d\n", width, height);
     printf("Niveles: 3\n");
     printf("Sprites: %d\n", num_sprites);
+    printf("Formato: v%d, %u secciones, grids%s en %s\n", RAY_MAPFILE_VERSION,
+           writer.header.num_sections, chunked ? " por chunks" : "",
+           codec == RAY_MAPFILE_CODEC_RLE ? "rle" : codec == RAY_MAPFILE_CODEC_DEFLATE ? "deflate" : "raw");
     
     return 0;
 }
@@ -69,6 +69,9 @@ void MainWindow::createActions()
     m_saveAsAction->setShortcut(QKeySequence::SaveAs);
     connect(m_saveAsAction, &QAction::triggered, this, &MainWindow::onSaveMapAs);
     
+    m_compressAction = new QAction(tr("&Comprimir Grids al Guardar"), this);
+    m_compressAction->setCheckable(true);
+    
     m_loadTexturesAction = new QAction(tr("Cargar &Texturas FPG..."), this);
     connect(m_loadTexturesAction, &QAction::triggered, this, &MainWindow::onLoadTextures);
     
@@ -96,6 +99,11 @@ void MainWindow::createActions()
     connect(m_zoomResetAction, &QAction::triggered, this, &MainWindow::onZoomReset);
 }
 
+uint32_t MainWindow::saveCodec() const
+{
+    return m_compressAction->isChecked() ? RAY_MAPFILE_CODEC_DEFLATE : RAY_MAPFILE_CODEC_RAW;
+}
+
 void MainWindow::createMenus()
 {
     QMenu *fileMenu = menuBar()->addMenu(tr("&Archivo"));
@@ -103,6 +111,7 @@ void MainWindow::createMenus()
     fileMenu->addAction(m_openAction);
     fileMenu->addAction(m_saveAction);
     fileMenu->addAction(m_saveAsAction);
+    fileMenu->addAction(m_compressAction);
     fileMenu->addSeparator();
     fileMenu->addAction(m_loadTexturesAction);
     fileMenu->addAction(m_exportTextAction);
@@ -361,7 +370,7 @@ void MainWindow::onSaveMap()
         QApplication::processEvents();
     };
     
-    if (RayMapFormat::saveMap(m_currentMapFile, m_mapData, progressCallback)) {
+    if (RayMapFormat::saveMap(m_currentMapFile, m_mapData, progressCallback, saveCodec())) {
         updateStatusBar(QString("Mapa guardado: %1").arg(m_currentMapFile));
     } else {
         QMessageBox::critical(this, tr("Error"),
@@ -387,7 +396,7 @@ void MainWindow::onSaveMapAs()
         QApplication::processEvents();
     };
     
-    if (RayMapFormat::saveMap(filename, m_mapData, progressCallback)) {
+    if (RayMapFormat::saveMap(filename, m_mapData, progressCallback, saveCodec())) {
         m_currentMapFile = filename;
         updateWindowTitle();
         updateStatusBar(QString("Mapa guardado: %1").arg(filename));
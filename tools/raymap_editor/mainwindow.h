@@ -107,12 +107,14 @@ private:
     void createToolbars();
     void createDockWindows();
     void createStatusBar();
+    uint32_t saveCodec() const;
     
     // Actions
     QAction *m_newAction;
     QAction *m_openAction;
     QAction *m_saveAction;
     QAction *m_saveAsAction;
+    QAction *m_compressAction;
     QAction *m_loadTexturesAction;
     QAction *m_exportTextAction;
     QAction *m_exitAction;
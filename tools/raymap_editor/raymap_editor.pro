@@ -40,6 +40,9 @@ FORMS += \
 # Configuración de compilación
 QMAKE_CXXFLAGS += -Wall -Wextra
 
+# zlib: FPG comprimidos y grids deflate del .raymap
+LIBS += -lz
+
 # Default rules for deployment
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
@@ -5,6 +5,7 @@
 #include <QDir>
 #include <QDebug>
 #include <cstring>
+#include <zlib.h>
 
 RayMapFormat::RayMapFormat()
 {
@@ -47,6 +48,14 @@ bool RayMapFormat::loadMap(const QString &filename, MapData &mapData,
         return false;
     }
     
+    // Versión 7: cabecera fija + directorio de secciones
+    if (header.version == RAY_MAPFILE_VERSION) {
+        file.seek(0);
+        QByteArray data = file.readAll();
+        file.close();
+        return loadSectionedMap(data, mapData, progressCallback);
+    }
+    
     // Verificar versión
     if (header.version < 1 || header.version > 4) {
         qWarning() << "Versión no soportada:" << header.version;
@@ -284,7 +293,8 @@ bool RayMapFormat::loadMap(const QString &filename, MapData &mapData,
 }
 
 bool RayMapFormat::saveMap(const QString &filename, const MapData &mapData,
-                           std::function<void(const QString&)> progressCallback)
+                           std::function<void(const QString&)> progressCallback,
+                           uint32_t codec)
 {
     QFile file(filename);
     if (!file.open(QIODevice::WriteOnly)) {
@@ -292,50 +302,52 @@ bool RayMapFormat::saveMap(const QString &filename, const MapData &mapData,
         return false;
     }
     
-    QDataStream out(&file);
-    out.setByteOrder(QDataStream::LittleEndian);
-    
-    // Preparar header (versión 4 - grids por nivel)
-    RAY_MapHeader header;
-    memcpy(header.magic, "RAYMAP\x1a", 7);
-    header.magic[7] = 0;
-    header.version = 4;  // Versión 4 con grids por nivel
+    // Header v7 (libmod_ray_mapfile.h)
+    RAY_MapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RAY_MAPFILE_MAGIC, 8);
+    header.version = RAY_MAPFILE_VERSION;
+    header.header_size = sizeof(RAY_MapFileHeader);
     header.map_width = mapData.width;
     header.map_height = mapData.height;
     header.num_levels = mapData.num_levels;
-    header.num_sprites = mapData.sprites.size();
-    header.num_thin_walls = 0;  // El editor no maneja ThinWalls standalone, solo dentro de ThickWalls
-    header.num_thick_walls = mapData.thickWalls.size();
-    header.num_spawn_flags = mapData.spawnFlags.size();
     header.camera_x = mapData.camera.x;
     header.camera_y = mapData.camera.y;
     header.camera_z = mapData.camera.z;
     header.camera_rot = mapData.camera.rotation;
     header.camera_pitch = mapData.camera.pitch;
     header.skyTextureID = mapData.skyTextureID;
-    
-    // Escribir header - USAR writeRawData para compatibilidad binaria exacta con C
-    out.writeRawData(header.magic, 8);
-    out.writeRawData(reinterpret_cast<const char*>(&header.version), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.map_width), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.map_height), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.num_levels), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.num_sprites), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.num_thin_walls), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.num_thick_walls), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.num_spawn_flags), sizeof(uint32_t));
-    out.writeRawData(reinterpret_cast<const char*>(&header.camera_x), sizeof(float));
-    out.writeRawData(reinterpret_cast<const char*>(&header.camera_y), sizeof(float));
-    out.writeRawData(reinterpret_cast<const char*>(&header.camera_z), sizeof(float));
-    out.writeRawData(reinterpret_cast<const char*>(&header.camera_rot), sizeof(float));
-    out.writeRawData(reinterpret_cast<const char*>(&header.camera_pitch), sizeof(float));
-    out.writeRawData(reinterpret_cast<const char*>(&header.skyTextureID), sizeof(int32_t));
-    
+    header.flags = RAY_MAPFILE_FLAG_CAMERA;
+    
+    QVector<RAY_MapFileSection> entries;
+    QVector<QByteArray> payloads;
+    auto addSection = [&](uint32_t type, uint32_t level, const QByteArray &data, uint32_t count) {
+        RAY_MapFileSection entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.type = type;
+        entry.level = level;
+        entry.count = count;
+        entry.codec = RAY_MAPFILE_CODEC_RAW;
+        
+        // Los grids se comprimen solo si así ocupan menos
+        QByteArray stored = data;
+        if (RAY_MAPFILE_IS_GRID(type) && codec != RAY_MAPFILE_CODEC_RAW) {
+            QByteArray packed = packGrid(data, codec);
+            if (!packed.isEmpty() && packed.size() < data.size()) {
+                entry.codec = codec;
+                stored = packed;
+            }
+        }
+        entry.size = stored.size();
+        entries.append(entry);
+        payloads.append(stored);
+    };
+    auto gridBytes = [](const void *data, int cells) {
+        return QByteArray(reinterpret_cast<const char*>(data), cells * 4);
+    };
     
     if (progressCallback) progressCallback("Guardando grids de paredes...");
     
-    // Escribir grids principales
-    // DEBUG: Contar puertas antes de guardar
     int door_count = 0;
     for (int val : mapData.grid0) if (val >= 1001 && val <= 2000) door_count++;
     for (int val : mapData.grid1) if (val >= 1001 && val <= 2000) door_count++;
@@ -344,104 +356,376 @@ bool RayMapFormat::saveMap(const QString &filename, const MapData &mapData,
         qDebug() << "EDITOR: Guardando" << door_count << "puertas en el mapa";
     }
     
-    // DEBUG: Imprimir primeros valores del grid0 antes de guardar
-    qDebug() << "DEBUG saveMap: grid0 size=" << mapData.grid0.size() << " width=" << mapData.width;
-    qDebug() << "DEBUG saveMap: Primeros 20 valores de grid0:";
-    for (int i = 0; i < 20 && i < mapData.grid0.size(); i++) {
-        qDebug() << "  grid0[" << i << "] =" << mapData.grid0[i];
+    // Grids por nivel: paredes, suelo, techo y altura de suelo
+    const QVector<int> *grids[3] = { &mapData.grid0, &mapData.grid1, &mapData.grid2 };
+    const QVector<int> *floors[3] = { &mapData.floor0, &mapData.floor1, &mapData.floor2 };
+    const QVector<int> *ceilings[3] = { &mapData.ceiling0, &mapData.ceiling1, &mapData.ceiling2 };
+    const QVector<float> *floorHeights[3] = { &mapData.floorHeight0, &mapData.floorHeight1,
+                                              &mapData.floorHeight2 };
+    int cells = mapData.width * mapData.height;
+    for (int level = 0; level < 3; level++) {
+        if (grids[level]->size() == cells)
+            addSection(RAY_SECTION_GRID, level, gridBytes(grids[level]->constData(), cells), cells);
+        if (floors[level]->size() == cells)
+            addSection(RAY_SECTION_FLOOR, level, gridBytes(floors[level]->constData(), cells), cells);
+        if (ceilings[level]->size() == cells)
+            addSection(RAY_SECTION_CEILING, level, gridBytes(ceilings[level]->constData(), cells), cells);
+        if (floorHeights[level]->size() == cells)
+            addSection(RAY_SECTION_FLOOR_HEIGHT, level,
+                       gridBytes(floorHeights[level]->constData(), cells), cells);
     }
     
-    writeGrid(out, mapData.grid0);
-    writeGrid(out, mapData.grid1);
-    writeGrid(out, mapData.grid2);
-    
     if (progressCallback) progressCallback("Guardando sprites...");
     
-    // Escribir sprites
+    QByteArray sprites;
     for (const SpriteData &sprite : mapData.sprites) {
-        out << sprite.texture_id;
-        out << sprite.x;
-        out << sprite.y;
-        out << sprite.z;
-        out << sprite.w;
-        out << sprite.h;
-        out << sprite.level;
-        out << sprite.rot;
+        RAY_MapFileSprite record;
+        record.textureID = sprite.texture_id;
+        record.x = sprite.x;
+        record.y = sprite.y;
+        record.z = sprite.z;
+        record.w = sprite.w;
+        record.h = sprite.h;
+        record.level = sprite.level;
+        record.rot = sprite.rot;
+        sprites.append(reinterpret_cast<const char*>(&record), sizeof(record));
     }
+    addSection(RAY_SECTION_SPRITES, 0, sprites, mapData.sprites.size());
     
-    // Escribir ThickWalls
+    // ThickWalls: mismo formato que en v6, ahora dentro de su sección
+    QByteArray thickWalls;
+    QDataStream tws(&thickWalls, QIODevice::WriteOnly);
+    tws.setByteOrder(QDataStream::LittleEndian);
     for (const ThickWall &tw : mapData.thickWalls) {
-        // Escribir campos básicos - USAR writeRawData para compatibilidad binaria exacta
-        out.writeRawData(reinterpret_cast<const char*>(&tw.type), sizeof(int));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.slopeType), sizeof(int));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.slope), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.x), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.y), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.w), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.h), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.ceilingTextureID), sizeof(int));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.floorTextureID), sizeof(int));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.startHeight), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.endHeight), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&tw.invertedSlope), sizeof(int));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.type), sizeof(int));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.slopeType), sizeof(int));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.slope), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.x), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.y), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.w), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.h), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.ceilingTextureID), sizeof(int));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.floorTextureID), sizeof(int));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.startHeight), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.endHeight), sizeof(float));
+        tws.writeRawData(reinterpret_cast<const char*>(&tw.invertedSlope), sizeof(int));
         
-        // Escribir puntos si es TRIANGLE o QUAD
-        if (tw.type == 2 || tw.type == 3) {  // TRIANGLE o QUAD
-            out << tw.points.size();
+        // Puntos si es TRIANGLE o QUAD
+        if (tw.type == 2 || tw.type == 3) {
+            int32_t numPoints = tw.points.size();
+            tws.writeRawData(reinterpret_cast<const char*>(&numPoints), sizeof(int32_t));
             for (const QPointF &point : tw.points) {
-                out << static_cast<float>(point.x());
-                out << static_cast<float>(point.y());
+                float px = static_cast<float>(point.x());
+                float py = static_cast<float>(point.y());
+                tws.writeRawData(reinterpret_cast<const char*>(&px), sizeof(float));
+                tws.writeRawData(reinterpret_cast<const char*>(&py), sizeof(float));
             }
         }
         
-        // Escribir ThinWalls del ThickWall - USAR writeRawData
-        int numThinWalls = tw.thinWalls.size();
-        out.writeRawData(reinterpret_cast<const char*>(&numThinWalls), sizeof(int));
+        int32_t numThinWalls = tw.thinWalls.size();
+        tws.writeRawData(reinterpret_cast<const char*>(&numThinWalls), sizeof(int32_t));
         for (const ThinWall &thin : tw.thinWalls) {
-            out.writeRawData(reinterpret_cast<const char*>(&thin.x1), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.y1), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.x2), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.y2), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.wallType), sizeof(int));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.horizontal), sizeof(int));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.height), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.z), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.slope), sizeof(float));
-            out.writeRawData(reinterpret_cast<const char*>(&thin.hidden), sizeof(int));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.x1), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.y1), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.x2), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.y2), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.wallType), sizeof(int));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.horizontal), sizeof(int));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.height), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.z), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.slope), sizeof(float));
+            tws.writeRawData(reinterpret_cast<const char*>(&thin.hidden), sizeof(int));
         }
     }
+    addSection(RAY_SECTION_THICK_WALLS, 0, thickWalls, mapData.thickWalls.size());
     
-    qDebug() << "ThickWalls guardados:" << mapData.thickWalls.size();
+    if (progressCallback) progressCallback("Guardando spawn flags...");
     
-    // Escribir floor grids
-    writeGrid(out, mapData.floor0);
-    writeGrid(out, mapData.floor1);
-    writeGrid(out, mapData.floor2);
+    QByteArray flags;
+    for (const SpawnFlag &flag : mapData.spawnFlags) {
+        RAY_MapFileSpawnFlag record;
+        record.flag_id = flag.flagId;
+        record.x = flag.x;
+        record.y = flag.y;
+        record.z = flag.z;
+        record.level = flag.level;
+        flags.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    addSection(RAY_SECTION_SPAWN_FLAGS, 0, flags, mapData.spawnFlags.size());
+    
+    // Offsets alineados para que el motor pueda proyectar el archivo con mmap
+    header.num_sections = entries.size();
+    quint64 offset = RAY_MAPFILE_ALIGN_UP(sizeof(RAY_MapFileHeader) +
+                                          entries.size() * sizeof(RAY_MapFileSection));
+    for (RAY_MapFileSection &entry : entries) {
+        entry.offset = offset;
+        offset = RAY_MAPFILE_ALIGN_UP(offset + entry.size);
+    }
     
-    // Escribir ceiling grids
-    writeGrid(out, mapData.ceiling0);
-    writeGrid(out, mapData.ceiling1);
-    writeGrid(out, mapData.ceiling2);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.constData()),
+               entries.size() * sizeof(RAY_MapFileSection));
+    for (int i = 0; i < entries.size(); i++) {
+        file.write(QByteArray(int(entries[i].offset - file.pos()), '\0'));
+        file.write(payloads[i]);
+    }
     
-    // Escribir floor height grids
-    writeFloatGrid(out, mapData.floorHeight0);
-    writeFloatGrid(out, mapData.floorHeight1);
-    writeFloatGrid(out, mapData.floorHeight2);
+    bool ok = file.error() == QFileDevice::NoError;
+    file.close();
+    qDebug() << "Mapa guardado como versión" << RAY_MAPFILE_VERSION << "con"
+             << entries.size() << "secciones";
+    return ok;
+}
+
+QByteArray RayMapFormat::packGrid(const QByteArray &grid, uint32_t codec)
+{
+    QByteArray packed;
+    if (codec == RAY_MAPFILE_CODEC_RLE) {
+        uint32_t count = grid.size() / 4;
+        packed.resize(RAY_MAPFILE_RLE_BOUND(count) * 4);
+        uint32_t words = ray_mapfile_rle_encode(reinterpret_cast<const uint32_t*>(grid.constData()),
+                                                count, reinterpret_cast<uint32_t*>(packed.data()));
+        packed.resize(words * 4);
+    } else if (codec == RAY_MAPFILE_CODEC_DEFLATE) {
+        uLongf size = compressBound(grid.size());
+        packed.resize(size);
+        if (compress2(reinterpret_cast<Bytef*>(packed.data()), &size,
+                      reinterpret_cast<const Bytef*>(grid.constData()), grid.size(),
+                      Z_BEST_COMPRESSION) != Z_OK) {
+            return QByteArray();
+        }
+        packed.resize(size);
+    }
+    return packed;
+}
+
+bool RayMapFormat::unpackGrid(const char *data, quint64 size, uint32_t codec, void *dst, int cells)
+{
+    if (codec == RAY_MAPFILE_CODEC_RAW) {
+        if (size != (quint64)cells * 4) return false;
+        memcpy(dst, data, size);
+        return true;
+    }
+    if (codec == RAY_MAPFILE_CODEC_RLE) {
+        return ray_mapfile_rle_decode(data, size, static_cast<uint32_t*>(dst), cells);
+    }
+    if (codec == RAY_MAPFILE_CODEC_DEFLATE) {
+        uLongf bytes = cells * 4;
+        return uncompress(static_cast<Bytef*>(dst), &bytes, reinterpret_cast<const Bytef*>(data),
+                          size) == Z_OK && bytes == (uLongf)cells * 4;
+    }
+    return false;
+}
+
+bool RayMapFormat::loadSectionedMap(const QByteArray &data, MapData &mapData,
+                                    std::function<void(const QString&)> progressCallback)
+{
+    RAY_MapFileHeader header;
+    if (data.size() < (int)sizeof(header)) {
+        qWarning() << "Header v7 incompleto";
+        return false;
+    }
+    memcpy(&header, data.constData(), sizeof(header));
     
-    // Escribir spawn flags (versión 3+)
-    if (progressCallback) progressCallback("Guardando spawn flags...");
-    for (const SpawnFlag &flag : mapData.spawnFlags) {
-        out.writeRawData(reinterpret_cast<const char*>(&flag.flagId), sizeof(int));
-        out.writeRawData(reinterpret_cast<const char*>(&flag.x), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&flag.y), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&flag.z), sizeof(float));
-        out.writeRawData(reinterpret_cast<const char*>(&flag.level), sizeof(int));
+    quint64 dirEnd = (quint64)header.header_size + (quint64)header.num_sections * sizeof(RAY_MapFileSection);
+    if (header.header_size < sizeof(header) || dirEnd > (quint64)data.size()) {
+        qWarning() << "Directorio de secciones inválido";
+        return false;
     }
+    const RAY_MapFileSection *entries =
+        reinterpret_cast<const RAY_MapFileSection*>(data.constData() + header.header_size);
+    
+    // Contenido de la sección de ese tipo y nivel (vacío si no está)
+    auto section = [&](uint32_t type, uint32_t level, uint32_t *count) {
+        for (uint32_t i = 0; i < header.num_sections; i++) {
+            const RAY_MapFileSection &e = entries[i];
+            if (e.type != type || e.level != level) continue;
+            if (e.offset > (quint64)data.size() || e.size > (quint64)data.size() - e.offset) break;
+            if (count) *count = e.count;
+            return QByteArray::fromRawData(data.constData() + e.offset, (int)e.size);
+        }
+        if (count) *count = 0;
+        return QByteArray();
+    };
+    
+    qDebug() << "Cargando mapa versión" << header.version << "de tamaño"
+             << header.map_width << "x" << header.map_height
+             << "con" << header.num_sections << "secciones";
+    
+    mapData.camera.enabled = (header.flags & RAY_MAPFILE_FLAG_CAMERA) != 0;
+    mapData.camera.x = header.camera_x;
+    mapData.camera.y = header.camera_y;
+    mapData.camera.z = header.camera_z;
+    mapData.camera.rotation = header.camera_rot;
+    mapData.camera.pitch = header.camera_pitch;
+    mapData.skyTextureID = header.skyTextureID;
     
-    qDebug() << "Spawn flags guardadas:" << mapData.spawnFlags.size();
+    mapData.resize(header.map_width, header.map_height);
+    mapData.num_levels = header.num_levels;
+    int cells = header.map_width * header.map_height;
+    
+    if (progressCallback) progressCallback("Cargando grids...");
+    
+    // Los grids que falten se quedan como los deja resize (a 0)
+    QVector<int> *grids[3] = { &mapData.grid0, &mapData.grid1, &mapData.grid2 };
+    QVector<int> *floors[3] = { &mapData.floor0, &mapData.floor1, &mapData.floor2 };
+    QVector<int> *ceilings[3] = { &mapData.ceiling0, &mapData.ceiling1, &mapData.ceiling2 };
+    QVector<float> *floorHeights[3] = { &mapData.floorHeight0, &mapData.floorHeight1,
+                                        &mapData.floorHeight2 };
+    auto copyGrid = [&](uint32_t type, int level, void *dst) {
+        for (uint32_t i = 0; i < header.num_sections; i++) {
+            const RAY_MapFileSection &e = entries[i];
+            if (e.type != type || (int)e.level != level) continue;
+            if (e.offset > (quint64)data.size() || e.size > (quint64)data.size() - e.offset ||
+                !unpackGrid(data.constData() + e.offset, e.size, e.codec, dst, cells)) {
+                qWarning() << "Sección" << type << "del nivel" << level << "inválida";
+                memset(dst, 0, cells * 4);
+            }
+            return;
+        }
+    };
+    for (int level = 0; level < 3; level++) {
+        grids[level]->fill(0, cells);
+        floors[level]->fill(0, cells);
+        ceilings[level]->fill(0, cells);
+        floorHeights[level]->fill(0.0f, cells);
+        copyGrid(RAY_SECTION_GRID, level, grids[level]->data());
+        copyGrid(RAY_SECTION_FLOOR, level, floors[level]->data());
+        copyGrid(RAY_SECTION_CEILING, level, ceilings[level]->data());
+        copyGrid(RAY_SECTION_FLOOR_HEIGHT, level, floorHeights[level]->data());
+    }
     
-    file.close();
-    qDebug() << "Mapa guardado exitosamente como versión 3";
+    // Mapa por chunks: cada bloque se descomprime y se reparte por los grids
+    // (el editor lo guarda después como un mapa normal)
+    uint32_t numChunks = 0;
+    QByteArray table = section(RAY_SECTION_CHUNKS, 0, &numChunks);
+    if (!table.isEmpty()) {
+        QByteArray blocks = section(RAY_SECTION_CHUNK_DATA, 0, nullptr);
+        int chunksX = RAY_MAPFILE_CHUNKS(header.map_width);
+        int chunksY = RAY_MAPFILE_CHUNKS(header.map_height);
+        int planes = RAY_MAPFILE_CHUNK_PLANES(header.num_levels);
+        if (numChunks != (uint32_t)(chunksX * chunksY) || header.num_levels > 3 ||
+            (quint64)table.size() < (quint64)numChunks * sizeof(RAY_MapFileChunk)) {
+            qWarning() << "Directorio de chunks inválido";
+            return false;
+        }
+        
+        if (progressCallback) progressCallback("Descomprimiendo chunks...");
+        QVector<int> block(planes * RAY_MAPFILE_CHUNK_CELLS);
+        for (uint32_t c = 0; c < numChunks; c++) {
+            RAY_MapFileChunk entry;
+            memcpy(&entry, table.constData() + c * sizeof(RAY_MapFileChunk), sizeof(entry));
+            if (entry.offset > (quint64)blocks.size() || entry.size > (quint64)blocks.size() - entry.offset ||
+                !unpackGrid(blocks.constData() + entry.offset, entry.size, entry.codec,
+                            block.data(), block.size())) {
+                qWarning() << "Chunk" << c << "inválido";
+                continue;
+            }
+            
+            // Planos del bloque: paredes, altura y Z-offset por nivel y después
+            // suelo, techo y altura de suelo de los niveles 0-2
+            void *dst[RAY_MAPFILE_CHUNK_PLANES(3)] = { nullptr };
+            for (int level = 0; level < 3; level++) {
+                if (level < (int)header.num_levels) dst[3 * level] = grids[level]->data();
+                dst[3 * header.num_levels + 3 * level] = floors[level]->data();
+                dst[3 * header.num_levels + 3 * level + 1] = ceilings[level]->data();
+                dst[3 * header.num_levels + 3 * level + 2] = floorHeights[level]->data();
+            }
+            int x0 = (c % chunksX) * RAY_MAPFILE_CHUNK_SIZE;
+            int y0 = (c / chunksX) * RAY_MAPFILE_CHUNK_SIZE;
+            int w = qMin(RAY_MAPFILE_CHUNK_SIZE, (int)header.map_width - x0);
+            int h = qMin(RAY_MAPFILE_CHUNK_SIZE, (int)header.map_height - y0);
+            for (int p = 0; p < planes && p < RAY_MAPFILE_CHUNK_PLANES(3); p++) {
+                if (!dst[p]) continue;
+                const int *src = block.constData() + p * RAY_MAPFILE_CHUNK_CELLS;
+                for (int y = 0; y < h; y++) {
+                    memcpy(static_cast<int*>(dst[p]) + (y0 + y) * header.map_width + x0,
+                           src + y * RAY_MAPFILE_CHUNK_SIZE, w * 4);
+                }
+            }
+        }
+    }
+    
+    if (progressCallback) progressCallback("Cargando sprites...");
+    
+    uint32_t count = 0;
+    QByteArray bytes = section(RAY_SECTION_SPRITES, 0, &count);
+    mapData.sprites.clear();
+    for (uint32_t i = 0; i < count && (i + 1) * sizeof(RAY_MapFileSprite) <= (quint64)bytes.size(); i++) {
+        RAY_MapFileSprite record;
+        memcpy(&record, bytes.constData() + i * sizeof(record), sizeof(record));
+        SpriteData sprite;
+        sprite.texture_id = record.textureID;
+        sprite.x = record.x;
+        sprite.y = record.y;
+        sprite.z = record.z;
+        sprite.w = record.w;
+        sprite.h = record.h;
+        sprite.level = record.level;
+        sprite.rot = record.rot;
+        mapData.sprites.append(sprite);
+    }
+    
+    bytes = section(RAY_SECTION_THICK_WALLS, 0, &count);
+    QDataStream in(bytes);
+    in.setByteOrder(QDataStream::LittleEndian);
+    mapData.thickWalls.clear();
+    for (uint32_t i = 0; i < count && !in.atEnd(); i++) {
+        ThickWall tw;
+        in.readRawData(reinterpret_cast<char*>(&tw.type), sizeof(int));
+        in.readRawData(reinterpret_cast<char*>(&tw.slopeType), sizeof(int));
+        in.readRawData(reinterpret_cast<char*>(&tw.slope), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.x), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.y), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.w), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.h), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.ceilingTextureID), sizeof(int));
+        in.readRawData(reinterpret_cast<char*>(&tw.floorTextureID), sizeof(int));
+        in.readRawData(reinterpret_cast<char*>(&tw.startHeight), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.endHeight), sizeof(float));
+        in.readRawData(reinterpret_cast<char*>(&tw.invertedSlope), sizeof(int));
+        
+        if (tw.type == 2 || tw.type == 3) {
+            int32_t numPoints = 0;
+            in.readRawData(reinterpret_cast<char*>(&numPoints), sizeof(int32_t));
+            for (int p = 0; p < numPoints && !in.atEnd(); p++) {
+                float px = 0, py = 0;
+                in.readRawData(reinterpret_cast<char*>(&px), sizeof(float));
+                in.readRawData(reinterpret_cast<char*>(&py), sizeof(float));
+                tw.points.append(QPointF(px, py));
+            }
+        }
+        
+        int32_t numThinWalls = 0;
+        in.readRawData(reinterpret_cast<char*>(&numThinWalls), sizeof(int32_t));
+        for (int t = 0; t < numThinWalls && !in.atEnd(); t++) {
+            ThinWall thin;
+            in.readRawData(reinterpret_cast<char*>(&thin.x1), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.y1), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.x2), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.y2), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.wallType), sizeof(int));
+            in.readRawData(reinterpret_cast<char*>(&thin.horizontal), sizeof(int));
+            in.readRawData(reinterpret_cast<char*>(&thin.height), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.z), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.slope), sizeof(float));
+            in.readRawData(reinterpret_cast<char*>(&thin.hidden), sizeof(int));
+            tw.thinWalls.append(thin);
+        }
+        mapData.thickWalls.append(tw);
+    }
+    
+    bytes = section(RAY_SECTION_SPAWN_FLAGS, 0, &count);
+    mapData.spawnFlags.clear();
+    for (uint32_t i = 0; i < count && (i + 1) * sizeof(RAY_MapFileSpawnFlag) <= (quint64)bytes.size(); i++) {
+        RAY_MapFileSpawnFlag record;
+        memcpy(&record, bytes.constData() + i * sizeof(record), sizeof(record));
+        mapData.spawnFlags.append(SpawnFlag(record.flag_id, record.x, record.y, record.z, record.level));
+    }
+    
+    qDebug() << "Mapa cargado:" << mapData.sprites.size() << "sprites,"
+             << mapData.thickWalls.size() << "ThickWalls,"
+             << mapData.spawnFlags.size() << "spawn flags";
     return true;
 }
 
@@ -502,14 +786,6 @@ bool RayMapFormat::readGrid(QDataStream &in, QVector<int> &grid, int width, int
     return bytesRead == size * sizeof(int);
 }
 
-bool RayMapFormat::writeGrid(QDataStream &out, const QVector<int> &grid)
-{
-    // Escribir como datos raw para compatibilidad binaria exacta con C
-    int bytesWritten = out.writeRawData(reinterpret_cast<const char*>(grid.data()), grid.size() * sizeof(int));
-    
-    return bytesWritten == grid.size() * sizeof(int);
-}
-
 bool RayMapFormat::readFloatGrid(QDataStream &in, QVector<float> &grid, int width, int height)
 {
     int size = width * height;
@@ -520,11 +796,3 @@ bool RayMapFormat::readFloatGrid(QDataStream &in, QVector<float> &grid, int widt
     
     return bytesRead == size * sizeof(float);
 }
-
-bool RayMapFormat::writeFloatGrid(QDataStream &out, const QVector<float> &grid)
-{
-    // Escribir como datos raw para compatibilidad con C
-    int bytesWritten = out.writeRawData(reinterpret_cast<const char*>(grid.data()), grid.size() * sizeof(float));
-    
-    return bytesWritten == grid.size() * sizeof(float);
-}
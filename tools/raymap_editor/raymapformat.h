@@ -2,9 +2,11 @@
 #define RAYMAPFORMAT_H
 
 #include <QString>
+#include <QByteArray>
 #include <cstdint>
 #include <functional>
 #include "mapdata.h"
+#include "../../libmod_ray_mapfile.h"
 
 // Header del formato .raymap
 struct RAY_MapHeader {
@@ -32,13 +34,15 @@ class RayMapFormat
 public:
     RayMapFormat();
     
-    // Cargar mapa desde archivo .raymap (soporta v1 y v2)
+    // Cargar mapa desde archivo .raymap (v1 a v4 y v7)
     static bool loadMap(const QString &filename, MapData &mapData,
                        std::function<void(const QString&)> progressCallback = nullptr);
     
-    // Guardar mapa a archivo .raymap (versión 4)
+    // Guardar mapa a archivo .raymap (versión 7, ver libmod_ray_mapfile.h).
+    // Con codec RLE o DEFLATE los grids que ocupen menos se guardan comprimidos
     static bool saveMap(const QString &filename, const MapData &mapData,
-                       std::function<void(const QString&)> progressCallback = nullptr);
+                       std::function<void(const QString&)> progressCallback = nullptr,
+                       uint32_t codec = RAY_MAPFILE_CODEC_RAW);
     
     // Exportar a formato de texto (CSV)
     static bool exportToText(const QString &directory, const MapData &mapData);
@@ -47,10 +51,12 @@ public:
     static bool importFromText(const QString &configFile, MapData &mapData);
     
 private:
+    static QByteArray packGrid(const QByteArray &grid, uint32_t codec);
+    static bool unpackGrid(const char *data, quint64 size, uint32_t codec, void *dst, int cells);
+    static bool loadSectionedMap(const QByteArray &data, MapData &mapData,
+                                 std::function<void(const QString&)> progressCallback);
     static bool readGrid(QDataStream &in, QVector<int> &grid, int width, int height);
-    static bool writeGrid(QDataStream &out, const QVector<int> &grid);
     static bool readFloatGrid(QDataStream &in, QVector<float> &grid, int width, int height);
-    static bool writeFloatGrid(QDataStream &out, const QVector<float> &grid);
 };
 
 #endif // RAYMAPFORMAT_H
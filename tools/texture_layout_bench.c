@@ -0,0 +1,223 @@
+/*
+ * texture_layout_bench.c - Benchmark de layout de texturas de pared
+ *
+ * Compara el muestreo de strips de pared (texture_x fijo, texture_y
+ * recorriendo la columna de arriba a abajo) sobre texturas guardadas por
+ * filas (layout del FPG) y sobre la copia traspuesta por columnas que usa
+ * la texture cache de libmod_ray.
+ *
+ * En Linux mide fallos de caché L1D y de último nivel con perf_event_open;
+ * si el kernel no lo permite (perf_event_paranoid, contenedores) muestra
+ * solo tiempos.
+ *
+ * Compilación:
+ *   gcc -O2 -o texture_layout_bench texture_layout_bench.c
+ * Uso:
+ *   ./texture_layout_bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define SCREEN_W 1280
+#define SCREEN_H 720
+#define NUM_TEXTURES 32
+
+/* ============================================================================
+   CONTADORES DE CACHÉ
+   ============================================================================ */
+
+typedef struct {
+    int fd_l1d;
+    int fd_llc;
+} Counters;
+
+#ifdef __linux__
+static int perf_open(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counters_open(Counters *c)
+{
+    c->fd_l1d = perf_open(PERF_TYPE_HW_CACHE,
+                          PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    c->fd_llc = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+}
+
+static void counters_start(Counters *c)
+{
+    if (c->fd_l1d >= 0) { ioctl(c->fd_l1d, PERF_EVENT_IOC_RESET, 0); ioctl(c->fd_l1d, PERF_EVENT_IOC_ENABLE, 0); }
+    if (c->fd_llc >= 0) { ioctl(c->fd_llc, PERF_EVENT_IOC_RESET, 0); ioctl(c->fd_llc, PERF_EVENT_IOC_ENABLE, 0); }
+}
+
+static long long counter_read(int fd)
+{
+    long long value = -1;
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &value, sizeof(value)) != sizeof(value)) return -1;
+    return value;
+}
+
+static void counters_stop(Counters *c, long long *l1d, long long *llc)
+{
+    *l1d = counter_read(c->fd_l1d);
+    *llc = counter_read(c->fd_llc);
+}
+
+static void counters_close(Counters *c)
+{
+    if (c->fd_l1d >= 0) close(c->fd_l1d);
+    if (c->fd_llc >= 0) close(c->fd_llc);
+}
+#else
+static void counters_open(Counters *c) { c->fd_l1d = c->fd_llc = -1; }
+static void counters_start(Counters *c) { (void)c; }
+static void counters_stop(Counters *c, long long *l1d, long long *llc) { (void)c; *l1d = *llc = -1; }
+static void counters_close(Counters *c) { (void)c; }
+#endif
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* ============================================================================
+   ESCENA SINTÉTICA
+   Un strip por columna de pantalla con textura, texture_x y altura
+   pseudoaleatorias pero deterministas (mismo recorrido en ambos layouts).
+   ============================================================================ */
+
+typedef struct {
+    int texture;
+    int texture_x;
+    int height;
+} Strip;
+
+static uint32_t rng_state = 12345;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static void build_strips(Strip *strips, int size)
+{
+    for (int x = 0; x < SCREEN_W; x++) {
+        strips[x].texture = rng_next() % NUM_TEXTURES;
+        strips[x].texture_x = rng_next() % size;
+        strips[x].height = 64 + rng_next() % (SCREEN_H * 2);
+    }
+}
+
+/* Mismo bucle que ray_draw_wall_strip, solo cambia cómo se direcciona el texel */
+static void draw_frame(uint32_t *fb, uint32_t **textures, const Strip *strips, int size, int column_major)
+{
+    for (int x = 0; x < SCREEN_W; x++) {
+        const Strip *s = &strips[x];
+        const uint32_t *tex = textures[s->texture];
+        int screen_y = (SCREEN_H - s->height) / 2;
+        int y_start = screen_y < 0 ? 0 : screen_y;
+        int y_end = screen_y + s->height;
+        if (y_end > SCREEN_H) y_end = SCREEN_H;
+
+        const uint32_t *column = tex + (size_t)s->texture_x * size;
+        uint32_t *dst = fb + (size_t)y_start * SCREEN_W + x;
+        for (int y = y_start; y < y_end; y++, dst += SCREEN_W) {
+            int texture_y = (int)(((float)(y - screen_y) / s->height) * size);
+            if (texture_y >= size) texture_y = size - 1;
+            *dst = column_major ? column[texture_y]
+                                : tex[(size_t)texture_y * size + s->texture_x];
+        }
+    }
+}
+
+static void run(int size, int frames, Counters *counters)
+{
+    uint32_t *rows[NUM_TEXTURES];
+    uint32_t *cols[NUM_TEXTURES];
+    for (int t = 0; t < NUM_TEXTURES; t++) {
+        rows[t] = (uint32_t*)malloc((size_t)size * size * sizeof(uint32_t));
+        cols[t] = (uint32_t*)malloc((size_t)size * size * sizeof(uint32_t));
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                uint32_t texel = 0xFF000000u | (uint32_t)(t * 7919 + y * size + x);
+                rows[t][(size_t)y * size + x] = texel;
+                cols[t][(size_t)x * size + y] = texel;
+            }
+        }
+    }
+
+    Strip *strips = (Strip*)malloc(SCREEN_W * sizeof(Strip));
+    uint32_t *fb = (uint32_t*)calloc((size_t)SCREEN_W * SCREEN_H, sizeof(uint32_t));
+    build_strips(strips, size);
+
+    for (int layout = 0; layout < 2; layout++) {
+        uint32_t **textures = layout ? cols : rows;
+        long long l1d, llc;
+
+        draw_frame(fb, textures, strips, size, layout);  /* calentar */
+        counters_start(counters);
+        double t0 = now_ms();
+        for (int f = 0; f < frames; f++) {
+            draw_frame(fb, textures, strips, size, layout);
+        }
+        double t1 = now_ms();
+        counters_stop(counters, &l1d, &llc);
+
+        printf("%4dx%-4d %-13s %9.3f ms/frame", size, size,
+               layout ? "column-major" : "row-major", (t1 - t0) / frames);
+        if (l1d >= 0) printf("  L1D miss/frame %10lld", l1d / frames);
+        if (llc >= 0) printf("  LLC miss/frame %9lld", llc / frames);
+        printf("\n");
+    }
+
+    for (int t = 0; t < NUM_TEXTURES; t++) {
+        free(rows[t]);
+        free(cols[t]);
+    }
+    free(strips);
+    free(fb);
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+    if (frames <= 0) frames = 200;
+
+    Counters counters;
+    counters_open(&counters);
+    if (counters.fd_l1d < 0 && counters.fd_llc < 0) {
+        printf("(perf_event_open no disponible: solo tiempos)\n");
+    }
+
+    printf("%dx%d, %d texturas, %d frames\n", SCREEN_W, SCREEN_H, NUM_TEXTURES, frames);
+    run(128, frames, &counters);
+    run(256, frames, &counters);
+
+    counters_close(&counters);
+    return 0;
+}